@@ -3,6 +3,7 @@ import re
 import os
 import subprocess
 import sys
+import fnmatch
 import timeit
 import tempfile
 import shutil
@@ -79,7 +80,9 @@ def error_abort(msg):
               required=False, envvar='LEGACY_CASMI')
 @click.option('--casm-compiler', help='Path to the CASM compiler.',
               required=False, envvar='CASM_COMPILER')
-def main(new_casmi, legacy_casmi, casm_compiler):
+@click.option('--pattern', help='Only run benchmarks matching the pattern (e.g. `*_large.casm`).',
+              default='*.casm')
+def main(new_casmi, legacy_casmi, casm_compiler, pattern):
     vms = []
 
     if not os.path.exists(new_casmi):
@@ -101,6 +104,7 @@ def main(new_casmi, legacy_casmi, casm_compiler):
     for root, dirs, files in os.walk(bench_path):
         for bench_file in files:
             if not bench_file.endswith(".casm"): continue
+            if not fnmatch.fnmatch(bench_file, pattern): continue
             #click.echo("Running benchmark %s" % os.path.join(os.path.split(root)[1], bench_file))
 
             results = {}
@@ -50,10 +50,10 @@ def create_dispatch_define(builtins):
         lines.append("case BuiltinAtom::Id::{}:".format(b[0].upper()))
         for arg in b[2:]:
             lines.append("  arg{0:} = {{ (uint64_t) arguments[{0:}].value.integer,".format(str(arg_ind))+
-                         " (uint8_t)!arguments[{0:}].is_symbolic(), 0 }};".format(str(arg_ind)))
+                         " (uint8_t)!(Mode::symbolic && arguments[{0:}].is_symbolic()), 0 }};".format(str(arg_ind)))
             arg_ind += 1
 
-        lines.append("  if (ctxt.symbolic) {")
+        lines.append("  if (Mode::symbolic) {")
         lines.append("    {}(&ret, ".format("symbolic::symbolic_"+b[0])+", ".join(["&arg"+str(i) for i in range(0, arg_ind)])+");")
         lines.append("    sym_name = \"{}\";".format(b[0].replace("BV", "")))
         lines.append("  } else {")
@@ -69,14 +69,17 @@ def create_dispatch_define(builtins):
 
 
 if __name__ == '__main__':
+    # usage: shared_glue.py OUTPUT [SHARED_HEADER], without the header of
+    # the CASM runtime no shared builtins are defined
     builtins = []
-    with open(sys.argv[1]) as f:
-        builtins = [
-            [match.group(1)]+arg_re.findall(match.group(2)) 
-                        for match in builtin_re.finditer(f.read())
-        ]
-
-    with open(sys.argv[2], "wt") as f:
+    if len(sys.argv) > 2:
+        with open(sys.argv[2]) as f:
+            builtins = [
+                [match.group(1)]+arg_re.findall(match.group(2)) 
+                            for match in builtin_re.finditer(f.read())
+            ]
+
+    with open(sys.argv[1], "wt") as f:
         res = create_typecheck_defines(builtins)
         res += create_dispatch_define(builtins)
         f.write(res)
@@ -24,6 +24,11 @@ HR = '-' * 65
 
 CMDLINE_RE = re.compile("// cmdline \"(.*)\"")
 
+# options passed to the interpreter in every test of run-pass, run-fail and
+# symbolic; --ast-walker runs the tests on the AST walker instead of the
+# bytecode VM
+extra_options = []
+
 def get_options(filename):
     with open(filename, "rt") as f:
         lines = f.readlines()
@@ -58,7 +63,7 @@ def test_symbolic(filename):
     short_filename = filename
     sys.stdout.write('\t[symbolic] '+short_filename)
     sys.stdout.flush()
-    p1 = subprocess.Popen([test_exe,]+get_options(filename)+[filename,]+["-s"],
+    p1 = subprocess.Popen([test_exe,]+extra_options+get_options(filename)+[filename,]+["-s"],
                           stderr=subprocess.PIPE, stdout=subprocess.PIPE)
     (stdout, err) = p1.communicate()
     expected_path = filename.rsplit(".", 1)[0] + '.expected'
@@ -91,7 +96,7 @@ def test_run_pass(filename):
     short_filename = filename.replace(RUN_PASS_PATH, '')
     sys.stdout.write('\t[run-pass] '+short_filename)
     sys.stdout.flush()
-    p1 = subprocess.Popen([test_exe,]+get_options(filename)+[filename,],
+    p1 = subprocess.Popen([test_exe,]+extra_options+get_options(filename)+[filename,],
                           stderr=subprocess.PIPE, stdout=subprocess.PIPE)
     (stdout, err) = p1.communicate()
     expected_path = filename.rsplit(".", 1)[0] + '.expected'
@@ -145,7 +150,7 @@ def test_run_fail(filename):
                 expected_errors[line_number-line_offset] = errors
             line_number += 1
 
-    p1 = subprocess.Popen([test_exe, filename], stderr=subprocess.PIPE)
+    p1 = subprocess.Popen([test_exe,]+extra_options+[filename,], stderr=subprocess.PIPE)
     err = p1.communicate()[1]
     err = err.decode(encoding='UTF-8')
 
@@ -230,10 +235,15 @@ def run_symbolic():
 
 
 if __name__ == '__main__':
-    if len(sys.argv) == 1:
+    args = sys.argv[1:]
+    if "--ast-walker" in args:
+        args.remove("--ast-walker")
+        extra_options.append("--ast-walker")
+
+    if len(args) == 0:
         test_runners = [run_existing_tests, run_run_pass, run_run_fail, run_symbolic]
-    elif len(sys.argv) == 2:
-        if sys.argv[1] == "symbolic":
+    elif len(args) == 1:
+        if args[0] == "symbolic":
             test_runners = [run_symbolic]
         else:
             print("invalid arg")
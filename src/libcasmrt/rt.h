@@ -1,16 +0,0 @@
-#ifndef CASMI_LIBRT_RT
-#define CASMI_LIBRT_RT
-
-IGNORE_VARIADIC_WARNINGS
-
-#include "libcasmrt/pp_casm_misc.h"
-#include "libcasmrt/pp_hashmap.h"
-#include "libcasmrt/pp_casm_updateset_linkedhash.h"
-
-#define CASM_DBG 0
-
-CASM_UPDATE_TYPE(4);
-
-REENABLE_VARIADIC_WARNINGS
-
-#endif //CASMI_LIBRT_RT
@@ -0,0 +1,367 @@
+#include <algorithm>
+
+#include "libutil/exceptions.h"
+
+#include "libinterpreter/bigint.h"
+
+static void trim(std::vector<uint32_t>& mag) {
+  while (!mag.empty() && mag.back() == 0) {
+    mag.pop_back();
+  }
+}
+
+static int compare_magnitude(const std::vector<uint32_t>& lhs,
+                             const std::vector<uint32_t>& rhs) {
+  if (lhs.size() != rhs.size()) {
+    return (lhs.size() < rhs.size()) ? -1 : 1;
+  }
+  for (size_t i = lhs.size(); i > 0; i--) {
+    if (lhs[i-1] != rhs[i-1]) {
+      return (lhs[i-1] < rhs[i-1]) ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+static std::vector<uint32_t> add_magnitude(const std::vector<uint32_t>& lhs,
+                                           const std::vector<uint32_t>& rhs) {
+  const std::vector<uint32_t>& longer = (lhs.size() < rhs.size()) ? rhs : lhs;
+  const std::vector<uint32_t>& shorter = (lhs.size() < rhs.size()) ? lhs : rhs;
+  std::vector<uint32_t> result(longer.size() + 1);
+  uint64_t carry = 0;
+  for (size_t i = 0; i < longer.size(); i++) {
+    carry += longer[i];
+    if (i < shorter.size()) {
+      carry += shorter[i];
+    }
+    result[i] = (uint32_t) carry;
+    carry >>= 32;
+  }
+  result[longer.size()] = (uint32_t) carry;
+  trim(result);
+  return result;
+}
+
+// lhs must not be smaller than rhs
+static std::vector<uint32_t> sub_magnitude(const std::vector<uint32_t>& lhs,
+                                           const std::vector<uint32_t>& rhs) {
+  std::vector<uint32_t> result(lhs.size());
+  int64_t borrow = 0;
+  for (size_t i = 0; i < lhs.size(); i++) {
+    int64_t diff = (int64_t) lhs[i] - borrow;
+    if (i < rhs.size()) {
+      diff -= rhs[i];
+    }
+    borrow = (diff < 0) ? 1 : 0;
+    result[i] = (uint32_t) (diff + (borrow << 32));
+  }
+  trim(result);
+  return result;
+}
+
+// divides mag in place and returns the remainder
+static uint32_t divide_small(std::vector<uint32_t>& mag, uint32_t divisor) {
+  uint64_t rem = 0;
+  for (size_t i = mag.size(); i > 0; i--) {
+    uint64_t cur = (rem << 32) | mag[i-1];
+    mag[i-1] = (uint32_t) (cur / divisor);
+    rem = cur % divisor;
+  }
+  trim(mag);
+  return (uint32_t) rem;
+}
+
+static void divide_magnitude(const std::vector<uint32_t>& lhs,
+                             const std::vector<uint32_t>& rhs,
+                             std::vector<uint32_t>& quotient,
+                             std::vector<uint32_t>& remainder) {
+  if (rhs.size() == 1) {
+    quotient = lhs;
+    uint32_t rem = divide_small(quotient, rhs[0]);
+    remainder.clear();
+    if (rem != 0) {
+      remainder.push_back(rem);
+    }
+    return;
+  }
+
+  // shift and subtract, one bit at a time
+  quotient.assign(lhs.size(), 0);
+  remainder.clear();
+  for (size_t i = lhs.size() * 32; i > 0; i--) {
+    const size_t bit = i - 1;
+    // remainder = remainder * 2 + bit of lhs
+    uint32_t carry = (lhs[bit / 32] >> (bit % 32)) & 1;
+    for (size_t j = 0; j < remainder.size(); j++) {
+      uint32_t next = remainder[j] >> 31;
+      remainder[j] = (remainder[j] << 1) | carry;
+      carry = next;
+    }
+    if (carry) {
+      remainder.push_back(carry);
+    }
+    if (compare_magnitude(remainder, rhs) >= 0) {
+      remainder = sub_magnitude(remainder, rhs);
+      quotient[bit / 32] |= UINT32_C(1) << (bit % 32);
+    }
+  }
+  trim(quotient);
+}
+
+bigint_t::bigint_t() : negative(false) {}
+
+bigint_t::bigint_t(INT_T v) : negative(v < 0) {
+  uint64_t mag = (v < 0) ? -(uint64_t) v : (uint64_t) v;
+  magnitude.push_back((uint32_t) mag);
+  magnitude.push_back((uint32_t) (mag >> 32));
+  trim(magnitude);
+}
+
+bool bigint_t::fits_int() const {
+  if (magnitude.size() > 2) {
+    return false;
+  }
+  uint64_t mag = 0;
+  for (size_t i = magnitude.size(); i > 0; i--) {
+    mag = (mag << 32) | magnitude[i-1];
+  }
+  return mag <= (uint64_t) INT64_MAX || (negative && mag == (uint64_t) INT64_MAX + 1);
+}
+
+INT_T bigint_t::to_int() const {
+  uint64_t mag = 0;
+  for (size_t i = std::min<size_t>(magnitude.size(), 2); i > 0; i--) {
+    mag = (mag << 32) | magnitude[i-1];
+  }
+  return (INT_T) (negative ? -mag : mag);
+}
+
+FLOAT_T bigint_t::to_float() const {
+  FLOAT_T result = 0;
+  for (size_t i = magnitude.size(); i > 0; i--) {
+    result = result * 4294967296.0 + magnitude[i-1];
+  }
+  return negative ? -result : result;
+}
+
+bool bigint_t::operator==(const bigint_t& other) const {
+  return negative == other.negative && magnitude == other.magnitude;
+}
+
+int bigint_t::compare(const bigint_t& other) const {
+  if (negative != other.negative) {
+    return negative ? -1 : 1;
+  }
+  int cmp = compare_magnitude(magnitude, other.magnitude);
+  return negative ? -cmp : cmp;
+}
+
+const bigint_t bigint_t::operator+(const bigint_t& other) const {
+  bigint_t result;
+  if (negative == other.negative) {
+    result.magnitude = add_magnitude(magnitude, other.magnitude);
+    result.negative = negative;
+  } else if (compare_magnitude(magnitude, other.magnitude) >= 0) {
+    result.magnitude = sub_magnitude(magnitude, other.magnitude);
+    result.negative = negative;
+  } else {
+    result.magnitude = sub_magnitude(other.magnitude, magnitude);
+    result.negative = other.negative;
+  }
+  if (result.is_zero()) {
+    result.negative = false;
+  }
+  return result;
+}
+
+const bigint_t bigint_t::operator-(const bigint_t& other) const {
+  bigint_t negated(other);
+  if (!negated.is_zero()) {
+    negated.negative = !negated.negative;
+  }
+  return *this + negated;
+}
+
+const bigint_t bigint_t::operator*(const bigint_t& other) const {
+  bigint_t result;
+  if (is_zero() || other.is_zero()) {
+    return result;
+  }
+  result.magnitude.assign(magnitude.size() + other.magnitude.size(), 0);
+  for (size_t i = 0; i < magnitude.size(); i++) {
+    uint64_t carry = 0;
+    for (size_t j = 0; j < other.magnitude.size(); j++) {
+      carry += (uint64_t) magnitude[i] * other.magnitude[j] + result.magnitude[i+j];
+      result.magnitude[i+j] = (uint32_t) carry;
+      carry >>= 32;
+    }
+    result.magnitude[i + other.magnitude.size()] = (uint32_t) carry;
+  }
+  trim(result.magnitude);
+  result.negative = negative != other.negative;
+  return result;
+}
+
+const bigint_t bigint_t::operator/(const bigint_t& other) const {
+  if (other.is_zero()) {
+    throw RuntimeException("division by zero");
+  }
+  bigint_t quotient;
+  std::vector<uint32_t> remainder;
+  divide_magnitude(magnitude, other.magnitude, quotient.magnitude, remainder);
+  quotient.negative = !quotient.is_zero() && negative != other.negative;
+  return quotient;
+}
+
+const bigint_t bigint_t::operator%(const bigint_t& other) const {
+  if (other.is_zero()) {
+    throw RuntimeException("division by zero");
+  }
+  std::vector<uint32_t> quotient;
+  bigint_t remainder;
+  divide_magnitude(magnitude, other.magnitude, quotient, remainder.magnitude);
+  // the remainder has the sign of the dividend, like for INT_T
+  remainder.negative = !remainder.is_zero() && negative;
+  return remainder;
+}
+
+const std::string bigint_t::to_str(unsigned int base) const {
+  if (is_zero()) {
+    return "0";
+  }
+  static const char digits[] = "0123456789abcdef";
+  // convert chunks of several digits at once
+  uint32_t chunk = base;
+  size_t chunk_digits = 1;
+  while ((uint64_t) chunk * base <= UINT32_MAX) {
+    chunk *= base;
+    chunk_digits += 1;
+  }
+
+  std::string result;
+  std::vector<uint32_t> mag(magnitude);
+  while (!mag.empty()) {
+    uint32_t rem = divide_small(mag, chunk);
+    for (size_t i = 0; i < chunk_digits && (rem > 0 || !mag.empty()); i++) {
+      result.push_back(digits[rem % base]);
+      rem /= base;
+    }
+  }
+  if (negative) {
+    result.push_back('-');
+  }
+  std::reverse(result.begin(), result.end());
+  return result;
+}
+
+namespace bigint {
+  bool enabled = false;
+
+  const InternedBigInt *boxed(INT_T v) {
+    return reinterpret_cast<const InternedBigInt*>(((uint64_t) v - (uint64_t) INT64_MIN) << 3);
+  }
+
+  const bigint_t get(INT_T v) {
+    if (is_boxed(v)) {
+      return *boxed(v);
+    }
+    return bigint_t(v);
+  }
+
+  const value_t make(const bigint_t& val) {
+    if (val.fits_int()) {
+      const INT_T v = val.to_int();
+      if (v >= BOXED_LIMIT) {
+        return value_t(v);
+      }
+    }
+    // interned entries are allocated with new and at least 8 byte aligned
+    const uint64_t ptr = reinterpret_cast<uint64_t>(InternedBigInt::intern(val));
+    return value_t((INT_T) ((ptr >> 3) + (uint64_t) INT64_MIN));
+  }
+
+  const value_t add_slow(INT_T lhs, INT_T rhs) {
+    return make(get(lhs) + get(rhs));
+  }
+
+  const value_t sub_slow(INT_T lhs, INT_T rhs) {
+    return make(get(lhs) - get(rhs));
+  }
+
+  const value_t mul_slow(INT_T lhs, INT_T rhs) {
+    return make(get(lhs) * get(rhs));
+  }
+
+  const value_t div(INT_T lhs, INT_T rhs) {
+    if (rhs == 0) {
+      throw RuntimeException("division by zero");
+    }
+    if (lhs < BOXED_LIMIT || rhs < BOXED_LIMIT || rhs == -1) {
+      return make(get(lhs) / get(rhs));
+    }
+    return value_t(lhs / rhs);
+  }
+
+  const value_t mod(INT_T lhs, INT_T rhs) {
+    if (rhs == 0) {
+      throw RuntimeException("division by zero");
+    }
+    if (lhs < BOXED_LIMIT || rhs < BOXED_LIMIT || rhs == -1) {
+      return make(get(lhs) % get(rhs));
+    }
+    return value_t(lhs % rhs);
+  }
+
+  int compare(INT_T lhs, INT_T rhs) {
+    if (lhs < BOXED_LIMIT || rhs < BOXED_LIMIT) {
+      return get(lhs).compare(get(rhs));
+    }
+    return (lhs < rhs) ? -1 : (lhs > rhs) ? 1 : 0;
+  }
+
+  const rational_t rational(INT_T num, INT_T denom) {
+    bigint_t n = get(num);
+    bigint_t d = get(denom);
+    if (d.is_zero()) {
+      throw RuntimeException("division by zero");
+    }
+    bigint_t a = n;
+    bigint_t b = d;
+    while (!b.is_zero()) {
+      bigint_t tmp = a % b;
+      a = b;
+      b = tmp;
+    }
+    a.negative = d.negative;
+    n = n / a;
+    d = d / a;
+    if (!n.fits_int() || !d.fits_int()) {
+      throw RuntimeException("rational overflow");
+    }
+    rational_t result;
+    result.numerator = n.to_int();
+    result.denominator = d.to_int();
+    return result;
+  }
+
+  const std::string to_str(INT_T v) {
+    return boxed(v)->to_str();
+  }
+
+  const value_t dispatch(ExpressionOperation op, INT_T lhs, INT_T rhs) {
+    switch (op) {
+      case ExpressionOperation::ADD: return add(lhs, rhs);
+      case ExpressionOperation::SUB: return sub(lhs, rhs);
+      case ExpressionOperation::MUL: return mul(lhs, rhs);
+      case ExpressionOperation::DIV: return div(lhs, rhs);
+      case ExpressionOperation::MOD: return mod(lhs, rhs);
+      case ExpressionOperation::EQ: return value_t(lhs == rhs);
+      case ExpressionOperation::NEQ: return value_t(lhs != rhs);
+      case ExpressionOperation::LESSER: return value_t(compare(lhs, rhs) < 0);
+      case ExpressionOperation::LESSEREQ: return value_t(compare(lhs, rhs) <= 0);
+      case ExpressionOperation::GREATER: return value_t(compare(lhs, rhs) > 0);
+      case ExpressionOperation::GREATEREQ: return value_t(compare(lhs, rhs) >= 0);
+      default: throw RuntimeException("Unsupported operation for Int");
+    }
+  }
+}
@@ -0,0 +1,121 @@
+#ifndef CASMI_LIBINTERPRETER_BIGINT_H
+#define CASMI_LIBINTERPRETER_BIGINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "libsyntax/ast.h"
+
+#include "libinterpreter/value.h"
+
+// Sign and magnitude of an arbitrary precision integer
+struct bigint_t {
+  bool negative;
+  // least significant word first, without leading zero words
+  std::vector<uint32_t> magnitude;
+
+  bigint_t();
+  bigint_t(INT_T v);
+
+  bool is_zero() const { return magnitude.empty(); }
+  bool fits_int() const;
+  INT_T to_int() const;
+  FLOAT_T to_float() const;
+
+  bool operator==(const bigint_t& other) const;
+  // -1, 0 or 1
+  int compare(const bigint_t& other) const;
+
+  const bigint_t operator+(const bigint_t& other) const;
+  const bigint_t operator-(const bigint_t& other) const;
+  const bigint_t operator*(const bigint_t& other) const;
+  // truncating division like for INT_T, throws on division by zero
+  const bigint_t operator/(const bigint_t& other) const;
+  const bigint_t operator%(const bigint_t& other) const;
+
+  const std::string to_str(unsigned int base=10) const;
+};
+
+// Big integers are interned and managed like strings
+struct InternedBigInt : public bigint_t {
+  const size_t hash;
+  uint32_t usage_count;
+  bool pinned;
+
+  static const InternedBigInt *intern(const bigint_t& val);
+  static void free_unused();
+
+  private:
+    InternedBigInt(const bigint_t& val, size_t hash);
+};
+
+// Int values of the --bigint mode. Values that fit stay in value.integer,
+// larger results are interned and encoded in value.integer below
+// BOXED_LIMIT, so that update packing, hashing and equality keep working on
+// value.integer. Without --bigint, Int arithmetic wraps around.
+namespace bigint {
+  extern bool enabled;
+
+  const INT_T BOXED_LIMIT = INT64_MIN + (INT64_C(1) << 56);
+
+  inline bool is_boxed(INT_T v) {
+    return enabled && v < BOXED_LIMIT;
+  }
+
+  const bigint_t get(INT_T v);
+  // returns an inline value if val fits, an interned one otherwise
+  const value_t make(const bigint_t& val);
+  const InternedBigInt *boxed(INT_T v);
+
+  // for values that do not come from the arithmetic below, e.g. literals
+  inline const value_t from_int(INT_T v) {
+    if (is_boxed(v)) {
+      return make(bigint_t(v));
+    }
+    return value_t(v);
+  }
+
+  const value_t add_slow(INT_T lhs, INT_T rhs);
+  const value_t sub_slow(INT_T lhs, INT_T rhs);
+  const value_t mul_slow(INT_T lhs, INT_T rhs);
+  const value_t div(INT_T lhs, INT_T rhs);
+  const value_t mod(INT_T lhs, INT_T rhs);
+  // -1, 0 or 1
+  int compare(INT_T lhs, INT_T rhs);
+  // reduced num/denom, throws if it does not fit a rational_t
+  const rational_t rational(INT_T num, INT_T denom);
+  const std::string to_str(INT_T v);
+
+  inline const value_t add(INT_T lhs, INT_T rhs) {
+    INT_T res;
+    if (__builtin_add_overflow(lhs, rhs, &res) || lhs < BOXED_LIMIT ||
+        rhs < BOXED_LIMIT || res < BOXED_LIMIT) {
+      return add_slow(lhs, rhs);
+    }
+    return value_t(res);
+  }
+
+  inline const value_t sub(INT_T lhs, INT_T rhs) {
+    INT_T res;
+    if (__builtin_sub_overflow(lhs, rhs, &res) || lhs < BOXED_LIMIT ||
+        rhs < BOXED_LIMIT || res < BOXED_LIMIT) {
+      return sub_slow(lhs, rhs);
+    }
+    return value_t(res);
+  }
+
+  inline const value_t mul(INT_T lhs, INT_T rhs) {
+    INT_T res;
+    if (__builtin_mul_overflow(lhs, rhs, &res) || lhs < BOXED_LIMIT ||
+        rhs < BOXED_LIMIT || res < BOXED_LIMIT) {
+      return mul_slow(lhs, rhs);
+    }
+    return value_t(res);
+  }
+
+  // all binary operations of Int operands
+  const value_t dispatch(ExpressionOperation op, INT_T lhs, INT_T rhs);
+}
+
+#endif
@@ -3,7 +3,9 @@
 #include <sstream>
 
 #include "libinterpreter/builtins.h"
+#include "libinterpreter/bigint.h"
 
+template<class Mode>
 const value_t builtins::dispatch(BuiltinAtom::Id atom_id,  ExecutionContext& ctxt,
                                const value_t arguments[], uint16_t num_arguments) {
   switch (atom_id) {
@@ -50,9 +52,9 @@ const value_t builtins::dispatch(BuiltinAtom::Id atom_id,  ExecutionContext& ctx
       return std::move(asrational(arguments[0]));
 
     case BuiltinAtom::Id::SYMBOLIC:
-      return std::move(symbolic(arguments[0]));
+      return std::move(symbolic<Mode>(arguments[0]));
 
-    default: return std::move(shared::dispatch(atom_id, ctxt, arguments, num_arguments));
+    default: return std::move(shared::dispatch<Mode>(atom_id, ctxt, arguments, num_arguments));
   }
 }
 
@@ -60,6 +62,21 @@ const value_t builtins::dispatch(BuiltinAtom::Id atom_id,  ExecutionContext& ctx
 const value_t builtins::pow(const value_t& base, const value_t& power) {
   switch (base.type) {
     case TypeType::INT:
+      if (bigint::enabled && power.value.integer >= 0 &&
+          !bigint::is_boxed(power.value.integer)) {
+        // square and multiply, intermediate results are promoted as needed
+        value_t result((INT_T) 1);
+        value_t factor = base;
+        for (INT_T p = power.value.integer; p > 0; p >>= 1) {
+          if (p & 1) {
+            result = bigint::mul(result.value.integer, factor.value.integer);
+          }
+          if (p > 1) {
+            factor = bigint::mul(factor.value.integer, factor.value.integer);
+          }
+        }
+        return result;
+      }
       return std::move(value_t((INT_T)std::pow(base.value.integer, power.value.integer)));
 
     case TypeType::FLOAT:
@@ -69,9 +86,12 @@ const value_t builtins::pow(const value_t& base, const value_t& power) {
 }
 
 const value_t builtins::hex(const value_t& arg) {
-  // TODO LEAK!
   if (arg.is_undef()) {
-    return std::move(value_t(new std::string("undef")));
+    return std::move(value_t(string_t::intern("undef")));
+  }
+
+  if (bigint::is_boxed(arg.value.integer)) {
+    return value_t(string_t::intern(bigint::boxed(arg.value.integer)->to_str(16)));
   }
 
   std::stringstream ss;
@@ -80,84 +100,39 @@ const value_t builtins::hex(const value_t& arg) {
   } else {
     ss << std::hex << arg.value.integer;
   }
-  return std::move(value_t(new std::string(ss.str())));
+  return std::move(value_t(string_t::intern(ss.str())));
 }
 
 const value_t builtins::nth(const value_t& list_arg, const value_t& index ) {
-  if (list_arg.is_undef() || index.is_undef()) {
+  if (list_arg.is_undef() || index.is_undef() || index.value.integer < 1) {
     return value_t();
   }
 
-  List *list = list_arg.value.list;
-  List::const_iterator iter = list->begin();
-  INT_T i = 1;
-
-  while (iter != list->end() && i < index.value.integer) {
-    i++;
-    iter++;
-  }
-  if (i == index.value.integer && iter != list->end()) {
-    return std::move(value_t(*iter));
-  } else {
-    return std::move(value_t());
-  }
+  return std::move(list_arg.value.list->nth(index.value.integer - 1));
 }
 
 const value_t builtins::app(ExecutionContext& ctxt, const value_t& list, const value_t& val) {
-  // TODO LEAK
   if (list.is_undef()) {
     return std::move(value_t());
   }
 
-  List *current = list.value.list;
-
-  while (1 == 1) {
-    if (current->list_type == List::ListType::HEAD) {
-      current = reinterpret_cast<HeadList*>(current)->right;
-    }
-    if (current->list_type == List::ListType::SKIP) {
-      current = reinterpret_cast<SkipList*>(current)->bottom;
-    }
-    if (current->list_type == List::ListType::BOTTOM) {
-      BottomList *bottom = reinterpret_cast<BottomList*>(current);
-      if (bottom->tail) {
-        current = bottom->tail;
-      } else {
-        break;
-      }
-    }
-    if (current->list_type == List::ListType::TAIL) {
-      TailList *tail = reinterpret_cast<TailList*>(current);
-      if (tail->right) {
-        current = tail->right;
-      } else {
-        break;
-      }
-    }
-  }
-
-
-  TailList *tail = new TailList(nullptr, val);
-  ctxt.temp_lists.push_back(tail);
-
-  if (current->list_type == List::ListType::TAIL) {
-    reinterpret_cast<TailList*>(current)->right = tail;
-  } else if (current->list_type == List::ListType::BOTTOM) {
-    reinterpret_cast<BottomList*>(current)->tail = tail;
+  AppendList *appended;
+  if (list.value.list->is_append()) {
+    appended = reinterpret_cast<AppendList*>(list.value.list)->append(ctxt.list_arena, val);
   } else {
-    FAILURE();
+    appended = ctxt.list_arena.make<AppendList>(list.value.list,
+                                                std::make_shared<std::vector<value_t>>(1, val),
+                                                0, 1);
   }
-  return std::move(value_t(list.type, list.value.list));
+  return std::move(value_t(list.type, appended));
 }
 
 const value_t builtins::cons(ExecutionContext& ctxt, const value_t& val, const value_t& list) {
-  // TODO LEAK
   if (list.is_undef()) {
     return std::move(value_t());
   }
 
-  HeadList *consed_list = new HeadList(list.value.list, val);
-  ctxt.temp_lists.push_back(consed_list);
+  HeadList *consed_list = ctxt.list_arena.make<HeadList>(list.value.list, val);
   return value_t(list.type, consed_list);
 }
 
@@ -170,35 +145,42 @@ const value_t builtins::tail(ExecutionContext& ctxt, const value_t& arg_list) {
 
   if (list->is_head()) {
     return std::move(value_t(arg_list.type, reinterpret_cast<HeadList*>(list)->right));
+  } else if (list->is_range()) {
+    RangeList *range = reinterpret_cast<RangeList*>(list);
+    RangeList *rest = ctxt.list_arena.make<RangeList>(range->first + range->step, range->step,
+                                                      (range->count > 0) ? range->count - 1 : 0);
+    return std::move(value_t(arg_list.type, rest));
+  } else if (list->is_append()) {
+    AppendList *append = reinterpret_cast<AppendList*>(list);
+    AppendList *rest;
+    if (append->front->size() > 0) {
+      rest = ctxt.list_arena.make<AppendList>(
+          tail(ctxt, value_t(arg_list.type, append->front)).value.list,
+          append->buffer, append->begin, append->end);
+    } else if (append->begin < append->end) {
+      rest = ctxt.list_arena.make<AppendList>(append->front, append->buffer,
+                                              append->begin + 1, append->end);
+    } else {
+      return arg_list;
+    }
+    return std::move(value_t(arg_list.type, rest));
   } else if (list->is_bottom()) {
     BottomList *btm = reinterpret_cast<BottomList*>(list);
-    SkipList *skip = new SkipList(1, btm);
-    ctxt.temp_lists.push_back(skip);
+    SkipList *skip = ctxt.list_arena.make<SkipList>(1, btm);
     return std::move(value_t(arg_list.type, skip));
   } else {
     SkipList *old_skip = reinterpret_cast<SkipList*>(list);
-    SkipList *skip = new SkipList(old_skip->skip+1, old_skip->bottom);
-    ctxt.temp_lists.push_back(skip);
+    SkipList *skip = ctxt.list_arena.make<SkipList>(old_skip->skip+1, old_skip->bottom);
     return std::move(value_t(arg_list.type, skip));
   }
 }
 
 const value_t builtins::len(const value_t& list_arg) {
-  // TODO len is really slow right now, it itertes over complete list
   if (list_arg.is_undef()) {
     return std::move(value_t());
   }
 
-  List *list = list_arg.value.list;
-  List::const_iterator iter = list->begin();
-
-  size_t count = 0;
-
-  while (iter != list->end()) {
-    count++;
-    iter++;
-  }
-  return std::move(value_t((INT_T) count));
+  return std::move(value_t((INT_T) list_arg.value.list->size()));
 }
 
 const value_t builtins::peek(const value_t& arg_list) {
@@ -248,9 +230,10 @@ const value_t builtins::asint(const value_t& arg) {
     case TypeType::INT:
       return std::move(value_t(arg.value.integer));
     case TypeType::FLOAT:
-      return std::move(value_t((INT_T)arg.value.float_));
+      return bigint::from_int((INT_T)arg.value.float_);
     case TypeType::RATIONAL:
-      return std::move(value_t((INT_T)(arg.value.rat->numerator / arg.value.rat->denominator)));
+      return bigint::from_int((INT_T)(arg.to_rational().numerator /
+                                      arg.to_rational().denominator));
     default: FAILURE();
   }
 }
@@ -262,11 +245,15 @@ const value_t builtins::asfloat(const value_t& arg) {
 
   switch (arg.type) {
     case TypeType::INT:
+      if (bigint::is_boxed(arg.value.integer)) {
+        return value_t(bigint::boxed(arg.value.integer)->to_float());
+      }
       return std::move(value_t((FLOAT_T) arg.value.integer));
     case TypeType::FLOAT:
       return std::move(value_t(arg.value.float_));
     case TypeType::RATIONAL:
-      return std::move(value_t(((FLOAT_T)arg.value.rat->numerator) / arg.value.rat->denominator));
+      return std::move(value_t(((FLOAT_T)arg.to_rational().numerator) /
+                               arg.to_rational().denominator));
     default: FAILURE();
   }
 }
@@ -324,25 +311,27 @@ const value_t builtins::asrational(const value_t& arg) {
     return std::move(arg);
   }
 
-  rational_t *result = (rational_t*) pp_mem_alloc(
-      &(ExecutionContext::value_stack), sizeof(rational_t)
-  );
   switch (arg.type) {
     case TypeType::INT:
-      result->numerator = arg.value.integer;
-      result->denominator = 1;
-      return std::move(value_t(result));
-    case TypeType::FLOAT:
-      get_numerator_denominator(arg.value.float_, &result->numerator, &result->denominator);
-      return std::move(value_t(result));
+      if (bigint::is_boxed(arg.value.integer)) {
+        return value_t(bigint::rational(arg.value.integer, 1));
+      }
+      return std::move(value_t(rational_t(arg.value.integer, 1)));
+    case TypeType::FLOAT: {
+      int64_t num;
+      int64_t denom;
+      get_numerator_denominator(arg.value.float_, &num, &denom);
+      return std::move(value_t(rational_t(num, denom)));
+    }
     case TypeType::RATIONAL:
-      return std::move(value_t(arg.value.rat));
+      return std::move(arg);
     default: FAILURE();
   }
 }
 
+template<class Mode>
 const value_t builtins::symbolic(const value_t& arg) {
-  if (arg.is_symbolic() && !arg.value.sym->list) {
+  if (Mode::symbolic && arg.is_symbolic() && !arg.value.sym->list) {
     return std::move(value_t(true));
   } else {
     return std::move(value_t(false));
@@ -370,7 +359,9 @@ namespace shared {
   // create concrete variants of the shareds
   #define CASM_CALL_SHARED(NAME, VALUE, ARGS...)  NAME(VALUE, ##ARGS)
   #define DEFINE_CASM_SHARED(NAME, VALUE, ARGS...) void NAME(VALUE, ##ARGS)
+#ifdef CASMI_SHARED_BUILTINS
   #include "libcasmrt/pp_casm_shared.h"
+#endif
 
 
   namespace symbolic {
@@ -389,13 +380,16 @@ namespace shared {
     #define SYMBOLIC
     #define CASM_CALL_SHARED(NAME, VALUE, ARGS...)  symbolic_##NAME(VALUE, ##ARGS)
     #define DEFINE_CASM_SHARED(NAME, VALUE, ARGS...) void symbolic_##NAME(VALUE, ##ARGS)
+#ifdef CASMI_SHARED_BUILTINS
     #include "libcasmrt/pp_casm_shared.h"
+#endif
   }
 
   #pragma GCC diagnostic warning "-Wmissing-field-initializers"
   #pragma GCC diagnostic warning "-Wunused-parameter"
   REENABLE_VARIADIC_WARNINGS
 
+  template<class Mode>
   const value_t dispatch(BuiltinAtom::Id builtin_id,  ExecutionContext& ctxt,
                        const value_t arguments[], uint16_t num_arguments) {
     const char *sym_name;
@@ -412,7 +406,7 @@ namespace shared {
 
     if (ret.defined == TRUE) {
       return std::move(value_t((INT_T)ret.value));
-    } else if (ctxt.symbolic && ret.sym) {
+    } else if (Mode::symbolic && ret.sym) {
       value_t v(new symbol_t(::symbolic::next_symbol_id()));
       ::symbolic::dump_builtin(ctxt.trace, sym_name, arguments, num_arguments, v);
       return std::move(v);
@@ -422,3 +416,8 @@ namespace shared {
   }
 }
 }
+
+template const value_t builtins::dispatch<ConcreteMode>(BuiltinAtom::Id atom_id,
+    ExecutionContext& ctxt, const value_t arguments[], uint16_t num_arguments);
+template const value_t builtins::dispatch<SymbolicMode>(BuiltinAtom::Id atom_id,
+    ExecutionContext& ctxt, const value_t arguments[], uint16_t num_arguments);
@@ -5,9 +5,12 @@
 
 #include "libinterpreter/execution_context.h"
 #include "libinterpreter/value.h"
+#include "libinterpreter/execution_mode.h"
 #include "libinterpreter/symbolic.h"
 
 namespace builtins {
+  // Mode::symbolic enables the handling of symbolic values
+  template<class Mode>
   const value_t dispatch(BuiltinAtom::Id atom_id, ExecutionContext& ctxt,
                          const value_t arguments[], uint16_t num_arguments);
 
@@ -28,6 +31,7 @@ namespace builtins {
   const value_t asfloat(const value_t& arg);
   const value_t asrational(const value_t& arg);
 
+  template<class Mode>
   const value_t symbolic(const value_t& arg);
 
   namespace shared {
@@ -37,6 +41,7 @@ namespace builtins {
       bool sym;
     };
 
+    template<class Mode>
     const value_t dispatch(BuiltinAtom::Id builtin_id, ExecutionContext& ctxt,
                          const value_t arguments[], uint16_t num_arguments);
 
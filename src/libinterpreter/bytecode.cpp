@@ -0,0 +1,666 @@
+#include <algorithm>
+#include <sstream>
+
+#include "macros.h"
+#include "libutil/exceptions.h"
+
+#include "libinterpreter/bytecode.h"
+#include "libinterpreter/bigint.h"
+
+const char *opcode_to_str(Opcode op) {
+  switch (op) {
+    case Opcode::LOAD_CONST: return "LOAD_CONST";
+    case Opcode::MOVE: return "MOVE";
+    case Opcode::ADD: return "ADD";
+    case Opcode::SUB: return "SUB";
+    case Opcode::MUL: return "MUL";
+    case Opcode::EQ: return "EQ";
+    case Opcode::NEQ: return "NEQ";
+    case Opcode::LESSER: return "LESSER";
+    case Opcode::LESSEREQ: return "LESSEREQ";
+    case Opcode::GREATER: return "GREATER";
+    case Opcode::GREATEREQ: return "GREATEREQ";
+    case Opcode::BIG_ADD: return "BIG_ADD";
+    case Opcode::BIG_SUB: return "BIG_SUB";
+    case Opcode::BIG_MUL: return "BIG_MUL";
+    case Opcode::BINARY: return "BINARY";
+    case Opcode::UNARY: return "UNARY";
+    case Opcode::READ: return "READ";
+    case Opcode::READ_SUBRANGE: return "READ_SUBRANGE";
+    case Opcode::DERIVED: return "DERIVED";
+    case Opcode::BUILTIN: return "BUILTIN";
+    case Opcode::LIST: return "LIST";
+    case Opcode::RANGE: return "RANGE";
+    case Opcode::UPDATE: return "UPDATE";
+    case Opcode::UPDATE_SUBRANGE: return "UPDATE_SUBRANGE";
+    case Opcode::UPDATE_DUMPS: return "UPDATE_DUMPS";
+    case Opcode::PUSH: return "PUSH";
+    case Opcode::POP: return "POP";
+    case Opcode::JUMP: return "JUMP";
+    case Opcode::BRANCH: return "BRANCH";
+    case Opcode::JUMP_IF_EQ: return "JUMP_IF_EQ";
+    case Opcode::JUMP_IF_BOOL: return "JUMP_IF_BOOL";
+    case Opcode::JUMP_TABLE: return "JUMP_TABLE";
+    case Opcode::SEQ_BEGIN: return "SEQ_BEGIN";
+    case Opcode::SEQ_END: return "SEQ_END";
+    case Opcode::PAR_BEGIN: return "PAR_BEGIN";
+    case Opcode::PAR_END: return "PAR_END";
+    case Opcode::FORALL: return "FORALL";
+    case Opcode::ITERATE: return "ITERATE";
+    case Opcode::CALL_PRE: return "CALL_PRE";
+    case Opcode::CALL: return "CALL";
+    case Opcode::ASSERT: return "ASSERT";
+    case Opcode::ASSURE: return "ASSURE";
+    case Opcode::PRINT: return "PRINT";
+    case Opcode::DIEDIE: return "DIEDIE";
+    case Opcode::IMPOSSIBLE: return "IMPOSSIBLE";
+    case Opcode::END: return "END";
+    default: FAILURE();
+  }
+}
+
+const std::string Chunk::to_str() const {
+  std::stringstream ss;
+  for (size_t i = 0; i < code.size(); i++) {
+    const Instruction& inst = code[i];
+    ss << i << ": " << opcode_to_str(inst.op) << " " << inst.a << " " << inst.b
+       << " " << inst.c;
+    switch (inst.op) {
+      case Opcode::JUMP:
+      case Opcode::BRANCH:
+      case Opcode::JUMP_IF_EQ:
+      case Opcode::JUMP_IF_BOOL:
+      case Opcode::JUMP_TABLE:
+      case Opcode::FORALL:
+      case Opcode::ITERATE:
+        ss << " -> " << inst.target;
+        break;
+      default: break;
+    }
+    ss << std::endl;
+  }
+  return ss.str();
+}
+
+static Opcode binary_opcode(ExpressionOperation op) {
+  if (bigint::enabled) {
+    // big integers are interned, so only equality can compare value.integer
+    switch (op) {
+      case ExpressionOperation::ADD: return Opcode::BIG_ADD;
+      case ExpressionOperation::SUB: return Opcode::BIG_SUB;
+      case ExpressionOperation::MUL: return Opcode::BIG_MUL;
+      case ExpressionOperation::EQ: return Opcode::EQ;
+      case ExpressionOperation::NEQ: return Opcode::NEQ;
+      default: return Opcode::BINARY;
+    }
+  }
+  switch (op) {
+    case ExpressionOperation::ADD: return Opcode::ADD;
+    case ExpressionOperation::SUB: return Opcode::SUB;
+    case ExpressionOperation::MUL: return Opcode::MUL;
+    case ExpressionOperation::EQ: return Opcode::EQ;
+    case ExpressionOperation::NEQ: return Opcode::NEQ;
+    case ExpressionOperation::LESSER: return Opcode::LESSER;
+    case ExpressionOperation::LESSEREQ: return Opcode::LESSEREQ;
+    case ExpressionOperation::GREATER: return Opcode::GREATER;
+    case ExpressionOperation::GREATEREQ: return Opcode::GREATEREQ;
+    default: return Opcode::BINARY;
+  }
+}
+
+BytecodeCompiler::BytecodeCompiler() : chunk_(nullptr), next_register_(0),
+    pinned_registers_(0), binding_registers_(), read_values_(0) {}
+
+uint16_t BytecodeCompiler::allocate(uint16_t count) {
+  if (next_register_ + count > UINT16_MAX) {
+    throw RuntimeException("too many registers needed");
+  }
+  uint16_t base = next_register_;
+  next_register_ += count;
+  if (next_register_ > chunk_->num_registers) {
+    chunk_->num_registers = next_register_;
+  }
+  return base;
+}
+
+void BytecodeCompiler::release(uint16_t mark) {
+  next_register_ = (mark > pinned_registers_) ? mark : pinned_registers_;
+}
+
+size_t BytecodeCompiler::emit(Opcode op, uint16_t a, uint16_t b, uint16_t c,
+                              AstNode *node) {
+  chunk_->code.push_back(Instruction(op, a, b, c, node));
+  return chunk_->code.size() - 1;
+}
+
+void BytecodeCompiler::patch(size_t pos) {
+  chunk_->code[pos].target = chunk_->code.size();
+}
+
+uint16_t BytecodeCompiler::constant(const value_t& v) {
+  chunk_->constants.push_back(v);
+  return chunk_->constants.size() - 1;
+}
+
+void BytecodeCompiler::compile_rule(RuleNode *rule, Chunk *chunk) {
+  chunk_ = chunk;
+  chunk_->num_arguments = rule->arguments.size();
+  next_register_ = 0;
+  pinned_registers_ = 0;
+  binding_registers_.clear();
+
+  for (uint16_t i = 0; i < chunk_->num_arguments; i++) {
+    binding_registers_.push_back(allocate(1));
+  }
+  read_values_ = allocate(rule->num_read_values);
+  pinned_registers_ = next_register_;
+
+  compile_statement(rule->child_);
+  emit(Opcode::END, 0, 0, 0, rule);
+}
+
+void BytecodeCompiler::compile_derived(Function *derived, Chunk *chunk) {
+  chunk_ = chunk;
+  chunk_->num_arguments = derived->arguments_.size();
+  next_register_ = 0;
+  pinned_registers_ = 0;
+  binding_registers_.clear();
+
+  for (uint16_t i = 0; i < chunk_->num_arguments; i++) {
+    binding_registers_.push_back(allocate(1));
+  }
+  read_values_ = allocate(derived->num_read_values);
+  pinned_registers_ = next_register_;
+
+  // the END instruction of a derived function holds the result register
+  uint16_t result = allocate(1);
+  compile_expression(derived->derived, result);
+  emit(Opcode::END, result, 0, 0, derived->derived);
+}
+
+void BytecodeCompiler::compile_statement(AstNode *stmt) {
+  const uint16_t mark = next_register_;
+
+  switch (stmt->node_type_) {
+    case NodeType::SEQBLOCK:
+    case NodeType::PARBLOCK: {
+      const bool seq = stmt->node_type_ == NodeType::SEQBLOCK;
+      UnaryNode *block = reinterpret_cast<UnaryNode*>(stmt);
+      uint16_t forked = allocate(1);
+      emit(seq ? Opcode::SEQ_BEGIN : Opcode::PAR_BEGIN, forked,
+           block->unchecked_updates ? 1 : 0, 0, stmt);
+      AstListNode *stmts = reinterpret_cast<AstListNode*>(block->child_);
+      for (AstNode *s : stmts->nodes) {
+        compile_statement(s);
+      }
+      emit(seq ? Opcode::SEQ_END : Opcode::PAR_END, forked, 0, 0, stmt);
+      break;
+    }
+    case NodeType::UPDATE:
+    case NodeType::UPDATE_SUBRANGE:
+    case NodeType::UPDATE_DUMPS:
+      compile_update(reinterpret_cast<UpdateNode*>(stmt));
+      break;
+    case NodeType::ASSERT:
+    case NodeType::ASSURE: {
+      UnaryNode *node = reinterpret_cast<UnaryNode*>(stmt);
+      uint16_t v = compile_operand(reinterpret_cast<ExpressionBase*>(node->child_));
+      emit((stmt->node_type_ == NodeType::ASSERT) ? Opcode::ASSERT : Opcode::ASSURE,
+           v, 0, 0, stmt);
+      break;
+    }
+    case NodeType::SKIP: break;
+    case NodeType::IFTHENELSE: {
+      IfThenElseNode *node = reinterpret_cast<IfThenElseNode*>(stmt);
+      uint16_t cond = compile_operand(node->condition_);
+      size_t branch = emit(Opcode::BRANCH, cond, 0, 0, node);
+      release(mark);
+
+      compile_statement(node->then_);
+      if (node->else_) {
+        size_t jump = emit(Opcode::JUMP, 0, 0, 0, node);
+        patch(branch);
+        compile_statement(node->else_);
+        patch(jump);
+      } else {
+        patch(branch);
+      }
+      break;
+    }
+    case NodeType::CALL:
+      compile_call(reinterpret_cast<CallNode*>(stmt));
+      break;
+    case NodeType::PRINT: {
+      PrintNode *node = reinterpret_cast<PrintNode*>(stmt);
+      uint16_t base = compile_arguments(&node->atoms);
+      emit(Opcode::PRINT, base, node->atoms.size(), 0, node);
+      break;
+    }
+    case NodeType::LET: {
+      LetNode *node = reinterpret_cast<LetNode*>(stmt);
+      uint16_t binding = allocate(1);
+      compile_expression(node->expr, binding);
+      binding_registers_.push_back(binding);
+      compile_statement(node->stmt);
+      binding_registers_.pop_back();
+      break;
+    }
+    case NodeType::POP: {
+      PopNode *node = reinterpret_cast<PopNode*>(stmt);
+      if (node->to->symbol_type == FunctionAtom::SymbolType::FUNCTION) {
+        uint16_t from = allocate(1);
+        compile_function_atom(node->from, from);
+        emit(Opcode::POP, from, 0, 0, node);
+      } else {
+        // the new binding lives until the end of the rule
+        uint16_t binding = allocate(1);
+        pinned_registers_ = next_register_;
+        uint16_t from = allocate(1);
+        compile_function_atom(node->from, from);
+        binding_registers_.push_back(binding);
+        emit(Opcode::POP, from, binding, 0, node);
+      }
+      break;
+    }
+    case NodeType::PUSH: {
+      PushNode *node = reinterpret_cast<PushNode*>(stmt);
+      uint16_t expr = compile_operand(node->expr);
+      uint16_t to = allocate(1);
+      compile_function_atom(node->to, to);
+      emit(Opcode::PUSH, expr, to, 0, node);
+      break;
+    }
+    case NodeType::FORALL: {
+      ForallNode *node = reinterpret_cast<ForallNode*>(stmt);
+      uint16_t in = compile_operand(node->in_expr);
+      uint16_t binding = allocate(1);
+      size_t forall = emit(Opcode::FORALL, in, binding, 0, node);
+      binding_registers_.push_back(binding);
+      compile_statement(node->statement);
+      binding_registers_.pop_back();
+      emit(Opcode::END, 0, 0, 0, node);
+      patch(forall);
+      break;
+    }
+    case NodeType::ITERATE: {
+      size_t iterate = emit(Opcode::ITERATE, 0, 0, 0, stmt);
+      compile_statement(reinterpret_cast<UnaryNode*>(stmt)->child_);
+      emit(Opcode::END, 0, 0, 0, stmt);
+      patch(iterate);
+      break;
+    }
+    case NodeType::CASE:
+      compile_case(reinterpret_cast<CaseNode*>(stmt));
+      break;
+    case NodeType::DIEDIE: {
+      DiedieNode *node = reinterpret_cast<DiedieNode*>(stmt);
+      if (node->msg) {
+        emit(Opcode::DIEDIE, compile_operand(node->msg), 1, 0, node);
+      } else {
+        emit(Opcode::DIEDIE, 0, 0, 0, node);
+      }
+      break;
+    }
+    case NodeType::IMPOSSIBLE:
+      emit(Opcode::IMPOSSIBLE, 0, 0, 0, stmt);
+      break;
+    default:
+      throw RuntimeException(
+        std::string("Invalid node type: ")+
+        type_to_str(stmt->node_type_)+
+        std::string(" at ")+
+        stmt->location_str());
+  }
+
+  release(mark);
+}
+
+void BytecodeCompiler::compile_update(UpdateNode *update) {
+  // the expression is evaluated before the arguments, like in the AST walker
+  uint16_t expr = compile_operand(update->expr_);
+  uint16_t base = compile_arguments(update->func->arguments);
+  uint16_t num_arguments = (update->func->arguments) ? update->func->arguments->size() : 0;
+
+  switch (update->node_type_) {
+    case NodeType::UPDATE:
+      emit(Opcode::UPDATE, expr, base, num_arguments, update);
+      break;
+    case NodeType::UPDATE_SUBRANGE:
+      if (update->func->symbol->subrange_arguments.size() > 0) {
+        // reading the function checks the subranges of the arguments
+        emit(Opcode::READ_SUBRANGE, allocate(1), base, num_arguments, update->func);
+      }
+      emit(Opcode::UPDATE_SUBRANGE, expr, base, num_arguments, update);
+      break;
+    case NodeType::UPDATE_DUMPS:
+      emit(Opcode::UPDATE_DUMPS, expr, base, num_arguments, update);
+      break;
+    default: FAILURE();
+  }
+}
+
+void BytecodeCompiler::compile_call(CallNode *call) {
+  if (call->ruleref) {
+    emit(Opcode::CALL_PRE, compile_operand(call->ruleref), 0, 0, call);
+  }
+  uint16_t base = compile_arguments(call->arguments);
+  uint16_t num_arguments = (call->arguments) ? call->arguments->size() : 0;
+  emit(Opcode::CALL, 0, base, num_arguments, call);
+}
+
+static value_t enum_value(FunctionAtom *atom) {
+  // the in expression of forall rules is the name of the enum itself,
+  // which has no value. Do not insert an empty element in the mapping,
+  // chunks may be compiled before the function states are set up
+  auto iter = atom->enum_->mapping.find(atom->name);
+  value_t v = value_t((iter != atom->enum_->mapping.end()) ? iter->second : nullptr);
+  v.type = TypeType::ENUM;
+  return v;
+}
+
+static value_t label_value(AtomNode *label) {
+  switch (label->node_type_) {
+    case NodeType::INT_ATOM: {
+      const value_t val = bigint::from_int(reinterpret_cast<IntAtom*>(label)->val_);
+      val.pin();
+      return val;
+    }
+    case NodeType::BOOLEAN_ATOM:
+      return value_t(reinterpret_cast<BooleanAtom*>(label)->value);
+    case NodeType::STRING_ATOM:
+      {
+        StringAtom *atom = reinterpret_cast<StringAtom*>(label);
+        return value_t(string_t::literal(atom->string, atom->interned));
+      }
+    case NodeType::FUNCTION_ATOM:
+      return enum_value(reinterpret_cast<FunctionAtom*>(label));
+    default:
+      FAILURE();
+  }
+}
+
+void BytecodeCompiler::compile_case(CaseNode *node) {
+  uint16_t cond = compile_operand(node->expr);
+  if (node->has_constant_labels()) {
+    compile_jump_table(node, cond);
+    return;
+  }
+  const uint16_t mark = next_register_;
+
+  // labels are compared in order, the first matching label wins
+  std::vector<size_t> label_jumps;
+  for (auto& pair : node->case_list) {
+    if (pair.first) {
+      uint16_t label = compile_operand(pair.first);
+      label_jumps.push_back(emit(Opcode::JUMP_IF_EQ, cond, label, 0, node));
+      release(mark);
+    } else {
+      label_jumps.push_back(0);
+    }
+  }
+  size_t default_jump = emit(Opcode::JUMP, 0, 0, 0, node);
+
+  std::vector<size_t> end_jumps;
+  bool has_default = false;
+  for (size_t i = 0; i < node->case_list.size(); i++) {
+    if (node->case_list[i].first) {
+      patch(label_jumps[i]);
+    } else {
+      patch(default_jump);
+      has_default = true;
+    }
+    compile_statement(node->case_list[i].second);
+    end_jumps.push_back(emit(Opcode::JUMP, 0, 0, 0, node));
+  }
+
+  if (!has_default) {
+    patch(default_jump);
+  }
+  for (size_t jump : end_jumps) {
+    patch(jump);
+  }
+}
+
+void BytecodeCompiler::compile_jump_table(CaseNode *node, uint16_t cond) {
+  const uint16_t index = chunk_->jump_tables.size();
+  const size_t table_jump = emit(Opcode::JUMP_TABLE, cond, index, 0, node);
+  chunk_->jump_tables.emplace_back();
+
+  std::vector<std::pair<value_t, uint32_t>> labels;
+  std::vector<size_t> end_jumps;
+  uint32_t default_target = 0;
+  bool has_default = false;
+  for (auto& pair : node->case_list) {
+    const uint32_t start = chunk_->code.size();
+    if (pair.first) {
+      labels.push_back(std::make_pair(label_value(pair.first), start));
+    } else {
+      default_target = start;
+      has_default = true;
+    }
+    compile_statement(pair.second);
+    end_jumps.push_back(emit(Opcode::JUMP, 0, 0, 0, node));
+  }
+  if (!has_default) {
+    default_target = chunk_->code.size();
+  }
+  for (size_t jump : end_jumps) {
+    patch(jump);
+  }
+  chunk_->code[table_jump].target = default_target;
+
+  // nested cases may have grown the jump tables in the meantime
+  JumpTable& table = chunk_->jump_tables[index];
+  table.default_target = default_target;
+
+  bool dense = !labels.empty();
+  INT_T min = INT64_MAX;
+  INT_T max = INT64_MIN;
+  for (auto& label : labels) {
+    if (label.first.type != TypeType::INT) {
+      dense = false;
+      break;
+    }
+    min = std::min(min, label.first.value.integer);
+    max = std::max(max, label.first.value.integer);
+  }
+  // at most four slots per label, otherwise the labels are hashed
+  if (dense && (uint64_t) max - (uint64_t) min < 4 * labels.size()) {
+    table.first = min;
+    table.dense.assign((uint64_t) max - (uint64_t) min + 1, default_target);
+    // the first matching label wins
+    for (auto iter = labels.rbegin(); iter != labels.rend(); iter++) {
+      table.dense[(uint64_t) iter->first.value.integer - (uint64_t) min] = iter->second;
+    }
+  } else {
+    for (auto& label : labels) {
+      table.targets.emplace(label.first, label.second);
+    }
+  }
+}
+
+uint16_t BytecodeCompiler::compile_operand(ExpressionBase *expr) {
+  if (expr->node_type_ == NodeType::FUNCTION_ATOM) {
+    FunctionAtom *func = reinterpret_cast<FunctionAtom*>(expr);
+    if (func->symbol_type == FunctionAtom::SymbolType::PARAMETER) {
+      if (func->offset >= binding_registers_.size()) {
+        throw RuntimeException("invalid binding offset at "+expr->location_str());
+      }
+      return binding_registers_[func->offset];
+    }
+    if (func->value_number != 0) {
+      // the value stays in the register of the value number
+      const uint16_t value = read_values_ + func->value_number - 1;
+      if (!func->reuses_value) {
+        compile_function_atom(func, value);
+      }
+      return value;
+    }
+  }
+  uint16_t dst = allocate(1);
+  compile_expression(expr, dst);
+  return dst;
+}
+
+uint16_t BytecodeCompiler::compile_arguments(const std::vector<ExpressionBase*> *args) {
+  if (args == nullptr) {
+    return next_register_;
+  }
+  uint16_t base = allocate(args->size());
+  for (size_t i = 0; i < args->size(); i++) {
+    compile_expression(args->at(i), base + i);
+  }
+  return base;
+}
+
+void BytecodeCompiler::compile_expression(ExpressionBase *expr, uint16_t dst) {
+  if (expr->node_type_ == NodeType::BOOLEAN_EXPRESSION) {
+    // the right operand is skipped if the left one decides the result
+    Expression *e = reinterpret_cast<Expression*>(expr);
+    compile_expression(e->left_, dst);
+    const uint16_t mark = next_register_;
+    size_t skip = emit(Opcode::JUMP_IF_BOOL, dst, e->op == ExpressionOperation::OR, 0, e);
+    uint16_t rhs = compile_operand(e->right_);
+    emit(Opcode::BINARY, dst, dst, rhs, e);
+    release(mark);
+    patch(skip);
+    return;
+  }
+  if (expr->node_type_ != NodeType::EXPRESSION &&
+      expr->node_type_ != NodeType::INT_EXPRESSION) {
+    compile_atom(reinterpret_cast<AtomNode*>(expr), dst);
+    return;
+  }
+
+  const uint16_t mark = next_register_;
+  Expression *e = reinterpret_cast<Expression*>(expr);
+  uint16_t lhs = compile_operand(e->left_);
+  if (e->right_) {
+    uint16_t rhs = compile_operand(e->right_);
+    emit(binary_opcode(e->op), dst, lhs, rhs, e);
+  } else {
+    emit(Opcode::UNARY, dst, lhs, 0, e);
+  }
+  release(mark);
+}
+
+void BytecodeCompiler::compile_function_atom(BaseFunctionAtom *atom, uint16_t dst) {
+  if (atom->node_type_ == NodeType::FUNCTION_ATOM &&
+      reinterpret_cast<FunctionAtom*>(atom)->reuses_value) {
+    // the arguments have been evaluated by the first read
+    FunctionAtom *func = reinterpret_cast<FunctionAtom*>(atom);
+    emit(Opcode::MOVE, dst, read_values_ + func->value_number - 1, 0, func);
+    return;
+  }
+
+  const uint16_t mark = next_register_;
+  uint16_t base = compile_arguments(atom->arguments);
+  uint16_t num_arguments = (atom->arguments) ? atom->arguments->size() : 0;
+
+  if (atom->node_type_ == NodeType::BUILTIN_ATOM) {
+    emit(Opcode::BUILTIN, dst, base, num_arguments, atom);
+    release(mark);
+    return;
+  }
+
+  FunctionAtom *func = reinterpret_cast<FunctionAtom*>(atom);
+  if (func->symbol_type == FunctionAtom::SymbolType::DERIVED) {
+    emit(Opcode::DERIVED, dst, base, num_arguments, func);
+  } else if (func->node_type_ == NodeType::FUNCTION_ATOM_SUBRANGE) {
+    emit(Opcode::READ_SUBRANGE, dst, base, num_arguments, func);
+  } else {
+    switch (func->symbol_type) {
+      case FunctionAtom::SymbolType::PARAMETER:
+        emit(Opcode::MOVE, dst, compile_operand(func), 0, func);
+        break;
+      case FunctionAtom::SymbolType::FUNCTION: {
+        const uint16_t value = read_values_ + func->value_number - 1;
+        if (func->value_number != 0 && dst != value) {
+          // later reads move the value from the register of the value number
+          emit(Opcode::READ, value, base, num_arguments, func);
+          emit(Opcode::MOVE, dst, value, 0, func);
+        } else {
+          emit(Opcode::READ, dst, base, num_arguments, func);
+        }
+        break;
+      }
+      case FunctionAtom::SymbolType::ENUM:
+        emit(Opcode::LOAD_CONST, dst, constant(enum_value(func)), 0, func);
+        break;
+      default:
+        FAILURE();
+    }
+  }
+  release(mark);
+}
+
+void BytecodeCompiler::compile_atom(AtomNode *atom, uint16_t dst) {
+  switch (atom->node_type_) {
+    case NodeType::INT_ATOM: {
+      const value_t val = bigint::from_int(reinterpret_cast<IntAtom*>(atom)->val_);
+      val.pin();
+      emit(Opcode::LOAD_CONST, dst, constant(val), 0, atom);
+      break;
+    }
+    case NodeType::FLOAT_ATOM:
+      emit(Opcode::LOAD_CONST, dst,
+           constant(value_t(reinterpret_cast<FloatAtom*>(atom)->val_)), 0, atom);
+      break;
+    case NodeType::RATIONAL_ATOM: {
+      // constants live as long as the chunk
+      const value_t rat(reinterpret_cast<RationalAtom*>(atom)->val_);
+      rat.pin();
+      emit(Opcode::LOAD_CONST, dst, constant(rat), 0, atom);
+      break;
+    }
+    case NodeType::UNDEF_ATOM:
+    case NodeType::SELF_ATOM:
+      emit(Opcode::LOAD_CONST, dst, constant(value_t()), 0, atom);
+      break;
+    case NodeType::RULE_ATOM:
+      emit(Opcode::LOAD_CONST, dst,
+           constant(value_t(reinterpret_cast<RuleAtom*>(atom)->rule)), 0, atom);
+      break;
+    case NodeType::BOOLEAN_ATOM:
+      emit(Opcode::LOAD_CONST, dst,
+           constant(value_t(reinterpret_cast<BooleanAtom*>(atom)->value)), 0, atom);
+      break;
+    case NodeType::STRING_ATOM: {
+      StringAtom *string = reinterpret_cast<StringAtom*>(atom);
+      emit(Opcode::LOAD_CONST, dst,
+           constant(value_t(string_t::literal(string->string, string->interned))),
+           0, atom);
+      break;
+    }
+    case NodeType::NUMBER_RANGE_ATOM: {
+      NumberRangeAtom *range = reinterpret_cast<NumberRangeAtom*>(atom);
+      const uint16_t mark = next_register_;
+      uint16_t start = compile_operand(range->start);
+      uint16_t end = compile_operand(range->end);
+      emit(Opcode::RANGE, dst, start, end, range);
+      release(mark);
+      break;
+    }
+    case NodeType::LIST_ATOM: {
+      // the elements are evaluated from right to left, like in the AST walker
+      ListAtom *list = reinterpret_cast<ListAtom*>(atom);
+      const uint16_t mark = next_register_;
+      size_t size = (list->expr_list) ? list->expr_list->size() : 0;
+      uint16_t base = allocate(size);
+      for (size_t i = 0; i < size; i++) {
+        compile_expression(list->expr_list->at(size - i - 1), base + i);
+      }
+      emit(Opcode::LIST, dst, base, size, list);
+      release(mark);
+      break;
+    }
+    case NodeType::BUILTIN_ATOM:
+    case NodeType::FUNCTION_ATOM:
+    case NodeType::FUNCTION_ATOM_SUBRANGE:
+      compile_function_atom(reinterpret_cast<BaseFunctionAtom*>(atom), dst);
+      break;
+    default:
+      throw RuntimeException("Invalid atom type:"+type_to_str(atom->node_type_)+
+                             std::to_string(atom->node_type_));
+  }
+}
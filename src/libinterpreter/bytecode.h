@@ -0,0 +1,168 @@
+#ifndef CASMI_LIBINTERPRETER_BYTECODE_H
+#define CASMI_LIBINTERPRETER_BYTECODE_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "libsyntax/ast.h"
+
+#include "libinterpreter/value.h"
+
+// Instruction set of the bytecode VM. Operands a, b and c are register
+// indices unless noted otherwise, node points to the AST node the instruction
+// was compiled from and is used for error reporting and by the visitor
+// methods shared with the AST walker.
+enum class Opcode : uint8_t {
+  LOAD_CONST,       // a = constants[b]
+  MOVE,             // a = b
+
+  ADD,              // a = b op c
+  SUB,
+  MUL,
+  EQ,
+  NEQ,
+  LESSER,
+  LESSEREQ,
+  GREATER,
+  GREATEREQ,
+  BIG_ADD,          // like ADD, promotes to big integers on overflow
+  BIG_SUB,
+  BIG_MUL,
+  BINARY,           // a = b op c, op is taken from the Expression node
+  UNARY,            // a = op b
+
+  READ,             // a = function(b .. b+c)
+  READ_SUBRANGE,    // like READ, checks the arguments against subranges
+  DERIVED,          // a = derived(b .. b+c)
+  BUILTIN,          // a = builtin(b .. b+c)
+  LIST,             // a = [b .. b+c], elements are stored in reverse order
+  RANGE,            // a = [b..c], the integer range is not materialized
+
+  UPDATE,           // function(b .. b+c) := a
+  UPDATE_SUBRANGE,
+  UPDATE_DUMPS,
+  PUSH,             // push a into list b
+  POP,              // pops from list a, stores into function or register b
+
+  JUMP,             // jump to target
+  BRANCH,           // jump to target if a is false, fails if a is undef
+  JUMP_IF_EQ,       // jump to target if a == b
+  JUMP_IF_BOOL,     // jump to target if a is the boolean b, short-circuits and/or
+  JUMP_TABLE,       // jump to the label of a in jump_tables[b], target is the
+                    // default label of the case
+
+  SEQ_BEGIN,        // forks a sequential pseudostate if needed, a is set if forked
+  SEQ_END,          // merges the pseudostate if a is set
+  PAR_BEGIN,        // like SEQ_BEGIN, b is set if the updates are unchecked
+  PAR_END,
+  FORALL,           // runs the body for every element of a bound to b,
+                    // target is the first instruction after the body
+  ITERATE,          // runs the body until no updates are produced
+
+  CALL_PRE,         // resolves the rule reference in a
+  CALL,             // calls the rule with the arguments b .. b+c
+
+  ASSERT,
+  ASSURE,
+  PRINT,            // prints a .. a+b
+  DIEDIE,           // aborts with message a, if b is set
+  IMPOSSIBLE,
+
+  END               // ends the rule or the body of a loop
+};
+
+const char *opcode_to_str(Opcode op);
+
+struct Instruction {
+  Opcode op;
+  uint16_t a;
+  uint16_t b;
+  uint16_t c;
+  uint32_t target;
+  AstNode *node;
+
+  Instruction(Opcode op, uint16_t a, uint16_t b, uint16_t c, AstNode *node)
+    : op(op), a(a), b(b), c(c), target(0), node(node) {}
+};
+
+// Labels of a case statement with constant labels. Int labels which cover a
+// dense range are looked up by index, all other labels by hash.
+struct JumpTable {
+  INT_T first;
+  std::vector<uint32_t> dense;
+  std::unordered_map<value_t, uint32_t> targets;
+  uint32_t default_target;
+
+  JumpTable() : first(0), dense(), targets(), default_target(0) {}
+
+  uint32_t lookup(const value_t& v) const {
+    if (!dense.empty()) {
+      if (v.type == TypeType::INT && v.value.integer >= first &&
+          (uint64_t) v.value.integer - (uint64_t) first < dense.size()) {
+        return dense[v.value.integer - first];
+      }
+      return default_target;
+    }
+    auto iter = targets.find(v);
+    return (iter != targets.end()) ? iter->second : default_target;
+  }
+};
+
+// Compiled body of a rule or a derived function. Registers 0 .. num_arguments
+// hold the arguments, followed by the values of numbered reads. The other
+// registers hold bindings and temporaries.
+struct Chunk {
+  std::vector<Instruction> code;
+  std::vector<value_t> constants;
+  std::vector<JumpTable> jump_tables;
+  uint16_t num_arguments;
+  uint16_t num_registers;
+
+  Chunk() : code(), constants(), jump_tables(), num_arguments(0), num_registers(0) {}
+
+  const std::string to_str() const;
+};
+
+// Lowers the typed AST of rules and derived functions to bytecode. Bindings
+// are resolved to registers at compile time, their offsets are the ones
+// assigned by the typechecker. Reads which reuse the value of an earlier read
+// are compiled to moves from its register.
+class BytecodeCompiler {
+  private:
+    Chunk *chunk_;
+    uint16_t next_register_;
+    // registers below are occupied by bindings of `pop` that live until the
+    // end of the rule
+    uint16_t pinned_registers_;
+    std::vector<uint16_t> binding_registers_;
+    // first register of the reads with a value number, see ReadNumbering
+    uint16_t read_values_;
+
+    uint16_t allocate(uint16_t count);
+    void release(uint16_t mark);
+
+    size_t emit(Opcode op, uint16_t a, uint16_t b, uint16_t c, AstNode *node);
+    void patch(size_t pos);
+    uint16_t constant(const value_t& v);
+
+    void compile_statement(AstNode *stmt);
+    void compile_update(UpdateNode *update);
+    void compile_call(CallNode *call);
+    void compile_case(CaseNode *node);
+    void compile_jump_table(CaseNode *node, uint16_t cond);
+
+    void compile_expression(ExpressionBase *expr, uint16_t dst);
+    uint16_t compile_operand(ExpressionBase *expr);
+    uint16_t compile_arguments(const std::vector<ExpressionBase*> *args);
+    void compile_function_atom(BaseFunctionAtom *atom, uint16_t dst);
+    void compile_atom(AtomNode *atom, uint16_t dst);
+
+  public:
+    BytecodeCompiler();
+
+    void compile_rule(RuleNode *rule, Chunk *chunk);
+    void compile_derived(Function *derived, Chunk *chunk);
+};
+
+#endif
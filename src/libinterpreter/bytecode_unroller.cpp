@@ -0,0 +1,452 @@
+#include <cstdio>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include "macros.h"
+#include "libutil/exceptions.h"
+
+#include "libinterpreter/bytecode_unroller.h"
+
+static const char *operation_name(ExpressionOperation op) {
+  switch (op) {
+    case ExpressionOperation::ADD: return "ADD";
+    case ExpressionOperation::SUB: return "SUB";
+    case ExpressionOperation::MUL: return "MUL";
+    case ExpressionOperation::DIV: return "DIV";
+    case ExpressionOperation::MOD: return "MOD";
+    case ExpressionOperation::RAT_DIV: return "RAT_DIV";
+    case ExpressionOperation::EQ: return "EQ";
+    case ExpressionOperation::NEQ: return "NEQ";
+    case ExpressionOperation::LESSER: return "LESSER";
+    case ExpressionOperation::GREATER: return "GREATER";
+    case ExpressionOperation::LESSEREQ: return "LESSEREQ";
+    case ExpressionOperation::GREATEREQ: return "GREATEREQ";
+    case ExpressionOperation::OR: return "OR";
+    case ExpressionOperation::XOR: return "XOR";
+    case ExpressionOperation::AND: return "AND";
+    case ExpressionOperation::NOT: return "NOT";
+    default: FAILURE();
+  }
+}
+
+static const char *int_operator(Opcode op) {
+  switch (op) {
+    case Opcode::ADD: return "+";
+    case Opcode::SUB: return "-";
+    case Opcode::MUL: return "*";
+    case Opcode::EQ: return "==";
+    case Opcode::NEQ: return "!=";
+    case Opcode::LESSER: return "<";
+    case Opcode::LESSEREQ: return "<=";
+    case Opcode::GREATER: return ">";
+    case Opcode::GREATEREQ: return ">=";
+    default: FAILURE();
+  }
+}
+
+static std::string string_literal(const std::string& str) {
+  std::stringstream ss;
+  ss << "\"";
+  for (char c : str) {
+    switch (c) {
+      case '"': ss << "\\\""; break;
+      case '\\': ss << "\\\\"; break;
+      case '\n': ss << "\\n\"\n  \""; break;
+      case '\t': ss << "\\t"; break;
+      default:
+        if (c >= 0x20 && c < 0x7f && c != '?') {
+          ss << c;
+        } else {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\%03o", (unsigned char) c);
+          ss << buf;
+        }
+    }
+  }
+  ss << "\"";
+  return ss.str();
+}
+
+static std::string reg(uint16_t r) {
+  return "r["+std::to_string(r)+"]";
+}
+
+static std::string node(size_t pc) {
+  return "chunk->code["+std::to_string(pc)+"].node";
+}
+
+static std::set<uint32_t> jump_targets(const JumpTable& table) {
+  std::set<uint32_t> targets(table.dense.begin(), table.dense.end());
+  for (auto& pair : table.targets) {
+    targets.insert(pair.second);
+  }
+  targets.insert(table.default_target);
+  return targets;
+}
+
+BytecodeUnroller::BytecodeUnroller(Driver& driver, const std::string& source)
+    : driver_(driver), source_(source), compiler_(), rule_names_(), derived_names_(),
+      chunk_(nullptr), labels_(), derived_(false) {}
+
+void BytecodeUnroller::generate(std::ostream& out) {
+  std::vector<std::pair<std::string, std::unique_ptr<Chunk>>> rules;
+  std::vector<std::pair<std::string, std::unique_ptr<Chunk>>> derived;
+
+  for (auto& pair : driver_.rules_map_) {
+    rule_names_[pair.first] = "rule_"+std::to_string(rules.size());
+    Chunk *chunk = new Chunk();
+    compiler_.compile_rule(pair.second, chunk);
+    rules.push_back(std::make_pair(pair.first, std::unique_ptr<Chunk>(chunk)));
+  }
+
+  for (auto& pair : driver_.function_table.table_) {
+    if (pair.second->type != Symbol::SymbolType::DERIVED) {
+      continue;
+    }
+    derived_names_[pair.first] = "derived_"+std::to_string(derived.size());
+    Chunk *chunk = new Chunk();
+    compiler_.compile_derived(reinterpret_cast<Function*>(pair.second), chunk);
+    derived.push_back(std::make_pair(pair.first, std::unique_ptr<Chunk>(chunk)));
+  }
+
+  out << "// unrolled by casmi --unroll-bytecode from " << driver_.get_filename() << std::endl;
+  out << "#include \"libinterpreter/unroller_runtime.h\"" << std::endl << std::endl;
+
+  for (auto& pair : rules) {
+    const std::string& name = rule_names_[pair.first];
+    out << "// rule " << pair.first << std::endl;
+    out << "static void " << name << "(const value_t arguments[]);" << std::endl;
+    out << "static const Chunk *chunk_" << name << ";" << std::endl;
+  }
+  for (auto& pair : derived) {
+    const std::string& name = derived_names_[pair.first];
+    out << "// derived " << pair.first << std::endl;
+    out << "static value_t " << name << "(const value_t arguments[]);" << std::endl;
+    out << "static const Chunk *chunk_" << name << ";" << std::endl;
+  }
+  out << std::endl;
+
+  for (auto& pair : rules) {
+    emit_function(out, rule_names_[pair.first], *pair.second, false);
+  }
+  for (auto& pair : derived) {
+    emit_function(out, derived_names_[pair.first], *pair.second, true);
+  }
+
+  out << "static const char source[] =" << std::endl;
+  out << "  " << string_literal(source_) << ";" << std::endl << std::endl;
+
+  out << "int main(int argc, char *argv[]) {" << std::endl;
+  out << "  UnrolledRule rules[] = {" << std::endl;
+  for (auto& pair : rules) {
+    const std::string& name = rule_names_[pair.first];
+    out << "    {" << string_literal(pair.first) << ", " << name << ", &chunk_" << name
+        << ", " << pair.second->code.size() << "}," << std::endl;
+  }
+  out << "  };" << std::endl;
+  if (derived.size() > 0) {
+    out << "  UnrolledDerived derived[] = {" << std::endl;
+    for (auto& pair : derived) {
+      const std::string& name = derived_names_[pair.first];
+      out << "    {" << string_literal(pair.first) << ", " << name << ", &chunk_" << name
+          << ", " << pair.second->code.size() << "}," << std::endl;
+    }
+    out << "  };" << std::endl;
+  } else {
+    out << "  UnrolledDerived *derived = nullptr;" << std::endl;
+  }
+  out << "  return unrolled_main(argc, argv, " << string_literal(driver_.get_filename())
+      << ", source, rules, " << rules.size() << ", derived, " << derived.size() << ");"
+      << std::endl;
+  out << "}" << std::endl;
+}
+
+void BytecodeUnroller::emit_function(std::ostream& out, const std::string& name,
+                                 const Chunk& chunk, bool derived) {
+  chunk_ = &chunk;
+  derived_ = derived;
+  labels_.clear();
+  for (const Instruction& inst : chunk.code) {
+    switch (inst.op) {
+      case Opcode::JUMP:
+      case Opcode::BRANCH:
+      case Opcode::JUMP_IF_EQ:
+      case Opcode::JUMP_IF_BOOL:
+        labels_.insert(inst.target);
+        break;
+      case Opcode::JUMP_TABLE:
+        for (uint32_t target : jump_targets(chunk.jump_tables[inst.b])) {
+          labels_.insert(target);
+        }
+        break;
+      default: break;
+    }
+  }
+
+  out << "static " << (derived ? "value_t " : "void ") << name
+      << "(const value_t arguments[]) {" << std::endl;
+  out << "  const Chunk *chunk = chunk_" << name << ";" << std::endl;
+  out << "  UNUSED(chunk);" << std::endl;
+  out << "  UNUSED(arguments);" << std::endl;
+  out << "  value_t r[" << std::max((uint16_t) 1, chunk.num_registers) << "];" << std::endl;
+  for (uint16_t i = 0; i < chunk.num_arguments; i++) {
+    out << "  " << reg(i) << " = arguments[" << i << "];" << std::endl;
+  }
+  emit_range(out, 0, chunk.code.size(), 1);
+  out << "}" << std::endl << std::endl;
+}
+
+void BytecodeUnroller::emit_range(std::ostream& out, size_t begin, size_t end, int indent) {
+  const std::string ind(indent * 2, ' ');
+  size_t pc = begin;
+
+  while (pc < end) {
+    if (labels_.count(pc) > 0) {
+      out << "L" << pc << ": ;" << std::endl;
+    }
+
+    const Instruction& inst = chunk_->code[pc];
+    switch (inst.op) {
+      case Opcode::FORALL:
+        out << ind << "unroller_runtime->forall(" << node(pc) << ", " << reg(inst.a)
+            << ", [&](const value_t& v) {" << std::endl;
+        out << ind << "  " << reg(inst.b) << " = v;" << std::endl;
+        emit_range(out, pc + 1, inst.target - 1, indent + 1);
+        if (labels_.count(inst.target - 1) > 0) {
+          out << "L" << (inst.target - 1) << ": ;" << std::endl;
+        }
+        out << ind << "});" << std::endl;
+        pc = inst.target;
+        break;
+      case Opcode::ITERATE:
+        out << ind << "unroller_runtime->iterate([&]() {" << std::endl;
+        emit_range(out, pc + 1, inst.target - 1, indent + 1);
+        if (labels_.count(inst.target - 1) > 0) {
+          out << "L" << (inst.target - 1) << ": ;" << std::endl;
+        }
+        out << ind << "});" << std::endl;
+        pc = inst.target;
+        break;
+      default:
+        emit_instruction(out, pc, ind);
+        pc += 1;
+    }
+  }
+}
+
+void BytecodeUnroller::emit_constant(std::ostream& out, const Instruction& inst) {
+  switch (inst.node->node_type_) {
+    case NodeType::INT_ATOM: {
+      INT_T val = reinterpret_cast<IntAtom*>(inst.node)->val_;
+      if (val == INT64_MIN) {
+        out << "value_t((INT_T) INT64_MIN)";
+      } else {
+        out << "value_t((INT_T) " << val << "LL)";
+      }
+      break;
+    }
+    case NodeType::FLOAT_ATOM: {
+      char buf[64];
+      snprintf(buf, sizeof(buf), "%.17g", reinterpret_cast<FloatAtom*>(inst.node)->val_);
+      std::string literal(buf);
+      if (literal.find_first_of(".e") == std::string::npos) {
+        literal += ".0";
+      }
+      out << "value_t((FLOAT_T) " << literal << ")";
+      break;
+    }
+    case NodeType::BOOLEAN_ATOM:
+      out << "value_t(" << (reinterpret_cast<BooleanAtom*>(inst.node)->value ? "true" : "false")
+          << ")";
+      break;
+    case NodeType::UNDEF_ATOM:
+    case NodeType::SELF_ATOM:
+      out << "value_t()";
+      break;
+    default:
+      // strings, rationals, lists, rules and enums are shared with the chunk
+      out << "chunk->constants[" << inst.b << "]";
+  }
+}
+
+void BytecodeUnroller::emit_binary(std::ostream& out, size_t pc) {
+  const Instruction& inst = chunk_->code[pc];
+  Expression *expr = reinterpret_cast<Expression*>(inst.node);
+  if (inst.op != Opcode::BINARY && expr->node_type_ == NodeType::INT_EXPRESSION) {
+    const bool cmp = inst.op != Opcode::ADD && inst.op != Opcode::SUB &&
+                     inst.op != Opcode::MUL;
+    out << "CASM_UNROLLED_INT_OP(" << reg(inst.a) << ", " << reg(inst.b) << ", "
+        << reg(inst.c) << ", " << int_operator(inst.op) << ", "
+        << (cmp ? "TypeType::BOOLEAN, boolean" : "TypeType::INT, integer")
+        << ", " << node(pc) << ");";
+  } else {
+    out << reg(inst.a) << " = operators::dispatch<ConcreteMode>(ExpressionOperation::"
+        << operation_name(expr->op) << ", " << reg(inst.b) << ", " << reg(inst.c) << ");";
+  }
+}
+
+void BytecodeUnroller::emit_instruction(std::ostream& out, size_t pc, const std::string& ind) {
+  const Instruction& inst = chunk_->code[pc];
+  const std::string args = "&"+reg(inst.b)+", "+std::to_string(inst.c);
+
+  out << ind;
+  switch (inst.op) {
+    case Opcode::LOAD_CONST:
+      out << reg(inst.a) << " = ";
+      emit_constant(out, inst);
+      out << ";";
+      break;
+    case Opcode::MOVE:
+      out << reg(inst.a) << " = " << reg(inst.b) << ";";
+      break;
+
+    case Opcode::ADD:
+    case Opcode::SUB:
+    case Opcode::MUL:
+    case Opcode::EQ:
+    case Opcode::NEQ:
+    case Opcode::LESSER:
+    case Opcode::LESSEREQ:
+    case Opcode::GREATER:
+    case Opcode::GREATEREQ:
+    case Opcode::BINARY:
+      emit_binary(out, pc);
+      break;
+    case Opcode::UNARY:
+      out << reg(inst.a) << " = operators::dispatch<ConcreteMode>(ExpressionOperation::"
+          << operation_name(reinterpret_cast<Expression*>(inst.node)->op) << ", "
+          << reg(inst.b) << ", " << reg(inst.b) << ");";
+      break;
+
+    case Opcode::READ:
+      out << reg(inst.a) << " = unroller_runtime->read(" << node(pc) << ", " << args << ");";
+      break;
+    case Opcode::READ_SUBRANGE:
+      out << reg(inst.a) << " = unroller_runtime->read_subrange(" << node(pc) << ", "
+          << args << ");";
+      break;
+    case Opcode::DERIVED: {
+      FunctionAtom *atom = reinterpret_cast<FunctionAtom*>(inst.node);
+      out << reg(inst.a) << " = " << derived_names_.at(atom->symbol->name) << "(&"
+          << reg(inst.b) << ");";
+      break;
+    }
+    case Opcode::BUILTIN:
+      out << reg(inst.a) << " = unroller_runtime->builtin(" << node(pc) << ", " << args << ");";
+      break;
+    case Opcode::LIST:
+      out << reg(inst.a) << " = unroller_runtime->list(" << node(pc) << ", " << args << ");";
+      break;
+    case Opcode::RANGE:
+      out << reg(inst.a) << " = unroller_runtime->range(" << node(pc) << ", " << reg(inst.b)
+          << ", " << reg(inst.c) << ");";
+      break;
+
+    case Opcode::UPDATE:
+    case Opcode::UPDATE_SUBRANGE:
+    case Opcode::UPDATE_DUMPS:
+      out << "unroller_runtime->update(Opcode::" << opcode_to_str(inst.op) << ", "
+          << node(pc) << ", " << reg(inst.a) << ", " << args << ");";
+      break;
+    case Opcode::PUSH:
+      out << "unroller_runtime->push(" << node(pc) << ", " << reg(inst.a) << ", "
+          << reg(inst.b) << ");";
+      break;
+    case Opcode::POP:
+      if (reinterpret_cast<PopNode*>(inst.node)->to->symbol_type !=
+          FunctionAtom::SymbolType::FUNCTION) {
+        out << reg(inst.b) << " = ";
+      }
+      out << "unroller_runtime->pop(" << node(pc) << ", " << reg(inst.a) << ");";
+      break;
+
+    case Opcode::JUMP:
+      out << "goto L" << inst.target << ";";
+      break;
+    case Opcode::BRANCH:
+      out << "if (" << reg(inst.a) << ".is_undef()) { unroller_runtime->undef_condition("
+          << node(pc) << "); }" << std::endl;
+      out << ind << "if (!" << reg(inst.a) << ".value.boolean) { goto L" << inst.target << "; }";
+      break;
+    case Opcode::JUMP_IF_EQ:
+      out << "if (" << reg(inst.b) << " == " << reg(inst.a) << ") { goto L"
+          << inst.target << "; }";
+      break;
+    case Opcode::JUMP_IF_BOOL:
+      out << "if (" << reg(inst.a) << ".type == TypeType::BOOLEAN && "
+          << ((inst.b) ? "" : "!") << reg(inst.a) << ".value.boolean) { goto L"
+          << inst.target << "; }";
+      break;
+    case Opcode::JUMP_TABLE:
+      // the table is looked up in the chunk, which is compiled from the
+      // embedded specification at startup
+      out << "switch (chunk->jump_tables[" << inst.b << "].lookup(" << reg(inst.a) << ")) {";
+      for (uint32_t target : jump_targets(chunk_->jump_tables[inst.b])) {
+        out << " case " << target << ": goto L" << target << ";";
+      }
+      out << " default: FAILURE(); }";
+      break;
+
+    case Opcode::SEQ_BEGIN:
+      out << reg(inst.a) << " = value_t(unroller_runtime->seq_begin());";
+      break;
+    case Opcode::SEQ_END:
+      out << "unroller_runtime->seq_end(" << reg(inst.a) << ".value.boolean);";
+      break;
+    case Opcode::PAR_BEGIN:
+      out << reg(inst.a) << " = value_t(unroller_runtime->par_begin("
+          << (inst.b ? "true" : "false") << "));";
+      break;
+    case Opcode::PAR_END:
+      out << "unroller_runtime->par_end(" << reg(inst.a) << ".value.boolean);";
+      break;
+
+    case Opcode::CALL_PRE:
+      out << "unroller_runtime->call_pre(" << node(pc) << ", " << reg(inst.a) << ");";
+      break;
+    case Opcode::CALL: {
+      CallNode *call = reinterpret_cast<CallNode*>(inst.node);
+      if (call->ruleref) {
+        out << "unroller_runtime->call_indirect(" << node(pc) << ", " << args << ");";
+      } else if (call->rule) {
+        out << rule_names_.at(call->rule->name) << "(&" << reg(inst.b) << ");";
+      } else {
+        out << "// rule `" << call->rule_name << "` not set";
+      }
+      break;
+    }
+
+    case Opcode::ASSERT:
+      out << "unroller_runtime->assert_(" << node(pc) << ", " << reg(inst.a) << ");";
+      break;
+    case Opcode::ASSURE:
+      out << "unroller_runtime->assure(" << node(pc) << ", " << reg(inst.a) << ");";
+      break;
+    case Opcode::PRINT:
+      out << "unroller_runtime->print(" << node(pc) << ", &" << reg(inst.a) << ", "
+          << inst.b << ");";
+      break;
+    case Opcode::DIEDIE:
+      out << "unroller_runtime->diedie(" << node(pc) << ", "
+          << ((inst.b) ? reg(inst.a) : "value_t()") << ");";
+      break;
+    case Opcode::IMPOSSIBLE:
+      out << "unroller_runtime->impossible(" << node(pc) << ");";
+      break;
+
+    case Opcode::END:
+      if (derived_) {
+        out << "return " << reg(inst.a) << ";";
+      } else {
+        out << "return;";
+      }
+      break;
+
+    default:
+      throw RuntimeException(std::string("cannot emit instruction ")+
+                             opcode_to_str(inst.op));
+  }
+  out << std::endl;
+}
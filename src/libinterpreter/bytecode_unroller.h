@@ -0,0 +1,49 @@
+#ifndef CASMI_LIBINTERPRETER_BYTECODE_UNROLLER_H
+#define CASMI_LIBINTERPRETER_BYTECODE_UNROLLER_H
+
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+
+#include "libsyntax/driver.h"
+
+#include "libinterpreter/bytecode.h"
+
+// Unrolls the bytecode of a typechecked specification to C++ which links
+// against libinterpreter (see unroller_runtime.h). Rules and derived functions
+// are lowered with the BytecodeCompiler first, the instructions are then
+// emitted as C++ statements with one local register array per function.
+//
+// This only removes the dispatch loop of the VM: registers stay untyped
+// value_t, function reads, updates and builtins call into the runtime and
+// operators other than Int arithmetic are dispatched like in the VM.
+class BytecodeUnroller {
+  private:
+    Driver& driver_;
+    const std::string source_;
+
+    BytecodeCompiler compiler_;
+    std::map<std::string, std::string> rule_names_;
+    std::map<std::string, std::string> derived_names_;
+
+    const Chunk *chunk_;
+    std::set<size_t> labels_;
+    bool derived_;
+
+    void emit_function(std::ostream& out, const std::string& name, const Chunk& chunk,
+                       bool derived);
+    void emit_range(std::ostream& out, size_t begin, size_t end, int indent);
+    void emit_instruction(std::ostream& out, size_t pc, const std::string& ind);
+    void emit_constant(std::ostream& out, const Instruction& inst);
+    void emit_binary(std::ostream& out, size_t pc);
+
+  public:
+    // source is embedded in the generated code, the specification must be
+    // typechecked and optimized like in unrolled_main
+    BytecodeUnroller(Driver& driver, const std::string& source);
+
+    void generate(std::ostream& out);
+};
+
+#endif
@@ -0,0 +1,407 @@
+#include <assert.h>
+
+#include "macros.h"
+#include "libutil/exceptions.h"
+
+#include "libinterpreter/bytecode_vm.h"
+#include "libinterpreter/bigint.h"
+#include "libinterpreter/operators.h"
+#include "libinterpreter/symbolic.h"
+
+// integer fast path of binary operations, everything else goes through
+// operators::dispatch
+#define INT_OPERATION(int_op, result_type, result_field)                     \
+  {                                                                          \
+    const value_t& lhs = regs[inst.b];                                       \
+    const value_t& rhs = regs[inst.c];                                       \
+    if (lhs.type == TypeType::INT && rhs.type == TypeType::INT) {            \
+      const auto res = lhs.value.integer int_op rhs.value.integer;           \
+      regs[inst.a].type = result_type;                                       \
+      regs[inst.a].value.result_field = res;                                 \
+    } else {                                                                 \
+      regs[inst.a] = operators::dispatch<ConcreteMode>(                      \
+          reinterpret_cast<Expression*>(inst.node)->op, lhs, rhs);           \
+    }                                                                        \
+    break;                                                                   \
+  }
+
+// like INT_OPERATION, results that overflow become big integers
+#define BIG_INT_OPERATION(big_op)                                            \
+  {                                                                          \
+    const value_t& lhs = regs[inst.b];                                       \
+    const value_t& rhs = regs[inst.c];                                       \
+    if (lhs.type == TypeType::INT && rhs.type == TypeType::INT) {            \
+      regs[inst.a] = bigint::big_op(lhs.value.integer, rhs.value.integer);   \
+    } else {                                                                 \
+      regs[inst.a] = operators::dispatch<ConcreteMode>(                      \
+          reinterpret_cast<Expression*>(inst.node)->op, lhs, rhs);           \
+    }                                                                        \
+    break;                                                                   \
+  }
+
+BytecodeVM::BytecodeVM(ExecutionVisitor<ConcreteMode>& visitor)
+    : visitor_(visitor), compiler_(), rules_(), derived_(), registers_() {}
+
+const Chunk *BytecodeVM::rule_chunk(RuleNode *rule) {
+  auto iter = rules_.find(rule);
+  if (iter != rules_.end()) {
+    return iter->second.get();
+  }
+  Chunk *chunk = new Chunk();
+  rules_[rule] = std::unique_ptr<Chunk>(chunk);
+  compiler_.compile_rule(rule, chunk);
+  return chunk;
+}
+
+const Chunk *BytecodeVM::derived_chunk(Function *derived) {
+  auto iter = derived_.find(derived);
+  if (iter != derived_.end()) {
+    return iter->second.get();
+  }
+  Chunk *chunk = new Chunk();
+  derived_[derived] = std::unique_ptr<Chunk>(chunk);
+  compiler_.compile_derived(derived, chunk);
+  return chunk;
+}
+
+value_t *BytecodeVM::reserve(size_t base, const Chunk *chunk) {
+  if (registers_.size() < base + chunk->num_registers) {
+    registers_.resize(base + chunk->num_registers);
+  }
+  return &registers_[base];
+}
+
+void BytecodeVM::execute_rule(RuleNode *rule) {
+  call_rule(rule, 0, 0, 0);
+}
+
+void BytecodeVM::call_rule(RuleNode *rule, size_t arguments, uint16_t num_arguments,
+                           size_t base) {
+  const Chunk *chunk = rule_chunk(rule);
+  value_t *regs = reserve(base, chunk);
+  for (uint16_t i = 0; i < num_arguments; i++) {
+    regs[i] = registers_[arguments + i];
+  }
+  run(chunk, 0, base);
+}
+
+const value_t BytecodeVM::run_derived(FunctionAtom *atom, size_t arguments,
+                                      uint16_t num_arguments, size_t base) {
+  const Chunk *chunk = derived_chunk(atom->symbol);
+  value_t *regs = reserve(base, chunk);
+  for (uint16_t i = 0; i < num_arguments; i++) {
+    regs[i] = registers_[arguments + i];
+  }
+  run(chunk, 0, base);
+  return registers_[base + chunk->code.back().a];
+}
+
+const value_t BytecodeVM::call_derived(FunctionAtom *atom, size_t arguments,
+                                       uint16_t num_arguments, size_t base) {
+  DerivedCache& cache = visitor_.context_.derived_cache;
+  if (cache.enabled) {
+    // the arguments are packed before the register file can grow
+    return cache.get(atom->symbol, &registers_[arguments], num_arguments, [&]() {
+      return run_derived(atom, arguments, num_arguments, base);
+    });
+  }
+  return run_derived(atom, arguments, num_arguments, base);
+}
+
+void BytecodeVM::update(const Instruction& inst, const value_t regs[]) {
+  for (uint16_t i = 0; i < inst.c; i++) {
+    visitor_.arguments[i] = regs[inst.b + i];
+  }
+  visitor_.num_arguments = inst.c;
+
+  UpdateNode *node = reinterpret_cast<UpdateNode*>(inst.node);
+  switch (inst.op) {
+    case Opcode::UPDATE:
+      visitor_.visit_update(node, regs[inst.a]);
+      break;
+    case Opcode::UPDATE_SUBRANGE:
+      visitor_.visit_update_subrange(node, regs[inst.a]);
+      break;
+    case Opcode::UPDATE_DUMPS:
+      visitor_.visit_update_dumps(node, regs[inst.a]);
+      break;
+    default: FAILURE();
+  }
+}
+
+void BytecodeVM::run(const Chunk *chunk, size_t pc, size_t base) {
+  const Instruction *code = chunk->code.data();
+  ExecutionContext& context = visitor_.context_;
+  // the register file can grow while calling other rules, regs must be
+  // reloaded after every instruction that executes other chunks
+  value_t *regs = &registers_[base];
+  const size_t callee_base = base + chunk->num_registers;
+
+  while (true) {
+    const Instruction& inst = code[pc];
+    pc += 1;
+
+    switch (inst.op) {
+      case Opcode::LOAD_CONST:
+        regs[inst.a] = chunk->constants[inst.b];
+        break;
+      case Opcode::MOVE:
+        regs[inst.a] = regs[inst.b];
+        break;
+
+      case Opcode::ADD: INT_OPERATION(+, TypeType::INT, integer)
+      case Opcode::SUB: INT_OPERATION(-, TypeType::INT, integer)
+      case Opcode::MUL: INT_OPERATION(*, TypeType::INT, integer)
+      case Opcode::LESSER: INT_OPERATION(<, TypeType::BOOLEAN, boolean)
+      case Opcode::LESSEREQ: INT_OPERATION(<=, TypeType::BOOLEAN, boolean)
+      case Opcode::GREATER: INT_OPERATION(>, TypeType::BOOLEAN, boolean)
+      case Opcode::GREATEREQ: INT_OPERATION(>=, TypeType::BOOLEAN, boolean)
+      case Opcode::EQ: INT_OPERATION(==, TypeType::BOOLEAN, boolean)
+      case Opcode::NEQ: INT_OPERATION(!=, TypeType::BOOLEAN, boolean)
+      case Opcode::BIG_ADD: BIG_INT_OPERATION(add)
+      case Opcode::BIG_SUB: BIG_INT_OPERATION(sub)
+      case Opcode::BIG_MUL: BIG_INT_OPERATION(mul)
+      case Opcode::BINARY:
+        regs[inst.a] = operators::dispatch<ConcreteMode>(
+            reinterpret_cast<Expression*>(inst.node)->op, regs[inst.b], regs[inst.c]);
+        break;
+      case Opcode::UNARY:
+        regs[inst.a] = operators::dispatch<ConcreteMode>(
+            reinterpret_cast<Expression*>(inst.node)->op, regs[inst.b], regs[inst.b]);
+        break;
+
+      case Opcode::READ: {
+        uint64_t args[10];
+        uint16_t sym_args = pack_values_in_array<ConcreteMode>(&regs[inst.b], args, inst.c);
+        regs[inst.a] = context.get_function_value(
+            reinterpret_cast<FunctionAtom*>(inst.node)->symbol, args, sym_args);
+        break;
+      }
+      case Opcode::READ_SUBRANGE:
+        regs[inst.a] = visitor_.visit_function_atom_subrange(
+            reinterpret_cast<FunctionAtom*>(inst.node), &regs[inst.b], inst.c);
+        break;
+      case Opcode::DERIVED: {
+        const value_t v = call_derived(reinterpret_cast<FunctionAtom*>(inst.node),
+                                       base + inst.b, inst.c, callee_base);
+        regs = &registers_[base];
+        regs[inst.a] = v;
+        break;
+      }
+      case Opcode::BUILTIN:
+        regs[inst.a] = visitor_.visit_builtin_atom(
+            reinterpret_cast<BuiltinAtom*>(inst.node), &regs[inst.b], inst.c);
+        break;
+      case Opcode::LIST: {
+        const std::vector<value_t> vals(&regs[inst.b], &regs[inst.b + inst.c]);
+        regs[inst.a] = visitor_.visit_list_atom(reinterpret_cast<ListAtom*>(inst.node),
+                                                vals);
+        break;
+      }
+      case Opcode::RANGE:
+        regs[inst.a] = visitor_.visit_number_range_atom(
+            reinterpret_cast<NumberRangeAtom*>(inst.node), regs[inst.b], regs[inst.c]);
+        break;
+
+      case Opcode::UPDATE:
+      case Opcode::UPDATE_SUBRANGE:
+      case Opcode::UPDATE_DUMPS:
+        update(inst, regs);
+        break;
+      case Opcode::PUSH:
+        visitor_.visit_push(reinterpret_cast<PushNode*>(inst.node), regs[inst.a],
+                            regs[inst.b]);
+        break;
+      case Opcode::POP: {
+        PopNode *node = reinterpret_cast<PopNode*>(inst.node);
+        const value_t to_res = visitor_.apply_pop(node, regs[inst.a]);
+        if (node->to->symbol_type != FunctionAtom::SymbolType::FUNCTION) {
+          regs[inst.b] = to_res;
+        }
+        break;
+      }
+
+      case Opcode::JUMP:
+        pc = inst.target;
+        break;
+      case Opcode::BRANCH: {
+        const value_t& cond = regs[inst.a];
+        if (cond.is_undef()) {
+          visitor_.driver_.error(
+              reinterpret_cast<IfThenElseNode*>(inst.node)->condition_->location,
+              "condition must be true or false but was undef");
+          throw RuntimeException("Condition is undef");
+        }
+        if (!cond.value.boolean) {
+          pc = inst.target;
+        }
+        break;
+      }
+      case Opcode::JUMP_IF_EQ:
+        if (regs[inst.b] == regs[inst.a]) {
+          pc = inst.target;
+        }
+        break;
+      case Opcode::JUMP_IF_BOOL:
+        if (regs[inst.a].type == TypeType::BOOLEAN &&
+            regs[inst.a].value.boolean == (inst.b != 0)) {
+          pc = inst.target;
+        }
+        break;
+      case Opcode::JUMP_TABLE:
+        pc = chunk->jump_tables[inst.b].lookup(regs[inst.a]);
+        break;
+
+      case Opcode::SEQ_BEGIN:
+        regs[inst.a] = value_t(context.updateset.pseudostate % 2 == 0);
+        if (regs[inst.a].value.boolean) {
+          CASM_UPDATESET_FORK_SEQ(&context.updateset);
+        }
+        break;
+      case Opcode::SEQ_END:
+        if (regs[inst.a].value.boolean) {
+          context.merge_seq(visitor_.driver_);
+        }
+        break;
+      case Opcode::PAR_BEGIN:
+        regs[inst.a] = value_t(context.fork_par(inst.b != 0));
+        break;
+      case Opcode::PAR_END:
+        if (regs[inst.a].value.boolean) {
+          context.merge_par();
+        }
+        break;
+
+      case Opcode::FORALL: {
+        ForallNode *node = reinterpret_cast<ForallNode*>(inst.node);
+        const value_t in_list = regs[inst.a];
+        const bool forked = context.fork_par(node->unchecked_updates);
+
+        switch (node->in_expr->type_.t) {
+          case TypeType::LIST: {
+            if (in_list.is_undef()) {
+              break;
+            }
+            List *l = in_list.value.list;
+            if (l->is_range()) {
+              RangeList *range = reinterpret_cast<RangeList*>(l);
+              for (size_t i = 0; i < range->count; i++) {
+                registers_[base + inst.b] = value_t(range->at(i));
+                run(chunk, pc, base);
+              }
+              break;
+            }
+            for (auto iter = l->begin(); iter != l->end(); iter++) {
+              registers_[base + inst.b] = *iter;
+              run(chunk, pc, base);
+            }
+            break;
+          }
+          case TypeType::INT: {
+            INT_T end = in_list.value.integer;
+            if (end > 0) {
+              for (INT_T i = 0; i < end; i++) {
+                registers_[base + inst.b] = value_t(i);
+                run(chunk, pc, base);
+              }
+            } else {
+              for (INT_T i = 0; end < i; i--) {
+                registers_[base + inst.b] = value_t(i);
+                run(chunk, pc, base);
+              }
+            }
+            break;
+          }
+          case TypeType::ENUM: {
+            FunctionAtom *func = reinterpret_cast<FunctionAtom*>(node->in_expr);
+            assert(func->name == func->enum_->name);
+            for (auto pair : func->enum_->mapping) {
+              // the mapping contains an element with the name of the enum
+              if (func->name == pair.first) {
+                continue;
+              }
+              value_t v = value_t(pair.second);
+              v.type = TypeType::ENUM;
+              registers_[base + inst.b] = v;
+              run(chunk, pc, base);
+            }
+            break;
+          }
+          default: assert(0);
+        }
+
+        if (forked) {
+          context.merge_par();
+        }
+        regs = &registers_[base];
+        pc = inst.target;
+        break;
+      }
+      case Opcode::ITERATE: {
+        bool forked = false;
+        bool running = true;
+        if (context.updateset.pseudostate % 2 == 0) {
+          CASM_UPDATESET_FORK_SEQ(&context.updateset);
+          forked = true;
+        }
+
+        while (running) {
+          CASM_UPDATESET_FORK_PAR(&context.updateset);
+          run(chunk, pc, base);
+          if (CASM_UPDATESET_EMPTY(&context.updateset)) {
+            running = false;
+          }
+          context.merge_par();
+        }
+
+        if (forked) {
+          context.merge_seq(visitor_.driver_);
+        }
+        regs = &registers_[base];
+        pc = inst.target;
+        break;
+      }
+
+      case Opcode::CALL_PRE:
+        visitor_.visit_call_pre(reinterpret_cast<CallNode*>(inst.node), regs[inst.a]);
+        break;
+      case Opcode::CALL: {
+        CallNode *call = reinterpret_cast<CallNode*>(inst.node);
+        if (call->rule == nullptr) {
+          DEBUG("rule not set!");
+          break;
+        }
+        if (call->ruleref) {
+          visitor_.check_call_arguments(call, &regs[inst.b], inst.c);
+        }
+        call_rule(call->rule, base + inst.b, inst.c, callee_base);
+        regs = &registers_[base];
+        break;
+      }
+
+      case Opcode::ASSERT:
+        visitor_.visit_assert(reinterpret_cast<UnaryNode*>(inst.node), regs[inst.a]);
+        break;
+      case Opcode::ASSURE:
+        visitor_.visit_assure(reinterpret_cast<UnaryNode*>(inst.node), regs[inst.a]);
+        break;
+      case Opcode::PRINT: {
+        const std::vector<value_t> vals(&regs[inst.a], &regs[inst.a + inst.b]);
+        visitor_.visit_print(reinterpret_cast<PrintNode*>(inst.node), vals);
+        break;
+      }
+      case Opcode::DIEDIE:
+        visitor_.visit_diedie(reinterpret_cast<DiedieNode*>(inst.node),
+                              (inst.b) ? regs[inst.a] : value_t());
+        break;
+      case Opcode::IMPOSSIBLE:
+        visitor_.visit_impossible(inst.node);
+        break;
+
+      case Opcode::END:
+        return;
+
+      default: FAILURE();
+    }
+  }
+}
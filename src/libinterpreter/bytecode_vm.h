@@ -0,0 +1,48 @@
+#ifndef CASMI_LIBINTERPRETER_BYTECODE_VM_H
+#define CASMI_LIBINTERPRETER_BYTECODE_VM_H
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "libinterpreter/bytecode.h"
+#include "libinterpreter/execution_visitor.h"
+
+// Register based VM which executes rules compiled by BytecodeCompiler. It is
+// only used in concrete mode, the leaf operations (updates, builtins, prints,
+// error reporting) are shared with the ExecutionVisitor to keep the behavior
+// identical to the AST walker.
+class BytecodeVM : public RuleExecutor {
+  private:
+    ExecutionVisitor<ConcreteMode>& visitor_;
+    BytecodeCompiler compiler_;
+
+    std::unordered_map<const RuleNode*, std::unique_ptr<Chunk>> rules_;
+    std::unordered_map<const Function*, std::unique_ptr<Chunk>> derived_;
+
+    // register file shared by all active rules, each call gets a window
+    // starting at base
+    std::vector<value_t> registers_;
+
+    const Chunk *rule_chunk(RuleNode *rule);
+    const Chunk *derived_chunk(Function *derived);
+    value_t *reserve(size_t base, const Chunk *chunk);
+
+    void run(const Chunk *chunk, size_t pc, size_t base);
+    // arguments is the index of the first argument in the register file
+    void call_rule(RuleNode *rule, size_t arguments, uint16_t num_arguments,
+                   size_t base);
+    const value_t run_derived(FunctionAtom *atom, size_t arguments,
+                              uint16_t num_arguments, size_t base);
+    // goes through the derived cache if it is enabled
+    const value_t call_derived(FunctionAtom *atom, size_t arguments,
+                               uint16_t num_arguments, size_t base);
+    void update(const Instruction& inst, const value_t regs[]);
+
+  public:
+    BytecodeVM(ExecutionVisitor<ConcreteMode>& visitor);
+
+    void execute_rule(RuleNode *rule);
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include <algorithm>
+
+#include "libinterpreter/derived_cache.h"
+#include "libinterpreter/execution_visitor.h"
+
+// interned arguments must outlive the entries using them as key
+static void retain_arguments(const Function *derived, const uint64_t args[], bool retain) {
+  for (size_t i = 0; i < derived->argument_count(); i++) {
+    value_t v;
+    v.type = derived->arguments_[i]->t;
+    v.value.integer = args[i];
+    if (v.is_list()) {
+      // list arguments are packed as interned lists
+      const InternedList *list = reinterpret_cast<const InternedList*>(args[i]);
+      if (retain) {
+        InternedList::bump_usage(list);
+      } else {
+        InternedList::decrease_usage(list);
+      }
+    } else if (retain) {
+      v.bump_usage();
+    } else {
+      v.decrease_usage();
+    }
+  }
+}
+
+DerivedCache::table::table(const Function *derived)
+    : derived(derived), entries(0, {derived->arguments_}, {derived->arguments_}) {}
+
+DerivedCache::DerivedCache(size_t num_symbols)
+    : tables_(num_symbols), uncachable_(num_symbols, 0), dependents_(num_symbols),
+      written_(num_symbols, 0), writes_(), reads_(), depth_(0), enabled(false) {}
+
+DerivedCache::~DerivedCache() {}
+
+DerivedCache::table *DerivedCache::create_table(const Function *derived) {
+  if (uncachable_[derived->id]) {
+    return nullptr;
+  }
+  switch (derived->return_type_->t) {
+    case TypeType::LIST:
+    case TypeType::TUPLE:
+    case TypeType::TUPLE_OR_LIST:
+      uncachable_[derived->id] = 1;
+      return nullptr;
+    default:
+      break;
+  }
+  tables_[derived->id].reset(new table(derived));
+  return tables_[derived->id].get();
+}
+
+bool DerivedCache::pack(const value_t arguments[], uint16_t num_arguments,
+                        uint64_t args[]) const {
+  for (uint16_t i = 0; i < num_arguments; i++) {
+    // undef is packed like the zero value of the type
+    if (arguments[i].is_undef()) {
+      return false;
+    }
+  }
+  pack_values_in_array<ConcreteMode>(arguments, args, num_arguments);
+  return true;
+}
+
+bool DerivedCache::is_stale(const std::vector<uint32_t>& reads) const {
+  for (uint32_t func : reads) {
+    if (written_[func] != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void DerivedCache::store(table *t, uint64_t args[], const value_t& result, size_t mark) {
+  std::vector<uint32_t> reads(reads_.begin() + mark, reads_.end());
+  std::sort(reads.begin(), reads.end());
+  reads.erase(std::unique(reads.begin(), reads.end()), reads.end());
+  // the callers depend on the same functions
+  reads_.resize(mark);
+  if (depth_ > 0) {
+    reads_.insert(reads_.end(), reads.begin(), reads.end());
+  }
+
+  if (!writes_.empty() && is_stale(reads)) {
+    return;
+  }
+
+  const uint16_t num_args = t->derived->argument_count();
+  auto iter = t->entries.find(ArgumentsKey(args, num_args, false, 0));
+  if (iter != t->entries.end()) {
+    // a stale entry which is replaced
+    iter->second.value.decrease_usage();
+    iter->second.value = result;
+    iter->second.reads = reads;
+  } else {
+    retain_arguments(t->derived, args, true);
+    entry e = {result, reads};
+    t->entries.emplace(ArgumentsKey(args, num_args, true, 0), std::move(e));
+  }
+  result.bump_usage();
+
+  for (uint32_t func : reads) {
+    std::vector<table*>& dependents = dependents_[func];
+    if (std::find(dependents.begin(), dependents.end(), t) == dependents.end()) {
+      dependents.push_back(t);
+    }
+  }
+}
+
+void DerivedCache::release(const table *t, const ArgumentsKey& key, const entry& e) {
+  e.value.decrease_usage();
+  retain_arguments(t->derived, key.p, false);
+}
+
+void DerivedCache::apply_updates() {
+  if (writes_.empty()) {
+    return;
+  }
+
+  std::vector<table*> affected;
+  for (uint32_t func : writes_) {
+    affected.insert(affected.end(), dependents_[func].begin(), dependents_[func].end());
+  }
+  std::sort(affected.begin(), affected.end());
+  affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+  for (table *t : affected) {
+    for (auto iter = t->entries.begin(); iter != t->entries.end();) {
+      if (is_stale(iter->second.reads)) {
+        release(t, iter->first, iter->second);
+        iter = t->entries.erase(iter);
+      } else {
+        iter++;
+      }
+    }
+  }
+
+  // no entry reads an updated function anymore
+  for (uint32_t func : writes_) {
+    dependents_[func].clear();
+    written_[func] = 0;
+  }
+  writes_.clear();
+}
+
+void DerivedCache::clear() {
+  for (auto& t : tables_) {
+    if (t) {
+      for (const auto& pair : t->entries) {
+        release(t.get(), pair.first, pair.second);
+      }
+      t->entries.clear();
+    }
+  }
+  for (auto& dependents : dependents_) {
+    dependents.clear();
+  }
+  for (uint32_t func : writes_) {
+    written_[func] = 0;
+  }
+  writes_.clear();
+  reads_.clear();
+  depth_ = 0;
+}
+
+size_t DerivedCache::size() const {
+  size_t size = 0;
+  for (const auto& t : tables_) {
+    if (t) {
+      size += t->entries.size();
+    }
+  }
+  return size;
+}
@@ -0,0 +1,121 @@
+#ifndef CASMI_LIBINTERPRETER_DERIVED_CACHE_H
+#define CASMI_LIBINTERPRETER_DERIVED_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "libsyntax/symbols.h"
+
+#include "libinterpreter/value.h"
+#include "libinterpreter/function_state.h"
+
+// Results of derived functions keyed on the derived function and its
+// arguments, enabled by --cache-derived. Every entry records the functions
+// read while computing it and is dropped in apply_updates when one of them
+// was updated. Updates of the current step are visible to reads in
+// sequential blocks, entries that read a function updated in the current step
+// are neither used nor stored.
+class DerivedCache {
+  private:
+    struct entry {
+      value_t value;
+      // sorted ids of the functions read while computing the value
+      std::vector<uint32_t> reads;
+    };
+
+    struct table {
+      const Function *derived;
+      std::unordered_map<ArgumentsKey, entry> entries;
+
+      table(const Function *derived);
+    };
+
+    // by id of the derived function, nullptr if it has not been called yet
+    std::vector<std::unique_ptr<table>> tables_;
+    // results with list values live in the list arena of the step
+    std::vector<uint8_t> uncachable_;
+    // tables with entries that read the function, by id of the function
+    std::vector<std::vector<table*>> dependents_;
+
+    // functions updated in the current step
+    std::vector<uint8_t> written_;
+    std::vector<uint32_t> writes_;
+
+    // functions read by the derived functions being computed, nested calls
+    // append to the reads of their callers
+    std::vector<uint32_t> reads_;
+    uint32_t depth_;
+
+    // creates the table on the first call, nullptr if the derived function
+    // is not cached
+    table *create_table(const Function *derived);
+    // returns false if the arguments can not be used as key
+    bool pack(const value_t arguments[], uint16_t num_arguments, uint64_t args[]) const;
+    bool is_stale(const std::vector<uint32_t>& reads) const;
+    void store(table *t, uint64_t args[], const value_t& result, size_t mark);
+    void release(const table *t, const ArgumentsKey& key, const entry& e);
+
+  public:
+    bool enabled;
+
+    DerivedCache(size_t num_symbols = 0);
+    DerivedCache(const DerivedCache& other) = delete;
+    ~DerivedCache();
+
+    inline void read(uint32_t func) {
+      if (depth_ > 0) {
+        reads_.push_back(func);
+      }
+    }
+
+    inline void write(uint32_t func) {
+      if (enabled && written_[func] == 0) {
+        written_[func] = 1;
+        writes_.push_back(func);
+      }
+    }
+
+    // returns the cached result of the derived function for the arguments or
+    // computes it by calling compute()
+    template<class F>
+    const value_t get(const Function *derived, const value_t arguments[],
+                      uint16_t num_arguments, F compute);
+
+    // drops the entries that read a function updated in this step
+    void apply_updates();
+    void clear();
+    size_t size() const;
+};
+
+template<class F>
+const value_t DerivedCache::get(const Function *derived, const value_t arguments[],
+                                uint16_t num_arguments, F compute) {
+  table *t = tables_[derived->id].get();
+  if (t == nullptr) {
+    t = create_table(derived);
+  }
+  uint64_t args[10];
+  if (t == nullptr || !pack(arguments, num_arguments, args)) {
+    return compute();
+  }
+
+  auto iter = t->entries.find(ArgumentsKey(args, num_arguments, false, 0));
+  if (iter != t->entries.end() &&
+      (writes_.empty() || !is_stale(iter->second.reads))) {
+    if (depth_ > 0) {
+      reads_.insert(reads_.end(), iter->second.reads.begin(), iter->second.reads.end());
+    }
+    return iter->second.value;
+  }
+
+  const size_t mark = reads_.size();
+  depth_ += 1;
+  const value_t result = compute();
+  depth_ -= 1;
+  store(t, args, result, mark);
+  return result;
+}
+
+#endif
@@ -1,46 +1,13 @@
+#include <algorithm>
 #include <sstream>
 
 #include "macros.h"
 #include "libutil/exceptions.h"
 
 #include "libinterpreter/execution_context.h"
+#include "libinterpreter/bigint.h"
 #include "libinterpreter/symbolic.h"
 
-//#define UPDATESET_DATA_SIZE 65535*64 * 50
-//#define UPDATESET_SIZE 65535*64
-#define UPDATESET_SIZE 1561 * 19
-#define UPDATESET_DATA_SIZE UPDATESET_SIZE * 50
-#define TEMP_STACK_SIZE 1024 * 1024 * 10
-
-ArgumentsKey::ArgumentsKey(uint64_t *args, uint16_t size, bool dyn,
-    uint16_t syms) : dynamic(dyn), sym_args(syms) {
-  if (dynamic) {
-    p = new uint64_t[size];
-    for (uint16_t i = 0; i < size; i++) {
-      p[i] = args[i];
-    }
-  } else {
-    p = args;
-  }
-}
-
-ArgumentsKey::ArgumentsKey(const ArgumentsKey& other) : p(other.p),
-    dynamic(other.dynamic), sym_args(other.sym_args) {
-}
-
-ArgumentsKey::ArgumentsKey(ArgumentsKey&& other) noexcept {
-  p = other.p;
-  dynamic = other.dynamic;
-  other.dynamic = false;
-  sym_args = other.sym_args;
-}
-
-ArgumentsKey::~ArgumentsKey() {
-  if (dynamic) {
-    delete[] p;
-  }
-}
-
 std::string arguments_to_string(const Function *func, const uint64_t args[]) {
   std::stringstream ss;
   if (func->arguments_.size() == 0) {
@@ -59,27 +26,20 @@ std::string arguments_to_string(const Function *func, const uint64_t args[]) {
   return "("+ss.str().substr(0, ss.str().size()-2)+")";
 }
 
-pp_mem ExecutionContext::value_stack;
-
 ExecutionContext::ExecutionContext(const SymbolTable& st, RuleNode *init,
     const bool symbolic, const bool fileout, const bool dump_updates): debuginfo_filters(),
-    symbol_table(std::move(st)), temp_lists(), symbolic(symbolic), fileout(fileout),
+    symbol_table(std::move(st)), list_arena(), derived_cache(symbol_table.size()),
+    symbolic(symbolic), fileout(fileout),
     dump_updates(dump_updates), trace_creates(), trace(), update_dump(),
     path_name(""), path_conditions() {
 
-  pp_mem_new(&updateset_data_, UPDATESET_DATA_SIZE, "mem for updateset hashmap");
-  updateset.set =  pp_hashmap_new(&updateset_data_, UPDATESET_SIZE, "main updateset");
-
-  pp_mem_new(&pp_stack, TEMP_STACK_SIZE, "mem for temporary updates");
-  pp_mem_new(&value_stack, 1024 * 1024, "mem for value stuff");
-
   if (init->child_ && init->child_->node_type_ == NodeType::PARBLOCK) {
     updateset.pseudostate = 1;
   } else {
     updateset.pseudostate = 0;
   }
 
-  function_states = std::vector<std::unordered_map<ArgumentsKey, value_t>>(symbol_table.size());
+  function_states = std::vector<FunctionState>(symbol_table.size());
   function_symbols = std::vector<const Function*>(symbol_table.size());
   Function *program_sym = symbol_table.get_function("program");
   // TODO location is wrong here
@@ -94,19 +54,26 @@ ExecutionContext::ExecutionContext(const ExecutionContext& other) :
      debuginfo_filters(other.debuginfo_filters), symbol_table(other.symbol_table),
      symbolic(other.symbolic), fileout(other.fileout), dump_updates(other.dump_updates),
      trace(other.trace), update_dump(other.update_dump), path_name(other.path_name) {
-
   // TODO copy updates!
-  pp_mem_new(&updateset_data_, UPDATESET_DATA_SIZE, "mem for updateset hashmap");
-  updateset.set =  pp_hashmap_new(&updateset_data_, UPDATESET_SIZE, "main updateset");
+}
 
-  pp_mem_new(&pp_stack, TEMP_STACK_SIZE, "mem for temporary updates");
+static void release(std::vector<BottomList*>& released, List *list) {
+  BottomList *unused = list->decrease_usage();
+  if (unused) {
+    released.push_back(unused);
+  }
+}
 
+// interned values used as keys of a function live as long as the function
+static void pin_arguments(const Function *function, casm_update *u) {
+  for (size_t i = 0; i < function->argument_count(); i++) {
+    if ((u->sym_args & (1 << i)) == 0) {
+      pin_uint64_value(function->arguments_[i], u->args[i]);
+    }
+  }
 }
 
 void ExecutionContext::apply_updates() {
-  pp_hashmap_bucket* i = updateset.set->tail->previous;
-  casm_update* u;
-
   std::unordered_map<uint32_t, std::vector<ArgumentsKey>> updated_functions;
   if (symbolic || dump_updates) {
     for (uint32_t i = 0; i < function_states.size(); i++) {
@@ -115,53 +82,68 @@ void ExecutionContext::apply_updates() {
   }
 
   std::vector<value_t*> to_fold;
-  while( i != updateset.set->head ) {
-    u = (casm_update*)i->value;
-
-    auto& function_map = function_states[u->func];
+  // lists that were referenced by the old values of the updated locations
+  std::vector<BottomList*> released;
+  updateset.for_each([&](casm_update *u) {
+    auto& function_state = function_states[u->func];
     const Function* function_symbol = function_symbols[u->func];
-    // TODO handle tuples
-    if (function_symbol->return_type_->t == TypeType::LIST) {
-      value_t& list = function_map[ArgumentsKey(u->args, u->num_args, false, u->sym_args)];
+    if (function_symbol->return_type_->t == TypeType::LIST ||
+        function_symbol->return_type_->t == TypeType::TUPLE ||
+        function_symbol->return_type_->t == TypeType::TUPLE_OR_LIST) {
+      value_t& list = function_state.get(u->args, u->sym_args);
       if (u->symbolic){
-        value_t v(function_symbol->return_type_->t, u);
-        function_map[ArgumentsKey(u->args, u->num_args, true, u->sym_args)] = v;
+        list = value_t(function_symbol->return_type_->t, u);
       } else if (u->defined == 0) {
         // set list to undef
-        if (!list.is_undef()) {
-          list.value.list->decrease_usage();
+        if (!list.is_undef() && !list.is_symbolic()) {
+          release(released, list.value.list);
           list.type = TypeType::UNDEF;
         }
+        if (!symbolic) {
+          function_state.erase(u->args, u->sym_args);
+        }
       } else {
         if (!list.is_undef() && !list.is_symbolic()) {
-          list.value.list->decrease_usage();
+          release(released, list.value.list);
         } else {
           list.type = function_symbol->return_type_->t;
         }
         list.value.list = reinterpret_cast<List*>(u->value);
         list.value.list->bump_usage();
+        list.value.list->retain_elements();
         to_fold.push_back(&list);
       }
+    } else if (function_symbol->return_type_->t == TypeType::STRING ||
+               function_symbol->return_type_->t == TypeType::RATIONAL ||
+               (function_symbol->return_type_->t == TypeType::INT && bigint::enabled)) {
+      // interned values are reference counted, unused ones are freed after
+      // the step
+      value_t& v = function_state.get(u->args, u->sym_args);
+      v.decrease_usage();
+      v = value_t(function_symbol->return_type_->t, u);
+      v.bump_usage();
+      if (!symbolic && u->defined == 0) {
+        function_state.erase(u->args, u->sym_args);
+      }
+    } else if (!symbolic && u->defined == 0) {
+      // reading a missing key yields undef in concrete mode, symbolic mode
+      // needs to know if a key was set to undef explicitly
+      function_state.erase(u->args, u->sym_args);
     } else {
-      value_t v(function_symbol->return_type_->t, u);
-      // we could erase keys that store an undef value in concrete mode,
-      // but we need to know if a key was set to undef explicitly in symbolic
-      // mode
-      function_map[ArgumentsKey(u->args, u->num_args, true, u->sym_args)] = v;
+      function_state.get(u->args, u->sym_args) = value_t(function_symbol->return_type_->t, u);
     }
 
+    pin_arguments(function_symbol, u);
+
     if (symbolic || dump_updates) {
       updated_functions[u->func].push_back(
             ArgumentsKey(u->args, u->num_args, true, u->sym_args));
     }
-
-    i->used = 0;
-    i = i->previous;
-  }
+  });
 
   if (symbolic) {
     for (uint32_t i = 1; i < function_states.size(); i++) {
-      auto& function_map = function_states[i];
+      auto& function_state = function_states[i];
       const Function* function_symbol = function_symbols[i];
       const auto& updated_keys = updated_functions[i];
       if (!function_symbol->is_symbolic || function_symbol->is_static) {
@@ -169,36 +151,37 @@ void ExecutionContext::apply_updates() {
       }
 
       std::equal_to<ArgumentsKey> eq = {function_symbol->arguments_};
-      for (const auto& pair : function_map) {
+      function_state.for_each([&](uint64_t *args, uint16_t sym_args, const value_t& v) {
+        const ArgumentsKey key(args, function_symbol->argument_count(), false, sym_args);
         bool found = false;
         for (const auto& k : updated_keys) {
-          if (eq(k, pair.first)) {
+          if (eq(k, key)) {
             found = true;
             break;
           }
         }
         if (!found) {
-          symbolic::dump_symbolic(trace, function_symbol, pair.first.p,
-              pair.first.sym_args, pair.second);
+          symbolic::dump_symbolic(trace, function_symbol, args, sym_args, v);
         }
-      }
+      });
       for (const auto& k : updated_keys) {
         symbolic::dump_update(trace, function_symbol, k.p,
-         k.sym_args, function_map[k]);
+         k.sym_args, function_state.get(k.p, k.sym_args));
       }
     }
   }
 
   if (dump_updates) {
     for (uint32_t i = 0; i < function_states.size(); i++) {
-      auto& function_map = function_states[i];
+      auto& function_state = function_states[i];
       const Function* function_symbol = function_symbols[i];
       const auto& updated_keys = updated_functions[i];
 
       for (const auto& k : updated_keys) {
+        const value_t *v = function_state.find(k.p, k.sym_args);
         update_dump.push_back(function_symbol->name+
             arguments_to_string(function_symbol, k.p)+" = "+
-            function_map[k].to_str());
+            ((v != nullptr) ? v->to_str() : value_t().to_str()));
       }
     }
 
@@ -212,96 +195,66 @@ void ExecutionContext::apply_updates() {
 
 
   // Handle lists
-  // 1. convert chained lists to BottomLists
-  for (value_t* v : to_fold) {
-    BottomList *new_l = v->value.list->collect();
-    if (new_l->check_allocated_and_set_to_false()) {
-      temp_lists.push_back(new_l);
+  // 1. convert chained lists to BottomLists; a list stored to several
+  // locations is collected once, so that its storage can be reused if the
+  // old version is not referenced anymore
+  std::sort(to_fold.begin(), to_fold.end(), [](const value_t *lhs, const value_t *rhs) {
+    return lhs->value.list < rhs->value.list;
+  });
+  for (size_t i = 0; i < to_fold.size();) {
+    List *list = to_fold[i]->value.list;
+    size_t refs = 1;
+    while (i + refs < to_fold.size() && to_fold[i + refs]->value.list == list) {
+      refs += 1;
+    }
+    BottomList *new_l = list->store(refs);
+    for (; refs > 0; refs--, i++) {
+      to_fold[i]->value.list = new_l;
     }
-    v->value.list = new_l;
   }
   to_fold.clear(); 
-  std::vector<size_t> deleted;
 
-  // delete all list objects, except BottomLists that are currently used
-  for (size_t i=0; i < temp_lists.size(); i++) {
-    if (!(temp_lists[i]->is_bottom() && reinterpret_cast<BottomList*>(temp_lists[i])->is_used())) {
-      delete temp_lists[i];
-      deleted.push_back(i);
+  // 2. free the old values that are not referenced anymore; a list can be
+  // released several times if it was stored again in between
+  std::sort(released.begin(), released.end());
+  released.erase(std::unique(released.begin(), released.end()), released.end());
+  for (BottomList *list : released) {
+    if (!list->is_used() && !list->is_temporary()) {
+      delete list;
     }
   }
 
-  // remove deleted lists from temp_lists
-  for (size_t del : deleted) {
-    temp_lists[del] = std::move(temp_lists.back());
-    temp_lists.pop_back();
-  }
+  // 3. all lists that are still referenced were promoted
+  list_arena.clear();
   // list handling done
 
+  // releases the results that depend on updated functions
+  derived_cache.apply_updates();
+  free_unused_values();
 
-  // free allocated updateset data
-  pp_mem_free(&updateset_data_);
-  pp_mem_free(&pp_stack);
-
-  updateset.set->head->previous = NULL;
-  updateset.set->head->next     = updateset.set->tail;
 
-  updateset.set->tail->previous = updateset.set->head;
-  updateset.set->tail->next     = NULL;
-
-  updateset.set->count = 0;
+  updateset.clear();
 }
 
-void ExecutionContext::merge_par() {
-  updateset.pseudostate--;
-
-  pp_hashmap_bucket* j = updateset.set->tail->previous;
-  pp_hashmap_bucket* i;
-
-  while( j != updateset.set->head ) {
-      i = j;
-      j = j->previous;
-
-      if( (uint16_t)i->key <= updateset.pseudostate ) break;
-
-      pp_hashmap_delete(updateset.set, i);
-
-      pp_hashmap_set(updateset.set, i->key-1, i->value);
-
+bool ExecutionContext::fork_par(bool unchecked_updates) {
+  // the order of the updates is only visible in dumps and symbolic traces
+  if (updateset.pseudostate % 2 == 0 || (unchecked_updates && !symbolic && !dump_updates)) {
+    return false;
   }
+  CASM_UPDATESET_FORK_PAR(&updateset);
+  return true;
+}
 
+void ExecutionContext::merge_par() {
+  updateset.merge_par();
 }
 
 void ExecutionContext::merge_seq(Driver& driver) {
-  updateset.pseudostate--;
-
-  pp_hashmap_bucket* j = updateset.set->tail->previous;
-  pp_hashmap_bucket* i;
-  casm_update* u;
-  casm_update* v;
-
-  while( j != updateset.set->head ) {
-      i = j;
-      j = j->previous;
-
-      if( (uint16_t)i->key <= updateset.pseudostate ) break;
-
-      pp_hashmap_delete(updateset.set, i);
-
-      if( (v = (casm_update*) pp_hashmap_set(updateset.set, i->key-1, i->value)) != NULL ) {
-          u = (casm_update*)i->value;
-
-          const Function *func = function_symbols[u->func];
-          DEBUG("FUNC "<<func->name);
-          for (size_t i=0; i < func->arguments_.size(); i++) {
-            DEBUG("CHECK ARGS "<<u->args[i] << " "<<v->args[i]);
-            if (!eq_uint64_value(func->arguments_[i], u->args[i], v->args[i])) {
-              return;
-            }
-          }
-          driver.error(*reinterpret_cast<yy::location*>(u->line), "conflict merging updatesets");
-          throw RuntimeException("merge error");
-      }
+  casm_update *u = updateset.merge_seq();
+  if (u != nullptr) {
+    DEBUG("FUNC "<<function_symbols[u->func]->name);
+    driver.error(*reinterpret_cast<yy::location*>(u->line), "conflict merging updatesets");
+    throw RuntimeException("merge error");
   }
 }
 
@@ -320,33 +273,26 @@ bool args_eq(uint64_t args1[], uint64_t args2[], size_t len) {
 }
 
 const value_t ExecutionContext::get_function_value(Function *sym, uint64_t args[], uint16_t sym_args) {
-  auto& function_map = function_states[sym->id];
-  try {
-    const value_t &v = function_map.at(ArgumentsKey(&args[0], sym->arguments_.size(), false, sym_args));
-    int64_t state = (updateset.pseudostate % 2 == 0) ? updateset.pseudostate-1:
-                                                       updateset.pseudostate;
-    for (; state > 0; state -= 2) {
-      uint64_t key = (uint64_t) &v << 16 | state;
-      casm_update *update = (casm_update*) pp_hashmap_get(updateset.set, key);
-      if (update) {
-        return value_t(sym->return_type_->t, update);
-      }
+  derived_cache.read(sym->id);
+  auto& function_state = function_states[sym->id];
+  const value_t *v = function_state.find(args, sym_args);
+  if (v) {
+    casm_update *update = updateset.get(v);
+    if (update) {
+      return value_t(sym->return_type_->t, update);
     }
-    return v;
+    return *v;
+  }
 
-  } catch (const std::out_of_range &e) {
-    if (symbolic && sym->is_symbolic) {
-      // TODO cleanup symbol
-      function_map.emplace(
-          ArgumentsKey(&args[0], sym->arguments_.size(), true, sym_args),
-          value_t(new symbol_t(symbolic::next_symbol_id())));
-      value_t& v = function_map[ArgumentsKey(&args[0], sym->arguments_.size(), false, sym_args)];
-      symbolic::dump_create(trace_creates, sym, &args[0], sym_args, v);
-      return v;
-    }
-    undef.type = TypeType::UNDEF;
-    return undef;
+  if (symbolic && sym->is_symbolic) {
+    // TODO cleanup symbol
+    value_t& v = function_state.get(args, sym_args);
+    v = value_t(new symbol_t(symbolic::next_symbol_id()));
+    symbolic::dump_create(trace_creates, sym, &args[0], sym_args, v);
+    return v;
   }
+  undef.type = TypeType::UNDEF;
+  return undef;
 }
 
 bool ExecutionContext::set_debuginfo_filter(const std::string& filters) {
@@ -8,71 +8,22 @@
 #include "libsyntax/driver.h"
 
 #include "libinterpreter/value.h"
-
-#include "libcasmrt/rt.h"
-
-static Type symbol_type(TypeType::SYMBOL);
-
-struct ArgumentsKey {
-  uint64_t* p;
-  bool dynamic;
-  uint16_t sym_args;
-
-  // size must be equal to the size specified in the function type
-  ArgumentsKey(uint64_t *args, uint16_t size, bool dyn, uint16_t sym_args);
-  ArgumentsKey(const ArgumentsKey& other);
-  ArgumentsKey(ArgumentsKey&& other) noexcept;
-  ~ArgumentsKey();
-};
-
-
-
-namespace std {
-
-  template <> struct hash<ArgumentsKey> {
-    std::vector<Type*> types;
-
-    size_t operator()(const ArgumentsKey &key) const {
-      size_t h = 0;
-      for(uint16_t i = 0; i < types.size(); i++) {
-        if ((key.sym_args & (1 << i)) != 0) {
-          h ^= hash_uint64_value(&symbol_type, key.p[i]);
-        } else {
-          h ^= hash_uint64_value(types[i], key.p[i]);
-        }
-      }
-      return h;
-    }
-  };
-
-  template <> struct equal_to<ArgumentsKey> {
-    std::vector<Type*> types;
-
-    bool operator()(const ArgumentsKey &lhs, const ArgumentsKey &rhs) const {
-      for(uint16_t i = 0; i < types.size(); i++) {
-        if (!eq_uint64_value(types[i], lhs.p[i], rhs.p[i])) {
-          return false;
-        }
-      }
-      return true;
-    }
-  };
-}
-
+#include "libinterpreter/updateset.h"
+#include "libinterpreter/function_state.h"
+#include "libinterpreter/derived_cache.h"
 
 class ExecutionContext {
   private:
-    pp_mem updateset_data_;
     std::map<const std::string, bool> debuginfo_filters;
 
   public:
-    std::vector<std::unordered_map<ArgumentsKey, value_t>> function_states;
+    std::vector<FunctionState> function_states;
     std::vector<const Function*> function_symbols;
     const SymbolTable symbol_table;
     casm_updateset updateset;
-    pp_mem pp_stack;
-    std::vector<List*> temp_lists;
-    static pp_mem value_stack;
+    // temporary list nodes of the current step
+    ListArena list_arena;
+    DerivedCache derived_cache;
     const bool symbolic;
     const bool fileout;
     const bool dump_updates;
@@ -88,6 +39,10 @@ class ExecutionContext {
     ExecutionContext(const ExecutionContext& other);
 
     void apply_updates();
+    // forks a parallel pseudostate if the current one is sequential, returns
+    // true if forked; blocks with unchecked updates add them to the
+    // sequential pseudostate directly
+    bool fork_par(bool unchecked_updates);
     void merge_par();
     void merge_seq(Driver& driver);
 
@@ -0,0 +1,15 @@
+#ifndef CASMI_LIBINTERPRETER_EXECUTION_MODE_H
+#define CASMI_LIBINTERPRETER_EXECUTION_MODE_H
+
+// The interpreter is instantiated once per execution mode. All checks for
+// symbolic values are guarded by Mode::symbolic, so the concrete
+// instantiation does not contain any code for symbolic execution.
+struct ConcreteMode {
+  static constexpr bool symbolic = false;
+};
+
+struct SymbolicMode {
+  static constexpr bool symbolic = true;
+};
+
+#endif
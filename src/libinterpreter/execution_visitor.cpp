@@ -16,20 +16,18 @@
 #include "libinterpreter/operators.h"
 #include "libinterpreter/symbolic.h"
 
-IGNORE_VARIADIC_WARNINGS
-
-DEFINE_CASM_UPDATESET_FORK_PAR
-DEFINE_CASM_UPDATESET_FORK_SEQ
-
-REENABLE_VARIADIC_WARNINGS
-
 
+template<class Mode>
 uint16_t pack_values_in_array(const value_t value_list[], uint64_t array[], uint32_t size) {
   uint16_t sym_args = 0;
   for (uint32_t i=0; i < size; i++) {
     const value_t& v = value_list[i];
-    array[i] = v.to_uint64_t();
-    if (v.is_symbolic()) {
+    if (v.is_list()) {
+      array[i] = (uint64_t) InternedList::intern(v.value.list);
+    } else {
+      array[i] = v.to_uint64_t();
+    }
+    if (Mode::symbolic && v.is_symbolic()) {
       sym_args = sym_args | (1 << i);
     }
   }
@@ -37,12 +35,13 @@ uint16_t pack_values_in_array(const value_t value_list[], uint64_t array[], uint
 }
 
 
-ExecutionVisitor::ExecutionVisitor(ExecutionContext &ctxt, Driver& driver)
-    : driver_(driver), context_(ctxt) {
-  rule_bindings.push_back(&main_bindings);
-}
+template<class Mode>
+ExecutionVisitor<Mode>::ExecutionVisitor(ExecutionContext &ctxt, Driver& driver)
+    : bindings(256), frames(), frame_base(0), bindings_top(0), driver_(driver),
+      context_(ctxt) {}
 
-void ExecutionVisitor::visit_assert(UnaryNode* assert, const value_t& val) {
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_assert(UnaryNode* assert, const value_t& val) {
   if (val.value.boolean != true) {
     driver_.error(assert->location,
                   "Assertion failed");
@@ -50,34 +49,30 @@ void ExecutionVisitor::visit_assert(UnaryNode* assert, const value_t& val) {
   }
 }
 
-void ExecutionVisitor::visit_assure(UnaryNode* assure, const value_t& val) {
-  if (context_.symbolic && val.is_symbolic() && val.value.sym->condition) {
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_assure(UnaryNode* assure, const value_t& val) {
+  if (Mode::symbolic && val.is_symbolic() && val.value.sym->condition) {
     context_.path_conditions.push_back(val.value.sym->condition);
   } else {
     visit_assert(assure, val);
   }
 }
 
-casm_update *ExecutionVisitor::add_update(const value_t& val, size_t sym_id) {
-  casm_update* up = (casm_update*) pp_mem_alloc(&(context_.pp_stack), sizeof(casm_update));
+template<class Mode>
+casm_update *ExecutionVisitor<Mode>::add_update(const value_t& val, size_t sym_id) {
+  casm_update* up = context_.updateset.new_update(num_arguments);
+  context_.derived_cache.write(sym_id);
 
   up->value = (void*) val.to_uint64_t();
   up->defined = (val.is_undef()) ? 0 : 1;
-  up->symbolic = val.is_symbolic();
+  up->symbolic = Mode::symbolic && val.is_symbolic();
   up->func = sym_id;
   // TODO: Do we need line here?
   //up->line = (uint64_t) loc.lines;
   // TODO use arg!
-  up->sym_args = pack_values_in_array(arguments, up->args, num_arguments);
-
-  up->num_args = num_arguments;
+  up->sym_args = pack_values_in_array<Mode>(arguments, up->args, num_arguments);
 
-  auto& function_map = context_.function_states[sym_id];
-  const ArgumentsKey key(up->args, up->num_args, false, up->sym_args);
-  if (function_map.count(key) == 0) {
-    function_map.emplace(ArgumentsKey(up->args, up->num_args, true, up->sym_args), value_t());
-  }
-  const value_t& ref = function_map[key];
+  const value_t& ref = context_.function_states[sym_id].get(up->args, up->sym_args);
 
   casm_update* v = (casm_update*)casm_updateset_add(&(context_.updateset),
                                                     (void*) &ref,
@@ -96,7 +91,8 @@ casm_update *ExecutionVisitor::add_update(const value_t& val, size_t sym_id) {
   return up;
 }
 
-void ExecutionVisitor::visit_update_dumps(UpdateNode *update, const value_t& expr_v) {
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_update_dumps(UpdateNode *update, const value_t& expr_v) {
   const std::string& filter = driver_.function_trace_map[update->func->symbol->id];
   if (context_.filter_enabled(filter)) {
     std::cout << filter << ": " << update->func->symbol->name ;
@@ -118,7 +114,8 @@ void ExecutionVisitor::visit_update_dumps(UpdateNode *update, const value_t& exp
   visit_update(update, expr_v);
 }
 
-void ExecutionVisitor::visit_update(UpdateNode *update, const value_t& expr_v) {
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_update(UpdateNode *update, const value_t& expr_v) {
   try {
     casm_update *up = add_update(expr_v, update->func->symbol->id);
     up->line = (uint64_t) &update->location;
@@ -130,13 +127,14 @@ void ExecutionVisitor::visit_update(UpdateNode *update, const value_t& expr_v) {
   }
 }
 
-void ExecutionVisitor::visit_update_subrange(UpdateNode *update, const value_t& expr_v) {
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_update_subrange(UpdateNode *update, const value_t& expr_v) {
   INT_T v = expr_v.value.integer;
   Type *t = update->func->symbol->return_type_;
   if ((t->subrange_start < t->subrange_end) &&
       (v < t->subrange_start || v > t->subrange_end)) {
     driver_.error(update->location,
-                  std::to_string(v)+" does violate the subrange "
+                  expr_v.to_str()+" does violate the subrange "
                   +std::to_string(t->subrange_start)
                   +".." +std::to_string(t->subrange_end)
                   +" of `"+update->func->name+"`");
@@ -147,9 +145,11 @@ void ExecutionVisitor::visit_update_subrange(UpdateNode *update, const value_t&
 
 
 
-void ExecutionVisitor::visit_call_pre(CallNode *call) { UNUSED(call); }
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_call_pre(CallNode *call) { UNUSED(call); }
 
-void ExecutionVisitor::visit_call_pre(CallNode *call, const value_t& expr) {
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_call_pre(CallNode *call, const value_t& expr) {
   if (expr.type != TypeType::UNDEF) {
     call->rule = expr.value.rule;
   } else {
@@ -157,47 +157,54 @@ void ExecutionVisitor::visit_call_pre(CallNode *call, const value_t& expr) {
   }
 }
 
-void ExecutionVisitor::visit_call(CallNode *call, std::vector<value_t> &argument_results) {
-  UNUSED(call);
-
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_call(CallNode *call, size_t base) {
   if (call->ruleref) {
-    size_t args_defined = call->rule->arguments.size();
-    size_t args_provided = argument_results.size();
-    if (args_defined != args_provided) {
-      driver_.error(call->location, "indirectly called rule `"+call->rule->name+
-                    "` expects "+std::to_string(args_defined)+" arguments but "+
-                    std::to_string(args_provided)+" where provided");
-      throw RuntimeException("Invalid indirect call");
-    } else {
-      for (size_t i=0; i < args_defined; i++) {
-        Type arg_t(argument_results[i].type);
-        if (call->rule->arguments[i]->t == TypeType::LIST) {
-          // TODO
-          assert(0);
-        } else if (call->rule->arguments[i]->t == TypeType::LIST) {
-          // TODO
-          assert(0);
-        } else if (!call->rule->arguments[i]->unify(&arg_t) && !(argument_results[i].is_undef() && argument_results[i].type == TypeType::UNDEF)) {
-          driver_.error(call->arguments->at(i)->location,
-                        "argument "+std::to_string(i+1)+" of indirectly called rule `"+
-                        call->rule->name+"` must be `"+
-                        call->rule->arguments[i]->to_str()+"` but was `"+
-                        Type(argument_results[i].type).to_str()+"`");
-          throw RuntimeException("Invalid indirect call");
-        }
+    check_call_arguments(call, arguments_at(base), bindings_top - base);
+  }
+
+  enter_frame(base);
+}
+
+template<class Mode>
+void ExecutionVisitor<Mode>::check_call_arguments(CallNode *call, const value_t arguments[],
+                                            size_t num_arguments) {
+  size_t args_defined = call->rule->arguments.size();
+  size_t args_provided = num_arguments;
+  if (args_defined != args_provided) {
+    driver_.error(call->location, "indirectly called rule `"+call->rule->name+
+                  "` expects "+std::to_string(args_defined)+" arguments but "+
+                  std::to_string(args_provided)+" where provided");
+    throw RuntimeException("Invalid indirect call");
+  } else {
+    for (size_t i=0; i < args_defined; i++) {
+      Type arg_t(arguments[i].type);
+      if (call->rule->arguments[i]->t == TypeType::LIST) {
+        // TODO
+        assert(0);
+      } else if (call->rule->arguments[i]->t == TypeType::LIST) {
+        // TODO
+        assert(0);
+      } else if (!call->rule->arguments[i]->unify(&arg_t) && !(arguments[i].is_undef() && arguments[i].type == TypeType::UNDEF)) {
+        driver_.error(call->arguments->at(i)->location,
+                      "argument "+std::to_string(i+1)+" of indirectly called rule `"+
+                      call->rule->name+"` must be `"+
+                      call->rule->arguments[i]->to_str()+"` but was `"+
+                      Type(arguments[i].type).to_str()+"`");
+        throw RuntimeException("Invalid indirect call");
       }
     }
   }
- 
-  rule_bindings.push_back(&argument_results);
 }
 
-void ExecutionVisitor::visit_call_post(CallNode *call) {
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_call_post(CallNode *call) {
   UNUSED(call);
-  rule_bindings.pop_back();
+  leave_frame();
 }
 
-void ExecutionVisitor::visit_print(PrintNode *node, const std::vector<value_t> &arguments) {
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_print(PrintNode *node, const std::vector<value_t> &arguments) {
   std::stringstream ss;
   if (node->filter.size() > 0 ) {
     if (context_.filter_enabled(node->filter)) {
@@ -212,24 +219,26 @@ void ExecutionVisitor::visit_print(PrintNode *node, const std::vector<value_t> &
   }
   ss << std::endl;
 
-  if (context_.symbolic) {
+  if (Mode::symbolic) {
     context_.trace.push_back(ss.str());
   } else {
     std::cout << ss.str();
   }
 }
 
-void ExecutionVisitor::visit_diedie(DiedieNode *node, const value_t& msg) {
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_diedie(DiedieNode *node, const value_t& msg) {
   if (node->msg) {
-    driver_.error(node->location, *msg.value.string);
+    driver_.error(node->location, msg.value.string->str);
   } else {
     driver_.error(node->location, "`diedie` executed");
   }
     throw RuntimeException("diedie");
 }
 
-void ExecutionVisitor::visit_impossible(AstNode *node) {
-  if (context_.symbolic) {
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_impossible(AstNode *node) {
+  if (Mode::symbolic) {
     driver_.info(node->location, "`impossible` executed, aborting trace");
     throw ImpossibleException();
   } else {
@@ -238,18 +247,21 @@ void ExecutionVisitor::visit_impossible(AstNode *node) {
   }
 }
 
-void ExecutionVisitor::visit_let(LetNode*, const value_t& v) {
-  rule_bindings.back()->push_back(v);
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_let(LetNode *node, const value_t& v) {
+  bind(node->offset, v);
 }
 
-void ExecutionVisitor::visit_let_post(LetNode*) {
-  rule_bindings.back()->pop_back();
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_let_post(LetNode *node) {
+  unbind(node->offset);
 }
 
-void ExecutionVisitor::visit_push(PushNode *node, const value_t& expr, const value_t& atom) {
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_push(PushNode *node, const value_t& expr, const value_t& atom) {
   // at the moment, functions with arguments are not supported
   num_arguments = 0;
-  if (atom.is_symbolic()) {
+  if (Mode::symbolic && atom.is_symbolic()) {
     const value_t to_res(new symbol_t(symbolic::next_symbol_id()));
     if (atom.value.sym->list) {
       to_res.value.sym->list = builtins::cons(context_, expr,
@@ -286,10 +298,11 @@ void ExecutionVisitor::visit_push(PushNode *node, const value_t& expr, const val
   }
 }
 
-void ExecutionVisitor::visit_pop(PopNode *node, const value_t& val) {
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_pop(PopNode *node, const value_t& val) {
   // at the moment, functions with arguments are not supported
   num_arguments = 0;
-  if (val.is_symbolic()) {
+  if (Mode::symbolic && val.is_symbolic()) {
     const value_t to_res = (val.value.sym->list) ? builtins::peek(value_t(TypeType::LIST, val.value.sym->list)) :
                                            value_t(new symbol_t(symbolic::next_symbol_id()));
 
@@ -305,7 +318,7 @@ void ExecutionVisitor::visit_pop(PopNode *node, const value_t& val) {
         throw ex;
       }
     } else {
-      rule_bindings.back()->push_back(to_res);
+      bind(node->to->offset, to_res);
     }
 
     const value_t from_res(new symbol_t(symbolic::next_symbol_id()));
@@ -328,57 +341,69 @@ void ExecutionVisitor::visit_pop(PopNode *node, const value_t& val) {
     }
 
   } else {
-    const value_t to_res = builtins::peek(val);
+    const value_t to_res = apply_pop(node, val);
 
-    if (node->to->symbol_type == FunctionAtom::SymbolType::FUNCTION) {
-      try {
-        casm_update *up = add_update(to_res, node->to->symbol->id);
-        up->line = (uint64_t) &node->location;
-      } catch (const RuntimeException& ex) {
-        // TODO this is probably not the cleanest solutions
-        driver_.error(node->to->location,
-                      "update conflict in parallel block for function `"+node->to->name+"`");
-        throw ex;
-      }
-    } else {
-      rule_bindings.back()->push_back(to_res);
-    } 
+    if (node->to->symbol_type != FunctionAtom::SymbolType::FUNCTION) {
+      bind(node->to->offset, to_res);
+    }
+  }
+}
+
+template<class Mode>
+const value_t ExecutionVisitor<Mode>::apply_pop(PopNode *node, const value_t& val) {
+  // at the moment, functions with arguments are not supported
+  num_arguments = 0;
+  const value_t to_res = builtins::peek(val);
 
-    const value_t from_res = builtins::tail(context_, val);
+  if (node->to->symbol_type == FunctionAtom::SymbolType::FUNCTION) {
     try {
-      casm_update *up = add_update(from_res, node->from->symbol->id);
+      casm_update *up = add_update(to_res, node->to->symbol->id);
       up->line = (uint64_t) &node->location;
     } catch (const RuntimeException& ex) {
       // TODO this is probably not the cleanest solutions
-      driver_.error(node->location,
-                    "update conflict in parallel block for function `"+node->from->name+"`");
+      driver_.error(node->to->location,
+                    "update conflict in parallel block for function `"+node->to->name+"`");
       throw ex;
     }
+  }
 
+  const value_t from_res = builtins::tail(context_, val);
+  try {
+    casm_update *up = add_update(from_res, node->from->symbol->id);
+    up->line = (uint64_t) &node->location;
+  } catch (const RuntimeException& ex) {
+    // TODO this is probably not the cleanest solutions
+    driver_.error(node->location,
+                  "update conflict in parallel block for function `"+node->from->name+"`");
+    throw ex;
   }
+  return to_res;
 }
 
-const value_t ExecutionVisitor::visit_expression(Expression *expr,
+template<class Mode>
+const value_t ExecutionVisitor<Mode>::visit_expression(Expression *expr,
                                                const value_t &left_val,
                                                const value_t &right_val) {
-  return operators::dispatch(expr->op, left_val, right_val);
+  return operators::dispatch<Mode>(expr->op, left_val, right_val);
 }
 
-value_t ExecutionVisitor::visit_expression_single(Expression *expr, const value_t &val) {
+template<class Mode>
+value_t ExecutionVisitor<Mode>::visit_expression_single(Expression *expr, const value_t &val) {
   UNUSED(expr);
-  return operators::dispatch(expr->op, val, val);
+  return operators::dispatch<Mode>(expr->op, val, val);
 }
 
-const value_t ExecutionVisitor::visit_function_atom(FunctionAtom *atom,
+template<class Mode>
+const value_t ExecutionVisitor<Mode>::visit_function_atom(FunctionAtom *atom,
                                                     const value_t arguments[],
                                                     uint16_t num_arguments) {
   switch (atom->symbol_type) {
     case FunctionAtom::SymbolType::PARAMETER:
-      return value_t(rule_bindings.back()->at(atom->offset));
+      return binding(atom->offset);
 
     case FunctionAtom::SymbolType::FUNCTION: {
       uint64_t args[5];
-      uint16_t sym_args = pack_values_in_array(arguments, args, num_arguments);
+      uint16_t sym_args = pack_values_in_array<Mode>(arguments, args, num_arguments);
 
       return context_.get_function_value(atom->symbol, args, sym_args);
     }
@@ -394,7 +419,8 @@ const value_t ExecutionVisitor::visit_function_atom(FunctionAtom *atom,
   }
 }
 
-const value_t ExecutionVisitor::visit_function_atom_subrange(FunctionAtom *atom,
+template<class Mode>
+const value_t ExecutionVisitor<Mode>::visit_function_atom_subrange(FunctionAtom *atom,
                                                              const value_t arguments[],
                                                              uint16_t num_arguments) {
   for (uint32_t i=0; i < atom->symbol->subrange_arguments.size(); i++) {
@@ -404,7 +430,7 @@ const value_t ExecutionVisitor::visit_function_atom_subrange(FunctionAtom *atom,
     if (v.value.integer < t->subrange_start ||
         v.value.integer > t->subrange_end) {
       driver_.error(atom->location,
-                  std::to_string(v.value.integer)+" does violate the subrange "
+                  v.to_str()+" does violate the subrange "
                   +std::to_string(t->subrange_start)
                   +".." +std::to_string(t->subrange_end)
                   +" of "+std::to_string(i+1)+". function argument");
@@ -415,7 +441,8 @@ const value_t ExecutionVisitor::visit_function_atom_subrange(FunctionAtom *atom,
 }
 
 
-const value_t ExecutionVisitor::visit_builtin_atom(BuiltinAtom *atom,
+template<class Mode>
+const value_t ExecutionVisitor<Mode>::visit_builtin_atom(BuiltinAtom *atom,
                                                    const value_t arguments[],
                                                    uint16_t num_arguments) {
   // TODO Int2Enum is a special builtin, it needs the complete type information
@@ -434,41 +461,43 @@ const value_t ExecutionVisitor::visit_builtin_atom(BuiltinAtom *atom,
     return std::move(value_t());
   }
 
-  return builtins::dispatch(atom->id, context_, arguments, num_arguments);
+  return builtins::dispatch<Mode>(atom->id, context_, arguments, num_arguments);
 }
 
-void ExecutionVisitor::visit_derived_function_atom_pre(FunctionAtom*,
+template<class Mode>
+void ExecutionVisitor<Mode>::visit_derived_function_atom_pre(FunctionAtom*,
                                                        const value_t arguments[],
                                                        uint16_t num_arguments) {
-  // TODO change, cleanup!
-  std::vector<value_t> *tmp = new std::vector<value_t>();
+  const size_t base = arguments_base();
   for (uint32_t i=0; i < num_arguments; i++) {
-    tmp->push_back(arguments[i]);
+    push_argument(arguments[i]);
   }
-
-  rule_bindings.push_back(tmp);
+  enter_frame(base);
 }
 
-const value_t ExecutionVisitor::visit_derived_function_atom(FunctionAtom*, const value_t& expr) {
-  rule_bindings.pop_back();
+template<class Mode>
+const value_t ExecutionVisitor<Mode>::visit_derived_function_atom(FunctionAtom*, const value_t& expr) {
+  leave_frame();
   return expr;
 }
 
-const value_t ExecutionVisitor::visit_list_atom(ListAtom *atom,
+template<class Mode>
+const value_t ExecutionVisitor<Mode>::visit_list_atom(ListAtom *atom,
                                                 const std::vector<value_t> &vals) {
+  if (!Mode::symbolic) {
+    return value_t(atom->type_, context_.list_arena.make<BottomList>(vals));
+  }
+
+  // symbols keep referencing their list after the step
   BottomList *list = new BottomList(vals);
-  //context_.temp_lists.push_back(list);
-
-  if (context_.symbolic) {
-    uint32_t sym_id = symbolic::dump_listconst(context_.trace_creates, list);
-    if (sym_id > 0) {
-      // TODO cleanup symbols
-      symbol_t *sym = new symbol_t(sym_id);
-      sym->type_dumped = true;
-      sym->list = list;
-      const value_t v(sym);
-      return v;
-    }
+  uint32_t sym_id = symbolic::dump_listconst(context_.trace_creates, list);
+  if (sym_id > 0) {
+    // TODO cleanup symbols
+    symbol_t *sym = new symbol_t(sym_id);
+    sym->type_dumped = true;
+    sym->list = list;
+    const value_t v(sym);
+    return v;
   }
   return value_t(atom->type_, list);
 }
@@ -486,8 +515,21 @@ std::string args_to_str(uint64_t args[], size_t size) {
   return res;
 }
 
-const value_t ExecutionVisitor::visit_number_range_atom(NumberRangeAtom *atom) {
-  return value_t(atom->type_, atom->list);
+template<class Mode>
+const value_t ExecutionVisitor<Mode>::visit_number_range_atom(NumberRangeAtom *atom,
+                                                             const value_t& start,
+                                                             const value_t& end) {
+  if (start.is_undef() || end.is_undef()) {
+    return value_t();
+  }
+  if (Mode::symbolic && (start.is_symbolic() || end.is_symbolic())) {
+    driver_.error(atom->location, "bounds of range expression must not be symbolic");
+    throw RuntimeException("Symbolic range bounds");
+  }
+
+  RangeList *range = context_.list_arena.make<RangeList>(start.value.integer,
+                                                         end.value.integer);
+  return value_t(atom->type_, range);
 }
 
 ExpressionOperation invert(ExpressionOperation op) {
@@ -502,23 +544,102 @@ ExpressionOperation invert(ExpressionOperation op) {
   }
 }
 
-template <>
-value_t AstWalker<ExecutionVisitor, value_t>::walk_list_atom(ListAtom *atom) {
+template<class Mode>
+static value_t walk_expression_base(AstWalker<ExecutionVisitor<Mode>, value_t>& walker,
+                                    ExpressionBase *expr) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
+  switch (expr->node_type_) {
+    case NodeType::INT_EXPRESSION: {
+      Expression *e = reinterpret_cast<Expression*>(expr);
+      const value_t lhs = walker.walk_expression_base(e->left_);
+      const value_t rhs = walker.walk_expression_base(e->right_);
+      return operators::int_dispatch<Mode>(e->op, lhs, rhs);
+    }
+    case NodeType::BOOLEAN_EXPRESSION: {
+      Expression *e = reinterpret_cast<Expression*>(expr);
+      const value_t lhs = walker.walk_expression_base(e->left_);
+      if (operators::short_circuits(e->op, lhs)) {
+        return lhs;
+      }
+      const value_t rhs = walker.walk_expression_base(e->right_);
+      return visitor.visit_expression(e, lhs, rhs);
+    }
+    case NodeType::EXPRESSION: {
+      Expression *e = reinterpret_cast<Expression*>(expr);
+      const value_t lhs = walker.walk_expression_base(e->left_);
+      if (e->right_) {
+        const value_t rhs = walker.walk_expression_base(e->right_);
+        return visitor.visit_expression(e, lhs, rhs);
+      } else {
+        return visitor.visit_expression_single(e, lhs);
+      }
+    }
+    default:
+      return walker.walk_atom(reinterpret_cast<AtomNode*>(expr));
+  }
+}
+
+template<class Mode>
+static value_t walk_list_atom(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, ListAtom *atom) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
   std::vector<value_t> expr_results;
   if (atom->expr_list) {
     for (auto iter=atom->expr_list->rbegin(); iter != atom->expr_list->rend(); iter++) {
-      expr_results.push_back(walk_expression_base(*iter));
+      expr_results.push_back(walker.walk_expression_base(*iter));
     }
   }
   return visitor.visit_list_atom(atom, expr_results);
 }
 
+template<class Mode>
+static value_t walk_derived(AstWalker<ExecutionVisitor<Mode>, value_t>& walker,
+                            FunctionAtom *atom, const value_t arguments[],
+                            uint16_t num_arguments) {
+  walker.visitor.visit_derived_function_atom_pre(atom, arguments, num_arguments);
+  const value_t expr = walker.walk_expression_base(atom->symbol->derived);
+  return walker.visitor.visit_derived_function_atom(atom, expr);
+}
 
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_ifthenelse(IfThenElseNode* node) {
-  const value_t cond = walk_expression_base(node->condition_);
+template<class Mode>
+static value_t walk_function_atom(AstWalker<ExecutionVisitor<Mode>, value_t>& walker,
+                                  BaseFunctionAtom *func) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
+  value_t arguments[10];
+  uint16_t num_arguments = 0;
+  if (func->arguments) {
+    for (; num_arguments < func->arguments->size(); num_arguments++) {
+      arguments[num_arguments] = walker.walk_expression_base(func->arguments->at(num_arguments));
+    }
+  }
 
-  if (cond.is_symbolic()) {
+  if (func->node_type_ == NodeType::BUILTIN_ATOM) {
+    return visitor.visit_builtin_atom(reinterpret_cast<BuiltinAtom*>(func),
+                                      arguments, num_arguments);
+  }
+  FunctionAtom *atom = reinterpret_cast<FunctionAtom*>(func);
+  if (atom->symbol_type == FunctionAtom::SymbolType::DERIVED) {
+    DerivedCache& cache = visitor.context_.derived_cache;
+    if (!Mode::symbolic && cache.enabled) {
+      return cache.get(atom->symbol, arguments, num_arguments, [&]() {
+        return walk_derived(walker, atom, arguments, num_arguments);
+      });
+    }
+    return walk_derived(walker, atom, arguments, num_arguments);
+  }
+  if (func->node_type_ == NodeType::FUNCTION_ATOM) {
+    return visitor.visit_function_atom(atom, arguments, num_arguments);
+  } else {
+    return visitor.visit_function_atom_subrange(atom, arguments, num_arguments);
+  }
+}
+
+
+template<class Mode>
+static void walk_ifthenelse(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, IfThenElseNode* node) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
+  const value_t cond = walker.walk_expression_base(node->condition_);
+
+  if (Mode::symbolic && cond.is_symbolic()) {
     symbolic_condition_t *sym_cond;
     if (cond.value.sym->condition) {
       sym_cond = cond.value.sym->condition;
@@ -531,14 +652,14 @@ void AstWalker<ExecutionVisitor, value_t>::walk_ifthenelse(IfThenElseNode* node)
       case symbolic::check_status_t::TRUE:
         symbolic::dump_pathcond_match(visitor.context_.trace, visitor.driver_.get_filename(),
             node->condition_->location.begin.line, sym_cond, true);
-        walk_statement(node->then_);
+        walker.walk_statement(node->then_);
         return;
       case symbolic::check_status_t::FALSE:;
         symbolic::dump_pathcond_match(visitor.context_.trace, visitor.driver_.get_filename(),
             node->condition_->location.begin.line, sym_cond, false);
 
         if (node->else_) {
-          walk_statement(node->else_);
+          walker.walk_statement(node->else_);
         }
         return;
     }
@@ -553,7 +674,7 @@ void AstWalker<ExecutionVisitor, value_t>::walk_ifthenelse(IfThenElseNode* node)
         symbolic::dump_if(visitor.context_.trace, visitor.driver_.get_filename(),
             node->condition_->location.begin.line, sym_cond);
         visitor.context_.path_conditions.push_back(sym_cond);
-        walk_statement(node->then_);
+        walker.walk_statement(node->then_);
         break;
 
       default: {
@@ -580,7 +701,7 @@ void AstWalker<ExecutionVisitor, value_t>::walk_ifthenelse(IfThenElseNode* node)
             node->condition_->location.begin.line, sym_cond);
         visitor.context_.path_conditions.push_back(sym_cond);
         if (node->else_) {
-          walk_statement(node->else_);
+          walker.walk_statement(node->else_);
         }
       }
     }
@@ -589,71 +710,72 @@ void AstWalker<ExecutionVisitor, value_t>::walk_ifthenelse(IfThenElseNode* node)
         "condition must be true or false but was undef");
     throw RuntimeException("Condition is undef");
   } else if (cond.value.boolean) {
-    walk_statement(node->then_);
+    walker.walk_statement(node->then_);
   } else if (node->else_) {
-    walk_statement(node->else_);
+    walker.walk_statement(node->else_);
   }
 }
 
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_seqblock(UnaryNode* seqblock) {
+template<class Mode>
+static void walk_seqblock(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, UnaryNode* seqblock) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
   bool forked = false;
   if (visitor.context_.updateset.pseudostate % 2 == 0) {
     CASM_UPDATESET_FORK_SEQ(&visitor.context_.updateset);
     forked = true;
   }
   visitor.visit_seqblock(seqblock);
-  walk_statements(reinterpret_cast<AstListNode*>(seqblock->child_));
+  walker.walk_statements(reinterpret_cast<AstListNode*>(seqblock->child_));
 
   if (forked) {
     visitor.context_.merge_seq(visitor.driver_);
   }
 }
 
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_parblock(UnaryNode* parblock) {
-  bool forked = false;
-  if (visitor.context_.updateset.pseudostate % 2 == 1) {
-    CASM_UPDATESET_FORK_PAR(&visitor.context_.updateset);
-    forked = true;
-  }
+template<class Mode>
+static void walk_parblock(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, UnaryNode* parblock) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
+  const bool forked = visitor.context_.fork_par(parblock->unchecked_updates);
   visitor.visit_seqblock(parblock);
-  walk_statements(reinterpret_cast<AstListNode*>(parblock->child_));
+  walker.walk_statements(reinterpret_cast<AstListNode*>(parblock->child_));
 
   if (forked) {
     visitor.context_.merge_par();
   }
 }
 
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_pop(PopNode* node) {
-  const value_t from = walk_function_atom(node->from);
-  if (visitor.context_.symbolic &&
+template<class Mode>
+static void walk_pop(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, PopNode* node) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
+  const value_t from = walker.walk_function_atom(node->from);
+  if (Mode::symbolic &&
       node->to->symbol_type == FunctionAtom::SymbolType::FUNCTION &&
       node->to->symbol->is_symbolic) {
-    walk_function_atom(node->to);
+    walker.walk_function_atom(node->to);
   }
   visitor.visit_pop(node, from);
 }
 
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_push(PushNode *node) {
-  const value_t expr = walk_expression_base(node->expr);
-  const value_t atom = walk_function_atom(node->to);
+template<class Mode>
+static void walk_push(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, PushNode *node) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
+  const value_t expr = walker.walk_expression_base(node->expr);
+  const value_t atom = walker.walk_function_atom(node->to);
   visitor.visit_push(node, expr, atom);
 }
 
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_case(CaseNode *node) {
-  const value_t cond = walk_expression_base(node->expr);
+template<class Mode>
+static void walk_case(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, CaseNode *node) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
+  const value_t cond = walker.walk_expression_base(node->expr);
 
-  if (cond.is_symbolic()) {
+  if (Mode::symbolic && cond.is_symbolic()) {
     for (uint32_t i=0; i < node->case_list.size(); i++) {
       auto pair = node->case_list[i];
       // pair.first == nullptr for default:
       symbolic_condition_t *sym_cond;
       if (pair.first) {
-        const value_t c = walk_atom(pair.first);
+        const value_t c = walker.walk_atom(pair.first);
         sym_cond = new symbolic_condition_t(new value_t(cond), new value_t(c),
             ExpressionOperation::EQ);
 
@@ -662,7 +784,7 @@ void AstWalker<ExecutionVisitor, value_t>::walk_case(CaseNode *node) {
           case symbolic::check_status_t::TRUE:
             symbolic::dump_pathcond_match(visitor.context_.trace, visitor.driver_.get_filename(),
                 pair.first->location.begin.line, sym_cond, true);
-            walk_statement(pair.second);
+            walker.walk_statement(pair.second);
             return;
           default: break;
         }
@@ -682,7 +804,7 @@ void AstWalker<ExecutionVisitor, value_t>::walk_case(CaseNode *node) {
           } else {
             visitor.context_.path_name += "D";
           }
-          walk_statement(pair.second);
+          walker.walk_statement(pair.second);
           return;
         }
         default: {
@@ -700,42 +822,65 @@ void AstWalker<ExecutionVisitor, value_t>::walk_case(CaseNode *node) {
     }
     exit(0);
   } else {
-    std::pair<AtomNode*, AstNode*> *default_pair = nullptr;
-    for (auto& pair : node->case_list) {
-      // pair.first == nullptr for default:
-      if (pair.first) {
-        if (walk_atom(pair.first) == cond) {
-          walk_statement(pair.second);
+    if (!node->map_fixed) {
+      // constant labels are evaluated once, the first matching label wins
+      if (node->has_constant_labels()) {
+        for (auto& pair : node->case_list) {
+          if (pair.first) {
+            node->label_map.emplace(walker.walk_atom(pair.first), pair.second);
+          }
+        }
+      }
+      node->map_fixed = true;
+    }
+
+    if (!node->label_map.empty()) {
+      auto iter = node->label_map.find(cond);
+      if (iter != node->label_map.end()) {
+        walker.walk_statement(iter->second);
+        return;
+      }
+    } else {
+      for (auto& pair : node->case_list) {
+        // pair.first == nullptr for default:
+        if (pair.first && walker.walk_atom(pair.first) == cond) {
+          walker.walk_statement(pair.second);
           return;
         }
-      } else {
-        default_pair = &pair;
       }
     }
-    if (default_pair) {
-      walk_statement(default_pair->second);
+    if (node->default_stmt) {
+      walker.walk_statement(node->default_stmt);
     }
   }
 }
 
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_forall(ForallNode *node) {
-  bool forked = false;
-  const value_t in_list = walk_expression_base(node->in_expr);
-
-  if (visitor.context_.updateset.pseudostate % 2 == 1) {
-    CASM_UPDATESET_FORK_PAR(&visitor.context_.updateset);
-    forked = true;
-  }
+template<class Mode>
+static void walk_forall(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, ForallNode *node) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
+  const value_t in_list = walker.walk_expression_base(node->in_expr);
+  const bool forked = visitor.context_.fork_par(node->unchecked_updates);
 
   switch (node->in_expr->type_.t) {
     case TypeType::LIST: {
+      // an undef list has no elements
+      if (in_list.is_undef()) {
+        break;
+      }
       List *l =  in_list.value.list;
 
+      if (l->is_range()) {
+        RangeList *range = reinterpret_cast<RangeList*>(l);
+        for (size_t i = 0; i < range->count; i++) {
+          visitor.bind(node->offset, value_t(range->at(i)));
+          walker.walk_statement(node->statement);
+        }
+        break;
+      }
+
       for (auto iter = l->begin(); iter != l->end(); iter++) {
-        visitor.rule_bindings.back()->push_back(*iter);
-        walk_statement(node->statement);
-        visitor.rule_bindings.back()->pop_back();
+        visitor.bind(node->offset, *iter);
+        walker.walk_statement(node->statement);
       }
       break;
     }
@@ -744,15 +889,13 @@ void AstWalker<ExecutionVisitor, value_t>::walk_forall(ForallNode *node) {
 
       if (end > 0) {
         for (INT_T i = 0; i < end; i++) {
-          visitor.rule_bindings.back()->push_back(value_t(i));
-          walk_statement(node->statement);
-          visitor.rule_bindings.back()->pop_back();
+          visitor.bind(node->offset, value_t(i));
+          walker.walk_statement(node->statement);
         }
       } else {
         for (INT_T i = 0; end < i; i--) {
-          visitor.rule_bindings.back()->push_back(value_t(i));
-          walk_statement(node->statement);
-          visitor.rule_bindings.back()->pop_back();
+          visitor.bind(node->offset, value_t(i));
+          walker.walk_statement(node->statement);
         }
       }
       break;
@@ -767,9 +910,8 @@ void AstWalker<ExecutionVisitor, value_t>::walk_forall(ForallNode *node) {
           }
           value_t v = value_t(pair.second);
           v.type = TypeType::ENUM;
-          visitor.rule_bindings.back()->push_back(std::move(v));
-          walk_statement(node->statement);
-          visitor.rule_bindings.back()->pop_back();
+          visitor.bind(node->offset, v);
+          walker.walk_statement(node->statement);
         }
       } else {
         assert(0);
@@ -779,15 +921,16 @@ void AstWalker<ExecutionVisitor, value_t>::walk_forall(ForallNode *node) {
     default: assert(0);
   }
 
+  visitor.unbind(node->offset);
+
   if (forked) {
     visitor.context_.merge_par();
   }
 }
 
-DEFINE_CASM_UPDATESET_EMPTY
-
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_iterate(UnaryNode *node) {
+template<class Mode>
+static void walk_iterate(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, UnaryNode *node) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
   bool forked = false;
   bool running = true;
 
@@ -799,7 +942,7 @@ void AstWalker<ExecutionVisitor, value_t>::walk_iterate(UnaryNode *node) {
   while (running) {
     CASM_UPDATESET_FORK_PAR(&visitor.context_.updateset);
 
-    walk_statement(node->child_);
+    walker.walk_statement(node->child_);
     if (CASM_UPDATESET_EMPTY(&visitor.context_.updateset)) {
       running = false;
     }
@@ -811,18 +954,19 @@ void AstWalker<ExecutionVisitor, value_t>::walk_iterate(UnaryNode *node) {
   }
 }
 
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_update(UpdateNode *node) {
+template<class Mode>
+static void walk_update(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, UpdateNode *node) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
   // this is used to dump %CREATE in trace if necessary
-  const value_t &expr_t = walk_expression_base(node->expr_);
-  if (visitor.context_.symbolic && node->func->symbol->is_symbolic) {
-    walk_expression_base(node->func);
+  const value_t &expr_t = walker.walk_expression_base(node->expr_);
+  if (Mode::symbolic && node->func->symbol->is_symbolic) {
+    walker.walk_expression_base(node->func);
   }
 
   if (node->func->arguments) {
     uint16_t i;
     for (i=0; i < node->func->arguments->size(); i++) {
-      visitor.arguments[i] = walk_expression_base(node->func->arguments->at(i));
+      visitor.arguments[i] = walker.walk_expression_base(node->func->arguments->at(i));
     }
     visitor.num_arguments = i;
   } else {
@@ -832,21 +976,22 @@ void AstWalker<ExecutionVisitor, value_t>::walk_update(UpdateNode *node) {
   visitor.visit_update(node, expr_t);
 }
 
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_update_subrange(UpdateNode *node) {
-  const value_t &expr_t = walk_expression_base(node->expr_);
+template<class Mode>
+static void walk_update_subrange(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, UpdateNode *node) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
+  const value_t &expr_t = walker.walk_expression_base(node->expr_);
 
   // walk the function expression when argument list contains subrange types
   // to check the subranges and when function is symbolic to dump creates
   if (node->func->symbol->subrange_arguments.size() > 0 || (
-      visitor.context_.symbolic && node->func->symbol->is_symbolic)) {
-    walk_expression_base(node->func);
+      Mode::symbolic && node->func->symbol->is_symbolic)) {
+    walker.walk_expression_base(node->func);
   }
 
   if (node->func->arguments) {
     uint16_t i;
     for (i=0; i < node->func->arguments->size(); i++) {
-      visitor.arguments[i] = walk_expression_base(node->func->arguments->at(i));
+      visitor.arguments[i] = walker.walk_expression_base(node->func->arguments->at(i));
     }
     visitor.num_arguments = i;
   } else {
@@ -856,14 +1001,15 @@ void AstWalker<ExecutionVisitor, value_t>::walk_update_subrange(UpdateNode *node
   visitor.visit_update_subrange(node, expr_t);
 }
 
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_update_dumps(UpdateNode *node) {
-  const value_t expr_t = walk_expression_base(node->expr_);
+template<class Mode>
+static void walk_update_dumps(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, UpdateNode *node) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
+  const value_t expr_t = walker.walk_expression_base(node->expr_);
 
   if (node->func->arguments) {
     uint16_t i;
     for (i=0; i < node->func->arguments->size(); i++) {
-      visitor.arguments[i] = walk_expression_base(node->func->arguments->at(i));
+      visitor.arguments[i] = walker.walk_expression_base(node->func->arguments->at(i));
     }
     visitor.num_arguments = i;
   } else {
@@ -873,11 +1019,107 @@ void AstWalker<ExecutionVisitor, value_t>::walk_update_dumps(UpdateNode *node) {
   visitor.visit_update_dumps(node, expr_t);
 }
 
-ExecutionWalker::ExecutionWalker(ExecutionVisitor& v) 
-     : AstWalker<ExecutionVisitor, value_t>(v), initialized() {
+template<class Mode>
+static void walk_call(AstWalker<ExecutionVisitor<Mode>, value_t>& walker, CallNode *call) {
+  ExecutionVisitor<Mode>& visitor = walker.visitor;
+  if (call->ruleref == nullptr) {
+    visitor.visit_call_pre(call);
+  } else {
+    const value_t v = walker.walk_expression_base(call->ruleref);
+    visitor.visit_call_pre(call, v);
+  }
+
+  // the arguments are pushed on the binding stack and become the frame of
+  // the called rule
+  const size_t base = visitor.arguments_base();
+  if (call->arguments != nullptr) {
+    for (ExpressionBase *e: *call->arguments) {
+      visitor.push_argument(walker.walk_expression_base(e));
+    }
+  }
+  if (call->rule != nullptr) {
+    visitor.visit_call(call, base);
+    walker.walk_rule(call->rule);
+    visitor.visit_call_post(call);
+  } else {
+    DEBUG("rule not set!");
+    visitor.drop_arguments(base);
+  }
+}
+
+// Specializations of the walker forward to the templates above
+#define DEFINE_EXECUTION_WALKER_SPECIALIZATIONS(Mode)                        \
+  template <>                                                                \
+  value_t AstWalker<ExecutionVisitor<Mode>, value_t>::walk_expression_base(ExpressionBase *expr) { \
+    return ::walk_expression_base(*this, expr);                              \
+  }                                                                          \
+  template <>                                                                \
+  value_t AstWalker<ExecutionVisitor<Mode>, value_t>::walk_list_atom(ListAtom *atom) { \
+    return ::walk_list_atom(*this, atom);                                    \
+  }                                                                          \
+  template <>                                                                \
+  value_t AstWalker<ExecutionVisitor<Mode>, value_t>::walk_function_atom(BaseFunctionAtom *func) { \
+    return ::walk_function_atom(*this, func);                                \
+  }                                                                          \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_ifthenelse(IfThenElseNode* node) { \
+    ::walk_ifthenelse(*this, node);                                          \
+  }                                                                          \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_seqblock(UnaryNode* seqblock) { \
+    ::walk_seqblock(*this, seqblock);                                        \
+  }                                                                          \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_parblock(UnaryNode* parblock) { \
+    ::walk_parblock(*this, parblock);                                        \
+  }                                                                          \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_pop(PopNode* node) { \
+    ::walk_pop(*this, node);                                                 \
+  }                                                                          \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_push(PushNode *node) { \
+    ::walk_push(*this, node);                                                \
+  }                                                                          \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_case(CaseNode *node) { \
+    ::walk_case(*this, node);                                                \
+  }                                                                          \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_forall(ForallNode *node) { \
+    ::walk_forall(*this, node);                                              \
+  }                                                                          \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_iterate(UnaryNode *node) { \
+    ::walk_iterate(*this, node);                                             \
+  }                                                                          \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_update(UpdateNode *node) { \
+    ::walk_update(*this, node);                                              \
+  }                                                                          \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_update_subrange(UpdateNode *node) { \
+    ::walk_update_subrange(*this, node);                                     \
+  }                                                                          \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_update_dumps(UpdateNode *node) { \
+    ::walk_update_dumps(*this, node);                                        \
+  }                                                                          \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_call(CallNode *call) { \
+    ::walk_call(*this, call);                                                \
+  }
+
+DEFINE_EXECUTION_WALKER_SPECIALIZATIONS(ConcreteMode)
+DEFINE_EXECUTION_WALKER_SPECIALIZATIONS(SymbolicMode)
+
+template<class Mode>
+ExecutionWalker<Mode>::ExecutionWalker(ExecutionVisitor<Mode>& v, RuleExecutor *executor)
+     : AstWalker<ExecutionVisitor<Mode>, value_t>(v), initialized(), executor_(executor) {
 }
 
-bool ExecutionWalker::init_function(const std::string& name, std::set<std::string>& visited) {
+template<class Mode>
+bool ExecutionWalker<Mode>::init_function(const std::string& name, std::set<std::string>& visited) {
   if (visitor.driver_.init_dependencies.count(name) != 0) {
     visited.insert(name);
     const std::set<std::string>& deps = visitor.driver_.init_dependencies[name];
@@ -899,12 +1141,13 @@ bool ExecutionWalker::init_function(const std::string& name, std::set<std::strin
     return true;
   }
 
-  visitor.context_.function_states[func->id] = std::move(
-      std::unordered_map<ArgumentsKey, value_t>(0, {func->arguments_}, {func->arguments_}));
+  // arguments can be symbols in symbolic mode, which requires a map
+  visitor.context_.function_states[func->id] = FunctionState(func,
+      visitor.context_.symbol_table, Mode::symbolic);
 
   visitor.context_.function_symbols[func->id] = func;
 
-  auto& function_map = visitor.context_.function_states[func->id];
+  auto& function_state = visitor.context_.function_states[func->id];
 
   if (func->intitializers_ != nullptr) {
     for (std::pair<ExpressionBase*, ExpressionBase*> init : *func->intitializers_) {
@@ -912,7 +1155,7 @@ bool ExecutionWalker::init_function(const std::string& name, std::set<std::strin
       uint64_t *args = new uint64_t[10];
       if (init.first != nullptr) {
         value_t arguments[10];
-        const value_t argument_v = walk_expression_base(init.first);
+        const value_t argument_v = this->walk_expression_base(init.first);
         if (func->arguments_.size() > 1) {
           List *list = argument_v.value.list;
           for (auto iter = list->begin(); iter != list->end(); iter++) {
@@ -923,40 +1166,69 @@ bool ExecutionWalker::init_function(const std::string& name, std::set<std::strin
             arguments[num_arguments] = argument_v;
             num_arguments += 1;
         }
-        pack_values_in_array(arguments, &args[0], num_arguments);
+        pack_values_in_array<Mode>(arguments, &args[0], num_arguments);
+        for (uint32_t i = 0; i < num_arguments; i++) {
+          if (arguments[i].is_list()) {
+            pin_uint64_value(func->arguments_[i], args[i]);
+          } else {
+            arguments[i].pin();
+          }
+        }
+        // dense storage has no slot for keys outside of the subranges
+        for (uint32_t j : func->subrange_arguments) {
+          const value_t& v = arguments[j];
+          const Type *t = func->arguments_[j];
+          if (!v.is_undef() && !v.is_symbolic() &&
+              (v.value.integer < t->subrange_start || v.value.integer > t->subrange_end)) {
+            visitor.driver_.error(init.first->location,
+                  v.to_str()+" does violate the subrange "
+                  +std::to_string(t->subrange_start)
+                  +".." +std::to_string(t->subrange_end)
+                  +" of "+std::to_string(j+1)+". function argument");
+            throw RuntimeException("Subrange violated");
+          }
+        }
       } else {
         args[0] = 0;
       }
 
-      if (function_map.count(ArgumentsKey(&args[0], num_arguments, false, 0)) != 0) {
+      if (function_state.find(&args[0], 0) != nullptr) {
         yy::location loc = init.first ? init.first->location+init.second->location
                                       : init.second->location;
         visitor.driver_.error(loc, "function `"+func->name+"("+args_to_str(args, num_arguments)+")` already initialized");
         throw RuntimeException("function already initialized");
       }
 
-      if (visitor.context_.symbolic && func->is_symbolic) {
-        const value_t v = walk_expression_base(init.second);
+      if (Mode::symbolic && func->is_symbolic) {
+        const value_t v = this->walk_expression_base(init.second);
         symbolic::dump_create(visitor.context_.trace_creates, func,
             &args[0], 0, v);
-        function_map.emplace(std::pair<ArgumentsKey, value_t>(
-              std::move(ArgumentsKey(&args[0], num_arguments, true, 0)), v));
+        function_state.get(&args[0], 0) = v;
       } else {
-        value_t v = walk_expression_base(init.second);
+        value_t v = this->walk_expression_base(init.second);
         if (func->subrange_return) {
           if (v.value.integer < func->return_type_->subrange_start ||
             v.value.integer > func->return_type_->subrange_end) {
             yy::location loc = init.first ? init.first->location+init.second->location
                                           : init.second->location;
             visitor.driver_.error(loc,
-                  std::to_string(v.value.integer)+" does violate the subrange "
+                  v.to_str()+" does violate the subrange "
                   +std::to_string(func->return_type_->subrange_start)
                   +".." +std::to_string(func->return_type_->subrange_end)
                   +" of `"+func->name+"`");
             throw RuntimeException("Subrange violated");
           }
         }
-        function_map.emplace(std::pair<ArgumentsKey, value_t>(std::move(ArgumentsKey(&args[0], num_arguments, true, 0)), v));
+        if (v.is_list()) {
+          // the function holds a reference, lists collected later must not
+          // reuse the storage of the initial value
+          v.value.list->bump_usage();
+          v.value.list->retain_elements();
+          v.value.list = v.value.list->store(1);
+        } else {
+          v.bump_usage();
+        }
+        function_state.get(&args[0], 0) = v;
       }
       initializer_args.push_back(args);
     }
@@ -966,7 +1238,8 @@ bool ExecutionWalker::init_function(const std::string& name, std::set<std::strin
   return true;
 }
 
-void ExecutionWalker::run() {
+template<class Mode>
+void ExecutionWalker<Mode>::run() {
 
   for (auto pair : visitor.driver_.init_dependencies) {
     std::set<std::string> visited;
@@ -994,11 +1267,12 @@ void ExecutionWalker::run() {
     init_function(pair.first, visited);
   }
 
-  for (List *l : visitor.context_.temp_lists) {
-    l->bump_usage();
-  }
-
-  visitor.context_.temp_lists.clear();
+  // the initial values of list functions were promoted when stored
+  visitor.context_.list_arena.clear();
+  // initializers are not applied as updates, derived results computed while
+  // initializing can depend on functions that were initialized later
+  visitor.context_.derived_cache.clear();
+  free_unused_values();
 
   Function *program_sym = visitor.context_.symbol_table.get_function("program");
   uint64_t args[10] = {0};
@@ -1007,14 +1281,18 @@ void ExecutionWalker::run() {
     if (program_val.type == TypeType::UNDEF) {
       break;
     }
-    walk_rule(program_val.value.rule);
+    if (executor_) {
+      executor_->execute_rule(program_val.value.rule);
+    } else {
+      this->walk_rule(program_val.value.rule);
+    }
     visitor.context_.apply_updates();
     // reuse symbolic counter as step counter, saves one counter in the main
     // loop
     symbolic::advance_timestamp();
   }
 
-  if (visitor.context_.symbolic) {
+  if (Mode::symbolic) {
     FILE *out;
     if (visitor.context_.fileout) {
       const std::string& filename = visitor.driver_.get_filename().substr(
@@ -1053,3 +1331,13 @@ void ExecutionWalker::run() {
     }
   }
 }
+
+template uint16_t pack_values_in_array<ConcreteMode>(const value_t value_list[],
+                                                     uint64_t array[], uint32_t size);
+template uint16_t pack_values_in_array<SymbolicMode>(const value_t value_list[],
+                                                     uint64_t array[], uint32_t size);
+
+template class ExecutionVisitor<ConcreteMode>;
+template class ExecutionVisitor<SymbolicMode>;
+template class ExecutionWalker<ConcreteMode>;
+template class ExecutionWalker<SymbolicMode>;
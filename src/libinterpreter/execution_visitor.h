@@ -1,6 +1,7 @@
 #ifndef CASMI_LIBINTERPRETER_EXEC_VISITOR
 #define CASMI_LIBINTERPRETER_EXEC_VISITOR
 
+#include <algorithm>
 #include <utility>
 #include <sys/types.h>
 
@@ -11,19 +12,71 @@
 #include "libsyntax/driver.h"
 
 #include "libinterpreter/execution_context.h"
+#include "libinterpreter/execution_mode.h"
 #include "libinterpreter/value.h"
+#include "libinterpreter/bigint.h"
 
+template<class Mode>
+uint16_t pack_values_in_array(const value_t value_list[], uint64_t array[], uint32_t size);
+
+// The visitor is instantiated for ConcreteMode and SymbolicMode, symbolic
+// values are only handled by the SymbolicMode instantiation
+template<class Mode>
 class ExecutionVisitor : public BaseVisitor<value_t> {
   private:
-    std::vector<value_t> main_bindings;
+    // bindings of all active rules and derived functions in one stack, the
+    // binding offsets computed by the TypecheckVisitor are relative to
+    // frame_base; the stack grows, but is never shrunk
+    std::vector<value_t> bindings;
+    std::vector<size_t> frames;
+    size_t frame_base;
+    size_t bindings_top;
     casm_update *add_update(const value_t& val, size_t sym_id);
 
+    void reserve_bindings(size_t size) {
+      if (size > bindings.size()) {
+        bindings.resize(std::max(size, 2 * bindings.size()));
+      }
+    }
 
   public:
     std::vector<value_t> value_list;
     Driver& driver_;
     ExecutionContext& context_;
-    std::vector<std::vector<value_t> *> rule_bindings;
+
+    const value_t& binding(size_t offset) const {
+      return bindings[frame_base + offset];
+    }
+
+    // sets the binding at offset and drops all bindings above it
+    void bind(size_t offset, const value_t& val) {
+      reserve_bindings(frame_base + offset + 1);
+      bindings[frame_base + offset] = val;
+      bindings_top = frame_base + offset + 1;
+    }
+
+    // drops the binding at offset and all bindings above it
+    void unbind(size_t offset) { bindings_top = frame_base + offset; }
+
+    // arguments of calls are pushed on top of the stack, enter_frame then
+    // makes them the first bindings of the called rule
+    void push_argument(const value_t& val) {
+      reserve_bindings(bindings_top + 1);
+      bindings[bindings_top] = val;
+      bindings_top += 1;
+    }
+    size_t arguments_base() const { return bindings_top; }
+    void drop_arguments(size_t base) { bindings_top = base; }
+    const value_t *arguments_at(size_t base) const { return &bindings[base]; }
+    void enter_frame(size_t base) {
+      frames.push_back(frame_base);
+      frame_base = base;
+    }
+    void leave_frame() {
+      bindings_top = frame_base;
+      frame_base = frames.back();
+      frames.pop_back();
+    }
 
     value_t arguments[10];
     uint32_t num_arguments;
@@ -38,7 +91,8 @@ class ExecutionVisitor : public BaseVisitor<value_t> {
     void visit_update_dumps(UpdateNode *update, const value_t& expr_v);
     void visit_call_pre(CallNode *call);
     void visit_call_pre(CallNode *call, const value_t& expr);
-    void visit_call(CallNode *call, std::vector<value_t> &arguments);
+    void visit_call(CallNode *call, size_t arguments_base);
+    void check_call_arguments(CallNode *call, const value_t arguments[], size_t num_arguments);
     void visit_call_post(CallNode *call);
     void visit_print(PrintNode *node, const std::vector<value_t> &arguments);
     void visit_diedie(DiedieNode *node, const value_t& msg);
@@ -48,13 +102,14 @@ class ExecutionVisitor : public BaseVisitor<value_t> {
     void visit_let_post(LetNode *node);
     void visit_push(PushNode *node, const value_t& expr, const value_t& atom);
     void visit_pop(PopNode *node, const value_t& val);
+    const value_t apply_pop(PopNode *node, const value_t& val);
 
     const value_t visit_expression(Expression *expr, const value_t& left_val,
                                  const value_t& right_val);
     value_t visit_expression_single(Expression *expr, const value_t& val);
-    const value_t visit_int_atom(IntAtom *atom) { return std::move(value_t(atom->val_)); }
+    const value_t visit_int_atom(IntAtom *atom) { return bigint::from_int(atom->val_); }
     const value_t visit_float_atom(FloatAtom *atom) { return std::move(value_t(atom->val_)); }
-    const value_t visit_rational_atom(RationalAtom *atom) { return std::move(value_t(&atom->val_)); }
+    const value_t visit_rational_atom(RationalAtom *atom) { return std::move(value_t(atom->val_)); }
     const value_t visit_undef_atom(UndefAtom *atom) { UNUSED(atom); return std::move(value_t()); }
     const value_t visit_function_atom(FunctionAtom *atom,
                                       const value_t arguments[], uint16_t num_arguments);
@@ -72,56 +127,73 @@ class ExecutionVisitor : public BaseVisitor<value_t> {
     const value_t visit_self_atom(SelfAtom *atom) { UNUSED(atom); return value_t(); }
     const value_t visit_rule_atom(RuleAtom *atom) { return value_t(atom->rule); }
     const value_t visit_boolean_atom(BooleanAtom *atom) { return value_t(atom->value); }
-    const value_t visit_string_atom(StringAtom *atom) { return value_t(&atom->string); }
+    const value_t visit_string_atom(StringAtom *atom) {
+      return value_t(string_t::literal(atom->string, atom->interned));
+    }
     const value_t visit_list_atom(ListAtom *atom, const std::vector<value_t> &vals);
-    const value_t visit_number_range_atom(NumberRangeAtom *atom);
+    const value_t visit_number_range_atom(NumberRangeAtom *atom, const value_t& start,
+                                          const value_t& end);
 };
 
-template <>
-value_t AstWalker<ExecutionVisitor, value_t>::walk_list_atom(ListAtom *atom);
-
-// Specialize if-then-else for ExecutionVisitor
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_ifthenelse(IfThenElseNode* node);
-
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_seqblock(UnaryNode* seqblock);
-
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_parblock(UnaryNode* parblock);
-
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_pop(PopNode* node);
-
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_push(PushNode* node);
-
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_case(CaseNode *node);
-
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_forall(ForallNode *node);
-
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_iterate(UnaryNode *node);
-
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_update(UpdateNode *node);
-
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_update_subrange(UpdateNode *node);
-
-template <>
-void AstWalker<ExecutionVisitor, value_t>::walk_update_dumps(UpdateNode *node);
+// Specialize the walker for ExecutionVisitor, the definitions are shared by
+// both execution modes
+#define DECLARE_EXECUTION_WALKER_SPECIALIZATIONS(Mode)                       \
+  template <>                                                                \
+  value_t AstWalker<ExecutionVisitor<Mode>, value_t>::walk_expression_base(ExpressionBase *expr); \
+  template <>                                                                \
+  value_t AstWalker<ExecutionVisitor<Mode>, value_t>::walk_list_atom(ListAtom *atom); \
+  template <>                                                                \
+  value_t AstWalker<ExecutionVisitor<Mode>, value_t>::walk_function_atom(BaseFunctionAtom *func); \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_ifthenelse(IfThenElseNode* node); \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_seqblock(UnaryNode* seqblock); \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_parblock(UnaryNode* parblock); \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_pop(PopNode* node);  \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_push(PushNode* node); \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_case(CaseNode *node); \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_forall(ForallNode *node); \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_iterate(UnaryNode *node); \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_update(UpdateNode *node); \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_update_subrange(UpdateNode *node); \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_update_dumps(UpdateNode *node); \
+  template <>                                                                \
+  void AstWalker<ExecutionVisitor<Mode>, value_t>::walk_call(CallNode *call);
+
+DECLARE_EXECUTION_WALKER_SPECIALIZATIONS(ConcreteMode)
+DECLARE_EXECUTION_WALKER_SPECIALIZATIONS(SymbolicMode)
+
+// Executes rules in place of the AST walker, implemented by the bytecode VM
+// and by code unrolled with --unroll-bytecode
+class RuleExecutor {
+  public:
+    virtual ~RuleExecutor() {}
+    virtual void execute_rule(RuleNode *rule) = 0;
+};
 
-class ExecutionWalker : public AstWalker<ExecutionVisitor, value_t> {
+template<class Mode>
+class ExecutionWalker : public AstWalker<ExecutionVisitor<Mode>, value_t> {
   private:
     std::set<std::string> initialized;
+    // rules are walked when no executor is set, only the walker supports
+    // symbolic mode
+    RuleExecutor *executor_;
 
     bool init_function(const std::string& name, std::set<std::string>& visited);
 
   public:
-    ExecutionWalker(ExecutionVisitor& v);
+    using AstWalker<ExecutionVisitor<Mode>, value_t>::visitor;
+
+    ExecutionWalker(ExecutionVisitor<Mode>& v, RuleExecutor *executor = nullptr);
     void run();
 };
 #endif //CASMI_LIBINTERPRETER_EXEC_VISITOR
@@ -0,0 +1,367 @@
+#include <new>
+
+#include "macros.h"
+#include "libutil/exceptions.h"
+
+#include "libinterpreter/function_state.h"
+
+// maximum number of slots for functions with dense storage
+#define DENSE_STORAGE_MAX_SIZE (1 << 16)
+
+#define ARGUMENTS_MAP_INITIAL_BITS 3
+#define ARGUMENTS_MAP_CHUNK_BITS 8
+
+// finalizer of MurmurHash3, every input bit affects every output bit
+static inline uint64_t mix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+uint64_t hash_arguments(const std::vector<Type*>& types, const uint64_t args[],
+                        uint16_t sym_args) {
+  uint64_t h = 0x9E3779B97F4A7C15ULL;
+  uint64_t last = 0;
+  for (uint16_t i = 0; i < types.size(); i++) {
+    if ((sym_args & (1 << i)) != 0) {
+      last = hash_uint64_value(&symbol_type, args[i]);
+    } else {
+      last = hash_uint64_value(types[i], args[i]);
+    }
+    h = mix64(h ^ (last >> 3));
+  }
+  // the low bits of the last argument are kept, consecutive integers end up
+  // in the same cache line of the slot array
+  return (h & ~7ULL) | (last & 7);
+}
+
+ArgumentsKey::ArgumentsKey(uint64_t *args, uint16_t size, bool dyn,
+    uint16_t syms) : dynamic(dyn), sym_args(syms) {
+  if (dynamic) {
+    p = new uint64_t[size];
+    for (uint16_t i = 0; i < size; i++) {
+      p[i] = args[i];
+    }
+  } else {
+    p = args;
+  }
+}
+
+ArgumentsKey::ArgumentsKey(const ArgumentsKey& other) : p(other.p),
+    dynamic(other.dynamic), sym_args(other.sym_args) {
+}
+
+ArgumentsKey::ArgumentsKey(ArgumentsKey&& other) noexcept {
+  p = other.p;
+  dynamic = other.dynamic;
+  other.dynamic = false;
+  sym_args = other.sym_args;
+}
+
+ArgumentsKey::~ArgumentsKey() {
+  if (dynamic) {
+    delete[] p;
+  }
+}
+
+ArgumentsMap::ArgumentsMap(const std::vector<Type*>& types) : types_(types),
+    num_args_(types.size()), stride_(sizeof(entry) + types.size() * sizeof(uint64_t)),
+    chunks_(), num_entries_(0), free_(), slots_(1 << ARGUMENTS_MAP_INITIAL_BITS, 0),
+    count_(0), bits_(ARGUMENTS_MAP_INITIAL_BITS) {}
+
+ArgumentsMap::entry *ArgumentsMap::at(uint32_t idx) const {
+  const uint32_t mask = (1 << ARGUMENTS_MAP_CHUNK_BITS) - 1;
+  return reinterpret_cast<entry*>(chunks_[idx >> ARGUMENTS_MAP_CHUNK_BITS].get()
+                                  + (idx & mask) * stride_);
+}
+
+bool ArgumentsMap::equals(entry *e, uint32_t hash, const uint64_t args[],
+                          uint16_t sym_args) const {
+  if (e->hash != hash || e->sym_args != sym_args) {
+    return false;
+  }
+  const uint64_t *entry_args = args_of(e);
+  for (uint16_t i = 0; i < num_args_; i++) {
+    if ((sym_args & (1 << i)) != 0) {
+      if (entry_args[i] != args[i]) {
+        return false;
+      }
+    } else if (!eq_uint64_value(types_[i], entry_args[i], args[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t ArgumentsMap::probe(uint32_t hash, const uint64_t args[], uint16_t sym_args) const {
+  const size_t mask = slots_.size() - 1;
+  size_t i = home(hash);
+  while (slots_[i] != 0) {
+    if ((slots_[i] >> 32) == hash &&
+        equals(at((uint32_t) slots_[i] - 1), hash, args, sym_args)) {
+      break;
+    }
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+void ArgumentsMap::grow() {
+  std::vector<uint64_t> old(slots_.size() * 2, 0);
+  old.swap(slots_);
+  bits_ += 1;
+
+  const size_t mask = slots_.size() - 1;
+  for (uint64_t s : old) {
+    if (s != 0) {
+      size_t i = home(s >> 32);
+      while (slots_[i] != 0) {
+        i = (i + 1) & mask;
+      }
+      slots_[i] = s;
+    }
+  }
+}
+
+value_t *ArgumentsMap::find(const uint64_t args[], uint16_t sym_args) const {
+  const uint32_t hash = (uint32_t) hash_arguments(types_, args, sym_args);
+  const uint64_t s = slots_[probe(hash, args, sym_args)];
+  return (s != 0) ? &at((uint32_t) s - 1)->value : nullptr;
+}
+
+value_t& ArgumentsMap::get(const uint64_t args[], uint16_t sym_args) {
+  if ((count_ + 1) * 2 > slots_.size()) {
+    grow();
+  }
+
+  const uint32_t hash = (uint32_t) hash_arguments(types_, args, sym_args);
+  const size_t i = probe(hash, args, sym_args);
+  if (slots_[i] != 0) {
+    return at((uint32_t) slots_[i] - 1)->value;
+  }
+
+  uint32_t idx;
+  if (!free_.empty()) {
+    idx = free_.back();
+    free_.pop_back();
+  } else {
+    idx = num_entries_;
+    num_entries_ += 1;
+    if ((idx >> ARGUMENTS_MAP_CHUNK_BITS) == chunks_.size()) {
+      chunks_.emplace_back(new char[stride_ << ARGUMENTS_MAP_CHUNK_BITS]);
+    }
+  }
+
+  entry *e = at(idx);
+  new (&e->value) value_t();
+  e->hash = hash;
+  e->sym_args = sym_args;
+  e->used = 1;
+  uint64_t *entry_args = args_of(e);
+  for (uint16_t j = 0; j < num_args_; j++) {
+    entry_args[j] = args[j];
+  }
+
+  slots_[i] = ((uint64_t) hash) << 32 | (idx + 1);
+  count_ += 1;
+  return e->value;
+}
+
+// backward shift deletion, keeps probe sequences intact without tombstones
+bool ArgumentsMap::erase(const uint64_t args[], uint16_t sym_args) {
+  const uint32_t hash = (uint32_t) hash_arguments(types_, args, sym_args);
+  size_t i = probe(hash, args, sym_args);
+  if (slots_[i] == 0) {
+    return false;
+  }
+
+  const uint32_t idx = (uint32_t) slots_[i] - 1;
+  at(idx)->used = 0;
+  free_.push_back(idx);
+  count_ -= 1;
+
+  const size_t mask = slots_.size() - 1;
+  size_t j = i;
+  while (true) {
+    j = (j + 1) & mask;
+    if (slots_[j] == 0) {
+      break;
+    }
+    size_t h = home(slots_[j] >> 32);
+    // move j to i if its home slot is not in the cyclic range (i, j]
+    if ((j > i && (h <= i || h > j)) || (j < i && (h <= i && h > j))) {
+      slots_[i] = slots_[j];
+      i = j;
+    }
+  }
+  slots_[i] = 0;
+  return true;
+}
+
+FunctionState::FunctionState() : storage_(Storage::FLAT), num_args_(0),
+    dimensions_(), values_(), present_(), flat_({}), map_() {}
+
+FunctionState::FunctionState(const Function *func, const SymbolTable& symbol_table,
+    bool symbolic) : storage_(symbolic ? Storage::MAP : Storage::DENSE),
+    num_args_(func->arguments_.size()), dimensions_(), values_(), present_(),
+    flat_(func->arguments_), map_(0, {func->arguments_}, {func->arguments_}) {
+
+  size_t size = 1;
+  for (uint16_t i = 0; i < num_args_ && storage_ == Storage::DENSE; i++) {
+    const Type *t = func->arguments_[i];
+    dimension dim = {t->t, 0, 0, {}};
+
+    if (t->t == TypeType::SELF) {
+      dim.size = 1;
+    } else if (t->t == TypeType::BOOLEAN) {
+      dim.size = 2;
+    } else if (t->t == TypeType::INT && t->subrange_start < t->subrange_end) {
+      dim.start = t->subrange_start;
+      dim.size = t->subrange_end - t->subrange_start + 1;
+    } else if (t->t == TypeType::ENUM && symbol_table.get_enum(t->enum_name)) {
+      const Enum *enum_ = symbol_table.get_enum(t->enum_name);
+      for (const auto& pair : enum_->mapping) {
+        if (pair.second->id >= dim.enum_values.size()) {
+          dim.enum_values.resize(pair.second->id + 1, nullptr);
+        }
+        dim.enum_values[pair.second->id] = pair.second;
+      }
+      dim.size = dim.enum_values.size();
+    }
+
+    if (dim.size == 0 || dim.size > DENSE_STORAGE_MAX_SIZE / size) {
+      storage_ = Storage::FLAT;
+    } else {
+      size *= dim.size;
+      dimensions_.push_back(std::move(dim));
+    }
+  }
+
+  if (storage_ == Storage::DENSE) {
+    values_.resize(size);
+    present_.resize(size, 0);
+  } else {
+    dimensions_.clear();
+  }
+}
+
+bool FunctionState::index(const uint64_t args[], size_t& idx) const {
+  idx = 0;
+  for (uint16_t i = 0; i < num_args_; i++) {
+    const dimension& dim = dimensions_[i];
+    size_t offset;
+    switch (dim.type) {
+      case TypeType::SELF:
+        offset = 0;
+        break;
+      case TypeType::BOOLEAN:
+        offset = (args[i] != 0) ? 1 : 0;
+        break;
+      case TypeType::INT:
+        offset = (size_t) ((INT_T) args[i] - dim.start);
+        break;
+      case TypeType::ENUM:
+        // undef is packed as 0
+        if (args[i] == 0) {
+          return false;
+        }
+        offset = reinterpret_cast<const enum_value_t*>(args[i])->id;
+        break;
+      default:
+        FAILURE();
+    }
+    if (offset >= dim.size) {
+      return false;
+    }
+    idx = idx * dim.size + offset;
+  }
+  return true;
+}
+
+void FunctionState::unpack_index(size_t idx, uint64_t args[]) const {
+  for (int32_t i = num_args_ - 1; i >= 0; i--) {
+    const dimension& dim = dimensions_[i];
+    size_t offset = idx % dim.size;
+    idx /= dim.size;
+    switch (dim.type) {
+      case TypeType::SELF:
+      case TypeType::BOOLEAN:
+        args[i] = offset;
+        break;
+      case TypeType::INT:
+        args[i] = (uint64_t) (dim.start + (INT_T) offset);
+        break;
+      case TypeType::ENUM:
+        args[i] = (uint64_t) dim.enum_values[offset];
+        break;
+      default:
+        FAILURE();
+    }
+  }
+}
+
+value_t *FunctionState::find(uint64_t args[], uint16_t sym_args) {
+  switch (storage_) {
+    case Storage::DENSE: {
+      size_t idx;
+      if (index(args, idx) && present_[idx]) {
+        return &values_[idx];
+      }
+      return nullptr;
+    }
+    case Storage::FLAT:
+      return flat_.find(args, sym_args);
+    case Storage::MAP: {
+      auto iter = map_.find(ArgumentsKey(args, num_args_, false, sym_args));
+      return (iter != map_.end()) ? &iter->second : nullptr;
+    }
+  }
+  return nullptr;
+}
+
+value_t& FunctionState::get(uint64_t args[], uint16_t sym_args) {
+  switch (storage_) {
+    case Storage::DENSE: {
+      size_t idx;
+      if (!index(args, idx)) {
+        throw RuntimeException("function argument out of range");
+      }
+      present_[idx] = 1;
+      return values_[idx];
+    }
+    case Storage::FLAT:
+      return flat_.get(args, sym_args);
+    case Storage::MAP:
+    default: {
+      const ArgumentsKey key(args, num_args_, false, sym_args);
+      auto iter = map_.find(key);
+      if (iter != map_.end()) {
+        return iter->second;
+      }
+      return map_.emplace(ArgumentsKey(args, num_args_, true, sym_args),
+                          value_t()).first->second;
+    }
+  }
+}
+
+void FunctionState::erase(uint64_t args[], uint16_t sym_args) {
+  switch (storage_) {
+    case Storage::DENSE: {
+      size_t idx;
+      if (index(args, idx)) {
+        present_[idx] = 0;
+        values_[idx] = value_t();
+      }
+      break;
+    }
+    case Storage::FLAT:
+      flat_.erase(args, sym_args);
+      break;
+    case Storage::MAP:
+      map_.erase(ArgumentsKey(args, num_args_, false, sym_args));
+      break;
+  }
+}
@@ -0,0 +1,208 @@
+#ifndef CASMI_LIBINTERPRETER_FUNCTION_STATE_H
+#define CASMI_LIBINTERPRETER_FUNCTION_STATE_H
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "libsyntax/symbols.h"
+
+#include "libinterpreter/value.h"
+
+static Type symbol_type(TypeType::SYMBOL);
+
+// order dependent hash of packed arguments, symbolic arguments are hashed as
+// symbols
+uint64_t hash_arguments(const std::vector<Type*>& types, const uint64_t args[],
+                        uint16_t sym_args);
+
+struct ArgumentsKey {
+  uint64_t* p;
+  bool dynamic;
+  uint16_t sym_args;
+
+  // size must be equal to the size specified in the function type
+  ArgumentsKey(uint64_t *args, uint16_t size, bool dyn, uint16_t sym_args);
+  ArgumentsKey(const ArgumentsKey& other);
+  ArgumentsKey(ArgumentsKey&& other) noexcept;
+  ~ArgumentsKey();
+};
+
+
+
+namespace std {
+
+  template <> struct hash<ArgumentsKey> {
+    std::vector<Type*> types;
+
+    size_t operator()(const ArgumentsKey &key) const {
+      size_t h = 0;
+      for (uint16_t i = 0; i < types.size(); i++) {
+        if ((key.sym_args & (1 << i)) != 0) {
+          h ^= hash_uint64_value(&symbol_type, key.p[i]);
+        } else {
+          h ^= hash_uint64_value(types[i], key.p[i]);
+        }
+      }
+      return h;
+    }
+  };
+
+  template <> struct equal_to<ArgumentsKey> {
+    std::vector<Type*> types;
+
+    bool operator()(const ArgumentsKey &lhs, const ArgumentsKey &rhs) const {
+      for(uint16_t i = 0; i < types.size(); i++) {
+        if (!eq_uint64_value(types[i], lhs.p[i], rhs.p[i])) {
+          return false;
+        }
+      }
+      return true;
+    }
+  };
+}
+
+// Hash map from packed arguments to values for functions with unbounded
+// argument domains. The table only stores a 32 bit hash and an entry index
+// per slot, entries hold the value and the arguments inline and live in
+// fixed size chunks, so the address of a value never changes. Erased entries
+// are reused for later inserts.
+class ArgumentsMap {
+  private:
+    struct entry {
+      value_t value;
+      uint32_t hash;
+      uint16_t sym_args;
+      uint16_t used;
+      // followed by the arguments
+    };
+
+    std::vector<Type*> types_;
+    uint16_t num_args_;
+    size_t stride_;
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    uint32_t num_entries_;
+    std::vector<uint32_t> free_;
+
+    // (hash << 32) | (entry index + 1), 0 marks an empty slot
+    std::vector<uint64_t> slots_;
+    uint32_t count_;
+    uint32_t bits_;
+
+    entry *at(uint32_t idx) const;
+    uint64_t *args_of(entry *e) const {
+      return reinterpret_cast<uint64_t*>(e + 1);
+    }
+    size_t home(uint32_t hash) const {
+      return hash & ((1 << bits_) - 1);
+    }
+    bool equals(entry *e, uint32_t hash, const uint64_t args[], uint16_t sym_args) const;
+    size_t probe(uint32_t hash, const uint64_t args[], uint16_t sym_args) const;
+    void grow();
+
+  public:
+    ArgumentsMap(const std::vector<Type*>& types);
+    ArgumentsMap(ArgumentsMap&& other) = default;
+    ArgumentsMap& operator=(ArgumentsMap&& other) = default;
+
+    size_t size() const { return count_; }
+
+    value_t *find(const uint64_t args[], uint16_t sym_args) const;
+
+    // returns the value for the arguments, inserts undef if they are not
+    // present yet
+    value_t& get(const uint64_t args[], uint16_t sym_args);
+
+    bool erase(const uint64_t args[], uint16_t sym_args);
+
+    // calls f(args, sym_args, value) for every entry
+    template<class F> void for_each(F f) {
+      for (uint32_t i = 0; i < num_entries_; i++) {
+        entry *e = at(i);
+        if (e->used) {
+          f(args_of(e), e->sym_args, e->value);
+        }
+      }
+    }
+};
+
+// State of a single function. The storage is chosen from the signature:
+// nullary functions and functions where all arguments are Self, enums,
+// Booleans or Int subranges use a flat array indexed by the arguments, all
+// other functions use an ArgumentsMap. In symbolic mode arguments can be
+// symbols and the symbolic traces depend on the iteration order of
+// std::unordered_map, so it is used for all functions. The addresses of the
+// stored values are stable, they are used as locations in the update set.
+class FunctionState {
+  public:
+    enum class Storage {
+      DENSE,
+      FLAT,
+      MAP
+    };
+
+  private:
+    // a bounded argument domain, values are mapped to [0, size)
+    struct dimension {
+      TypeType type;
+      INT_T start;
+      size_t size;
+      std::vector<enum_value_t*> enum_values;
+    };
+
+    Storage storage_;
+    uint16_t num_args_;
+    std::vector<dimension> dimensions_;
+    std::vector<value_t> values_;
+    std::vector<uint8_t> present_;
+    ArgumentsMap flat_;
+    std::unordered_map<ArgumentsKey, value_t> map_;
+
+    bool index(const uint64_t args[], size_t& idx) const;
+    void unpack_index(size_t idx, uint64_t args[]) const;
+
+  public:
+    FunctionState();
+    FunctionState(const Function *func, const SymbolTable& symbol_table,
+                  bool symbolic);
+
+    Storage storage() const { return storage_; }
+    bool is_dense() const { return storage_ == Storage::DENSE; }
+
+    // returns the value stored for the arguments or nullptr
+    value_t *find(uint64_t args[], uint16_t sym_args);
+
+    // returns the value stored for the arguments, a new undef value is
+    // stored if the arguments are not present; needs a single probe
+    value_t& get(uint64_t args[], uint16_t sym_args);
+
+    // removes the value stored for the arguments
+    void erase(uint64_t args[], uint16_t sym_args);
+
+    // calls f(args, sym_args, value) for every stored value
+    template<class F> void for_each(F f) {
+      switch (storage_) {
+        case Storage::DENSE: {
+          std::vector<uint64_t> args(num_args_);
+          for (size_t i = 0; i < values_.size(); i++) {
+            if (present_[i]) {
+              unpack_index(i, args.data());
+              f(args.data(), (uint16_t) 0, values_[i]);
+            }
+          }
+          break;
+        }
+        case Storage::FLAT:
+          flat_.for_each(f);
+          break;
+        case Storage::MAP:
+          for (auto& pair : map_) {
+            f(pair.first.p, pair.first.sym_args, pair.second);
+          }
+          break;
+      }
+    }
+};
+
+#endif
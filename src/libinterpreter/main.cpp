@@ -1,4 +1,6 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <cstdlib>
 
@@ -13,10 +15,14 @@
 #include "libsyntax/ast_dump_visitor.h"
 
 #include "libmiddle/typecheck_visitor.h"
+#include "libmiddle/optimization_passes.h"
 
 #include "libinterpreter/execution_visitor.h"
 #include "libinterpreter/execution_context.h"
+#include "libinterpreter/bytecode_vm.h"
+#include "libinterpreter/bytecode_unroller.h"
 #include "libinterpreter/value.h"
+#include "libinterpreter/bigint.h"
 
 // driver must be global, because it is needed for YY_INPUT
 // defined in src/libsyntax/driver.cpp
@@ -31,18 +37,28 @@ enum Optionvalue_ts {
   SYMBOLIC = (1 << 4),
   FILEOUT = (1 << 5),
   DUMP_UPDATES = (1 << 6),
-  ERROR = (1 << 9)
+  AST_WALKER = (1 << 7),
+  UNROLL_BYTECODE = (1 << 8),
+  DUMP_OPTIMIZED_AST = (1 << 9),
+  BIGINT = (1 << 10),
+  CACHE_DERIVED = (1 << 11),
+  ERROR = (1 << 12)
 };
 
 struct arguments {
   int flags;
   std::string filename;
   std::string debuginfo_filter;
+  std::string cpp_output;
 };
 
 struct arguments parse_cmd_args(int argc, char *argv[]) {
   int dump_ast = 0;
   int parse_only = 0;
+  int ast_walker = 0;
+  int dump_optimized_ast = 0;
+  int bigint = 0;
+  int cache_derived = 0;
   struct option long_options[] = {
        {"help", no_argument, 0, 'h'},
        {"dump-ast", no_argument, &dump_ast, 1},
@@ -51,6 +67,11 @@ struct arguments parse_cmd_args(int argc, char *argv[]) {
        {"symbolic", no_argument, 0, 's'},
        {"fileout", no_argument, 0, 'x'},
        {"dump-updates", no_argument, 0, 'u'},
+       {"ast-walker", no_argument, &ast_walker, 1},
+       {"unroll-bytecode", required_argument, 0, 'e'},
+       {"dump-optimized-ast", no_argument, &dump_optimized_ast, 1},
+       {"bigint", no_argument, &bigint, 1},
+       {"cache-derived", no_argument, &cache_derived, 1},
        {0, 0, 0, 0}
   };
 
@@ -67,6 +88,10 @@ struct arguments parse_cmd_args(int argc, char *argv[]) {
         switch (option_index) {
           case 1: flags |= Optionvalue_ts::DUMP_AST; break;
           case 2: flags |= Optionvalue_ts::PARSE_ONLY; break;
+          case 7: flags |= Optionvalue_ts::AST_WALKER; break;
+          case 9: flags |= Optionvalue_ts::DUMP_OPTIMIZED_AST; break;
+          case 10: flags |= Optionvalue_ts::BIGINT; break;
+          case 11: flags |= Optionvalue_ts::CACHE_DERIVED; break;
           default: flags |= Optionvalue_ts::ERROR;
         }
         break;
@@ -86,6 +111,10 @@ struct arguments parse_cmd_args(int argc, char *argv[]) {
       case 'u':
         flags |= Optionvalue_ts::DUMP_UPDATES;
         break;
+      case 'e':
+        flags |= Optionvalue_ts::UNROLL_BYTECODE;
+        opts.cpp_output = optarg;
+        break;
       case '?':
         flags |= Optionvalue_ts::ERROR;
         /* getopt_long already printed an error message. */
@@ -109,10 +138,31 @@ void print_help() {
   std::cout << "OPTIONS:" << std::endl;
   std::cout << "  -h, --help" << "\t\t\t" << "shows command line options" << std::endl;
   std::cout << "  --dump-ast" << "\t\t\t" << "dumps the AST as dot graph" << std::endl;
+  std::cout << "  --dump-optimized-ast" << "\t\t" << "dumps the AST after typechecking and optimization as dot graph" << std::endl;
   std::cout << "  --parse-only" << "\t\t\t" << "only parse the input, does not run typechecking" << std::endl;
   std::cout << "  --debuginfo-filter FILTERS" << "\t" << "comma separated list with filter names to enable"<< std::endl;
   std::cout << "  -s, --symbolic" << "\t\t" << "enable symbolic mode" << std::endl;
   std::cout << "  -u, --dump-updates" << "\t\t" << "dump generated updates after each step" << std::endl;
+  std::cout << "  --ast-walker" << "\t\t\t" << "execute rules by walking the AST instead of using the bytecode VM" << std::endl;
+  std::cout << "  --unroll-bytecode FILE" << "\t" << "unroll the bytecode of the rules to C++ instead of running them" << std::endl;
+  std::cout << "  --bigint" << "\t\t\t" << "promote Int values to arbitrary precision instead of wrapping around" << std::endl;
+  std::cout << "  --cache-derived" << "\t\t" << "reuse results of derived functions until a function they read is updated" << std::endl;
+}
+
+template<class Mode>
+int run_walker(ExecutionWalker<Mode>& walker) {
+  try {
+    walker.run();
+    return EXIT_SUCCESS;
+  } catch (const RuntimeException& ex) {
+    std::cerr << "Abort after runtime exception: "<< ex.what() << std::endl;;
+    return EXIT_FAILURE;
+  } catch (const ImpossibleException& ex) {
+    return EXIT_SUCCESS;
+  } catch (char * e) {
+    std::cerr << "Abort after catching a string: "<< e << std::endl;
+    return EXIT_FAILURE;
+  }
 }
 
 int main (int argc, char *argv[]) {
@@ -132,6 +182,24 @@ int main (int argc, char *argv[]) {
     std::cerr << "No filename provided" << std::endl;
     return EXIT_FAILURE;
   }
+  if ((opts.flags & Optionvalue_ts::BIGINT) != 0) {
+    if ((opts.flags & Optionvalue_ts::UNROLL_BYTECODE) != 0) {
+      std::cerr << "--bigint is not supported by --unroll-bytecode" << std::endl;
+      return EXIT_FAILURE;
+    }
+    // must be set before constant folding and bytecode compilation
+    bigint::enabled = true;
+  }
+  if ((opts.flags & Optionvalue_ts::CACHE_DERIVED) != 0) {
+    if ((opts.flags & Optionvalue_ts::UNROLL_BYTECODE) != 0) {
+      std::cerr << "--cache-derived is not supported by --unroll-bytecode" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if ((opts.flags & Optionvalue_ts::SYMBOLIC) != 0) {
+      std::cerr << "--cache-derived is not supported by --symbolic" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
   //
   // Setup the driver
   Driver driver;
@@ -169,8 +237,32 @@ int main (int argc, char *argv[]) {
       TypecheckVisitor typecheck_visitor(driver);
       AstWalker<TypecheckVisitor, Type*> typecheck_walker(typecheck_visitor);
       typecheck_walker.walk_specification(driver.result);
+      if (driver.ok()) {
+        run_optimization_passes(driver.result);
+      }
+
       if (!driver.ok()) {
         res = EXIT_FAILURE;
+      } else if ((opts.flags & Optionvalue_ts::DUMP_OPTIMIZED_AST) != 0) {
+        AstDumpVisitor dump_visitor;
+        AstWalker<AstDumpVisitor, bool> dump_walker(dump_visitor);
+        dump_walker.walk_specification(driver.result);
+        std::cout << dump_visitor.get_dump();
+        res = EXIT_SUCCESS;
+      } else if ((opts.flags & Optionvalue_ts::UNROLL_BYTECODE) != 0) {
+        std::ifstream in(opts.filename);
+        std::stringstream source;
+        source << in.rdbuf();
+
+        std::ofstream out(opts.cpp_output);
+        if (!out) {
+          std::cerr << "error: could not open `" << opts.cpp_output << "´" << std::endl;
+          res = EXIT_FAILURE;
+        } else {
+          BytecodeUnroller unroller(driver, source.str());
+          unroller.generate(out);
+          res = EXIT_SUCCESS;
+        }
       } else {
         ExecutionContext ctx(driver.function_table, driver.get_init_rule(),
             (opts.flags & Optionvalue_ts::SYMBOLIC) != 0,
@@ -181,19 +273,18 @@ int main (int argc, char *argv[]) {
           ctx.set_debuginfo_filter(opts.debuginfo_filter);
         }
 
-        ExecutionVisitor visitor(ctx, driver);
-        ExecutionWalker walker(visitor);
-        try {
-          walker.run();
-          res = EXIT_SUCCESS;
-        } catch (const RuntimeException& ex) {
-          std::cerr << "Abort after runtime exception: "<< ex.what() << std::endl;;
-          res = EXIT_FAILURE;
-        } catch (const ImpossibleException& ex) {
-          res = EXIT_SUCCESS;
-        } catch (char * e) {
-          std::cerr << "Abort after catching a string: "<< e << std::endl;
-          res = EXIT_FAILURE;
+        if ((opts.flags & Optionvalue_ts::SYMBOLIC) != 0) {
+          ExecutionVisitor<SymbolicMode> visitor(ctx, driver);
+          ExecutionWalker<SymbolicMode> walker(visitor);
+          res = run_walker(walker);
+        } else {
+          ctx.derived_cache.enabled = (opts.flags & Optionvalue_ts::CACHE_DERIVED) != 0;
+          ExecutionVisitor<ConcreteMode> visitor(ctx, driver);
+          BytecodeVM vm(visitor);
+          // the bytecode VM does not support symbolic execution
+          const bool use_bytecode = (opts.flags & Optionvalue_ts::AST_WALKER) == 0;
+          ExecutionWalker<ConcreteMode> walker(visitor, (use_bytecode) ? &vm : nullptr);
+          res = run_walker(walker);
         }
       }
   }
@@ -3,50 +3,66 @@
 #include <sstream>
 
 #include "libinterpreter/operators.h"
+#include "libinterpreter/bigint.h"
 #include "libinterpreter/execution_context.h"
 #include "libinterpreter/symbolic.h"
 
 #define HANDLE_SYMBOLIC_OR_UNDEF(lhs, rhs)                                   \
   if (lhs.is_undef() || rhs.is_undef()) {                                    \
     return value_t();                                                          \
-  } else if (lhs.is_symbolic() || rhs.is_symbolic()) {                       \
+  } else if (Mode::symbolic && (lhs.is_symbolic() || rhs.is_symbolic())) {   \
     /* TODO cleanup symbols */                                               \
     return value_t(new symbol_t(symbolic::next_symbol_id()));                  \
   }                                                                          \
 
-#define CREATE_NUMERICAL_OPERATION(op, lhs, rhs)  {                          \
+#define CREATE_NUMERICAL_OPERATION(op, operation, lhs, rhs)  {               \
   HANDLE_SYMBOLIC_OR_UNDEF(lhs, rhs)                                         \
   switch (lhs.type) {                                                        \
     case TypeType::INT:                                                      \
+      if (bigint::enabled) {                                                 \
+        return bigint::dispatch(ExpressionOperation::operation,              \
+                                lhs.value.integer, rhs.value.integer);       \
+      }                                                                      \
       return std::move(value_t(lhs.value.integer op rhs.value.integer));             \
     case TypeType::FLOAT:                                                    \
       return std::move(value_t(lhs.value.float_ op rhs.value.float_));             \
     case TypeType::RATIONAL:                                                 \
-      return std::move(value_t(&(*lhs.value.rat op *rhs.value.rat)));          \
+      return std::move(value_t(lhs.to_rational() op rhs.to_rational()));     \
     default: FAILURE();                                                      \
   }                                                                          \
 }
 
-#define CREATE_NUMERICAL_CMP_OPERATION(op, lhs, rhs)  {                      \
+#define CREATE_NUMERICAL_CMP_OPERATION(op, operation, lhs, rhs)  {           \
   HANDLE_SYMBOLIC_OR_UNDEF(lhs, rhs)                                         \
                                                                              \
   switch (lhs.type) {                                                        \
     case TypeType::INT:                                                      \
+      if (bigint::enabled) {                                                 \
+        return bigint::dispatch(ExpressionOperation::operation,              \
+                                lhs.value.integer, rhs.value.integer);       \
+      }                                                                      \
       return std::move(value_t(lhs.value.integer op rhs.value.integer));             \
     case TypeType::FLOAT:                                                    \
       return std::move(value_t(lhs.value.float_ op rhs.value.float_));             \
+    case TypeType::RATIONAL: {                                               \
+      /* denominators are positive */                                        \
+      const rational_t l = lhs.to_rational();                                \
+      const rational_t r = rhs.to_rational();                                \
+      return value_t((__int128) l.numerator * r.denominator op               \
+                     (__int128) r.numerator * l.denominator);                \
+    }                                                                        \
     default: FAILURE();                                                      \
   }                                                                          \
 }
 
 #define CHECK_SYMBOLIC_CMP_OPERATION(op, lhs, rhs) {                         \
- if (lhs.is_symbolic() && !rhs.is_undef()) {                                 \
+ if (Mode::symbolic && lhs.is_symbolic() && !rhs.is_undef()) {               \
     return value_t(new symbol_t(symbolic::next_symbol_id(),                    \
                               new symbolic_condition_t(new value_t(lhs),         \
                                                      new value_t(rhs),         \
                                                       op)));                 \
  }                                                                           \
- if (rhs.is_symbolic() && !lhs.is_undef()) {                                 \
+ if (Mode::symbolic && rhs.is_symbolic() && !lhs.is_undef()) {               \
     return value_t(new symbol_t(symbolic::next_symbol_id(),                    \
                               new symbolic_condition_t(new value_t(lhs),         \
                                                      new value_t(rhs),         \
@@ -54,28 +70,29 @@
   }                                                                          \
 }
 
+template<class Mode>
 const value_t operators::dispatch(ExpressionOperation op, const value_t& lhs, const value_t& rhs) {
   switch (op) {
     case ExpressionOperation::ADD:
-      return std::move(operators::add(lhs, rhs));
+      return std::move(operators::add<Mode>(lhs, rhs));
 
     case ExpressionOperation::SUB: 
-      return std::move(operators::sub(lhs, rhs));
+      return std::move(operators::sub<Mode>(lhs, rhs));
 
     case ExpressionOperation::MUL:
-      return std::move(operators::mul(lhs, rhs));
+      return std::move(operators::mul<Mode>(lhs, rhs));
 
     case ExpressionOperation::DIV:
-      return std::move(operators::div(lhs, rhs));
+      return std::move(operators::div<Mode>(lhs, rhs));
 
     case ExpressionOperation::MOD:
-      return std::move(operators::mod(lhs, rhs));
+      return std::move(operators::mod<Mode>(lhs, rhs));
 
     case ExpressionOperation::RAT_DIV:
-      return std::move(operators::rat_div(lhs, rhs));
+      return std::move(operators::rat_div<Mode>(lhs, rhs));
 
     case ExpressionOperation::EQ:
-      if (lhs.is_symbolic() && rhs.is_symbolic()) {
+      if (Mode::symbolic && lhs.is_symbolic() && rhs.is_symbolic()) {
         return std::move(operators::eq(lhs, rhs));
       } else {
         CHECK_SYMBOLIC_CMP_OPERATION(op, lhs, rhs);
@@ -83,7 +100,7 @@ const value_t operators::dispatch(ExpressionOperation op, const value_t& lhs, co
       }
 
     case ExpressionOperation::NEQ: 
-      if (lhs.is_symbolic() && rhs.is_symbolic()) {
+      if (Mode::symbolic && lhs.is_symbolic() && rhs.is_symbolic()) {
         return std::move(operators::neq(lhs, rhs));
       } else {
         CHECK_SYMBOLIC_CMP_OPERATION(op, lhs, rhs);
@@ -103,78 +120,118 @@ const value_t operators::dispatch(ExpressionOperation op, const value_t& lhs, co
       return std::move(operators::not_(lhs));
 
     case ExpressionOperation::LESSER:
-      if (lhs.is_symbolic() && rhs.is_symbolic() && lhs == rhs) {
+      if (Mode::symbolic && lhs.is_symbolic() && rhs.is_symbolic() && lhs == rhs) {
         return value_t(false);
       }
 
       CHECK_SYMBOLIC_CMP_OPERATION(op, lhs, rhs);
-      return std::move(operators::lesser(lhs, rhs));
+      return std::move(operators::lesser<Mode>(lhs, rhs));
 
     case ExpressionOperation::GREATER:
-      if (lhs.is_symbolic() && rhs.is_symbolic() && lhs == rhs) {
+      if (Mode::symbolic && lhs.is_symbolic() && rhs.is_symbolic() && lhs == rhs) {
         return value_t(false);
       }
 
       CHECK_SYMBOLIC_CMP_OPERATION(op, lhs, rhs);
-      return std::move(operators::greater(lhs, rhs));
+      return std::move(operators::greater<Mode>(lhs, rhs));
 
     case ExpressionOperation::LESSEREQ:
-      if (lhs.is_symbolic() && rhs.is_symbolic() && lhs == rhs) {
+      if (Mode::symbolic && lhs.is_symbolic() && rhs.is_symbolic() && lhs == rhs) {
         return value_t(true);
       }
 
       CHECK_SYMBOLIC_CMP_OPERATION(op, lhs, rhs);
-      return std::move(operators::lessereq(lhs, rhs));
+      return std::move(operators::lessereq<Mode>(lhs, rhs));
 
     case ExpressionOperation::GREATEREQ:
-      if (lhs.is_symbolic() && rhs.is_symbolic() && lhs == rhs) {
+      if (Mode::symbolic && lhs.is_symbolic() && rhs.is_symbolic() && lhs == rhs) {
         return value_t(true);
       }
 
       CHECK_SYMBOLIC_CMP_OPERATION(op, lhs, rhs);
-      return std::move(operators::greatereq(lhs, rhs));
+      return std::move(operators::greatereq<Mode>(lhs, rhs));
 
     default: FAILURE();
   }
 
 }
 
+template<class Mode>
+const value_t operators::int_dispatch(ExpressionOperation op, const value_t& lhs,
+                                      const value_t& rhs) {
+  if (lhs.type != TypeType::INT || rhs.type != TypeType::INT) {
+    return std::move(operators::dispatch<Mode>(op, lhs, rhs));
+  }
+
+  const INT_T l = lhs.value.integer;
+  const INT_T r = rhs.value.integer;
+  if (bigint::enabled) {
+    return bigint::dispatch(op, l, r);
+  }
+  switch (op) {
+    case ExpressionOperation::ADD: return value_t(l + r);
+    case ExpressionOperation::SUB: return value_t(l - r);
+    case ExpressionOperation::MUL: return value_t(l * r);
+    case ExpressionOperation::DIV: return value_t(l / r);
+    case ExpressionOperation::MOD: return value_t(l % r);
+    case ExpressionOperation::EQ: return value_t(l == r);
+    case ExpressionOperation::NEQ: return value_t(l != r);
+    case ExpressionOperation::LESSER: return value_t(l < r);
+    case ExpressionOperation::GREATER: return value_t(l > r);
+    case ExpressionOperation::LESSEREQ: return value_t(l <= r);
+    case ExpressionOperation::GREATEREQ: return value_t(l >= r);
+    default: FAILURE();
+  }
+}
+
+bool operators::short_circuits(ExpressionOperation op, const value_t& lhs) {
+  // undef and symbolic values never decide the result
+  return lhs.type == TypeType::BOOLEAN &&
+         lhs.value.boolean == (op == ExpressionOperation::OR);
+}
+
+template<class Mode>
 const value_t operators::add(const value_t& lhs, const value_t& rhs) {
-  CREATE_NUMERICAL_OPERATION(+, lhs, rhs);
+  CREATE_NUMERICAL_OPERATION(+, ADD, lhs, rhs);
 }
 
+template<class Mode>
 const value_t operators::sub(const value_t& lhs, const value_t& rhs) {
-  CREATE_NUMERICAL_OPERATION(-, lhs, rhs);
+  CREATE_NUMERICAL_OPERATION(-, SUB, lhs, rhs);
 }
 
+template<class Mode>
 const value_t operators::mul(const value_t& lhs, const value_t& rhs) {
-  CREATE_NUMERICAL_OPERATION(*, lhs, rhs);
+  CREATE_NUMERICAL_OPERATION(*, MUL, lhs, rhs);
 }
 
+template<class Mode>
 const value_t operators::div(const value_t& lhs, const value_t& rhs) {
-  CREATE_NUMERICAL_OPERATION(/, lhs, rhs);
+  CREATE_NUMERICAL_OPERATION(/, DIV, lhs, rhs);
 }
 
+template<class Mode>
 const value_t operators::mod(const value_t& lhs, const value_t& rhs) {
   HANDLE_SYMBOLIC_OR_UNDEF(lhs, rhs)
   if (lhs.type == TypeType::INT) {
+    if (bigint::enabled) {
+      return bigint::mod(lhs.value.integer, rhs.value.integer);
+    }
     return std::move(value_t(lhs.value.integer % rhs.value.integer));
   }
   return std::move(value_t());
 }
 
+template<class Mode>
 const value_t operators::rat_div(const value_t& lhs, const value_t& rhs) {
   HANDLE_SYMBOLIC_OR_UNDEF(lhs, rhs)
 
   switch (lhs.type) {
-    case TypeType::INT: {
-      rational_t *result = (rational_t*) pp_mem_alloc(
-        &(ExecutionContext::value_stack), sizeof(rational_t)
-      );
-      result->numerator = lhs.value.integer;
-      result->denominator = rhs.value.integer;
-      return std::move(value_t(result));
-    }
+    case TypeType::INT:
+      if (bigint::is_boxed(lhs.value.integer) || bigint::is_boxed(rhs.value.integer)) {
+        return value_t(bigint::rational(lhs.value.integer, rhs.value.integer));
+      }
+      return std::move(value_t(rational_t(lhs.value.integer, rhs.value.integer)));
     default: FAILURE();
   }
 }
@@ -215,18 +272,42 @@ const value_t operators::neq(const value_t& lhs, const value_t& rhs) {
   return std::move(value_t(lhs != rhs));
 }
 
+template<class Mode>
 const value_t operators::lesser(const value_t& lhs, const value_t& rhs) {
-  CREATE_NUMERICAL_CMP_OPERATION(<, lhs, rhs);
+  CREATE_NUMERICAL_CMP_OPERATION(<, LESSER, lhs, rhs);
 }
 
+template<class Mode>
 const value_t operators::greater(const value_t& lhs, const value_t& rhs) {
-  CREATE_NUMERICAL_CMP_OPERATION(>, lhs, rhs);
+  CREATE_NUMERICAL_CMP_OPERATION(>, GREATER, lhs, rhs);
 }
 
+template<class Mode>
 const value_t operators::lessereq(const value_t& lhs, const value_t& rhs) {
-  CREATE_NUMERICAL_CMP_OPERATION(<=, lhs, rhs);
+  CREATE_NUMERICAL_CMP_OPERATION(<=, LESSEREQ, lhs, rhs);
 }
 
+template<class Mode>
 const value_t operators::greatereq(const value_t& lhs, const value_t& rhs) {
-  CREATE_NUMERICAL_CMP_OPERATION(>=, lhs, rhs);
+  CREATE_NUMERICAL_CMP_OPERATION(>=, GREATEREQ, lhs, rhs);
 }
+
+// symbolic code is only part of the SymbolicMode instantiations
+#define INSTANTIATE_OPERATORS(Mode)                                          \
+  template const value_t operators::dispatch<Mode>(ExpressionOperation op,     \
+      const value_t& lhs, const value_t& rhs);                               \
+  template const value_t operators::int_dispatch<Mode>(ExpressionOperation op, \
+      const value_t& lhs, const value_t& rhs);                               \
+  template const value_t operators::add<Mode>(const value_t&, const value_t&); \
+  template const value_t operators::sub<Mode>(const value_t&, const value_t&); \
+  template const value_t operators::mul<Mode>(const value_t&, const value_t&); \
+  template const value_t operators::div<Mode>(const value_t&, const value_t&); \
+  template const value_t operators::mod<Mode>(const value_t&, const value_t&); \
+  template const value_t operators::rat_div<Mode>(const value_t&, const value_t&); \
+  template const value_t operators::lesser<Mode>(const value_t&, const value_t&); \
+  template const value_t operators::greater<Mode>(const value_t&, const value_t&); \
+  template const value_t operators::lessereq<Mode>(const value_t&, const value_t&); \
+  template const value_t operators::greatereq<Mode>(const value_t&, const value_t&);
+
+INSTANTIATE_OPERATORS(ConcreteMode)
+INSTANTIATE_OPERATORS(SymbolicMode)
@@ -4,15 +4,33 @@
 #include "libsyntax/ast.h"
 
 #include "libinterpreter/value.h"
+#include "libinterpreter/execution_mode.h"
 
 namespace operators {
+  // Mode::symbolic enables the handling of symbolic values
+  template<class Mode>
   const value_t dispatch(ExpressionOperation op, const value_t& lhs, const value_t& rhs);
 
+  // operands of INT_EXPRESSION nodes, everything that is not an Int value
+  // (undef, symbols) falls back to dispatch
+  template<class Mode>
+  const value_t int_dispatch(ExpressionOperation op, const value_t& lhs, const value_t& rhs);
+
+  // true if lhs alone decides the result of a BOOLEAN_EXPRESSION, i.e. it is
+  // false for `and` or true for `or`
+  bool short_circuits(ExpressionOperation op, const value_t& lhs);
+
+  template<class Mode>
   const value_t add(const value_t& lhs, const value_t& rhs);
+  template<class Mode>
   const value_t sub(const value_t& lhs, const value_t& rhs);
+  template<class Mode>
   const value_t mul(const value_t& lhs, const value_t& rhs);
+  template<class Mode>
   const value_t div(const value_t& lhs, const value_t& rhs);
+  template<class Mode>
   const value_t mod(const value_t& lhs, const value_t& rhs);
+  template<class Mode>
   const value_t rat_div(const value_t& lhs, const value_t& rhs);
 
   const value_t eq(const value_t& lhs, const value_t& rhs);
@@ -23,9 +41,13 @@ namespace operators {
   const value_t xor_(const value_t& lhs, const value_t& rhs);
   const value_t not_(const value_t& lhs);
 
+  template<class Mode>
   const value_t lesser(const value_t& lhs, const value_t& rhs);
+  template<class Mode>
   const value_t greater(const value_t& lhs, const value_t& rhs);
+  template<class Mode>
   const value_t lessereq(const value_t& lhs, const value_t& rhs);
+  template<class Mode>
   const value_t greatereq(const value_t& lhs, const value_t& rhs);
 };
 
@@ -159,25 +159,25 @@ namespace symbolic {
   }
 
   void dump_final(std::vector<std::string>& trace, const std::vector<const Function*> symbols,
-                  const std::vector<std::unordered_map<ArgumentsKey, value_t>>& states) {
+                  std::vector<FunctionState>& states) {
     std::stringstream ss;
     uint32_t i = 0;
     for (uint32_t j=0; j < symbols.size(); j++) {
       if (!symbols[j]->is_symbolic) {
         continue;
       }
-      for (auto& value_pair : states[j]) {
+      states[j].for_each([&](uint64_t *args, uint16_t sym_args, const value_t& v) {
         ss << "fof(final" << i << ",hypothesis,"
-           << location_to_string(symbols[j], value_pair.first.p, value_pair.first.sym_args, value_pair.second, 0)
+           << location_to_string(symbols[j], args, sym_args, v, 0)
            << ").%FINAL: " << symbols[j]->name;
         if (symbols[j]->arguments_.size() == 0) {
-          ss << arguments_to_string(symbols[j], value_pair.first.p, value_pair.first.sym_args, true);
+          ss << arguments_to_string(symbols[j], args, sym_args, true);
         } else {
-          ss << '(' << arguments_to_string(symbols[j], value_pair.first.p, value_pair.first.sym_args, true) << ')' ;
+          ss << '(' << arguments_to_string(symbols[j], args, sym_args, true) << ')' ;
         }
         ss << std::endl;
         i += 1;
-      }
+      });
     }
     trace.push_back(ss.str());
   }
@@ -213,19 +213,19 @@ namespace symbolic {
         return check_status_t::NOT_FOUND;
       case ExpressionOperation::LESSEREQ:
         if (known.op == ExpressionOperation::EQ) {
-          value_t res = operators::lessereq(*known.rhs, *check.rhs);
+          value_t res = operators::lessereq<SymbolicMode>(*known.rhs, *check.rhs);
           if (res.value.boolean) {
             return check_status_t::TRUE;
           } else {
             return check_status_t::FALSE;
           }
         } else if (known.op == ExpressionOperation::LESSEREQ) {
-          value_t res = operators::lessereq(*check.rhs, *known.rhs);
+          value_t res = operators::lessereq<SymbolicMode>(*check.rhs, *known.rhs);
           if (res.value.boolean) {
             return check_status_t::TRUE;
           }
         } else if (known.op == ExpressionOperation::GREATER) {
-          value_t res = operators::lessereq(*check.rhs, *known.rhs);
+          value_t res = operators::lessereq<SymbolicMode>(*check.rhs, *known.rhs);
           if (res.value.boolean) {
             return check_status_t::FALSE;
           }
@@ -233,19 +233,19 @@ namespace symbolic {
         return check_status_t::NOT_FOUND;
       case ExpressionOperation::GREATER:
         if (known.op == ExpressionOperation::EQ) {
-          value_t res = operators::greater(*known.rhs, *check.rhs);
+          value_t res = operators::greater<SymbolicMode>(*known.rhs, *check.rhs);
           if (res.value.boolean) {
             return check_status_t::TRUE;
           } else {
             return check_status_t::FALSE;
           }
         } else if (known.op == ExpressionOperation::LESSEREQ) {
-          value_t res = operators::lessereq(*known.rhs, *check.rhs);
+          value_t res = operators::lessereq<SymbolicMode>(*known.rhs, *check.rhs);
           if (res.value.boolean) {
             return check_status_t::FALSE;
           }
         } else if (known.op == ExpressionOperation::GREATER) {
-          value_t res = operators::greater(*check.rhs, *known.rhs);
+          value_t res = operators::greater<SymbolicMode>(*check.rhs, *known.rhs);
           if (res.value.boolean) {
             return check_status_t::TRUE;
           }
@@ -30,7 +30,7 @@ namespace symbolic {
       size_t lineno, const symbolic_condition_t *cond, bool status);
 
   void dump_final(std::vector<std::string>& trace, const std::vector<const Function*> symbols,
-                  const std::vector<std::unordered_map<ArgumentsKey, value_t>>& states);
+                  std::vector<FunctionState>& states);
 
   uint32_t dump_listconst(std::vector<std::string>& trace, List *l);
 
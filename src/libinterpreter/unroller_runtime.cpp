@@ -0,0 +1,185 @@
+#include <iostream>
+#include <cstdlib>
+
+#include <getopt.h>
+
+#include "macros.h"
+#include "libutil/exceptions.h"
+
+#include "libmiddle/typecheck_visitor.h"
+#include "libmiddle/optimization_passes.h"
+
+#include "libinterpreter/unroller_runtime.h"
+
+extern Driver *global_driver;
+
+UnrollerRuntime *unroller_runtime = nullptr;
+
+UnrollerRuntime::UnrollerRuntime(ExecutionVisitor<ConcreteMode>& visitor, Driver& driver,
+                             UnrolledRule rules[], size_t num_rules,
+                             UnrolledDerived derived[], size_t num_derived)
+    : compiler_(), chunks_(), rules_(), visitor(visitor), context(visitor.context_) {
+  for (size_t i = 0; i < num_rules; i++) {
+    if (driver.rules_map_.count(rules[i].name) == 0) {
+      throw RuntimeException(std::string("rule `")+rules[i].name+
+                             "` is not defined in the specification");
+    }
+    RuleNode *rule = driver.rules_map_[rules[i].name];
+    *rules[i].chunk = compile(rule, nullptr, rules[i].name, rules[i].num_instructions);
+    rules_[rule] = rules[i].function;
+  }
+
+  for (size_t i = 0; i < num_derived; i++) {
+    Function *func = context.symbol_table.get_function(derived[i].name);
+    if (!func || func->type != Symbol::SymbolType::DERIVED) {
+      throw RuntimeException(std::string("derived function `")+derived[i].name+
+                             "` is not defined in the specification");
+    }
+    *derived[i].chunk = compile(nullptr, func, derived[i].name,
+                                derived[i].num_instructions);
+  }
+}
+
+const Chunk *UnrollerRuntime::compile(RuleNode *rule, Function *derived, const char *name,
+                                    size_t num_instructions) {
+  Chunk *chunk = new Chunk();
+  chunks_.push_back(std::unique_ptr<Chunk>(chunk));
+  if (rule) {
+    compiler_.compile_rule(rule, chunk);
+  } else {
+    compiler_.compile_derived(derived, chunk);
+  }
+
+  // the generated code indexes the instructions of the chunk
+  if (chunk->code.size() != num_instructions) {
+    throw RuntimeException(std::string("generated code for `")+name+
+                           "` does not match the specification");
+  }
+  return chunk;
+}
+
+void UnrollerRuntime::execute_rule(RuleNode *rule) {
+  rules_.at(rule)(nullptr);
+}
+
+void UnrollerRuntime::update(Opcode op, AstNode *node, const value_t& val,
+                           const value_t arguments[], uint16_t num_arguments) {
+  for (uint16_t i = 0; i < num_arguments; i++) {
+    visitor.arguments[i] = arguments[i];
+  }
+  visitor.num_arguments = num_arguments;
+
+  UpdateNode *update = reinterpret_cast<UpdateNode*>(node);
+  switch (op) {
+    case Opcode::UPDATE:
+      visitor.visit_update(update, val);
+      break;
+    case Opcode::UPDATE_SUBRANGE:
+      visitor.visit_update_subrange(update, val);
+      break;
+    case Opcode::UPDATE_DUMPS:
+      visitor.visit_update_dumps(update, val);
+      break;
+    default: FAILURE();
+  }
+}
+
+void UnrollerRuntime::undef_condition(AstNode *node) {
+  visitor.driver_.error(reinterpret_cast<IfThenElseNode*>(node)->condition_->location,
+                        "condition must be true or false but was undef");
+  throw RuntimeException("Condition is undef");
+}
+
+void UnrollerRuntime::call_indirect(AstNode *node, const value_t arguments[],
+                                  uint16_t num_arguments) {
+  CallNode *call = reinterpret_cast<CallNode*>(node);
+  if (call->rule == nullptr) {
+    DEBUG("rule not set!");
+    return;
+  }
+  visitor.check_call_arguments(call, arguments, num_arguments);
+  rules_.at(call->rule)(arguments);
+}
+
+int unrolled_main(int argc, char *argv[], const char *filename, const char *source,
+                UnrolledRule rules[], size_t num_rules,
+                UnrolledDerived derived[], size_t num_derived) {
+  struct option long_options[] = {
+       {"help", no_argument, 0, 'h'},
+       {"debuginfo-filter", required_argument, 0, 'd'},
+       {"dump-updates", no_argument, 0, 'u'},
+       {0, 0, 0, 0}
+  };
+
+  bool dump_updates = false;
+  std::string debuginfo_filter;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "hd:u", long_options, nullptr)) != -1) {
+    switch (opt) {
+      case 'h':
+        std::cout << "USAGE: " << argv[0] << " [OPTIONS]" << std::endl;
+        std::cout << std::endl;
+        std::cout << "Bytecode of " << filename << " unrolled by casmi" << std::endl;
+        std::cout << std::endl;
+        std::cout << "OPTIONS:" << std::endl;
+        std::cout << "  -h, --help" << "\t\t\t" << "shows command line options" << std::endl;
+        std::cout << "  --debuginfo-filter FILTERS" << "\t" << "comma separated list with filter names to enable"<< std::endl;
+        std::cout << "  -u, --dump-updates" << "\t\t" << "dump generated updates after each step" << std::endl;
+        return EXIT_SUCCESS;
+      case 'd':
+        debuginfo_filter = optarg;
+        break;
+      case 'u':
+        dump_updates = true;
+        break;
+      default:
+        std::cerr << "There has been an error" << std::endl;
+        return EXIT_FAILURE;
+    }
+  }
+
+  StringDriver driver;
+  global_driver = &driver;
+
+  if (driver.parse(source, filename) == nullptr) {
+    std::cerr << "Error parsing embedded specification" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  TypecheckVisitor typecheck_visitor(driver);
+  AstWalker<TypecheckVisitor, Type*> typecheck_walker(typecheck_visitor);
+  typecheck_walker.walk_specification(driver.result);
+
+  int res = EXIT_FAILURE;
+  if (driver.ok()) {
+    // must match the passes run by casmi before unrolling the bytecode
+    run_optimization_passes(driver.result);
+
+    ExecutionContext ctx(driver.function_table, driver.get_init_rule(), false, false,
+                         dump_updates);
+    if (debuginfo_filter.size() > 0) {
+      ctx.set_debuginfo_filter(debuginfo_filter);
+    }
+
+    ExecutionVisitor<ConcreteMode> visitor(ctx, driver);
+    try {
+      UnrollerRuntime runtime(visitor, driver, rules, num_rules, derived, num_derived);
+      unroller_runtime = &runtime;
+      ExecutionWalker<ConcreteMode> walker(visitor, &runtime);
+      walker.run();
+      res = EXIT_SUCCESS;
+    } catch (const RuntimeException& ex) {
+      std::cerr << "Abort after runtime exception: "<< ex.what() << std::endl;;
+      res = EXIT_FAILURE;
+    } catch (const ImpossibleException& ex) {
+      res = EXIT_SUCCESS;
+    } catch (char * e) {
+      std::cerr << "Abort after catching a string: "<< e << std::endl;
+      res = EXIT_FAILURE;
+    }
+    unroller_runtime = nullptr;
+  }
+
+  delete driver.result;
+  return res;
+}
@@ -0,0 +1,241 @@
+#ifndef CASMI_LIBINTERPRETER_UNROLLER_RUNTIME_H
+#define CASMI_LIBINTERPRETER_UNROLLER_RUNTIME_H
+
+#include <assert.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "libsyntax/driver.h"
+
+#include "libinterpreter/bytecode.h"
+#include "libinterpreter/execution_visitor.h"
+#include "libinterpreter/operators.h"
+
+// Runtime support for code unrolled with `casmi --unroll-bytecode`. The
+// generated code contains one C++ function per rule and derived function,
+// the specification itself is embedded and parsed at startup to set up the
+// symbol table, function initializers and error locations.
+//
+// The unroller lowers rules with the BytecodeCompiler and translates the
+// instructions to C++, the runtime compiles the same rules again to find the
+// AST nodes and constants referenced by the instructions. Apart from the
+// instruction dispatch everything is executed like in the bytecode VM.
+
+struct UnrolledRule {
+  const char *name;
+  void (*function)(const value_t arguments[]);
+  const Chunk **chunk;
+  size_t num_instructions;
+};
+
+struct UnrolledDerived {
+  const char *name;
+  value_t (*function)(const value_t arguments[]);
+  const Chunk **chunk;
+  size_t num_instructions;
+};
+
+// integer fast path of binary operations with operands of static type Int
+#define CASM_UNROLLED_INT_OP(dst, lhs, rhs, int_op, result_type, result_field, node) \
+  do {                                                                       \
+    if ((lhs).type == TypeType::INT && (rhs).type == TypeType::INT) {        \
+      const auto res = (lhs).value.integer int_op (rhs).value.integer;       \
+      (dst).type = result_type;                                              \
+      (dst).value.result_field = res;                                        \
+    } else {                                                                 \
+      (dst) = operators::dispatch<ConcreteMode>(                             \
+          reinterpret_cast<Expression*>(node)->op, lhs, rhs);                \
+    }                                                                        \
+  } while (0)
+
+class UnrollerRuntime : public RuleExecutor {
+  private:
+    BytecodeCompiler compiler_;
+    std::vector<std::unique_ptr<Chunk>> chunks_;
+    std::unordered_map<const RuleNode*, void (*)(const value_t[])> rules_;
+
+    const Chunk *compile(RuleNode *rule, Function *derived, const char *name,
+                         size_t num_instructions);
+
+  public:
+    ExecutionVisitor<ConcreteMode>& visitor;
+    ExecutionContext& context;
+
+    UnrollerRuntime(ExecutionVisitor<ConcreteMode>& visitor, Driver& driver,
+                  UnrolledRule rules[], size_t num_rules,
+                  UnrolledDerived derived[], size_t num_derived);
+
+    void execute_rule(RuleNode *rule);
+
+    const value_t read(AstNode *node, const value_t arguments[], uint16_t num_arguments) {
+      uint64_t args[10];
+      uint16_t sym_args = pack_values_in_array<ConcreteMode>(arguments, args, num_arguments);
+      return context.get_function_value(reinterpret_cast<FunctionAtom*>(node)->symbol,
+                                        args, sym_args);
+    }
+
+    const value_t read_subrange(AstNode *node, const value_t arguments[],
+                                uint16_t num_arguments) {
+      return visitor.visit_function_atom_subrange(reinterpret_cast<FunctionAtom*>(node),
+                                                  arguments, num_arguments);
+    }
+
+    const value_t builtin(AstNode *node, const value_t arguments[], uint16_t num_arguments) {
+      return visitor.visit_builtin_atom(reinterpret_cast<BuiltinAtom*>(node),
+                                        arguments, num_arguments);
+    }
+
+    const value_t list(AstNode *node, const value_t values[], uint16_t num_values) {
+      return visitor.visit_list_atom(reinterpret_cast<ListAtom*>(node),
+                                     std::vector<value_t>(values, values + num_values));
+    }
+
+    const value_t range(AstNode *node, const value_t& start, const value_t& end) {
+      return visitor.visit_number_range_atom(reinterpret_cast<NumberRangeAtom*>(node),
+                                             start, end);
+    }
+
+    void update(Opcode op, AstNode *node, const value_t& val, const value_t arguments[],
+                uint16_t num_arguments);
+    void push(AstNode *node, const value_t& val, const value_t& to) {
+      visitor.visit_push(reinterpret_cast<PushNode*>(node), val, to);
+    }
+    const value_t pop(AstNode *node, const value_t& from) {
+      return visitor.apply_pop(reinterpret_cast<PopNode*>(node), from);
+    }
+
+    void undef_condition(AstNode *node);
+
+    bool seq_begin() {
+      if (context.updateset.pseudostate % 2 == 0) {
+        CASM_UPDATESET_FORK_SEQ(&context.updateset);
+        return true;
+      }
+      return false;
+    }
+    void seq_end(bool forked) {
+      if (forked) {
+        context.merge_seq(visitor.driver_);
+      }
+    }
+    bool par_begin(bool unchecked_updates) {
+      return context.fork_par(unchecked_updates);
+    }
+    void par_end(bool forked) {
+      if (forked) {
+        context.merge_par();
+      }
+    }
+
+    template<class F>
+    void forall(AstNode *node, const value_t& in, F body);
+    template<class F>
+    void iterate(F body);
+
+    void call_pre(AstNode *node, const value_t& ruleref) {
+      visitor.visit_call_pre(reinterpret_cast<CallNode*>(node), ruleref);
+    }
+    void call_indirect(AstNode *node, const value_t arguments[], uint16_t num_arguments);
+
+    void assert_(AstNode *node, const value_t& val) {
+      visitor.visit_assert(reinterpret_cast<UnaryNode*>(node), val);
+    }
+    void assure(AstNode *node, const value_t& val) {
+      visitor.visit_assure(reinterpret_cast<UnaryNode*>(node), val);
+    }
+    void print(AstNode *node, const value_t values[], uint16_t num_values) {
+      visitor.visit_print(reinterpret_cast<PrintNode*>(node),
+                          std::vector<value_t>(values, values + num_values));
+    }
+    void diedie(AstNode *node, const value_t& msg) {
+      visitor.visit_diedie(reinterpret_cast<DiedieNode*>(node), msg);
+    }
+    void impossible(AstNode *node) {
+      visitor.visit_impossible(node);
+    }
+};
+
+extern UnrollerRuntime *unroller_runtime;
+
+// entry point of unrolled specifications, accepts the concrete mode options of
+// casmi
+int unrolled_main(int argc, char *argv[], const char *filename, const char *source,
+                UnrolledRule rules[], size_t num_rules,
+                UnrolledDerived derived[], size_t num_derived);
+
+
+template<class F>
+void UnrollerRuntime::forall(AstNode *node, const value_t& in, F body) {
+  ForallNode *forall = reinterpret_cast<ForallNode*>(node);
+  const value_t in_list = in;
+  const bool forked = par_begin(forall->unchecked_updates);
+
+  switch (forall->in_expr->type_.t) {
+    case TypeType::LIST: {
+      if (in_list.is_undef()) {
+        break;
+      }
+      List *l = in_list.value.list;
+      if (l->is_range()) {
+        RangeList *range = reinterpret_cast<RangeList*>(l);
+        for (size_t i = 0; i < range->count; i++) {
+          body(value_t(range->at(i)));
+        }
+        break;
+      }
+      for (auto iter = l->begin(); iter != l->end(); iter++) {
+        body(*iter);
+      }
+      break;
+    }
+    case TypeType::INT: {
+      INT_T end = in_list.value.integer;
+      if (end > 0) {
+        for (INT_T i = 0; i < end; i++) {
+          body(value_t(i));
+        }
+      } else {
+        for (INT_T i = 0; end < i; i--) {
+          body(value_t(i));
+        }
+      }
+      break;
+    }
+    case TypeType::ENUM: {
+      FunctionAtom *func = reinterpret_cast<FunctionAtom*>(forall->in_expr);
+      for (auto pair : func->enum_->mapping) {
+        // the mapping contains an element with the name of the enum
+        if (func->name == pair.first) {
+          continue;
+        }
+        value_t v = value_t(pair.second);
+        v.type = TypeType::ENUM;
+        body(v);
+      }
+      break;
+    }
+    default: assert(0);
+  }
+
+  par_end(forked);
+}
+
+template<class F>
+void UnrollerRuntime::iterate(F body) {
+  const bool forked = seq_begin();
+  bool running = true;
+
+  while (running) {
+    CASM_UPDATESET_FORK_PAR(&context.updateset);
+    body();
+    if (CASM_UPDATESET_EMPTY(&context.updateset)) {
+      running = false;
+    }
+    context.merge_par();
+  }
+
+  seq_end(forked);
+}
+
+#endif
@@ -0,0 +1,150 @@
+#include <cassert>
+#include <cstdlib>
+
+#include "libinterpreter/updateset.h"
+
+#define UPDATESET_INITIAL_SIZE 1024
+#define UPDATESET_BLOCK_SIZE 1024 * 1024
+
+casm_updateset::casm_updateset() : cells_(UPDATESET_INITIAL_SIZE), log_(),
+    merge_buffer_(), blocks_(), current_block_(0), block_used_(0),
+    pseudostate(0) {
+  blocks_.push_back(new char[UPDATESET_BLOCK_SIZE]);
+}
+
+casm_updateset::~casm_updateset() {
+  for (char *block : blocks_) {
+    delete[] block;
+  }
+}
+
+void *casm_updateset::alloc(size_t size) {
+  assert(size <= UPDATESET_BLOCK_SIZE);
+
+  if (block_used_ + size > UPDATESET_BLOCK_SIZE) {
+    current_block_ += 1;
+    if (current_block_ == blocks_.size()) {
+      blocks_.push_back(new char[UPDATESET_BLOCK_SIZE]);
+    }
+    block_used_ = 0;
+  }
+
+  void *mem = blocks_[current_block_] + block_used_;
+  // all records are a multiple of 8 bytes, which keeps the block aligned
+  block_used_ += size;
+  return mem;
+}
+
+casm_update *casm_updateset::new_update(uint16_t num_args) {
+  casm_update *update = reinterpret_cast<casm_update*>(
+      alloc(sizeof(casm_update) + num_args * sizeof(uint64_t)));
+  update->num_args = num_args;
+  update->args = reinterpret_cast<uint64_t*>(update + 1);
+  return update;
+}
+
+casm_update *casm_updateset::add(const void *location, casm_update *update) {
+  bool inserted;
+  cell *c = cells_.insert((uint64_t) location, inserted);
+
+  if (!inserted && c->top->pseudostate == pseudostate) {
+    casm_update *old = c->top->update;
+    c->top->update = update;
+    // updates in sequential pseudostates simply overwrite earlier ones
+    return (pseudostate % 2 == 0) ? old : nullptr;
+  }
+
+  version *v = reinterpret_cast<version*>(alloc(sizeof(version)));
+  v->update = update;
+  v->prev = c->top;
+  v->prev_visible = nullptr;
+  v->pseudostate = pseudostate;
+  if (pseudostate % 2 == 1) {
+    v->prev_visible = c->visible;
+    c->visible = v;
+  }
+  c->top = v;
+  log_.push_back(make_key(location, pseudostate));
+  return nullptr;
+}
+
+casm_update *casm_updateset::get(const void *location, uint16_t state) const {
+  const cell *c = cells_.find((uint64_t) location);
+  if (c == nullptr) {
+    return nullptr;
+  }
+  for (const version *v = c->top; v != nullptr; v = v->prev) {
+    if (v->pseudostate == state) {
+      return v->update;
+    }
+  }
+  return nullptr;
+}
+
+bool casm_updateset::empty() const {
+  return log_.empty() || key_pseudostate(log_.back()) != pseudostate;
+}
+
+// moves the keys of the current pseudostate from the log to merge_buffer_
+// and drops the pseudostate
+void casm_updateset::collect_top_layer() {
+  size_t start = log_.size();
+  while (start > 0 && key_pseudostate(log_[start-1]) == pseudostate) {
+    start -= 1;
+  }
+  merge_buffer_.assign(log_.begin() + start, log_.end());
+  log_.resize(start);
+  pseudostate -= 1;
+}
+
+void casm_updateset::merge_par() {
+  collect_top_layer();
+
+  // newest updates are merged first, like the linked hashmap did
+  for (auto iter = merge_buffer_.rbegin(); iter != merge_buffer_.rend(); iter++) {
+    cell *c = cells_.find(key_location(*iter));
+    version *v = c->top;
+    if (v->prev != nullptr && v->prev->pseudostate == pseudostate) {
+      // the version in the sequential pseudostate is the visible one
+      v->prev->update = v->update;
+      c->top = v->prev;
+    } else {
+      v->pseudostate = pseudostate;
+      v->prev_visible = c->visible;
+      c->visible = v;
+      log_.push_back(*iter - 1);
+    }
+  }
+}
+
+casm_update *casm_updateset::merge_seq() {
+  collect_top_layer();
+
+  for (auto iter = merge_buffer_.rbegin(); iter != merge_buffer_.rend(); iter++) {
+    cell *c = cells_.find(key_location(*iter));
+    version *v = c->top;
+    // the update ends up in a parallel pseudostate and is no longer visible
+    c->visible = v->prev_visible;
+    if (v->prev != nullptr && v->prev->pseudostate == pseudostate) {
+      return v->update;
+    }
+    v->pseudostate = pseudostate;
+    log_.push_back(*iter - 1);
+  }
+  return nullptr;
+}
+
+void casm_updateset::clear() {
+  for (uint64_t key : log_) {
+    cell removed;
+    cells_.erase(key_location(key), removed);
+  }
+  log_.clear();
+
+  current_block_ = 0;
+  block_used_ = 0;
+}
+
+casm_update *casm_updateset_add(casm_updateset *uset, void *location, void *update) {
+  return uset->add(location, reinterpret_cast<casm_update*>(update));
+}
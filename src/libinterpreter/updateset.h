@@ -0,0 +1,225 @@
+#ifndef CASMI_LIBINTERPRETER_UPDATESET_H
+#define CASMI_LIBINTERPRETER_UPDATESET_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// A single update record. Records are allocated from the arena of the update
+// set together with their arguments, args points directly behind the record.
+struct casm_update {
+  void *value;
+  uint64_t line;
+  uint32_t func;
+  uint16_t num_args;
+  uint16_t sym_args;
+  uint8_t defined;
+  uint8_t symbolic;
+  uint64_t *args;
+};
+
+// Open addressing hash table with linear probing for slots with a non-zero
+// uint64_t key, key 0 marks an empty slot.
+template<class Slot>
+class flat_table {
+  private:
+    std::vector<Slot> slots_;
+    size_t count_;
+    uint32_t shift_;
+
+    // Fibonacci hashing, the low and the high bits of the key are both mixed
+    // into the upper bits of the product
+    size_t home(uint64_t key) const {
+      return (key * 0x9E3779B97F4A7C15ULL) >> shift_;
+    }
+
+    size_t probe(uint64_t key) const {
+      const size_t mask = slots_.size() - 1;
+      size_t i = home(key);
+      while (slots_[i].key != 0 && slots_[i].key != key) {
+        i = (i + 1) & mask;
+      }
+      return i;
+    }
+
+    void grow() {
+      std::vector<Slot> old(slots_.size() * 2, Slot());
+      old.swap(slots_);
+      shift_ -= 1;
+
+      for (const Slot& s : old) {
+        if (s.key != 0) {
+          slots_[probe(s.key)] = s;
+        }
+      }
+    }
+
+  public:
+    // size must be a power of two
+    flat_table(size_t size) : slots_(size, Slot()), count_(0), shift_(64) {
+      while (size > 1) {
+        shift_ -= 1;
+        size >>= 1;
+      }
+    }
+
+    size_t size() const { return count_; }
+
+    Slot *find(uint64_t key) {
+      Slot& s = slots_[probe(key)];
+      return (s.key == key) ? &s : nullptr;
+    }
+
+    const Slot *find(uint64_t key) const {
+      const Slot& s = slots_[probe(key)];
+      return (s.key == key) ? &s : nullptr;
+    }
+
+    // returns the slot for the key, inserted is set if the slot is new; the
+    // pointer is only valid until the next insert
+    Slot *insert(uint64_t key, bool& inserted) {
+      if ((count_ + 1) * 2 > slots_.size()) {
+        grow();
+      }
+      Slot& s = slots_[probe(key)];
+      inserted = (s.key == 0);
+      if (inserted) {
+        s = Slot();
+        s.key = key;
+        count_ += 1;
+      }
+      return &s;
+    }
+
+    // backward shift deletion, keeps probe sequences intact without
+    // tombstones; the removed slot is copied to removed
+    bool erase(uint64_t key, Slot& removed) {
+      const size_t mask = slots_.size() - 1;
+      size_t i = probe(key);
+      if (slots_[i].key == 0) {
+        return false;
+      }
+      removed = slots_[i];
+      count_ -= 1;
+
+      size_t j = i;
+      while (true) {
+        j = (j + 1) & mask;
+        if (slots_[j].key == 0) {
+          break;
+        }
+        size_t h = home(slots_[j].key);
+        // move j to i if its home slot is not in the cyclic range (i, j]
+        if ((j > i && (h <= i || h > j)) || (j < i && (h <= i && h > j))) {
+          slots_[i] = slots_[j];
+          i = j;
+        }
+      }
+      slots_[i] = Slot();
+      return true;
+    }
+};
+
+// Update set with pseudostate layers. Odd pseudostates belong to sequential
+// blocks, even ones to parallel blocks. Every updated location has a cell with
+// a stack of versions, one per pseudostate that contains an update for the
+// location. Only updates in odd pseudostates are visible to reads, the cell
+// keeps a pointer to the newest visible version so that reads need a single
+// probe regardless of the nesting depth. Merging a pseudostate rewrites the
+// top versions of its locations in place.
+class casm_updateset {
+  private:
+    struct version {
+      casm_update *update;
+      version *prev;
+      // next older version in an odd pseudostate
+      version *prev_visible;
+      uint16_t pseudostate;
+    };
+
+    struct cell {
+      uint64_t key;
+      version *top;
+      version *visible;
+    };
+
+    flat_table<cell> cells_;
+
+    // all keys (location << 16 | pseudostate) in insertion order, keys of
+    // higher pseudostates are always behind keys of lower pseudostates
+    std::vector<uint64_t> log_;
+    std::vector<uint64_t> merge_buffer_;
+
+    std::vector<char*> blocks_;
+    size_t current_block_;
+    size_t block_used_;
+
+    void *alloc(size_t size);
+    void collect_top_layer();
+
+  public:
+    uint16_t pseudostate;
+
+    casm_updateset();
+    casm_updateset(const casm_updateset& other) = delete;
+    ~casm_updateset();
+
+    static uint64_t make_key(const void *location, uint16_t pseudostate) {
+      return ((uint64_t) location) << 16 | pseudostate;
+    }
+
+    static uint64_t key_location(uint64_t key) {
+      return key >> 16;
+    }
+
+    static uint16_t key_pseudostate(uint64_t key) {
+      return (uint16_t) key;
+    }
+
+    // allocates a record with space for num_args arguments
+    casm_update *new_update(uint16_t num_args);
+
+    // adds the update for the location in the current pseudostate, returns
+    // the update it replaced if the pseudostate is parallel, nullptr otherwise
+    casm_update *add(const void *location, casm_update *update);
+
+    // returns the newest update for the location visible in the current
+    // pseudostate or nullptr
+    casm_update *get(const void *location) const {
+      const cell *c = cells_.find((uint64_t) location);
+      return (c != nullptr && c->visible != nullptr) ? c->visible->update : nullptr;
+    }
+
+    // returns the update for the location in exactly the given pseudostate
+    casm_update *get(const void *location, uint16_t pseudostate) const;
+
+    void fork() { pseudostate += 1; }
+    bool empty() const;
+    size_t size() const { return log_.size(); }
+
+    // merges the current parallel pseudostate into the enclosing sequential
+    // one, later updates overwrite earlier ones
+    void merge_par();
+
+    // merges the current sequential pseudostate into the enclosing parallel
+    // one, returns the first conflicting update or nullptr
+    casm_update *merge_seq();
+
+    // iterates over all updates, newest first
+    template<class F> void for_each(F f) const {
+      for (auto iter = log_.rbegin(); iter != log_.rend(); iter++) {
+        f(get(reinterpret_cast<const void*>(key_location(*iter)),
+              key_pseudostate(*iter)));
+      }
+    }
+
+    void clear();
+};
+
+#define CASM_UPDATESET_FORK_PAR(uset) (uset)->fork()
+#define CASM_UPDATESET_FORK_SEQ(uset) (uset)->fork()
+#define CASM_UPDATESET_EMPTY(uset) (uset)->empty()
+
+casm_update *casm_updateset_add(casm_updateset *uset, void *location, void *update);
+
+#endif
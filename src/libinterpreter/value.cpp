@@ -1,54 +1,35 @@
 #include <assert.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <utility>
 #include <sstream>
+#include <unordered_map>
 
 #include "libsyntax/ast.h"
 
 #include "libinterpreter/value.h"
+#include "libinterpreter/bigint.h"
 #include "libinterpreter/execution_context.h"
 
-value_t::value_t() : type(TypeType::UNDEF) {}
-
-value_t::value_t(INT_T integer) : type(TypeType::INT) {
-  value.integer = integer;
-}
-
-value_t::value_t(FLOAT_T float_) : type(TypeType::FLOAT) {
-  value.float_ = float_;
-}
-
-value_t::value_t(bool boolean) : type(TypeType::BOOLEAN) {
-  value.boolean = boolean;
-}
-
-value_t::value_t(RuleNode *rule) : type(TypeType::RULEREF) {
-  value.rule = rule;
-}
-
-value_t::value_t(std::string *string) : type(TypeType::STRING) {
-  value.string = string;
-}
-
-value_t::value_t(const Type &t, List *list) : type(t.t) {
-  value.list = list;
-}
-
-value_t::value_t(const enum_value_t *enum_val) : type(TypeType::ENUM) {
-  value.enum_val = enum_val;
-}
-
-value_t::value_t(const rational_t *rat) : type(TypeType::RATIONAL) {
-  value.rat = rat;
+// floats are packed bit for bit, so that arguments and function values keep
+// their fractional part; -0.0 is packed like 0.0 because they compare equal
+static uint64_t pack_float(FLOAT_T f) {
+  if (f == 0) {
+    return 0;
+  }
+  uint64_t bits;
+  std::memcpy(&bits, &f, sizeof(bits));
+  return bits;
 }
 
-value_t::value_t(symbol_t *sym) : type(TypeType::SYMBOL) {
-  value.sym = sym;
+static FLOAT_T unpack_float(uint64_t bits) {
+  FLOAT_T f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f;
 }
 
-value_t::value_t(const value_t& other) : type(other.type), value(other.value) {}
-
-value_t::value_t(value_t&& other) noexcept : type(other.type), value(other.value) {}
-
 value_t::value_t(TypeType t, casm_update* u) {
   if (u->defined == 0) {
     type = TypeType::UNDEF;
@@ -73,16 +54,16 @@ value_t::value_t(TypeType t, casm_update* u) {
       value.integer = (int64_t)u->value;
       break;
     case TypeType::FLOAT:
-      value.float_ = (int64_t)u->value;
+      value.float_ = unpack_float((uint64_t)u->value);
       break;
     case TypeType::ENUM:
       value.enum_val = reinterpret_cast<enum_value_t*>(u->value);
       break;
     case TypeType::RATIONAL:
-      value.rat = reinterpret_cast<const rational_t*>(u->value);
+      value.integer = (int64_t)u->value;
       break;
     case TypeType::STRING:
-      value.string = reinterpret_cast<std::string*>(u->value);
+      value.string = reinterpret_cast<const string_t*>(u->value);
       break;
     case TypeType::LIST:
       value.list = reinterpret_cast<List*>(u->value);
@@ -95,12 +76,6 @@ value_t::value_t(TypeType t, casm_update* u) {
 }
 
 
-value_t& value_t::operator=(const value_t& other) {
-  value = other.value;
-  type = other.type;
-  return *this;
-}
-
 bool value_t::operator==(const value_t &other) const {
   if (is_undef() || other.is_undef()) {
     return is_undef() && other.is_undef();
@@ -135,8 +110,9 @@ bool value_t::operator==(const value_t &other) const {
     case TypeType::FLOAT: return value.float_ == other.value.float_;
     case TypeType::BOOLEAN: return value.boolean == other.value.boolean;
     case TypeType::ENUM: return value.enum_val == other.value.enum_val;
-    case TypeType::RATIONAL: return *value.rat == *other.value.rat;
-    case TypeType::STRING: return *value.string == *other.value.string;
+    // rationals are reduced and stored inline whenever they fit
+    case TypeType::RATIONAL: return value.integer == other.value.integer;
+    case TypeType::STRING: return value.string == other.value.string;
     case TypeType::TUPLE:
     case TypeType::TUPLE_OR_LIST:
     case TypeType::LIST: return *value.list == *other.value.list;
@@ -153,7 +129,7 @@ uint64_t value_t::to_uint64_t() const {
     case TypeType::INT:
       return value.integer;
     case TypeType::FLOAT:
-      return value.float_;
+      return pack_float(value.float_);
     case TypeType::SELF:
     case TypeType::UNDEF: // are UNDEF and SELF the same here?
       return 0;
@@ -162,7 +138,7 @@ uint64_t value_t::to_uint64_t() const {
     case TypeType::ENUM:
       return (uint64_t) value.enum_val;
     case TypeType::RATIONAL:
-      return (uint64_t) value.rat;
+      return (uint64_t) value.integer;
     case TypeType::STRING: 
       return (uint64_t) value.string;
     case TypeType::TUPLE: 
@@ -177,17 +153,12 @@ uint64_t value_t::to_uint64_t() const {
   }
 }
 
-bool value_t::is_undef() const {
-  return type == TypeType::UNDEF;
-}
-
-bool value_t::is_symbolic() const {
-  return type == TypeType::SYMBOL;
-}
-
 const std::string value_t::to_str(bool symbolic) const {
   switch (type) {
     case TypeType::INT:
+      if (bigint::is_boxed(value.integer)) {
+        return bigint::to_str(value.integer);
+      }
       return std::move(std::to_string(value.integer));
     case TypeType::FLOAT:
       return std::move(std::to_string(value.float_));
@@ -200,9 +171,9 @@ const std::string value_t::to_str(bool symbolic) const {
     case TypeType::ENUM:
       return *value.enum_val->name;
     case TypeType::RATIONAL:
-      return value.rat->to_str();
+      return to_rational().to_str();
     case TypeType::STRING:
-      return *value.string;
+      return value.string->str;
     case TypeType::TUPLE:
     case TypeType::TUPLE_OR_LIST:
     case TypeType::LIST: {
@@ -256,146 +227,450 @@ std::string symbolic_condition_t::to_str() const {
   }
 }
 
+// Equal strings, rationals and lists are interned once. Entries whose usage
+// count drops to zero are remembered in `unused` and freed by free_unused
+// unless they were used again or pinned in the meantime.
+template<class T>
+struct intern_table {
+  std::unordered_multimap<size_t, T*> entries;
+  std::vector<const T*> unused;
+
+  static uint32_t& usage(T *entry) { return entry->usage_count; }
+
+  void insert(T *entry) {
+    entries.insert(std::make_pair(entry->hash, entry));
+    unused.push_back(entry);
+  }
+
+  void release(const T *entry) {
+    T *e = const_cast<T*>(entry);
+    usage(e) -= 1;
+    if (usage(e) == 0 && !e->pinned) {
+      unused.push_back(e);
+    }
+  }
+
+  void free_unused() {
+    while (!unused.empty()) {
+      std::vector<const T*> pending;
+      pending.swap(unused);
+      // an entry can be released several times in a step
+      std::sort(pending.begin(), pending.end());
+      pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+      std::vector<const T*> dead;
+      for (const T *entry : pending) {
+        if (usage(const_cast<T*>(entry)) > 0 || entry->pinned) {
+          continue;
+        }
+        auto range = entries.equal_range(entry->hash);
+        for (auto iter = range.first; iter != range.second; iter++) {
+          if (iter->second == entry) {
+            entries.erase(iter);
+            break;
+          }
+        }
+        dead.push_back(entry);
+      }
+      // freeing an interned list releases the lists it contains, which are
+      // still referenced above and checked again in the next round
+      for (const T *entry : dead) {
+        delete entry;
+      }
+    }
+  }
+};
+
+// the usage count of the BottomList keeps interned lists from being changed
+template<>
+uint32_t& intern_table<InternedList>::usage(InternedList *entry) {
+  return entry->references;
+}
+
+static intern_table<string_t>& string_table() {
+  static intern_table<string_t> table;
+  return table;
+}
+
+static intern_table<InternedRational>& rational_table() {
+  static intern_table<InternedRational> table;
+  return table;
+}
+
+static intern_table<InternedBigInt>& bigint_table() {
+  static intern_table<InternedBigInt> table;
+  return table;
+}
+
+static intern_table<InternedList>& list_table() {
+  static intern_table<InternedList> table;
+  return table;
+}
+
+void free_unused_values() {
+  // lists go first, they release their elements
+  list_table().free_unused();
+  string_table().free_unused();
+  rational_table().free_unused();
+  bigint_table().free_unused();
+}
+
+static int64_t gcd(int64_t a, int64_t b) {
+  int64_t tmp;
+
+  while (b != 0) {
+    tmp = b;
+    b = a % b;
+    a = tmp;
+  }
+  return a;
+}
+
 rational_t::rational_t() {}
 
 rational_t::rational_t(int64_t num, int64_t denom) {
-  numerator = num;
-  denominator = denom;
+  int64_t divisor = gcd(num, denom);
+  if (divisor == 0) {
+    // 0/0
+    divisor = 1;
+  }
+  if ((denom < 0) != (divisor < 0)) {
+    divisor = -divisor;
+  }
+  numerator = num / divisor;
+  denominator = denom / divisor;
 }
 
 rational_t::rational_t(const rational_t& other) : numerator(other.numerator),
     denominator(other.denominator) {}
 
+// reduces a result computed with 128 bit intermediates
+static const rational_t reduce(__int128 num, __int128 denom) {
+  __int128 a = (num < 0) ? -num : num;
+  __int128 b = (denom < 0) ? -denom : denom;
+  while (b != 0) {
+    __int128 tmp = b;
+    b = a % b;
+    a = tmp;
+  }
+  if (a > 1) {
+    num /= a;
+    denom /= a;
+  }
+  if (denom < 0) {
+    num = -num;
+    denom = -denom;
+  }
+  if (num < INT64_MIN || num > INT64_MAX || denom > INT64_MAX) {
+    throw RuntimeException("rational overflow");
+  }
+  rational_t result;
+  result.numerator = (int64_t) num;
+  result.denominator = (int64_t) denom;
+  return result;
+}
+
 bool rational_t::operator==(const rational_t& other) const {
-  return (numerator * other.denominator) == (other.numerator * denominator);
+  return numerator == other.numerator && denominator == other.denominator;
+}
+
+// the operators compute with 64 bit intermediates and fall back to 128 bit
+// ones if they overflow
+const rational_t rational_t::operator+(const rational_t& other) const {
+  int64_t lhs, rhs, num, denom;
+  if (!__builtin_mul_overflow(numerator, other.denominator, &lhs) &&
+      !__builtin_mul_overflow(other.numerator, denominator, &rhs) &&
+      !__builtin_add_overflow(lhs, rhs, &num) &&
+      !__builtin_mul_overflow(denominator, other.denominator, &denom)) {
+    return rational_t(num, denom);
+  }
+  return reduce((__int128) numerator * other.denominator +
+                (__int128) other.numerator * denominator,
+                (__int128) denominator * other.denominator);
+}
+
+const rational_t rational_t::operator-(const rational_t& other) const {
+  int64_t lhs, rhs, num, denom;
+  if (!__builtin_mul_overflow(numerator, other.denominator, &lhs) &&
+      !__builtin_mul_overflow(other.numerator, denominator, &rhs) &&
+      !__builtin_sub_overflow(lhs, rhs, &num) &&
+      !__builtin_mul_overflow(denominator, other.denominator, &denom)) {
+    return rational_t(num, denom);
+  }
+  return reduce((__int128) numerator * other.denominator -
+                (__int128) other.numerator * denominator,
+                (__int128) denominator * other.denominator);
 }
 
-const rational_t& rational_t::operator+(const rational_t& other) const {
-  rational_t *result = (rational_t*) pp_mem_alloc(
-      &(ExecutionContext::value_stack), sizeof(rational_t)
-  );
+const rational_t rational_t::operator*(const rational_t& other) const {
+  int64_t num, denom;
+  if (!__builtin_mul_overflow(numerator, other.numerator, &num) &&
+      !__builtin_mul_overflow(denominator, other.denominator, &denom)) {
+    return rational_t(num, denom);
+  }
+  return reduce((__int128) numerator * other.numerator,
+                (__int128) denominator * other.denominator);
+}
 
-  result->numerator = (numerator * other.denominator) + (other.numerator * denominator);
-  result->denominator = denominator * other.denominator;
-  return *result;
+const rational_t rational_t::operator/(const rational_t& other) const {
+  int64_t num, denom;
+  if (!__builtin_mul_overflow(numerator, other.denominator, &num) &&
+      !__builtin_mul_overflow(denominator, other.numerator, &denom)) {
+    return rational_t(num, denom);
+  }
+  return reduce((__int128) numerator * other.denominator,
+                (__int128) denominator * other.numerator);
 }
 
-const rational_t& rational_t::operator-(const rational_t& other) const {
-  rational_t *result = (rational_t*) pp_mem_alloc(
-      &(ExecutionContext::value_stack), sizeof(rational_t)
-  );
+const rational_t rational_t::operator%(const rational_t&) const {
+  // rational modulo is not supported by CASM
+  return *this;
+}
 
-  result->numerator = (numerator * other.denominator) - (other.numerator * denominator);
-  result->denominator = denominator * other.denominator;
-  return *result;
+const std::string rational_t::to_str() const {
+  if (denominator == 1) {
+    return std::to_string(numerator);
+  } else {
+    return std::to_string(numerator) + "/" + std::to_string(denominator);
+  }
 }
 
-const rational_t& rational_t::operator*(const rational_t& other) const {
-  rational_t *result = (rational_t*) pp_mem_alloc(
-      &(ExecutionContext::value_stack), sizeof(rational_t)
-  );
+InternedRational::InternedRational(const rational_t& rat, size_t hash)
+    : rational_t(rat), hash(hash), usage_count(0), pinned(false) {}
 
-  result->numerator = numerator * other.numerator;
-  result->denominator = denominator * other.denominator;
-  return *result;
+const InternedRational *InternedRational::intern(const rational_t& rat) {
+  auto& table = rational_table();
+  const size_t h = std::hash<int64_t>()(rat.numerator) * 31 + rat.denominator;
+  auto range = table.entries.equal_range(h);
+  for (auto iter = range.first; iter != range.second; iter++) {
+    if (*iter->second == rat) {
+      return iter->second;
+    }
+  }
+  InternedRational *result = new InternedRational(rat, h);
+  table.insert(result);
+  return result;
+}
+
+void InternedRational::free_unused() {
+  rational_table().free_unused();
 }
 
-const rational_t& rational_t::operator/(const rational_t& other) const {
-  rational_t *result = (rational_t*) pp_mem_alloc(
-      &(ExecutionContext::value_stack), sizeof(rational_t)
-  );
+InternedBigInt::InternedBigInt(const bigint_t& val, size_t hash)
+    : bigint_t(val), hash(hash), usage_count(0), pinned(false) {}
 
-  result->numerator = numerator * other.denominator;
-  result->denominator = denominator * other.numerator;
-  return *result;
+const InternedBigInt *InternedBigInt::intern(const bigint_t& val) {
+  auto& table = bigint_table();
+  size_t h = val.negative;
+  for (uint32_t word : val.magnitude) {
+    h = h * 31 + word;
+  }
+  auto range = table.entries.equal_range(h);
+  for (auto iter = range.first; iter != range.second; iter++) {
+    if (*iter->second == val) {
+      return iter->second;
+    }
+  }
+  InternedBigInt *result = new InternedBigInt(val, h);
+  table.insert(result);
+  return result;
 }
 
-const rational_t& rational_t::operator%(const rational_t&) const {
-  // rational modulo is not supported by CASM
-  return *this;
+void InternedBigInt::free_unused() {
+  bigint_table().free_unused();
 }
 
-int64_t gcd(int64_t a, int64_t b) {
-  int64_t tmp;
+string_t::string_t(const std::string& str, size_t hash)
+    : str(str), hash(hash), usage_count(0), pinned(false) {}
 
-  while (b != 0) {
-    tmp = b;
-    b = a % b;
-    a = tmp;
+const string_t *string_t::intern(const std::string& str) {
+  auto& table = string_table();
+  const size_t h = std::hash<std::string>()(str);
+  auto range = table.entries.equal_range(h);
+  for (auto iter = range.first; iter != range.second; iter++) {
+    if (iter->second->str == str) {
+      return iter->second;
+    }
   }
-  return a;
+  string_t *result = new string_t(str, h);
+  table.insert(result);
+  return result;
 }
 
-const std::string rational_t::to_str() const {
-  if (numerator == 0) {
-    return "0";
-  }
-  int64_t divisor = gcd(numerator, denominator);
-  int64_t num = numerator / divisor;
-  int64_t denom = denominator / divisor;
-  if (denom == 1) {
-    return std::to_string(num);
+const string_t *string_t::literal(const std::string& str, const string_t *&cache) {
+  if (cache == nullptr) {
+    cache = intern(str);
+    pin(cache);
+  }
+  return cache;
+}
+
+void string_t::pin(const string_t *s) {
+  const_cast<string_t*>(s)->pinned = true;
+}
+
+void string_t::bump_usage(const string_t *s) {
+  const_cast<string_t*>(s)->usage_count += 1;
+}
+
+void string_t::decrease_usage(const string_t *s) {
+  string_table().release(s);
+}
+
+void string_t::free_unused() {
+  string_table().free_unused();
+}
+
+// the low bit of value.integer marks inline rationals, interned ones are
+// pointers and aligned
+#define INLINE_RATIONAL_TAG 1
+
+value_t::value_t(const rational_t& rat) : type(TypeType::RATIONAL) {
+  if (rat.numerator >= INT32_MIN && rat.numerator <= INT32_MAX &&
+      rat.denominator > 0 && rat.denominator <= INT32_MAX) {
+    value.integer = (int64_t) ((((uint64_t) (uint32_t) rat.numerator) << 32) |
+                               (((uint64_t) rat.denominator) << 1) |
+                               INLINE_RATIONAL_TAG);
   } else {
-    return std::to_string(num) + "/" + std::to_string(denom);
+    value.rat = InternedRational::intern(rat);
   }
-  return "";
 }
 
-List::List(ListType t) : list_type(t) {}
+const rational_t value_t::to_rational() const {
+  const uint64_t bits = (uint64_t) value.integer;
+  if ((bits & INLINE_RATIONAL_TAG) == 0) {
+    return *value.rat;
+  }
+  rational_t rat;
+  rat.numerator = (int32_t) (bits >> 32);
+  rat.denominator = (bits & 0xFFFFFFFF) >> 1;
+  return rat;
+}
+
+static InternedRational *interned_rational(const value_t& v) {
+  if (v.type != TypeType::RATIONAL || (v.value.integer & INLINE_RATIONAL_TAG)) {
+    return nullptr;
+  }
+  return static_cast<InternedRational*>(const_cast<rational_t*>(v.value.rat));
+}
+
+static InternedBigInt *interned_bigint(const value_t& v) {
+  if (v.type != TypeType::INT || !bigint::is_boxed(v.value.integer)) {
+    return nullptr;
+  }
+  return const_cast<InternedBigInt*>(bigint::boxed(v.value.integer));
+}
+
+void value_t::bump_usage() const {
+  if (type == TypeType::STRING) {
+    string_t::bump_usage(value.string);
+  } else if (InternedRational *rat = interned_rational(*this)) {
+    rat->usage_count += 1;
+  } else if (InternedBigInt *big = interned_bigint(*this)) {
+    big->usage_count += 1;
+  }
+}
+
+void value_t::decrease_usage() const {
+  if (type == TypeType::STRING) {
+    string_t::decrease_usage(value.string);
+  } else if (InternedRational *rat = interned_rational(*this)) {
+    rational_table().release(rat);
+  } else if (InternedBigInt *big = interned_bigint(*this)) {
+    bigint_table().release(big);
+  }
+}
+
+void value_t::pin() const {
+  if (type == TypeType::STRING) {
+    string_t::pin(value.string);
+  } else if (InternedRational *rat = interned_rational(*this)) {
+    rat->pinned = true;
+  } else if (InternedBigInt *big = interned_bigint(*this)) {
+    big->pinned = true;
+  }
+}
+
+List::List(ListType t) : list_type(t), interned(nullptr) {}
+
+List::~List() {
+  reset_interned();
+}
+
+void List::reset_interned() {
+  // an interned list is its own interned version
+  if (interned && interned != this) {
+    InternedList::decrease_usage(interned);
+  }
+  interned = nullptr;
+}
 
 
 void List::const_iterator::do_init(const List *ptr) {
   pos = 0;
+  head = nullptr;
+  bottom = nullptr;
+  range = nullptr;
+  forward = nullptr;
   if (!ptr) {
-    head = nullptr;
-    bottom = nullptr;
-    tail = nullptr;
+    // continue with the appended elements of the innermost AppendList
+    while (!pending.empty()) {
+      const AppendList *next = pending.back();
+      pending.pop_back();
+      if (next->begin < next->end) {
+        init_forward(next->buffer.get(), next->begin, next->end);
+        return;
+      }
+    }
     return;
   }
 
   if (ptr->is_head()) {
     head = reinterpret_cast<const HeadList*>(ptr);
-    bottom = nullptr;
-    tail = nullptr;
   } else if (ptr->is_bottom()){
-    bottom = reinterpret_cast<const BottomList*>(ptr);
-    pos = bottom->values.size() - 1;
-    if (bottom->values.size() == 0) {
-      do_init(bottom->tail);
+    const BottomList *b = reinterpret_cast<const BottomList*>(ptr);
+    if (b->values.size() == 0) {
+      init_bottom_back(b, 0);
     } else {
-      head = nullptr;
-      tail = nullptr;
+      bottom = b;
+      pos = b->values.size() - 1;
     }
   } else if (ptr->is_skip()){
-    bottom = nullptr;
     const SkipList *skip = reinterpret_cast<const SkipList*>(ptr);
     if (skip->bottom->values.size() > skip->skip) {
       bottom = skip->bottom;
       pos = skip->bottom->values.size() - skip->skip - 1;
-      tail = nullptr;
     } else {
-      if (skip->bottom->tail) {
-        TailList *current = skip->bottom->tail;
-        size_t i;
-        size_t additional_skip =  skip->skip - skip->bottom->values.size();
-        for (i=0; current && i < additional_skip; i++) {
-          current = current->right;
-        }
-
-        if (i == additional_skip) {
-          tail = current;
-        } else {
-          tail = nullptr;
-        }
-      } else {
-        tail = nullptr;
-      }
+      init_bottom_back(skip->bottom, skip->skip - skip->bottom->values.size());
+    }
+  } else if (ptr->is_append()) {
+    const AppendList *a = reinterpret_cast<const AppendList*>(ptr);
+    pending.push_back(a);
+    do_init(a->front);
+  } else if (ptr->is_range()) {
+    const RangeList *r = reinterpret_cast<const RangeList*>(ptr);
+    if (r->count == 0) {
+      do_init(nullptr);
+    } else {
+      range = r;
+      pos = r->count - 1;
+      current = value_t(r->first);
     }
-    head = nullptr;
-  } else if (ptr->is_tail()) {
-    tail = reinterpret_cast<const TailList*>(ptr);
-    head = nullptr;
+  }
+}
+
+void List::const_iterator::init_forward(const std::vector<value_t> *vals,
+                                        size_t begin, size_t end) {
+  forward = vals;
+  pos = begin;
+  this->end = end;
+}
+
+void List::const_iterator::init_bottom_back(const BottomList *b, size_t skip) {
+  if (b->back_begin + skip < b->back.size()) {
     bottom = nullptr;
+    init_forward(&b->back, b->back_begin + skip, b->back.size());
+  } else {
+    do_init(nullptr);
   }
 }
 
@@ -403,7 +678,9 @@ List::const_iterator::const_iterator(const List *ptr) {
   do_init(ptr);
 }
 
-List::const_iterator::const_iterator(const self_type& other) : bottom(other.bottom), head(other.head), pos(other.pos) { }
+List::const_iterator::const_iterator(const self_type& other)
+    : bottom(other.bottom), head(other.head), range(other.range), forward(other.forward),
+      end(other.end), pos(other.pos), current(other.current), pending(other.pending) { }
 
 List::const_iterator::self_type List::const_iterator::operator++() {
   next();
@@ -418,11 +695,21 @@ void List::const_iterator::next() {
     if (pos > 0) {
       pos -= 1;
     } else {
-      do_init(bottom->tail);
+      init_bottom_back(bottom, 0);
+    }
+  } else if (forward) {
+    if (pos + 1 < end) {
+      pos += 1;
+    } else {
+      do_init(nullptr);
+    }
+  } else if (range) {
+    if (pos > 0) {
+      pos -= 1;
+      current.value.integer += range->step;
+    } else {
+      do_init(nullptr);
     }
-  } else if (tail) {
-      do_init(tail->right);
-    //FAILURE();
   }
 }
 
@@ -437,8 +724,10 @@ const value_t& List::const_iterator::operator*() {
     return head->current_head;
   } else if (bottom) {
     return bottom->values[pos];
-  } else if (tail) {
-    return tail->current_tail;
+  } else if (forward) {
+    return (*forward)[pos];
+  } else if (range) {
+    return current;
   } else {
     FAILURE();
   }
@@ -447,10 +736,10 @@ const value_t& List::const_iterator::operator*() {
 // all iterators that are not invalid (head = bottom = nullptr and pos = 0)
 // are equal; a valid and an invalid iterator are _NOT_ equal
 bool List::const_iterator::operator==(const self_type& rhs) const {
-  if (!head && !bottom && !tail) {
-    return !rhs.head && !rhs.bottom && !rhs.tail;
+  if (!head && !bottom && !forward && !range) {
+    return !rhs.head && !rhs.bottom && !rhs.forward && !rhs.range;
   } else {
-    return rhs.head || rhs.bottom || rhs.tail;
+    return rhs.head || rhs.bottom || rhs.forward || rhs.range;
   }
 }
 
@@ -468,6 +757,14 @@ List::const_iterator List::end() const {
 
 
 bool List::operator==(const List& other) const {
+  if (is_range() && other.is_range()) {
+    const RangeList *lhs = reinterpret_cast<const RangeList*>(this);
+    const RangeList *rhs = reinterpret_cast<const RangeList*>(&other);
+    return lhs->count == rhs->count &&
+           (lhs->count == 0 || lhs->first == rhs->first) &&
+           (lhs->count <= 1 || lhs->step == rhs->step);
+  }
+
   auto iter1 = begin();
   auto iter2 = other.begin();
 
@@ -502,8 +799,12 @@ bool List::is_skip() const {
   return list_type == ListType::SKIP;
 }
 
-bool List::is_tail() const {
-  return list_type == ListType::TAIL;
+bool List::is_append() const {
+  return list_type == ListType::APPEND;
+}
+
+bool List::is_range() const {
+  return list_type == ListType::RANGE;
 }
 
 const std::string List::to_str() const {
@@ -526,8 +827,75 @@ const std::string List::to_str() const {
 }
 
 
+size_t List::size() const {
+  switch (list_type) {
+    case ListType::HEAD: {
+      const HeadList *head = reinterpret_cast<const HeadList*>(this);
+      return head->depth + ((head->base) ? head->base->size() : 0);
+    }
+    case ListType::BOTTOM: {
+      const BottomList *bottom = reinterpret_cast<const BottomList*>(this);
+      return bottom->values.size() + bottom->back.size() - bottom->back_begin;
+    }
+    case ListType::SKIP: {
+      const SkipList *skip = reinterpret_cast<const SkipList*>(this);
+      size_t size = skip->bottom->size();
+      return (size > skip->skip) ? size - skip->skip : 0;
+    }
+    case ListType::RANGE:
+      return reinterpret_cast<const RangeList*>(this)->count;
+    case ListType::APPEND: {
+      const AppendList *append = reinterpret_cast<const AppendList*>(this);
+      return append->front->size() + append->end - append->begin;
+    }
+  }
+  FAILURE();
+}
+
+value_t List::nth(size_t index) const {
+  switch (list_type) {
+    case ListType::HEAD: {
+      const HeadList *head = reinterpret_cast<const HeadList*>(this);
+      if (index >= head->depth) {
+        return (head->base) ? head->base->nth(index - head->depth) : value_t();
+      }
+      for (; index > 0; index--) {
+        head = reinterpret_cast<const HeadList*>(head->right);
+      }
+      return head->current_head;
+    }
+    case ListType::BOTTOM: {
+      const BottomList *bottom = reinterpret_cast<const BottomList*>(this);
+      if (index < bottom->values.size()) {
+        return bottom->values[bottom->values.size() - index - 1];
+      }
+      index += bottom->back_begin - bottom->values.size();
+      return (index < bottom->back.size()) ? bottom->back[index] : value_t();
+    }
+    case ListType::SKIP: {
+      const SkipList *skip = reinterpret_cast<const SkipList*>(this);
+      return skip->bottom->nth(index + skip->skip);
+    }
+    case ListType::RANGE: {
+      const RangeList *range = reinterpret_cast<const RangeList*>(this);
+      return (index < range->count) ? value_t(range->at(index)) : value_t();
+    }
+    case ListType::APPEND: {
+      const AppendList *append = reinterpret_cast<const AppendList*>(this);
+      size_t front_size = append->front->size();
+      if (index < front_size) {
+        return append->front->nth(index);
+      }
+      index -= front_size;
+      return (index < append->end - append->begin) ? (*append->buffer)[append->begin + index]
+                                                   : value_t();
+    }
+  }
+  FAILURE();
+}
+
 void List::bump_usage() {
-  if (is_bottom()) {
+  if (is_bottom() || is_range()) {
     reinterpret_cast<BottomList*>(this)->usage_count += 1;
     return;
   }
@@ -539,56 +907,156 @@ void List::bump_usage() {
   if (is_skip()) {
     reinterpret_cast<SkipList*>(this)->bottom->bump_usage();
   }
+
+  if (is_append()) {
+    reinterpret_cast<AppendList*>(this)->front->bump_usage();
+  }
 }
 
-void List::decrease_usage() {
-  if (is_bottom()) {
-    reinterpret_cast<BottomList*>(this)->usage_count -= 1;
-    return;
+BottomList* List::decrease_usage() {
+  if (is_bottom() || is_range()) {
+    BottomList *list = reinterpret_cast<BottomList*>(this);
+    list->usage_count -= 1;
+    return (list->usage_count == 0) ? list : nullptr;
   }
 
   if (is_head()) {
-    reinterpret_cast<HeadList*>(this)->right->bump_usage();
+    return reinterpret_cast<HeadList*>(this)->right->decrease_usage();
   }
 
   if (is_skip()) {
-    reinterpret_cast<SkipList*>(this)->bottom->bump_usage();
+    return reinterpret_cast<SkipList*>(this)->bottom->decrease_usage();
+  }
+
+  if (is_append()) {
+    return reinterpret_cast<AppendList*>(this)->front->decrease_usage();
   }
+  return nullptr;
 }
 
-BottomList* List::collect() {
+BottomList* List::collect(uint32_t refs) {
+  if (is_range()) {
+    reinterpret_cast<RangeList*>(this)->materialize();
+  }
+
+  if (is_bottom()) {
+    // storing a list without changing it does not need a copy, the usage
+    // count already contains the new locations
+    BottomList* list = reinterpret_cast<BottomList*>(this);
+    list->usage_count = std::max(list->usage_count, refs);
+    return list;
+  }
+  return collect_unique(refs);
+}
+
+// Lists stored as elements of another list are referenced by it. Stored
+// lists are shared, temporary lists are copied to the heap because folding
+// may change or free them. Interned strings and rationals are pinned.
+static void retain_element(value_t& element) {
+  if (!element.is_list()) {
+    element.pin();
+    return;
+  }
+  List *list = element.value.list;
+  if (list->is_bottom() && !reinterpret_cast<BottomList*>(list)->is_temporary()) {
+    list->bump_usage();
+    return;
+  }
+  BottomList *copy = new BottomList();
+  for (auto iter = list->begin(); iter != list->end(); iter++) {
+    copy->values.push_back(*iter);
+    retain_element(copy->values.back());
+  }
+  // BottomLists store their elements in reverse order
+  std::reverse(copy->values.begin(), copy->values.end());
+  copy->bump_usage();
+  element.value.list = copy;
+}
+
+void List::retain_elements() {
+  List *list = this;
+  while (list) {
+    switch (list->list_type) {
+      case ListType::HEAD: {
+        HeadList *head = reinterpret_cast<HeadList*>(list);
+        retain_element(head->current_head);
+        list = head->right;
+        break;
+      }
+      case ListType::APPEND: {
+        AppendList *append = reinterpret_cast<AppendList*>(list);
+        for (size_t i = append->begin; i < append->end; i++) {
+          retain_element((*append->buffer)[i]);
+        }
+        list = append->front;
+        break;
+      }
+      case ListType::SKIP:
+        list = reinterpret_cast<SkipList*>(list)->bottom;
+        break;
+      case ListType::RANGE:
+        return;
+      case ListType::BOTTOM: {
+        BottomList *bottom = reinterpret_cast<BottomList*>(list);
+        // the elements of stored lists were retained when they were stored
+        if (bottom->is_temporary()) {
+          for (value_t& v : bottom->values) {
+            retain_element(v);
+          }
+          for (size_t i = bottom->back_begin; i < bottom->back.size(); i++) {
+            retain_element(bottom->back[i]);
+          }
+        }
+        return;
+      }
+    }
+  }
+}
+
+BottomList* List::store(uint32_t refs) {
+  BottomList *result = collect(refs);
+  if (result->is_temporary()) {
+    result = result->promote(refs);
+  }
+  return result;
+}
+
+BottomList* List::collect_unique(uint32_t refs) {
+  if (is_range()) {
+    reinterpret_cast<RangeList*>(this)->materialize();
+  }
+
   if (is_head()) {
     HeadList* list = reinterpret_cast<HeadList*>(this);
-    BottomList *result = list->right->collect();
+    BottomList *result = list->right->collect_unique(refs);
     result->values.push_back(std::move(list->current_head));
+    result->reset_interned();
     return result;
   } else if (is_skip()) {
     SkipList *list = reinterpret_cast<SkipList*>(this);
-    BottomList *result = list->bottom->collect();
-    for (size_t i=list->skip; i > 0; i--) {
-      result->values.pop_back();
-    }
+    BottomList *result = list->bottom->collect_unique(refs);
+    result->drop_front(list->skip);
+    result->reset_interned();
+    return result;
+  } else if (is_append()) {
+    AppendList *list = reinterpret_cast<AppendList*>(this);
+    BottomList *result = list->front->collect_unique(refs);
+    result->back.insert(result->back.end(), list->buffer->cbegin() + list->begin,
+                        list->buffer->cbegin() + list->end);
+    result->reset_interned();
     return result;
   } else if (is_bottom()) {
     BottomList* list = reinterpret_cast<BottomList*>(this);
-    if (list->usage_count <= 1) {
-      list->usage_count = 1;
-      if (list->tail) {
-        list->tail->collect(list->values);
-        list->tail = nullptr;
-      }
+    if (list->usage_count <= refs) {
+      // no other location references the list, it can be modified in place
+      list->usage_count = refs;
       return list;
     } else {
       BottomList *copy = new BottomList();
-      copy->usage_count = 1;
+      copy->usage_count = refs;
       copy->values = list->values;
-      list->usage_count -= 1;
-      copy->allocated_in_collect = true;
-
-      if (list->tail) {
-        list->tail->collect(copy->values);
-        list->tail = nullptr;
-      }
+      copy->back.assign(list->back.cbegin() + list->back_begin, list->back.cend());
+      list->usage_count -= refs;
       return copy;
     }
   } else {
@@ -596,23 +1064,43 @@ BottomList* List::collect() {
   }
 }
 
-HeadList::HeadList(List *l, const value_t& val) : List(ListType::HEAD), right(l), current_head(val) {}
+HeadList::HeadList(List *l, const value_t& val) : List(ListType::HEAD), right(l), current_head(val) {
+  if (l && l->is_head()) {
+    base = reinterpret_cast<HeadList*>(l)->base;
+    depth = reinterpret_cast<HeadList*>(l)->depth + 1;
+  } else {
+    base = l;
+    depth = 1;
+  }
+}
 
-TailList::TailList(TailList *l, const value_t& val) : List(ListType::TAIL), right(l), current_tail(val) {}
+AppendList::AppendList(List *front, const std::shared_ptr<std::vector<value_t>>& buffer,
+                       size_t begin, size_t end)
+    : List(ListType::APPEND), front(front), buffer(buffer), begin(begin), end(end) {}
 
-void TailList::collect(std::vector<value_t>& collect_to) {
-  collect_to.insert(collect_to.begin(), current_tail);
-  if (right) {
-    right->collect(collect_to);
+AppendList *AppendList::append(ListArena& arena, const value_t& val) const {
+  if (end == buffer->size()) {
+    // this is the newest version, older versions do not see the new element
+    buffer->push_back(val);
+    return arena.make<AppendList>(front, buffer, begin, end + 1);
   }
+  auto copy = std::make_shared<std::vector<value_t>>(buffer->begin() + begin,
+                                                     buffer->begin() + end);
+  copy->push_back(val);
+  return arena.make<AppendList>(front, copy, 0, copy->size());
 }
 
 BottomList::BottomList() 
-  : List(ListType::BOTTOM), usage_count(0), values(), tail(nullptr) {}
+  : List(ListType::BOTTOM), usage_count(0), temporary(false), values(), back(),
+    back_begin(0) {}
 
 
 BottomList::BottomList(const std::vector<value_t>& vals) 
-  : List(ListType::BOTTOM), usage_count(0), values(std::move(vals)), tail(nullptr) {}
+  : List(ListType::BOTTOM), usage_count(0), temporary(false),
+    values(std::move(vals)), back(), back_begin(0) {}
+
+BottomList::BottomList(ListType t)
+  : List(t), usage_count(0), temporary(false), values(), back(), back_begin(0) {}
 
 BottomList::~BottomList() {
 }
@@ -622,52 +1110,248 @@ bool BottomList::is_used() const {
   return usage_count > 0;
 }
 
-bool BottomList::check_allocated_and_set_to_false() {
-  if (allocated_in_collect) {
-    allocated_in_collect = false;
-    return true;
+bool BottomList::is_temporary() const {
+  return temporary;
+}
+
+BottomList* BottomList::promote(uint32_t refs) {
+  BottomList *list = new BottomList();
+  list->usage_count = refs;
+  if (usage_count <= refs) {
+    list->values = std::move(values);
+    list->back = std::move(back);
+    list->back_begin = back_begin;
+    values.clear();
+    back.clear();
+    back_begin = 0;
+    usage_count = 0;
+  } else {
+    list->values = values;
+    list->back.assign(back.cbegin() + back_begin, back.cend());
+    usage_count -= refs;
   }
-  return false;
+  return list;
+}
+
+void BottomList::drop_front(size_t n) {
+  size_t from_values = std::min(n, values.size());
+  values.resize(values.size() - from_values);
+  back_begin = std::min(back_begin + n - from_values, back.size());
+  // only shift the remaining elements once half of the back is unused, so
+  // that dropping elements stays constant time on average
+  if (back_begin > 0 && back_begin * 2 >= back.size()) {
+    back.erase(back.begin(), back.begin() + back_begin);
+    back_begin = 0;
+  }
+}
+
+RangeList::RangeList(INT_T start, INT_T end)
+  : BottomList(ListType::RANGE), first(start), step((start <= end) ? 1 : -1),
+    count(((start <= end) ? end - start : start - end) + 1) {}
+
+RangeList::RangeList(INT_T first, INT_T step, size_t count)
+  : BottomList(ListType::RANGE), first(first), step(step), count(count) {}
+
+void RangeList::materialize() {
+  if (!is_range()) {
+    return;
+  }
+  // BottomLists store their elements in reverse order
+  values.reserve(count);
+  for (size_t i = count; i > 0; i--) {
+    values.push_back(value_t(at(i - 1)));
+  }
+  list_type = ListType::BOTTOM;
 }
 
 SkipList::SkipList(size_t skip, BottomList *btm) : List(ListType::SKIP), skip(skip), bottom(btm) {}
 
-static std::hash<std::string> str_hasher;
+// interned lists are never modified, this keeps them from being collected
+// in place or freed if they are ever used as a value
+#define INTERNED_LIST_USAGE (UINT32_MAX / 2)
+
+InternedList::InternedList(size_t hash)
+    : BottomList(), hash(hash), references(0), pinned(false) {
+  usage_count = INTERNED_LIST_USAGE;
+}
+
+InternedList::~InternedList() {
+  for (const value_t& v : values) {
+    if (v.is_list()) {
+      decrease_usage(reinterpret_cast<const InternedList*>(v.value.list));
+    } else {
+      v.decrease_usage();
+    }
+  }
+}
+
+static size_t hash_element(const value_t& v) {
+  if (v.is_list()) {
+    return v.value.list->interned->hash;
+  } else if (v.type == TypeType::FLOAT) {
+    return std::hash<FLOAT_T>()(v.value.float_);
+  } else {
+    return std::hash<value_t>()(v);
+  }
+}
+
+static bool eq_elements(const value_t& lhs, const value_t& rhs) {
+  if (lhs.is_list() && rhs.is_list()) {
+    return lhs.value.list == rhs.value.list;
+  }
+  return lhs == rhs;
+}
+
+const InternedList *InternedList::intern(const List *list) {
+  if (list->interned) {
+    return list->interned;
+  }
+
+  // elements in reverse order like in a BottomList, nested lists are
+  // interned first, so that they can be compared by pointer
+  std::vector<value_t> elements;
+  elements.reserve(list->size());
+  size_t h = 0x9E3779B97F4A7C15ULL;
+  for (auto iter = list->begin(); iter != list->end(); iter++) {
+    elements.push_back(*iter);
+    value_t& v = elements.back();
+    if (v.is_list()) {
+      v.value.list = const_cast<InternedList*>(intern(v.value.list));
+    }
+    h = h * 31 + hash_element(v);
+  }
+  std::reverse(elements.begin(), elements.end());
+
+  auto& table = list_table();
+  const InternedList *result = nullptr;
+  auto range = table.entries.equal_range(h);
+  for (auto iter = range.first; iter != range.second; iter++) {
+    const std::vector<value_t>& values = iter->second->values;
+    if (values.size() == elements.size() &&
+        std::equal(values.begin(), values.end(), elements.begin(), eq_elements)) {
+      result = iter->second;
+      break;
+    }
+  }
+
+  if (result == nullptr) {
+    // the new list holds its elements until it is freed
+    for (const value_t& v : elements) {
+      if (v.is_list()) {
+        bump_usage(reinterpret_cast<const InternedList*>(v.value.list));
+      } else {
+        v.bump_usage();
+      }
+    }
+    InternedList *interned = new InternedList(h);
+    interned->values = std::move(elements);
+    interned->interned = interned;
+    table.insert(interned);
+    result = interned;
+  }
+  bump_usage(result);
+  list->interned = result;
+  return result;
+}
+
+void InternedList::pin(const InternedList *list) {
+  const_cast<InternedList*>(list)->pinned = true;
+}
+
+void InternedList::bump_usage(const InternedList *list) {
+  const_cast<InternedList*>(list)->references += 1;
+}
+
+void InternedList::decrease_usage(const InternedList *list) {
+  list_table().release(list);
+}
+
+size_t InternedList::count() {
+  return list_table().entries.size();
+}
+
+ListArena::ListArena() : blocks(), current_block(0), offset(0), lists() {}
+
+ListArena::~ListArena() {
+  clear();
+  for (char *block : blocks) {
+    delete[] block;
+  }
+}
+
+void ListArena::clear() {
+  for (List *list : lists) {
+    list->~List();
+  }
+  lists.clear();
+  // the blocks are kept for the next step
+  current_block = 0;
+  offset = 0;
+}
+
+void *ListArena::allocate(size_t size) {
+  // keep all nodes aligned like memory returned by new
+  const size_t align = alignof(std::max_align_t);
+  size = (size + align - 1) & ~(align - 1);
+  if (blocks.empty() || offset + size > block_size) {
+    if (!blocks.empty()) {
+      current_block += 1;
+    }
+    if (current_block == blocks.size()) {
+      blocks.push_back(new char[block_size]);
+    }
+    offset = 0;
+  }
+  void *mem = blocks[current_block] + offset;
+  offset += size;
+  return mem;
+}
 
 size_t hash_uint64_value(const Type *type, uint64_t val) {
   switch (type->t) {
     case TypeType::INT:
+    case TypeType::FLOAT:
+    case TypeType::BOOLEAN:
       return val;
     case TypeType::SELF:
     case TypeType::UNDEF: // are UNDEF and SELF the same here?
       return 0;
     case TypeType::RULEREF:
       return val;
-    case TypeType::STRING: 
-      return (uint64_t) str_hasher(*reinterpret_cast<std::string*>(val));
+    case TypeType::STRING:
+      if (val == 0) {
+        return 0;
+      }
+      return reinterpret_cast<const string_t*>(val)->hash;
     case TypeType::TUPLE: 
     case TypeType::TUPLE_OR_LIST: 
-      FAILURE();
-    case TypeType::LIST: {
-      size_t h = 0; 
-      List *list = reinterpret_cast<List*>(val);
-      for (auto iter=list->begin(); iter!=list->end(); iter++) {
-        h += hash_uint64_value(type->subtypes[0], (*iter).to_uint64_t());
-      }
-      return h;
-    }
+    case TypeType::LIST:
+      // arguments are interned by pack_values_in_array
+      return (val) ? reinterpret_cast<InternedList*>(val)->hash : 0;
     case TypeType::ENUM:
       return (size_t) reinterpret_cast<enum_value_t*>(val)->id;
-    case TypeType::RATIONAL: {
-      rational_t *rat = reinterpret_cast<rational_t*>(val);
-      return (size_t) rat->numerator + rat->denominator;
-    }
+    case TypeType::RATIONAL:
+      // inline rationals or interned ones
+      return val;
     case TypeType::SYMBOL:
       return val;
     default: FAILURE();
   }
 }
 
+void pin_uint64_value(const Type *type, uint64_t val) {
+  if (val != 0 && (type->t == TypeType::LIST || type->t == TypeType::TUPLE ||
+                   type->t == TypeType::TUPLE_OR_LIST)) {
+    InternedList::pin(reinterpret_cast<const InternedList*>(val));
+  } else if ((val != 0 && (type->t == TypeType::STRING || type->t == TypeType::RATIONAL)) ||
+             (type->t == TypeType::INT && bigint::is_boxed(val))) {
+    value_t v;
+    v.type = type->t;
+    v.value.integer = val;
+    v.pin();
+  }
+}
+
 bool eq_uint64_value(const Type *type, uint64_t lhs, uint64_t rhs) {
   switch (type->t) {
     case TypeType::SELF: return true;
@@ -676,19 +1360,18 @@ bool eq_uint64_value(const Type *type, uint64_t lhs, uint64_t rhs) {
     case TypeType::BOOLEAN:
       return lhs == rhs;
     case TypeType::STRING:
-      return *reinterpret_cast<std::string*>(lhs) ==
-             *reinterpret_cast<std::string*>(rhs); 
+      // equal strings are the same object
+      return lhs == rhs;
     case TypeType::TUPLE:
     case TypeType::TUPLE_OR_LIST:
     case TypeType::LIST:
-      return *reinterpret_cast<List*>(lhs) ==
-             *reinterpret_cast<List*>(rhs); 
+      // equal interned lists are the same object
+      return lhs == rhs;
     case TypeType::ENUM:
       return reinterpret_cast<enum_value_t*>(lhs)->id ==
              reinterpret_cast<enum_value_t*>(rhs)->id; 
     case TypeType::RATIONAL:
-      return *reinterpret_cast<rational_t*>(lhs) ==
-             *reinterpret_cast<rational_t*>(rhs); 
+      return lhs == rhs;
     default: FAILURE();
   }
 }
@@ -700,13 +1383,17 @@ namespace std {
     switch (key.type) {
       case TypeType::INT:
         return key.value.integer;
+      case TypeType::FLOAT:
+        return pack_float(key.value.float_);
+      case TypeType::BOOLEAN:
+        return key.value.boolean;
       case TypeType::SELF:
       case TypeType::UNDEF: // are UNDEF and SELF the same here?
         return 0;
       case TypeType::RULEREF:
         return (uint64_t) key.value.rule;
       case TypeType::STRING: 
-        return (uint64_t) str_hasher(*key.value.string);
+        return key.value.string->hash;
       case TypeType::TUPLE: 
       case TypeType::TUPLE_OR_LIST: 
       case TypeType::LIST: {
@@ -719,7 +1406,7 @@ namespace std {
       case TypeType::ENUM:
         return (size_t) key.value.enum_val->id;
       case TypeType::RATIONAL:
-        return (size_t) key.value.rat->numerator + key.value.rat->denominator;
+        return key.value.integer;
       default: throw RuntimeException("Unsupported type in std::hash<value_t>()");
     }
   }
@@ -741,6 +1428,10 @@ namespace std {
 
   std::hash<std::vector<value_t>> hash<BottomList>::list_hasher;
   size_t hash<BottomList>::operator()(const BottomList &key) const {
-    return list_hasher(key.values);
+    size_t h = list_hasher(key.values);
+    for (size_t i = key.back_begin; i < key.back.size(); i++) {
+      h = h * 31 + list_hasher.hasher(key.back[i]);
+    }
+    return h;
   }
 }
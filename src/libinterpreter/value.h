@@ -1,6 +1,10 @@
 #ifndef CASMI_LIBINTERPRETER_VALUE_H
 #define CASMI_LIBINTERPRETER_VALUE_H
 
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
 
 #include "macros.h"
 
@@ -8,7 +12,7 @@
 #include "libsyntax/symbols.h"
 #include "libutil/exceptions.h"
 
-#include "libcasmrt/rt.h"
+#include "libinterpreter/updateset.h"
 
 
 struct enum_value_t;
@@ -17,13 +21,17 @@ class RuleNode;
 enum class ExpressionOperation;
 
 class HeadList;
-class TailList;
+class AppendList;
 class BottomList;
+class RangeList;
 class List;
+class ListArena;
+class InternedList;
 
 struct symbolic_condition_t;
 struct symbol_t;
 struct rational_t;
+struct string_t;
 
 
 class value_t {
@@ -34,35 +42,54 @@ class value_t {
       FLOAT_T float_;
       bool boolean;
       RuleNode *rule;
-      std::string *string;
+      const string_t *string;
       List *list;
       const enum_value_t *enum_val;
       const rational_t *rat;
       symbol_t *sym;
     } value;
 
-    value_t();
-    value_t(INT_T integer);
-    value_t(FLOAT_T float_);
-    value_t(bool boolean);
-    value_t(RuleNode *rule);
-    value_t(std::string *string);
-    value_t(const Type& t, List *list);
-    value_t(const enum_value_t *enum_val);
-    value_t(const rational_t *val);
-    value_t(symbol_t *sym);
-    value_t(const value_t& other);
-    value_t(value_t&& other) noexcept;
+    value_t() : type(TypeType::UNDEF) {}
+    value_t(INT_T integer) : type(TypeType::INT) { value.integer = integer; }
+    value_t(FLOAT_T float_) : type(TypeType::FLOAT) { value.float_ = float_; }
+    value_t(bool boolean) : type(TypeType::BOOLEAN) { value.boolean = boolean; }
+    value_t(RuleNode *rule) : type(TypeType::RULEREF) { value.rule = rule; }
+    value_t(const string_t *string) : type(TypeType::STRING) { value.string = string; }
+    value_t(const Type& t, List *list) : type(t.t) { value.list = list; }
+    value_t(const enum_value_t *enum_val) : type(TypeType::ENUM) { value.enum_val = enum_val; }
+    value_t(const rational_t& rat);
+    value_t(symbol_t *sym) : type(TypeType::SYMBOL) { value.sym = sym; }
     value_t(TypeType type, casm_update* update);
 
-    value_t& operator=(const value_t& other);
+    // values are plain data, copying them must not call out of line code
+    value_t(const value_t& other) = default;
+    value_t(value_t&& other) noexcept = default;
+    value_t& operator=(const value_t& other) = default;
+
     bool operator==(const value_t &other) const;
     bool operator!=(const value_t &other) const;
 
     uint64_t to_uint64_t() const;
-
-    bool is_undef() const;
-    bool is_symbolic() const;
+    const rational_t to_rational() const;
+
+    // interned strings and rationals are reference counted by the function
+    // values holding them; values used as arguments or list elements are
+    // pinned
+    void bump_usage() const;
+    void decrease_usage() const;
+    void pin() const;
+
+    bool is_undef() const {
+      return type == TypeType::UNDEF;
+    }
+    bool is_symbolic() const {
+      return type == TypeType::SYMBOL;
+    }
+    // true for defined lists and tuples
+    bool is_list() const {
+      return type == TypeType::LIST || type == TypeType::TUPLE ||
+             type == TypeType::TUPLE_OR_LIST;
+    }
 
     const std::string to_str(bool symbolic=false) const;
 };
@@ -90,6 +117,35 @@ struct symbolic_condition_t {
   std::string to_str() const;
 };
 
+// Strings are interned: equal strings share one string_t with a
+// precomputed hash, so they are compared by pointer. Strings created at
+// runtime are freed at the end of the step once no function value holds
+// them; literals and strings used as arguments or list elements are pinned
+// and live until the program ends.
+struct string_t {
+  const std::string str;
+  const size_t hash;
+  uint32_t usage_count;
+  bool pinned;
+
+  static const string_t *intern(const std::string& str);
+  // interns a literal once, `cache` holds the result of the first call
+  static const string_t *literal(const std::string& str, const string_t *&cache);
+
+  static void pin(const string_t *s);
+  static void bump_usage(const string_t *s);
+  static void decrease_usage(const string_t *s);
+  // frees the strings created or released since the last call that are not
+  // held by any function value
+  static void free_unused();
+
+  private:
+    string_t(const std::string& str, size_t hash);
+};
+
+// Rationals are kept in lowest terms with a positive denominator, so equal
+// rationals have equal parts. The arithmetic operators throw a
+// RuntimeException if a reduced result does not fit in 64 bits.
 struct rational_t {
   int64_t numerator;
   int64_t denominator;
@@ -99,22 +155,37 @@ struct rational_t {
   rational_t(const rational_t& other);
 
   bool operator==(const rational_t& other) const;
-  const rational_t& operator+(const rational_t& other) const;
-  const rational_t& operator-(const rational_t& other) const;
-  const rational_t& operator*(const rational_t& other) const;
-  const rational_t& operator/(const rational_t& other) const;
-  const rational_t& operator%(const rational_t& other) const;
+  const rational_t operator+(const rational_t& other) const;
+  const rational_t operator-(const rational_t& other) const;
+  const rational_t operator*(const rational_t& other) const;
+  const rational_t operator/(const rational_t& other) const;
+  const rational_t operator%(const rational_t& other) const;
 
   const std::string to_str() const;
 };
 
+// Rationals with parts that fit in 32 bits are stored inline in value_t,
+// larger ones are interned and managed like strings.
+struct InternedRational : public rational_t {
+  const size_t hash;
+  uint32_t usage_count;
+  bool pinned;
+
+  static const InternedRational *intern(const rational_t& rat);
+  static void free_unused();
+
+  private:
+    InternedRational(const rational_t& rat, size_t hash);
+};
+
 class List {
   public:
     enum class ListType {
       HEAD,
       BOTTOM,
       SKIP,
-      TAIL,
+      APPEND,
+      RANGE,
     };
    
     class const_iterator {
@@ -138,16 +209,29 @@ class List {
       private:
         const BottomList *bottom;
         const HeadList *head;
-        const TailList *tail;
-        uint32_t pos;
+        const RangeList *range;
+        // elements [pos, end) of an append buffer or of the back of a
+        // BottomList
+        const std::vector<value_t> *forward;
+        size_t end;
+        size_t pos;
+        // element of a range, ranges do not store their elements
+        value_t current;
+        // appended elements that follow the elements of the current front
+        std::vector<const AppendList*> pending;
 
         void do_init(const List *other);
+        void init_forward(const std::vector<value_t> *vals, size_t begin, size_t end);
+        void init_bottom_back(const BottomList *b, size_t skip);
     };
 
     ListType list_type;
+    // interned version of the list, set when the list is used as argument;
+    // the list holds a reference to it until it is changed or destroyed
+    mutable const InternedList *interned;
 
     List(ListType t);
-    virtual ~List() {}
+    virtual ~List();
 
 
     bool operator==(const List& other) const;
@@ -156,50 +240,93 @@ class List {
     bool is_bottom() const;
     bool is_head() const;
     bool is_skip() const;
-    bool is_tail() const;
+    bool is_append() const;
+    bool is_range() const;
 
     const_iterator begin() const;
     const_iterator end() const;
 
     const std::string to_str() const;
 
+    // number of elements in constant time
+    size_t size() const;
+    // element at the 0-based index or undef if the index is out of range;
+    // elements in the collected part of a list and appended elements are
+    // accessed in constant time, only the elements added by cons in the
+    // current step are reached by following links
+    value_t nth(size_t index) const;
+
     void bump_usage();
-    void decrease_usage();
+    // returns the BottomList whose usage count dropped to zero, if any
+    BottomList* decrease_usage();
+
+    // Folds the list into a BottomList. `refs` is the number of locations
+    // the list is stored to in this step; the storage of the underlying
+    // BottomList is reused if no other location references it, otherwise
+    // it is copied first. A BottomList is shared instead of copied.
+    BottomList* collect(uint32_t refs = 1);
+    // collects the list for `refs` new locations and moves it out of the
+    // step's ListArena if necessary
+    BottomList* store(uint32_t refs);
+    // makes the lists stored as elements independent of the temporary
+    // lists of the step; must be called for all lists that are stored in
+    // a step before any of them is collected
+    void retain_elements();
 
-    BottomList* collect();
+  private:
+    BottomList* collect_unique(uint32_t refs);
+    // drops the interned version after the elements were changed
+    void reset_interned();
 };
 
 
 class HeadList : public List {
   public:
     List* right;
-    const value_t current_head;
+    value_t current_head;
+    // first list below the chain of HeadLists and the length of the chain
+    List *base;
+    size_t depth;
 
     HeadList(List* right, const value_t& val);
 };
 
-class TailList : public List {
+// The list `front` followed by the elements [begin, end) of `buffer`.
+// Appending to the newest version of a list pushes to the shared buffer;
+// older versions only see their prefix of the buffer, so no version is
+// ever modified. Appending to an older version copies its elements.
+class AppendList : public List {
   public:
-    TailList* right;
-    const value_t current_tail;
+    List *front;
+    std::shared_ptr<std::vector<value_t>> buffer;
+    size_t begin;
+    size_t end;
 
-    TailList(TailList* right, const value_t& val);
+    AppendList(List *front, const std::shared_ptr<std::vector<value_t>>& buffer,
+               size_t begin, size_t end);
 
-    void collect(std::vector<value_t>& collect_to);
+    // returns a new list with `val` appended
+    AppendList *append(ListArena& arena, const value_t& val) const;
 };
 
 
 class BottomList : public List {
   friend class List;
+  friend class ListArena;
+  friend class InternedList;
 
   private:
     uint32_t usage_count;
-    bool allocated_in_collect; 
+    // allocated in a ListArena and freed at the end of the step
+    bool temporary;
 
   public:
+    // elements in reverse order, cons pushes to the back
     std::vector<value_t> values;
-
-    TailList *tail;
+    // elements [back_begin, back.size()) follow the elements in `values`,
+    // app pushes to the back and tail skips elements at the front
+    std::vector<value_t> back;
+    size_t back_begin;
 
     BottomList();
     BottomList(const std::vector<value_t>& vals);
@@ -207,7 +334,63 @@ class BottomList : public List {
     virtual ~BottomList();
 
     bool is_used() const;
-    bool check_allocated_and_set_to_false();
+    bool is_temporary() const;
+
+    // returns a heap allocated list with the elements of this list for
+    // `refs` locations; the elements are moved if no other location
+    // references this list
+    BottomList* promote(uint32_t refs);
+
+    // removes the first `n` elements
+    void drop_front(size_t n);
+
+  protected:
+    BottomList(ListType t);
+};
+
+// The integer range [first..first+step*(count-1)] with step 1 or -1. The
+// elements are computed on the fly until the range is materialized, which
+// turns it into a regular BottomList in place when it is stored into a
+// function.
+class RangeList : public BottomList {
+  public:
+    INT_T first;
+    INT_T step;
+    size_t count;
+
+    // [start..end], the range is descending if start > end
+    RangeList(INT_T start, INT_T end);
+    RangeList(INT_T first, INT_T step, size_t count);
+
+    INT_T at(size_t i) const { return first + step * (INT_T) i; }
+
+    void materialize();
+};
+
+// Lists used as function arguments are interned: equal lists share one
+// InternedList, so arguments are compared by pointer and hashed with the
+// cached hash. Interned lists are never modified. Like strings they are
+// freed at the end of the step once nothing references them; the lists
+// they were interned from, derived cache entries and the elements of other
+// interned lists hold references, keys of functions are pinned.
+class InternedList : public BottomList {
+  public:
+    const size_t hash;
+    uint32_t references;
+    bool pinned;
+
+    virtual ~InternedList();
+
+    static const InternedList *intern(const List *list);
+
+    static void pin(const InternedList *list);
+    static void bump_usage(const InternedList *list);
+    static void decrease_usage(const InternedList *list);
+    // number of interned lists that were not freed yet
+    static size_t count();
+
+  private:
+    InternedList(size_t hash);
 };
 
 class SkipList : public List {
@@ -218,8 +401,48 @@ class SkipList : public List {
     SkipList(size_t skip, BottomList *btm);
 };
 
+// Holds the temporary list nodes created during a step. Nodes are
+// allocated from large blocks and all of them are destroyed at once by
+// clear(); lists that are stored into a function must be promoted first.
+class ListArena {
+  public:
+    ListArena();
+    ~ListArena();
+
+    ListArena(const ListArena&) = delete;
+    ListArena& operator=(const ListArena&) = delete;
+
+    template<class T, class... Args>
+    T* make(Args&&... args) {
+      T *list = new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+      mark_temporary(list);
+      lists.push_back(list);
+      return list;
+    }
+
+    size_t size() const { return lists.size(); }
+    void clear();
+
+  private:
+    static const size_t block_size = 64 * 1024;
+
+    std::vector<char*> blocks;
+    size_t current_block;
+    size_t offset;
+    std::vector<List*> lists;
+
+    void *allocate(size_t size);
+    void mark_temporary(List*) {}
+    void mark_temporary(BottomList *list) { list->temporary = true; }
+};
+
 size_t hash_uint64_value(const Type *type, uint64_t val);
 bool eq_uint64_value(const Type *type, uint64_t lhs, uint64_t rhs);
+void pin_uint64_value(const Type *type, uint64_t val);
+
+// frees the interned strings, rationals and lists that were created or
+// released since the last call and are not held by any function value
+void free_unused_values();
 
 namespace std {
 
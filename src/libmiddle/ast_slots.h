@@ -0,0 +1,168 @@
+#ifndef CASMI_LIBMIDDLE_AST_SLOTS
+#define CASMI_LIBMIDDLE_AST_SLOTS
+
+#include "macros.h"
+
+#include "libsyntax/ast.h"
+
+// calls on_statement for every statement slot and on_expression for every
+// expression slot of stmt
+template<class S, class E>
+void for_each_slot(AstNode *stmt, S on_statement, E on_expression) {
+  switch (stmt->node_type_) {
+    case NodeType::PARBLOCK:
+    case NodeType::SEQBLOCK: {
+      AstListNode *stmts = reinterpret_cast<AstListNode*>(
+          reinterpret_cast<UnaryNode*>(stmt)->child_);
+      for (AstNode*& s : stmts->nodes) {
+        on_statement(s);
+      }
+      break;
+    }
+    case NodeType::UPDATE:
+    case NodeType::UPDATE_SUBRANGE:
+    case NodeType::UPDATE_DUMPS: {
+      UpdateNode *update = reinterpret_cast<UpdateNode*>(stmt);
+      on_expression(update->expr_);
+      if (update->func->arguments) {
+        for (ExpressionBase*& arg : *update->func->arguments) {
+          on_expression(arg);
+        }
+      }
+      break;
+    }
+    case NodeType::ASSERT:
+    case NodeType::ASSURE: {
+      UnaryNode *node = reinterpret_cast<UnaryNode*>(stmt);
+      ExpressionBase *expr = reinterpret_cast<ExpressionBase*>(node->child_);
+      on_expression(expr);
+      node->child_ = expr;
+      break;
+    }
+    case NodeType::IFTHENELSE: {
+      IfThenElseNode *node = reinterpret_cast<IfThenElseNode*>(stmt);
+      on_expression(node->condition_);
+      on_statement(node->then_);
+      if (node->else_) {
+        on_statement(node->else_);
+      }
+      break;
+    }
+    case NodeType::CALL: {
+      CallNode *call = reinterpret_cast<CallNode*>(stmt);
+      if (call->ruleref) {
+        on_expression(call->ruleref);
+      }
+      if (call->arguments) {
+        for (ExpressionBase*& arg : *call->arguments) {
+          on_expression(arg);
+        }
+      }
+      break;
+    }
+    case NodeType::PRINT:
+      for (ExpressionBase*& atom : reinterpret_cast<PrintNode*>(stmt)->atoms) {
+        on_expression(atom);
+      }
+      break;
+    case NodeType::LET: {
+      LetNode *node = reinterpret_cast<LetNode*>(stmt);
+      on_expression(node->expr);
+      on_statement(node->stmt);
+      break;
+    }
+    case NodeType::PUSH: {
+      PushNode *node = reinterpret_cast<PushNode*>(stmt);
+      on_expression(node->expr);
+      if (node->to->arguments) {
+        for (ExpressionBase*& arg : *node->to->arguments) {
+          on_expression(arg);
+        }
+      }
+      break;
+    }
+    case NodeType::FORALL: {
+      ForallNode *node = reinterpret_cast<ForallNode*>(stmt);
+      on_expression(node->in_expr);
+      on_statement(node->statement);
+      break;
+    }
+    case NodeType::ITERATE:
+      on_statement(reinterpret_cast<UnaryNode*>(stmt)->child_);
+      break;
+    case NodeType::CASE: {
+      CaseNode *node = reinterpret_cast<CaseNode*>(stmt);
+      on_expression(node->expr);
+      for (auto& pair : node->case_list) {
+        if (pair.first) {
+          // labels are only replaced by bindings, which are atoms as well
+          ExpressionBase *label = pair.first;
+          on_expression(label);
+          pair.first = reinterpret_cast<AtomNode*>(label);
+        }
+        on_statement(pair.second);
+      }
+      break;
+    }
+    case NodeType::DIEDIE: {
+      DiedieNode *node = reinterpret_cast<DiedieNode*>(stmt);
+      if (node->msg) {
+        on_expression(node->msg);
+      }
+      break;
+    }
+    case NodeType::POP:
+    case NodeType::SKIP:
+    case NodeType::IMPOSSIBLE:
+      break;
+    default:
+      FAILURE();
+  }
+}
+
+// calls on_expression for every operand slot of expr
+template<class E>
+void for_each_operand(ExpressionBase *expr, E on_expression) {
+  switch (expr->node_type_) {
+    case NodeType::EXPRESSION:
+    case NodeType::INT_EXPRESSION:
+    case NodeType::BOOLEAN_EXPRESSION: {
+      Expression *e = reinterpret_cast<Expression*>(expr);
+      on_expression(e->left_);
+      if (e->right_) {
+        on_expression(e->right_);
+      }
+      break;
+    }
+    case NodeType::FUNCTION_ATOM:
+    case NodeType::FUNCTION_ATOM_SUBRANGE:
+    case NodeType::BUILTIN_ATOM: {
+      BaseFunctionAtom *atom = reinterpret_cast<BaseFunctionAtom*>(expr);
+      if (atom->arguments) {
+        for (ExpressionBase*& arg : *atom->arguments) {
+          on_expression(arg);
+        }
+      }
+      break;
+    }
+    case NodeType::LIST_ATOM: {
+      ListAtom *list = reinterpret_cast<ListAtom*>(expr);
+      if (list->expr_list) {
+        for (ExpressionBase*& e : *list->expr_list) {
+          on_expression(e);
+        }
+      }
+      break;
+    }
+    case NodeType::NUMBER_RANGE_ATOM: {
+      NumberRangeAtom *range = reinterpret_cast<NumberRangeAtom*>(expr);
+      on_expression(range->start);
+      on_expression(range->end);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+#endif
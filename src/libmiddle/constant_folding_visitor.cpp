@@ -0,0 +1,364 @@
+#include "libmiddle/constant_folding_visitor.h"
+
+#include "libinterpreter/operators.h"
+#include "libinterpreter/bigint.h"
+
+static bool is_constant(const AstNode *node) {
+  switch (node->node_type_) {
+    case NodeType::INT_ATOM:
+    case NodeType::FLOAT_ATOM:
+    case NodeType::BOOLEAN_ATOM:
+    case NodeType::UNDEF_ATOM:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static value_t constant_value(const AtomNode *atom) {
+  switch (atom->node_type_) {
+    case NodeType::INT_ATOM:
+      return bigint::from_int(reinterpret_cast<const IntAtom*>(atom)->val_);
+    case NodeType::FLOAT_ATOM:
+      return value_t(reinterpret_cast<const FloatAtom*>(atom)->val_);
+    case NodeType::BOOLEAN_ATOM:
+      return value_t(reinterpret_cast<const BooleanAtom*>(atom)->value);
+    case NodeType::UNDEF_ATOM:
+      return value_t();
+    default: FAILURE();
+  }
+}
+
+// returns nullptr for values that cannot be represented by a constant atom
+static AtomNode *create_atom(yy::location& loc, const value_t& val, TypeType type) {
+  switch (val.type) {
+    case TypeType::INT:
+      // big integers only live until the end of the step
+      if (bigint::is_boxed(val.value.integer)) {
+        return nullptr;
+      }
+      return new IntAtom(loc, val.value.integer);
+    case TypeType::FLOAT:
+      return new FloatAtom(loc, val.value.float_);
+    case TypeType::BOOLEAN:
+      return new BooleanAtom(loc, val.value.boolean);
+    case TypeType::UNDEF: {
+      UndefAtom *atom = new UndefAtom(loc);
+      atom->type_ = Type(type);
+      return atom;
+    }
+    default:
+      return nullptr;
+  }
+}
+
+// replaces the node in slot with atom, if atom is a folded constant
+template<class N>
+static void install(N*& slot, AtomNode *atom) {
+  if (atom != nullptr && atom != slot) {
+    delete slot;
+    slot = atom;
+  }
+}
+
+ConstantFoldingVisitor::ConstantFoldingVisitor() : num_folded(0) {}
+
+AtomNode *ConstantFoldingVisitor::read_function(FunctionAtom *atom, AtomNode* arguments[],
+                                                uint16_t num_arguments) {
+  Function *func = atom->symbol;
+  // the value of symbolic functions is only known at runtime, keys of
+  // functions with more than one argument are tuples
+  if (func->is_written || func->is_symbolic || func->intitializers_ == nullptr ||
+      num_arguments > 1) {
+    return nullptr;
+  }
+  const TypeType type = func->return_type_->t;
+  if (type != TypeType::INT && type != TypeType::FLOAT && type != TypeType::BOOLEAN) {
+    return nullptr;
+  }
+  for (uint16_t i = 0; i < num_arguments; i++) {
+    if (arguments[i] == nullptr) {
+      return nullptr;
+    }
+  }
+
+  const ExpressionBase *value = nullptr;
+  for (const auto& init : *func->intitializers_) {
+    if (!is_constant(init.second) || (init.first == nullptr) != (num_arguments == 0)) {
+      return nullptr;
+    }
+    if (num_arguments == 1) {
+      if (!is_constant(init.first)) {
+        return nullptr;
+      }
+      if (!(constant_value(reinterpret_cast<AtomNode*>(init.first)) ==
+            constant_value(arguments[0]))) {
+        continue;
+      }
+    }
+    if (value != nullptr) {
+      return nullptr;
+    }
+    value = init.second;
+  }
+
+  num_folded += 1;
+  // functions are undef for all arguments without initializer
+  if (value == nullptr) {
+    return create_atom(atom->location, value_t(), type);
+  }
+  return create_atom(atom->location, constant_value(reinterpret_cast<const AtomNode*>(value)),
+                     type);
+}
+
+void ConstantFoldingVisitor::install_arguments(std::vector<ExpressionBase*> *slots,
+                                               AtomNode* arguments[],
+                                               uint16_t num_arguments) {
+  for (uint16_t i = 0; i < num_arguments; i++) {
+    install(slots->at(i), arguments[i]);
+  }
+}
+
+void ConstantFoldingVisitor::visit_function_def(FunctionDefNode *def,
+    const std::vector<std::pair<AtomNode*, AtomNode*>>& initializers) {
+  for (size_t i = 0; i < initializers.size(); i++) {
+    std::pair<ExpressionBase*, ExpressionBase*>& init = def->sym->intitializers_->at(i);
+    // the walker passes a temporary undef atom for initializers without key
+    if (init.first != nullptr) {
+      install(init.first, initializers[i].first);
+    }
+    install(init.second, initializers[i].second);
+  }
+}
+
+void ConstantFoldingVisitor::visit_derived_def(FunctionDefNode *def, AtomNode *expr) {
+  install(def->sym->derived, expr);
+}
+
+void ConstantFoldingVisitor::visit_ifthenelse(IfThenElseNode *node, AtomNode *cond) {
+  install(node->condition_, cond);
+}
+
+void ConstantFoldingVisitor::visit_assert(UnaryNode *assert, AtomNode *val) {
+  install(assert->child_, val);
+}
+
+void ConstantFoldingVisitor::visit_assure(UnaryNode *assure, AtomNode *val) {
+  install(assure->child_, val);
+}
+
+AtomNode *ConstantFoldingVisitor::visit_update(UpdateNode *update, AtomNode*, AtomNode *expr) {
+  install(update->expr_, expr);
+  return nullptr;
+}
+
+AtomNode *ConstantFoldingVisitor::visit_update_subrange(UpdateNode *update, AtomNode*,
+                                                        AtomNode *expr) {
+  install(update->expr_, expr);
+  return nullptr;
+}
+
+AtomNode *ConstantFoldingVisitor::visit_update_dumps(UpdateNode *update, AtomNode*,
+                                                     AtomNode *expr) {
+  install(update->expr_, expr);
+  return nullptr;
+}
+
+AtomNode *ConstantFoldingVisitor::visit_call(CallNode *call, std::vector<AtomNode*>& arguments) {
+  for (size_t i = 0; i < arguments.size(); i++) {
+    install(call->arguments->at(i), arguments[i]);
+  }
+  return nullptr;
+}
+
+AtomNode *ConstantFoldingVisitor::visit_print(PrintNode *node, std::vector<AtomNode*>& arguments) {
+  for (size_t i = 0; i < arguments.size(); i++) {
+    install(node->atoms[i], arguments[i]);
+  }
+  return nullptr;
+}
+
+void ConstantFoldingVisitor::visit_diedie(DiedieNode *node, AtomNode* const& msg) {
+  if (node->msg) {
+    install(node->msg, msg);
+  }
+}
+
+void ConstantFoldingVisitor::visit_let(LetNode *node, AtomNode *expr) {
+  install(node->expr, expr);
+}
+
+void ConstantFoldingVisitor::visit_push(PushNode *node, AtomNode *expr, AtomNode*) {
+  install(node->expr, expr);
+}
+
+void ConstantFoldingVisitor::visit_case(CaseNode *node, AtomNode* const expr,
+                                        const std::vector<AtomNode*>& labels) {
+  install(node->expr, expr);
+
+  // labels only contains results for labels other than default
+  size_t i = 0;
+  for (auto& pair : node->case_list) {
+    if (pair.first) {
+      install(pair.first, labels[i]);
+      i += 1;
+    }
+  }
+}
+
+AtomNode *ConstantFoldingVisitor::visit_expression(Expression *expr, AtomNode *lhs,
+                                                   AtomNode *rhs) {
+  install(expr->left_, lhs);
+  install(expr->right_, rhs);
+  if (lhs == nullptr) {
+    return nullptr;
+  }
+
+  const value_t left = constant_value(lhs);
+  if ((expr->op == ExpressionOperation::AND || expr->op == ExpressionOperation::OR) &&
+      operators::short_circuits(expr->op, left)) {
+    num_folded += 1;
+    return create_atom(expr->location, left, expr->type_.t);
+  }
+  if (rhs == nullptr || expr->op == ExpressionOperation::RAT_DIV) {
+    return nullptr;
+  }
+
+  const value_t right = constant_value(rhs);
+  // keep the division, so that it fails at runtime
+  if ((expr->op == ExpressionOperation::DIV || expr->op == ExpressionOperation::MOD) &&
+      right.type == TypeType::INT && (right.value.integer == 0 || right.value.integer == -1)) {
+    return nullptr;
+  }
+
+  AtomNode *result = create_atom(expr->location,
+                                 operators::dispatch<ConcreteMode>(expr->op, left, right),
+                                 expr->type_.t);
+  if (result) {
+    num_folded += 1;
+  }
+  return result;
+}
+
+AtomNode *ConstantFoldingVisitor::visit_expression_single(Expression *expr, AtomNode *val) {
+  install(expr->left_, val);
+  if (val == nullptr) {
+    return nullptr;
+  }
+
+  const value_t v = constant_value(val);
+  AtomNode *result = create_atom(expr->location,
+                                 operators::dispatch<ConcreteMode>(expr->op, v, v),
+                                 expr->type_.t);
+  if (result) {
+    num_folded += 1;
+  }
+  return result;
+}
+
+AtomNode *ConstantFoldingVisitor::visit_function_atom(FunctionAtom *atom, AtomNode* arguments[],
+                                                      uint16_t num_arguments) {
+  install_arguments(atom->arguments, arguments, num_arguments);
+  if (atom->symbol_type == FunctionAtom::SymbolType::FUNCTION) {
+    return read_function(atom, arguments, num_arguments);
+  }
+  return nullptr;
+}
+
+AtomNode *ConstantFoldingVisitor::visit_function_atom_subrange(FunctionAtom *atom,
+                                                               AtomNode* arguments[],
+                                                               uint16_t num_arguments) {
+  // reads must still check the arguments against the subranges
+  install_arguments(atom->arguments, arguments, num_arguments);
+  return nullptr;
+}
+
+AtomNode *ConstantFoldingVisitor::visit_builtin_atom(BuiltinAtom *atom, AtomNode* arguments[],
+                                                     uint16_t num_arguments) {
+  install_arguments(atom->arguments, arguments, num_arguments);
+  return nullptr;
+}
+
+void ConstantFoldingVisitor::visit_derived_function_atom_pre(FunctionAtom *atom,
+                                                             AtomNode* arguments[],
+                                                             uint16_t num_arguments) {
+  install_arguments(atom->arguments, arguments, num_arguments);
+}
+
+AtomNode *ConstantFoldingVisitor::visit_derived_function_atom(FunctionAtom *atom,
+                                                              AtomNode *expr) {
+  install(atom->symbol->derived, expr);
+  if (expr == nullptr) {
+    return nullptr;
+  }
+  if (atom->arguments) {
+    for (ExpressionBase *arg : *atom->arguments) {
+      if (!is_constant(arg)) {
+        return nullptr;
+      }
+    }
+  }
+  num_folded += 1;
+  return create_atom(atom->location, constant_value(expr), atom->type_.t);
+}
+
+AtomNode *ConstantFoldingVisitor::visit_list_atom(ListAtom *atom, std::vector<AtomNode*>& vals) {
+  for (size_t i = 0; i < vals.size(); i++) {
+    install(atom->expr_list->at(i), vals[i]);
+  }
+  return nullptr;
+}
+
+AtomNode *ConstantFoldingVisitor::visit_number_range_atom(NumberRangeAtom *atom,
+                                                          AtomNode *start, AtomNode *end) {
+  install(atom->start, start);
+  install(atom->end, end);
+  return nullptr;
+}
+
+template <>
+void AstWalker<ConstantFoldingVisitor, AtomNode*>::walk_body_elements(AstListNode *body_elements) {
+  // initializers are folded first, so that rules and derived functions can
+  // use the values of functions that are defined after them
+  for (AstNode *e : body_elements->nodes) {
+    if (e->node_type_ == NodeType::FUNCTION &&
+        reinterpret_cast<FunctionDefNode*>(e)->sym->type == Symbol::SymbolType::FUNCTION) {
+      walk_function_def(reinterpret_cast<FunctionDefNode*>(e));
+    }
+  }
+
+  for (AstNode *e : body_elements->nodes) {
+    if (e->node_type_ == NodeType::FUNCTION &&
+        reinterpret_cast<FunctionDefNode*>(e)->sym->type == Symbol::SymbolType::DERIVED) {
+      walk_function_def(reinterpret_cast<FunctionDefNode*>(e));
+    } else if (e->node_type_ == NodeType::RULE) {
+      walk_rule(reinterpret_cast<RuleNode*>(e));
+    }
+  }
+  visitor.visit_body_elements(body_elements);
+}
+
+template <>
+void AstWalker<ConstantFoldingVisitor, AtomNode*>::walk_call(CallNode *call) {
+  // every rule is walked once as part of the specification, following the
+  // call could lead to an endless recursion
+  if (call->ruleref != nullptr) {
+    walk_expression_base(call->ruleref);
+  }
+  std::vector<AtomNode*> argument_results;
+  if (call->arguments != nullptr) {
+    for (ExpressionBase *e: *call->arguments) {
+      argument_results.push_back(walk_expression_base(e));
+    }
+  }
+  visitor.visit_call(call, argument_results);
+}
+
+template <>
+void AstWalker<ConstantFoldingVisitor, AtomNode*>::walk_forall(ForallNode *node) {
+  // constant Int bounds are folded like every other expression
+  install(node->in_expr, walk_expression_base(node->in_expr));
+  visitor.visit_forall_pre(node);
+  walk_statement(node->statement);
+  visitor.visit_forall_post(node);
+}
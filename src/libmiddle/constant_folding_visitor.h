@@ -0,0 +1,73 @@
+#ifndef CASMI_LIBMIDDLE_CONSTANT_FOLDING_VISITOR
+#define CASMI_LIBMIDDLE_CONSTANT_FOLDING_VISITOR
+
+#include <vector>
+
+#include "libsyntax/visitor.h"
+
+// Folds expressions over Int, Float and Boolean constants (and undef) into
+// atoms after typechecking. Reads of functions that are never written by a
+// rule are replaced by the value of their initializer if all arguments are
+// constant, this covers `static` functions as well.
+//
+// Every visit method returns the constant atom of the visited expression or
+// nullptr. Atoms created for folded expressions are installed into the slot
+// of the parent node by the parent's visit method, the replaced subtree is
+// deleted.
+class ConstantFoldingVisitor: public BaseVisitor<AtomNode*> {
+  private:
+    AtomNode *read_function(FunctionAtom *atom, AtomNode* arguments[],
+                            uint16_t num_arguments);
+    void install_arguments(std::vector<ExpressionBase*> *slots, AtomNode* arguments[],
+                           uint16_t num_arguments);
+
+  public:
+    size_t num_folded;
+
+    ConstantFoldingVisitor();
+
+    void visit_function_def(FunctionDefNode *def,
+                            const std::vector<std::pair<AtomNode*, AtomNode*>>& initializers);
+    void visit_derived_def(FunctionDefNode *def, AtomNode *expr);
+    void visit_ifthenelse(IfThenElseNode *node, AtomNode *cond);
+    void visit_assert(UnaryNode *assert, AtomNode *val);
+    void visit_assure(UnaryNode *assure, AtomNode *val);
+    AtomNode *visit_update(UpdateNode *update, AtomNode*, AtomNode *expr);
+    AtomNode *visit_update_subrange(UpdateNode *update, AtomNode*, AtomNode *expr);
+    AtomNode *visit_update_dumps(UpdateNode *update, AtomNode*, AtomNode *expr);
+    AtomNode *visit_call(CallNode *call, std::vector<AtomNode*>& arguments);
+    AtomNode *visit_print(PrintNode *node, std::vector<AtomNode*>& arguments);
+    void visit_diedie(DiedieNode *node, AtomNode* const& msg);
+    void visit_let(LetNode *node, AtomNode *expr);
+    void visit_push(PushNode *node, AtomNode *expr, AtomNode*);
+    void visit_case(CaseNode *node, AtomNode* const expr, const std::vector<AtomNode*>& labels);
+
+    AtomNode *visit_expression(Expression *expr, AtomNode *lhs, AtomNode *rhs);
+    AtomNode *visit_expression_single(Expression *expr, AtomNode *val);
+    AtomNode *visit_int_atom(IntAtom *atom) { return atom; }
+    AtomNode *visit_float_atom(FloatAtom *atom) { return atom; }
+    AtomNode *visit_undef_atom(UndefAtom *atom) { return atom; }
+    AtomNode *visit_boolean_atom(BooleanAtom *atom) { return atom; }
+    AtomNode *visit_function_atom(FunctionAtom *atom, AtomNode* arguments[],
+                                  uint16_t num_arguments);
+    AtomNode *visit_function_atom_subrange(FunctionAtom *atom, AtomNode* arguments[],
+                                           uint16_t num_arguments);
+    AtomNode *visit_builtin_atom(BuiltinAtom *atom, AtomNode* arguments[],
+                                 uint16_t num_arguments);
+    void visit_derived_function_atom_pre(FunctionAtom *atom, AtomNode* arguments[],
+                                         uint16_t num_arguments);
+    AtomNode *visit_derived_function_atom(FunctionAtom *atom, AtomNode *expr);
+    AtomNode *visit_list_atom(ListAtom *atom, std::vector<AtomNode*>& vals);
+    AtomNode *visit_number_range_atom(NumberRangeAtom *atom, AtomNode *start, AtomNode *end);
+};
+
+template <>
+void AstWalker<ConstantFoldingVisitor, AtomNode*>::walk_body_elements(AstListNode *body_elements);
+
+template <>
+void AstWalker<ConstantFoldingVisitor, AtomNode*>::walk_call(CallNode *call);
+
+template <>
+void AstWalker<ConstantFoldingVisitor, AtomNode*>::walk_forall(ForallNode *node);
+
+#endif
@@ -0,0 +1,318 @@
+#include "macros.h"
+
+#include "libmiddle/ast_slots.h"
+#include "libmiddle/invariant_hoisting.h"
+#include "libmiddle/read_numbering.h"
+
+static bool has_pop(AstNode *stmt) {
+  if (stmt->node_type_ == NodeType::POP) {
+    return true;
+  }
+  bool found = false;
+  for_each_slot(stmt, [&](AstNode*& s) { found = found || has_pop(s); },
+                [](ExpressionBase*&) {});
+  return found;
+}
+
+static void shift_expression(ExpressionBase *expr, size_t from, size_t count) {
+  if (expr->node_type_ == NodeType::FUNCTION_ATOM) {
+    FunctionAtom *atom = reinterpret_cast<FunctionAtom*>(expr);
+    if (atom->symbol_type == FunctionAtom::SymbolType::PARAMETER && atom->offset >= from) {
+      atom->offset += count;
+    }
+  }
+  for_each_operand(expr, [&](ExpressionBase*& e) { shift_expression(e, from, count); });
+}
+
+// moves the bindings at or above offset from up by count slots
+static void shift_statement(AstNode *stmt, size_t from, size_t count) {
+  if (stmt->node_type_ == NodeType::LET) {
+    LetNode *node = reinterpret_cast<LetNode*>(stmt);
+    if (node->offset >= from) {
+      node->offset += count;
+    }
+  } else if (stmt->node_type_ == NodeType::FORALL) {
+    ForallNode *node = reinterpret_cast<ForallNode*>(stmt);
+    if (node->offset >= from) {
+      node->offset += count;
+    }
+  }
+  for_each_slot(stmt, [&](AstNode*& s) { shift_statement(s, from, count); },
+                [&](ExpressionBase*& e) { shift_expression(e, from, count); });
+}
+
+// replaces the hoisted expressions by their bindings
+static void replace_expression(ExpressionBase*& slot,
+                               const std::unordered_map<ExpressionBase*, ExpressionBase*>& bindings) {
+  auto iter = bindings.find(slot);
+  if (iter != bindings.end()) {
+    slot = iter->second;
+    return;
+  }
+  for_each_operand(slot, [&](ExpressionBase*& e) { replace_expression(e, bindings); });
+}
+
+static void replace_statement(AstNode *stmt,
+                              const std::unordered_map<ExpressionBase*, ExpressionBase*>& bindings) {
+  for_each_slot(stmt, [&](AstNode*& s) { replace_statement(s, bindings); },
+                [&](ExpressionBase*& e) { replace_expression(e, bindings); });
+}
+
+// the remaining operations can not fail, rational arithmetic can overflow
+static bool can_fail(Expression *expr) {
+  switch (expr->op) {
+    case ExpressionOperation::DIV:
+    case ExpressionOperation::MOD:
+    case ExpressionOperation::RAT_DIV:
+      return true;
+    default:
+      return expr->left_->type_ == TypeType::RATIONAL ||
+             (expr->right_ && expr->right_->type_ == TypeType::RATIONAL);
+  }
+}
+
+InvariantHoisting::InvariantHoisting() : writes_(), loop_offset_(0),
+    derived_invariant_(), num_hoisted(0) {}
+
+void InvariantHoisting::hoist_specification(AstNode *specification) {
+  AstListNode *body_elements = reinterpret_cast<AstListNode*>(specification);
+  for (AstNode *e : body_elements->nodes) {
+    // reads of symbolic functions create symbols
+    if (e->node_type_ == NodeType::FUNCTION &&
+        reinterpret_cast<FunctionDefNode*>(e)->sym->is_symbolic) {
+      return;
+    }
+  }
+  for (AstNode *e : body_elements->nodes) {
+    if (e->node_type_ == NodeType::RULE) {
+      hoist_rule(reinterpret_cast<RuleNode*>(e));
+    }
+  }
+}
+
+void InvariantHoisting::hoist_rule(RuleNode *rule) {
+  // the bindings of pop live until the end of the rule
+  if (has_pop(rule->child_)) {
+    return;
+  }
+  hoist_statement(rule->child_, rule->arguments.size());
+}
+
+void InvariantHoisting::hoist_statement(AstNode*& slot, size_t num_bindings) {
+  AstNode *stmt = slot;
+  size_t inner_bindings = num_bindings;
+  if (stmt->node_type_ == NodeType::LET) {
+    inner_bindings = reinterpret_cast<LetNode*>(stmt)->offset + 1;
+  } else if (stmt->node_type_ == NodeType::FORALL) {
+    inner_bindings = reinterpret_cast<ForallNode*>(stmt)->offset + 1;
+  }
+  // inner loops first, their hoisted values may be invariant in this loop
+  for_each_slot(stmt, [&](AstNode*& s) { hoist_statement(s, inner_bindings); },
+                [](ExpressionBase*&) {});
+
+  if (stmt->node_type_ == NodeType::FORALL || stmt->node_type_ == NodeType::ITERATE) {
+    hoist_loop(slot, num_bindings);
+  }
+}
+
+void InvariantHoisting::hoist_loop(AstNode*& slot, size_t num_bindings) {
+  writes_.clear();
+  derived_invariant_.clear();
+  loop_offset_ = num_bindings;
+  std::unordered_set<const RuleNode*> rules;
+  if (!collect_writes(slot, rules)) {
+    return;
+  }
+
+  AstNode *body = (slot->node_type_ == NodeType::FORALL)
+      ? reinterpret_cast<ForallNode*>(slot)->statement
+      : reinterpret_cast<UnaryNode*>(slot)->child_;
+  std::vector<ExpressionBase*> invariants;
+  collect_statement(body, invariants);
+  if (invariants.empty()) {
+    return;
+  }
+
+  // equal expressions share a binding
+  std::vector<ExpressionBase*> values;
+  std::vector<size_t> value_index;
+  std::unordered_map<std::string, size_t> keys;
+  for (ExpressionBase *invariant : invariants) {
+    std::string key;
+    if (append_expression_key(invariant, key)) {
+      auto iter = keys.find(key);
+      if (iter != keys.end()) {
+        value_index.push_back(iter->second);
+        continue;
+      }
+      keys.emplace(key, values.size());
+    }
+    value_index.push_back(values.size());
+    values.push_back(invariant);
+  }
+
+  shift_statement(slot, num_bindings, values.size());
+
+  std::unordered_map<ExpressionBase*, ExpressionBase*> bindings;
+  for (size_t i = 0; i < invariants.size(); i++) {
+    ExpressionBase *expr = invariants[i];
+    FunctionAtom *binding = new FunctionAtom(expr->location, "%invariant");
+    binding->symbol_type = FunctionAtom::SymbolType::PARAMETER;
+    binding->offset = num_bindings + value_index[i];
+    binding->type_ = Type(expr->type_);
+    bindings.emplace(expr, binding);
+  }
+  replace_statement(body, bindings);
+  for (size_t i = 0; i < invariants.size(); i++) {
+    if (invariants[i] != values[value_index[i]]) {
+      delete invariants[i];
+    }
+  }
+
+  for (size_t i = values.size(); i > 0; i--) {
+    ExpressionBase *expr = values[i - 1];
+    LetNode *let = new LetNode(slot->location, Type(expr->type_), "%invariant", expr, slot);
+    let->offset = num_bindings + i - 1;
+    slot = let;
+  }
+  num_hoisted += values.size();
+}
+
+bool InvariantHoisting::collect_writes(AstNode *stmt,
+                                       std::unordered_set<const RuleNode*>& rules) {
+  switch (stmt->node_type_) {
+    case NodeType::UPDATE:
+    case NodeType::UPDATE_SUBRANGE:
+    case NodeType::UPDATE_DUMPS:
+      writes_.insert(reinterpret_cast<UpdateNode*>(stmt)->func->symbol);
+      return true;
+    case NodeType::PUSH:
+      writes_.insert(reinterpret_cast<PushNode*>(stmt)->to->symbol);
+      return true;
+    case NodeType::POP: {
+      PopNode *node = reinterpret_cast<PopNode*>(stmt);
+      writes_.insert(node->from->symbol);
+      if (node->to->symbol_type == FunctionAtom::SymbolType::FUNCTION) {
+        writes_.insert(node->to->symbol);
+      }
+      return true;
+    }
+    case NodeType::CALL: {
+      CallNode *call = reinterpret_cast<CallNode*>(stmt);
+      // the called rule is only known at runtime
+      if (call->ruleref) {
+        return false;
+      }
+      if (rules.insert(call->rule).second) {
+        return collect_writes(call->rule->child_, rules);
+      }
+      return true;
+    }
+    default: {
+      bool known = true;
+      for_each_slot(stmt, [&](AstNode*& s) { known = known && collect_writes(s, rules); },
+                    [](ExpressionBase*&) {});
+      return known;
+    }
+  }
+}
+
+void InvariantHoisting::collect_statement(AstNode *stmt,
+                                          std::vector<ExpressionBase*>& invariants) {
+  for_each_slot(stmt, [&](AstNode*& s) { collect_statement(s, invariants); },
+                [&](ExpressionBase*& e) { collect_expression(e, invariants); });
+}
+
+void InvariantHoisting::collect_expression(ExpressionBase *expr,
+                                           std::vector<ExpressionBase*>& invariants) {
+  bool worth_hoisting = false;
+  switch (expr->node_type_) {
+    case NodeType::EXPRESSION:
+    case NodeType::INT_EXPRESSION:
+    case NodeType::BOOLEAN_EXPRESSION:
+      worth_hoisting = true;
+      break;
+    case NodeType::FUNCTION_ATOM: {
+      // bindings and enum constants are as cheap as the binding of the let
+      const FunctionAtom::SymbolType type = reinterpret_cast<FunctionAtom*>(expr)->symbol_type;
+      worth_hoisting = type == FunctionAtom::SymbolType::FUNCTION ||
+                       type == FunctionAtom::SymbolType::DERIVED;
+      break;
+    }
+    default:
+      break;
+  }
+
+  if (worth_hoisting && expr->type_.is_complete() && is_invariant(expr, false)) {
+    invariants.push_back(expr);
+    return;
+  }
+  for_each_operand(expr, [&](ExpressionBase*& e) { collect_expression(e, invariants); });
+}
+
+bool InvariantHoisting::is_invariant(ExpressionBase *expr, bool in_derived) {
+  switch (expr->node_type_) {
+    case NodeType::INT_ATOM:
+    case NodeType::FLOAT_ATOM:
+    case NodeType::RATIONAL_ATOM:
+    case NodeType::BOOLEAN_ATOM:
+    case NodeType::UNDEF_ATOM:
+    case NodeType::STRING_ATOM:
+    case NodeType::RULE_ATOM:
+      return true;
+    case NodeType::FUNCTION_ATOM: {
+      FunctionAtom *atom = reinterpret_cast<FunctionAtom*>(expr);
+      switch (atom->symbol_type) {
+        case FunctionAtom::SymbolType::PARAMETER:
+          // the bindings of derived functions are their arguments
+          return in_derived || atom->offset < loop_offset_;
+        case FunctionAtom::SymbolType::ENUM:
+          return true;
+        case FunctionAtom::SymbolType::FUNCTION:
+          if (atom->symbol->is_symbolic || writes_.count(atom->symbol) > 0) {
+            return false;
+          }
+          break;
+        case FunctionAtom::SymbolType::DERIVED:
+          if (!is_invariant_derived(atom->symbol)) {
+            return false;
+          }
+          break;
+        default:
+          return false;
+      }
+      break;
+    }
+    case NodeType::EXPRESSION:
+    case NodeType::INT_EXPRESSION:
+    case NodeType::BOOLEAN_EXPRESSION:
+      if (can_fail(reinterpret_cast<Expression*>(expr))) {
+        return false;
+      }
+      break;
+    case NodeType::LIST_ATOM:
+    case NodeType::NUMBER_RANGE_ATOM:
+      break;
+    default:
+      // builtins and reads with subrange checks can fail
+      return false;
+  }
+
+  bool invariant = true;
+  for_each_operand(expr, [&](ExpressionBase*& e) {
+    invariant = invariant && is_invariant(e, in_derived);
+  });
+  return invariant;
+}
+
+bool InvariantHoisting::is_invariant_derived(const Function *derived) {
+  auto iter = derived_invariant_.find(derived);
+  if (iter != derived_invariant_.end()) {
+    return iter->second;
+  }
+  // recursive calls are not hoisted
+  derived_invariant_[derived] = false;
+  const bool invariant = is_invariant(derived->derived, true);
+  derived_invariant_[derived] = invariant;
+  return invariant;
+}
@@ -0,0 +1,50 @@
+#ifndef CASMI_LIBMIDDLE_INVARIANT_HOISTING
+#define CASMI_LIBMIDDLE_INVARIANT_HOISTING
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "libsyntax/ast.h"
+
+// Hoists loop invariant expressions out of the bodies of forall and iterate.
+// An expression is invariant if it neither uses a binding of the loop nor
+// reads a function written by the loop, including the rules called from it.
+// The iterations of iterate see the updates of the previous ones, functions
+// written anywhere in the body are therefore never invariant.
+//
+// Every invariant expression is evaluated once by a let which encloses the
+// loop, the bindings of the loop move up by the number of hoisted values.
+// Only expressions which can not fail are hoisted, they may be evaluated
+// although the loop body would not have evaluated them. Specifications with
+// symbolic functions and rules with `pop` are left unchanged. Must only run
+// on a specification that typechecked without errors.
+class InvariantHoisting {
+  private:
+    // functions written by the loop being hoisted from
+    std::unordered_set<const Function*> writes_;
+    // first binding of the loop being hoisted from
+    size_t loop_offset_;
+    // derived functions which only read invariant functions, by loop
+    std::unordered_map<const Function*, bool> derived_invariant_;
+
+    void hoist_statement(AstNode*& slot, size_t num_bindings);
+    void hoist_loop(AstNode*& slot, size_t num_bindings);
+
+    bool collect_writes(AstNode *stmt, std::unordered_set<const RuleNode*>& rules);
+    void collect_statement(AstNode *stmt, std::vector<ExpressionBase*>& invariants);
+    void collect_expression(ExpressionBase *expr, std::vector<ExpressionBase*>& invariants);
+    bool is_invariant(ExpressionBase *expr, bool in_derived);
+    bool is_invariant_derived(const Function *derived);
+
+  public:
+    size_t num_hoisted;
+
+    InvariantHoisting();
+
+    void hoist_rule(RuleNode *rule);
+    void hoist_specification(AstNode *specification);
+};
+
+#endif
@@ -0,0 +1,30 @@
+#include "libmiddle/optimization_passes.h"
+
+#include "libmiddle/constant_folding_visitor.h"
+#include "libmiddle/specialization_visitor.h"
+#include "libmiddle/update_analysis.h"
+#include "libmiddle/invariant_hoisting.h"
+#include "libmiddle/read_numbering.h"
+
+void run_optimization_passes(AstNode *specification) {
+  ConstantFoldingVisitor folding_visitor;
+  AstWalker<ConstantFoldingVisitor, AtomNode*> folding_walker(folding_visitor);
+  folding_walker.walk_specification(specification);
+  DEBUG("folded "<<folding_visitor.num_folded<<" expressions");
+
+  SpecializationVisitor specialization_visitor;
+  AstWalker<SpecializationVisitor, bool> specialization_walker(specialization_visitor);
+  specialization_walker.walk_specification(specification);
+
+  UpdateAnalysis update_analysis;
+  update_analysis.analyze_specification(specification);
+  DEBUG("found "<<update_analysis.num_unchecked<<" blocks with unchecked updates");
+
+  InvariantHoisting invariant_hoisting;
+  invariant_hoisting.hoist_specification(specification);
+  DEBUG("hoisted "<<invariant_hoisting.num_hoisted<<" loop invariant expressions");
+
+  ReadNumbering read_numbering;
+  read_numbering.number_specification(specification);
+  DEBUG("reused "<<read_numbering.num_reused<<" reads");
+}
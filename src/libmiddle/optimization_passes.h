@@ -0,0 +1,14 @@
+#ifndef CASMI_LIBMIDDLE_OPTIMIZATION_PASSES
+#define CASMI_LIBMIDDLE_OPTIMIZATION_PASSES
+
+#include "libsyntax/ast.h"
+
+// Runs constant folding followed by expression specialization, the analysis
+// of update conflicts, the hoisting of loop invariant expressions and the
+// value numbering of function reads. Must only run on a specification that
+// typechecked without errors. casmi and the unroller runtime must run the
+// same passes, otherwise the unrolled code does not match the specification
+// it embeds.
+void run_optimization_passes(AstNode *specification);
+
+#endif
@@ -0,0 +1,380 @@
+#include <cstring>
+
+#include "macros.h"
+
+#include "libmiddle/read_numbering.h"
+
+// at most this many registers of a chunk hold numbered reads
+static const uint16_t MAX_READ_VALUES = 1024;
+
+bool append_expression_key(ExpressionBase *expr, std::string& key) {
+  switch (expr->node_type_) {
+    case NodeType::INT_ATOM:
+      key += "i" + std::to_string(reinterpret_cast<IntAtom*>(expr)->val_);
+      return true;
+    case NodeType::FLOAT_ATOM: {
+      uint64_t bits;
+      std::memcpy(&bits, &reinterpret_cast<FloatAtom*>(expr)->val_, sizeof(bits));
+      key += "f" + std::to_string(bits);
+      return true;
+    }
+    case NodeType::BOOLEAN_ATOM:
+      key += (reinterpret_cast<BooleanAtom*>(expr)->value) ? "true" : "false";
+      return true;
+    case NodeType::UNDEF_ATOM:
+      key += "undef";
+      return true;
+    case NodeType::STRING_ATOM: {
+      const std::string& string = reinterpret_cast<StringAtom*>(expr)->string;
+      key += "s" + std::to_string(string.size()) + ":" + string;
+      return true;
+    }
+    case NodeType::RULE_ATOM:
+      key += "@" + reinterpret_cast<RuleAtom*>(expr)->name;
+      return true;
+    case NodeType::FUNCTION_ATOM: {
+      FunctionAtom *atom = reinterpret_cast<FunctionAtom*>(expr);
+      switch (atom->symbol_type) {
+        case FunctionAtom::SymbolType::PARAMETER:
+          key += "$" + std::to_string(atom->offset);
+          return true;
+        case FunctionAtom::SymbolType::ENUM:
+          key += "#" + atom->name;
+          return true;
+        case FunctionAtom::SymbolType::FUNCTION:
+        case FunctionAtom::SymbolType::DERIVED:
+          break;
+        default:
+          return false;
+      }
+      break;
+    }
+    case NodeType::BUILTIN_ATOM:
+      // symbols and shared builtins are not deterministic
+      if (reinterpret_cast<BuiltinAtom*>(expr)->id >= BuiltinAtom::Id::SYMBOLIC) {
+        return false;
+      }
+      key += "!";
+      break;
+    case NodeType::EXPRESSION:
+    case NodeType::INT_EXPRESSION:
+    case NodeType::BOOLEAN_EXPRESSION: {
+      Expression *e = reinterpret_cast<Expression*>(expr);
+      key += "(" + operator_to_str(e->op) + " ";
+      if (!append_expression_key(e->left_, key)) {
+        return false;
+      }
+      if (e->right_) {
+        key += " ";
+        if (!append_expression_key(e->right_, key)) {
+          return false;
+        }
+      }
+      key += ")";
+      return true;
+    }
+    case NodeType::LIST_ATOM: {
+      ListAtom *list = reinterpret_cast<ListAtom*>(expr);
+      key += "[";
+      if (list->expr_list) {
+        for (ExpressionBase *e : *list->expr_list) {
+          if (!append_expression_key(e, key)) {
+            return false;
+          }
+          key += ",";
+        }
+      }
+      key += "]";
+      return true;
+    }
+    case NodeType::NUMBER_RANGE_ATOM: {
+      NumberRangeAtom *range = reinterpret_cast<NumberRangeAtom*>(expr);
+      key += "[";
+      if (!append_expression_key(range->start, key)) {
+        return false;
+      }
+      key += "..";
+      if (!append_expression_key(range->end, key)) {
+        return false;
+      }
+      key += "]";
+      return true;
+    }
+    default:
+      return false;
+  }
+
+  // reads, derived functions and builtins
+  BaseFunctionAtom *atom = reinterpret_cast<BaseFunctionAtom*>(expr);
+  key += atom->name + "(";
+  if (atom->arguments) {
+    for (ExpressionBase *arg : *atom->arguments) {
+      if (!append_expression_key(arg, key)) {
+        return false;
+      }
+      key += ",";
+    }
+  }
+  key += ")";
+  return true;
+}
+
+ReadNumbering::ReadNumbering() : available_(), groups_(), num_reused(0) {}
+
+void ReadNumbering::number_specification(AstNode *specification) {
+  for (AstNode *e : reinterpret_cast<AstListNode*>(specification)->nodes) {
+    if (e->node_type_ == NodeType::RULE) {
+      number_rule(reinterpret_cast<RuleNode*>(e));
+    } else if (e->node_type_ == NodeType::FUNCTION) {
+      Function *sym = reinterpret_cast<FunctionDefNode*>(e)->sym;
+      if (sym->type == Symbol::SymbolType::DERIVED) {
+        number_derived(sym);
+      }
+    }
+  }
+}
+
+void ReadNumbering::number_rule(RuleNode *rule) {
+  number_statement(rule->child_);
+  rule->num_read_values = assign();
+}
+
+void ReadNumbering::number_derived(Function *derived) {
+  number_expression(derived->derived);
+  derived->num_read_values = assign();
+}
+
+uint16_t ReadNumbering::assign() {
+  uint16_t num_values = 0;
+  for (group& g : groups_) {
+    uint16_t number = 0;
+    if (!g.reuses.empty() && num_values < MAX_READ_VALUES) {
+      num_values += 1;
+      number = num_values;
+      num_reused += g.reuses.size();
+    }
+    g.definition->value_number = number;
+    g.definition->reuses_value = false;
+    for (FunctionAtom *atom : g.reuses) {
+      atom->value_number = number;
+      atom->reuses_value = (number != 0);
+    }
+  }
+  available_.clear();
+  groups_.clear();
+  return num_values;
+}
+
+void ReadNumbering::intersect(const Available& snapshot) {
+  for (auto iter = available_.begin(); iter != available_.end();) {
+    // the read may have been killed and executed again in between
+    auto s = snapshot.find(iter->first);
+    if (s == snapshot.end() || s->second != iter->second) {
+      iter = available_.erase(iter);
+    } else {
+      iter++;
+    }
+  }
+}
+
+void ReadNumbering::number_statement(AstNode *stmt) {
+  switch (stmt->node_type_) {
+    case NodeType::PARBLOCK: {
+      AstListNode *stmts = reinterpret_cast<AstListNode*>(
+          reinterpret_cast<UnaryNode*>(stmt)->child_);
+      for (AstNode *s : stmts->nodes) {
+        number_statement(s);
+      }
+      break;
+    }
+    case NodeType::SEQBLOCK: {
+      // the updates of every statement are visible to the next one
+      AstListNode *stmts = reinterpret_cast<AstListNode*>(
+          reinterpret_cast<UnaryNode*>(stmt)->child_);
+      for (AstNode *s : stmts->nodes) {
+        number_statement(s);
+        available_.clear();
+      }
+      break;
+    }
+    case NodeType::UPDATE:
+    case NodeType::UPDATE_SUBRANGE:
+    case NodeType::UPDATE_DUMPS: {
+      UpdateNode *update = reinterpret_cast<UpdateNode*>(stmt);
+      number_expression(update->expr_);
+      number_arguments(update->func->arguments);
+      break;
+    }
+    case NodeType::ASSERT:
+    case NodeType::ASSURE:
+      number_expression(reinterpret_cast<ExpressionBase*>(
+          reinterpret_cast<UnaryNode*>(stmt)->child_));
+      break;
+    case NodeType::IFTHENELSE: {
+      IfThenElseNode *node = reinterpret_cast<IfThenElseNode*>(stmt);
+      number_expression(node->condition_);
+      const Available snapshot = available_;
+      number_statement(node->then_);
+      intersect(snapshot);
+      if (node->else_) {
+        number_statement(node->else_);
+        intersect(snapshot);
+      }
+      break;
+    }
+    case NodeType::CALL: {
+      CallNode *call = reinterpret_cast<CallNode*>(stmt);
+      if (call->ruleref) {
+        number_expression(call->ruleref);
+      }
+      number_arguments(call->arguments);
+      break;
+    }
+    case NodeType::PRINT:
+      number_arguments(&reinterpret_cast<PrintNode*>(stmt)->atoms);
+      break;
+    case NodeType::LET: {
+      // reads of the binding must not outlive it, the offset is reused
+      LetNode *node = reinterpret_cast<LetNode*>(stmt);
+      number_expression(node->expr);
+      const Available snapshot = available_;
+      number_statement(node->stmt);
+      intersect(snapshot);
+      break;
+    }
+    case NodeType::POP:
+      number_arguments(reinterpret_cast<PopNode*>(stmt)->from->arguments);
+      break;
+    case NodeType::PUSH: {
+      PushNode *node = reinterpret_cast<PushNode*>(stmt);
+      number_expression(node->expr);
+      number_arguments(node->to->arguments);
+      break;
+    }
+    case NodeType::FORALL: {
+      ForallNode *node = reinterpret_cast<ForallNode*>(stmt);
+      number_expression(node->in_expr);
+      const Available snapshot = available_;
+      number_statement(node->statement);
+      intersect(snapshot);
+      break;
+    }
+    case NodeType::ITERATE:
+      // the updates of an iteration are visible to the next one
+      available_.clear();
+      number_statement(reinterpret_cast<UnaryNode*>(stmt)->child_);
+      available_.clear();
+      break;
+    case NodeType::CASE: {
+      CaseNode *node = reinterpret_cast<CaseNode*>(stmt);
+      number_expression(node->expr);
+      const Available snapshot = available_;
+      if (!node->has_constant_labels()) {
+        // labels are compared until the first one matches
+        for (auto& pair : node->case_list) {
+          if (pair.first) {
+            number_expression(pair.first);
+            intersect(snapshot);
+          }
+        }
+      }
+      for (auto& pair : node->case_list) {
+        number_statement(pair.second);
+        intersect(snapshot);
+      }
+      break;
+    }
+    case NodeType::DIEDIE: {
+      DiedieNode *node = reinterpret_cast<DiedieNode*>(stmt);
+      if (node->msg) {
+        number_expression(node->msg);
+      }
+      break;
+    }
+    case NodeType::SKIP:
+    case NodeType::IMPOSSIBLE:
+      break;
+    default:
+      FAILURE();
+  }
+}
+
+void ReadNumbering::number_expression(ExpressionBase *expr) {
+  switch (expr->node_type_) {
+    case NodeType::EXPRESSION:
+    case NodeType::INT_EXPRESSION: {
+      Expression *e = reinterpret_cast<Expression*>(expr);
+      number_expression(e->left_);
+      if (e->right_) {
+        number_expression(e->right_);
+      }
+      break;
+    }
+    case NodeType::BOOLEAN_EXPRESSION: {
+      // the right operand is skipped if the left one decides the result
+      Expression *e = reinterpret_cast<Expression*>(expr);
+      number_expression(e->left_);
+      const Available snapshot = available_;
+      number_expression(e->right_);
+      intersect(snapshot);
+      break;
+    }
+    case NodeType::FUNCTION_ATOM: {
+      FunctionAtom *atom = reinterpret_cast<FunctionAtom*>(expr);
+      if (atom->symbol_type == FunctionAtom::SymbolType::FUNCTION) {
+        number_read(atom);
+      } else {
+        number_arguments(atom->arguments);
+      }
+      break;
+    }
+    case NodeType::FUNCTION_ATOM_SUBRANGE:
+    case NodeType::BUILTIN_ATOM:
+      number_arguments(reinterpret_cast<BaseFunctionAtom*>(expr)->arguments);
+      break;
+    case NodeType::LIST_ATOM: {
+      // the elements are evaluated from right to left
+      ListAtom *list = reinterpret_cast<ListAtom*>(expr);
+      if (list->expr_list) {
+        for (auto iter = list->expr_list->rbegin(); iter != list->expr_list->rend(); iter++) {
+          number_expression(*iter);
+        }
+      }
+      break;
+    }
+    case NodeType::NUMBER_RANGE_ATOM: {
+      NumberRangeAtom *range = reinterpret_cast<NumberRangeAtom*>(expr);
+      number_expression(range->start);
+      number_expression(range->end);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void ReadNumbering::number_arguments(const std::vector<ExpressionBase*> *args) {
+  if (args) {
+    for (ExpressionBase *arg : *args) {
+      number_expression(arg);
+    }
+  }
+}
+
+void ReadNumbering::number_read(FunctionAtom *atom) {
+  std::string key;
+  if (!append_expression_key(atom, key)) {
+    number_arguments(atom->arguments);
+    return;
+  }
+
+  auto iter = available_.find(key);
+  if (iter != available_.end()) {
+    // the arguments are not evaluated again
+    groups_[iter->second].reuses.push_back(atom);
+    return;
+  }
+  number_arguments(atom->arguments);
+  available_.emplace(key, groups_.size());
+  groups_.push_back({atom, {}});
+}
@@ -0,0 +1,60 @@
+#ifndef CASMI_LIBMIDDLE_READ_NUMBERING
+#define CASMI_LIBMIDDLE_READ_NUMBERING
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "libsyntax/ast.h"
+
+// Appends a key which is equal for expressions that evaluate to the same
+// value in the same state, returns false if there is no such key.
+bool append_expression_key(ExpressionBase *expr, std::string& key);
+
+// Value numbering of function reads in the bodies of rules and derived
+// functions. Updates of a parallel context are not visible to reads of the
+// same step, so a read of a function with syntactically identical arguments
+// yields the same value as an earlier read unless an update could have become
+// visible in between. Only sequential blocks and iterate make updates visible;
+// they end the lifetime of all earlier reads. Reads in conditionally executed
+// code (branches, the right operand of `and` and `or`, case labels, forall
+// and let bodies) are not available after it.
+//
+// Reads are visited in the evaluation order of the bytecode compiler, which
+// keeps the first read of a value number in a register and replaces the other
+// reads by moves. Must only run on a specification that typechecked without
+// errors.
+class ReadNumbering {
+  private:
+    struct group {
+      FunctionAtom *definition;
+      std::vector<FunctionAtom*> reuses;
+    };
+
+    // available reads by key, the value is the index into groups_
+    typedef std::unordered_map<std::string, size_t> Available;
+
+    Available available_;
+    std::vector<group> groups_;
+
+    void number_statement(AstNode *stmt);
+    void number_expression(ExpressionBase *expr);
+    void number_arguments(const std::vector<ExpressionBase*> *args);
+    void number_read(FunctionAtom *atom);
+
+    // keeps the reads which are in snapshot with the same definition
+    void intersect(const Available& snapshot);
+    // assigns the value numbers of the groups with reuses
+    uint16_t assign();
+
+  public:
+    size_t num_reused;
+
+    ReadNumbering();
+
+    void number_rule(RuleNode *rule);
+    void number_derived(Function *derived);
+    void number_specification(AstNode *specification);
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "libmiddle/specialization_visitor.h"
+
+SpecializationVisitor::SpecializationVisitor() : num_specialized(0) {}
+
+bool SpecializationVisitor::visit_expression(Expression *expr, bool, bool) {
+  if (expr->node_type_ != NodeType::EXPRESSION) {
+    return true;
+  }
+
+  switch (expr->op) {
+    case ExpressionOperation::ADD:
+    case ExpressionOperation::SUB:
+    case ExpressionOperation::MUL:
+    case ExpressionOperation::DIV:
+    case ExpressionOperation::MOD:
+    case ExpressionOperation::EQ:
+    case ExpressionOperation::NEQ:
+    case ExpressionOperation::LESSER:
+    case ExpressionOperation::GREATER:
+    case ExpressionOperation::LESSEREQ:
+    case ExpressionOperation::GREATEREQ:
+      if (expr->left_->type_.t == TypeType::INT &&
+          expr->right_->type_.t == TypeType::INT) {
+        expr->node_type_ = NodeType::INT_EXPRESSION;
+        num_specialized += 1;
+      }
+      break;
+
+    case ExpressionOperation::AND:
+    case ExpressionOperation::OR:
+      expr->node_type_ = NodeType::BOOLEAN_EXPRESSION;
+      num_specialized += 1;
+      break;
+
+    default: break;
+  }
+  return true;
+}
+
+template <>
+void AstWalker<SpecializationVisitor, bool>::walk_call(CallNode *call) {
+  // every rule is walked once as part of the specification, following the
+  // call could lead to an endless recursion
+  if (call->ruleref != nullptr) {
+    walk_expression_base(call->ruleref);
+  }
+  if (call->arguments != nullptr) {
+    for (ExpressionBase *e: *call->arguments) {
+      walk_expression_base(e);
+    }
+  }
+}
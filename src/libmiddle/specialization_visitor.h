@@ -0,0 +1,24 @@
+#ifndef CASMI_LIBMIDDLE_SPECIALIZATION_VISITOR
+#define CASMI_LIBMIDDLE_SPECIALIZATION_VISITOR
+
+#include "libsyntax/visitor.h"
+
+// Rewrites typed expressions to specialized node kinds after typechecking:
+//  - INT_EXPRESSION for arithmetic and comparisons with Int operands
+//  - BOOLEAN_EXPRESSION for `and` and `or`, which short-circuit when the
+//    left operand decides the result
+// Must only run on a specification that typechecked without errors.
+class SpecializationVisitor: public BaseVisitor<bool> {
+  public:
+    size_t num_specialized;
+
+    SpecializationVisitor();
+
+    bool visit_expression(Expression *expr, bool, bool);
+    bool visit_function_atom(FunctionAtom*, bool[], uint16_t) { return true; }
+};
+
+template <>
+void AstWalker<SpecializationVisitor, bool>::walk_call(CallNode *call);
+
+#endif
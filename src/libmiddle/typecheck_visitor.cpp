@@ -140,6 +140,9 @@ void TypecheckVisitor::visit_update(UpdateNode *update, Type*, Type*) {
   if (update->func->symbol && update->func->symbol->is_static) {
     driver_.error(update->location, "cannot update static function `"+update->func->name+"`");
   }
+  if (update->func->symbol) {
+    update->func->symbol->is_written = true;
+  }
 
   if (!update->func->type_.unify(&update->expr_->type_)) {
     driver_.error(update->location, "type `"+update->func->type_.get_most_general_type()->to_str()+"` of `"+
@@ -231,9 +234,9 @@ void TypecheckVisitor::visit_let(LetNode *node, Type*) {
   auto current_rule_binding_types = rule_binding_types.back();
   auto current_rule_binding_offsets = rule_binding_offsets.back();
 
+  node->offset = current_rule_binding_types->size();
   current_rule_binding_offsets->insert(
-      std::pair<std::string, size_t>(node->identifier,
-                                     current_rule_binding_types->size())
+      std::pair<std::string, size_t>(node->identifier, node->offset)
   );
   current_rule_binding_types->push_back(&node->type_);
 }
@@ -256,6 +259,7 @@ void TypecheckVisitor::visit_push(PushNode *node, Type *expr, Type *atom) {
         driver_.error(node->to->location, "cannot push into static function `"+
                                             node->to->symbol->name+"`");
     }
+    node->to->symbol->is_written = true;
     if (!expr->unify(atom->subtypes[0])) {
       driver_.error(node->expr->location, 
                     "cannot push "+expr->get_most_general_type()->to_str()
@@ -276,6 +280,7 @@ void TypecheckVisitor::visit_pop(PopNode *node) {
     if (node->from->symbol->is_static) {
         driver_.error(node->from->location, "cannot pop from static function `"+node->from->symbol->name+"`");
     }
+    node->from->symbol->is_written = true;
   }
 
 
@@ -284,6 +289,7 @@ void TypecheckVisitor::visit_pop(PopNode *node) {
     if (sym->is_static) {
       driver_.error(node->to->location, "cannot pop into static function `"+sym->name+"`");
     }
+    sym->is_written = true;
 
     if (node->to->arguments) {
       // TODO this should be doable!
@@ -632,6 +638,14 @@ Type* TypecheckVisitor::visit_list_atom(ListAtom *atom, std::vector<Type*> &vals
   return &atom->type_;
 }
 
+Type* TypecheckVisitor::visit_number_range_atom(NumberRangeAtom *atom, Type *start, Type *end) {
+  if (!start->unify(TypeType::INT) || !end->unify(TypeType::INT)) {
+    driver_.error(atom->location, "numbers in range expression must be Int but were "+
+                                  start->to_str()+" and "+end->to_str());
+  }
+  return &atom->type_;
+}
+
 template <>
 void AstWalker<TypecheckVisitor, Type*>::walk_forall(ForallNode *node) {
 
@@ -653,9 +667,9 @@ void AstWalker<TypecheckVisitor, Type*>::walk_forall(ForallNode *node) {
   auto current_rule_binding_types = visitor.rule_binding_types.back();
   auto current_rule_binding_offsets = visitor.rule_binding_offsets.back();
 
+  node->offset = current_rule_binding_types->size();
   current_rule_binding_offsets->insert(
-      std::pair<std::string, size_t>(node->identifier,
-                                     current_rule_binding_types->size())
+      std::pair<std::string, size_t>(node->identifier, node->offset)
   );
   current_rule_binding_types->push_back(&node->type_);
 
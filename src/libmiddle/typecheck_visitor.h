@@ -70,7 +70,7 @@ class TypecheckVisitor : public BaseVisitor<Type*> {
     Type* visit_boolean_atom(BooleanAtom *atom) { return &atom->type_; }
     Type* visit_string_atom(StringAtom *atom) { return &atom->type_; }
     Type* visit_list_atom(ListAtom *atom, std::vector<Type*> &vals);
-    Type* visit_number_range_atom(NumberRangeAtom *atom) { return &atom->type_; }
+    Type* visit_number_range_atom(NumberRangeAtom *atom, Type *start, Type *end);
 };
 
 template <>
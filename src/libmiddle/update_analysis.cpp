@@ -0,0 +1,304 @@
+#include "macros.h"
+
+#include "libmiddle/ast_slots.h"
+#include "libmiddle/update_analysis.h"
+#include "libmiddle/read_numbering.h"
+
+static bool is_constant(ExpressionBase *expr) {
+  switch (expr->node_type_) {
+    case NodeType::INT_ATOM:
+    case NodeType::BOOLEAN_ATOM:
+    case NodeType::STRING_ATOM:
+      return true;
+    case NodeType::FUNCTION_ATOM:
+      return reinterpret_cast<FunctionAtom*>(expr)->symbol_type == FunctionAtom::SymbolType::ENUM;
+    default:
+      return false;
+  }
+}
+
+static bool is_binding(ExpressionBase *expr, size_t offset) {
+  if (expr->node_type_ != NodeType::FUNCTION_ATOM) {
+    return false;
+  }
+  FunctionAtom *atom = reinterpret_cast<FunctionAtom*>(expr);
+  return atom->symbol_type == FunctionAtom::SymbolType::PARAMETER && atom->offset == offset;
+}
+
+// true if expr yields different values for different values of the binding
+static bool is_injective(ExpressionBase *expr, size_t offset) {
+  if (is_binding(expr, offset)) {
+    return true;
+  }
+  if (expr->node_type_ != NodeType::INT_EXPRESSION) {
+    return false;
+  }
+  Expression *e = reinterpret_cast<Expression*>(expr);
+  if (e->op != ExpressionOperation::ADD && e->op != ExpressionOperation::SUB) {
+    return false;
+  }
+  return (is_binding(e->left_, offset) && e->right_->node_type_ == NodeType::INT_ATOM) ||
+         (is_binding(e->right_, offset) && e->left_->node_type_ == NodeType::INT_ATOM);
+}
+
+static bool equal_keys(ExpressionBase *a, ExpressionBase *b) {
+  std::string key_a;
+  std::string key_b;
+  return append_expression_key(a, key_a) && append_expression_key(b, key_b) && key_a == key_b;
+}
+
+static bool different_constants(ExpressionBase *a, ExpressionBase *b) {
+  return is_constant(a) && is_constant(b) && !equal_keys(a, b);
+}
+
+// true if the updates can not update the same location
+static bool distinct(const UpdateAnalysis::Write& a, const UpdateAnalysis::Write& b) {
+  if (a.function != b.function) {
+    return true;
+  }
+  if (!a.known || !b.known || a.arguments == nullptr) {
+    return false;
+  }
+  for (size_t i = 0; i < a.arguments->size(); i++) {
+    if (different_constants(a.arguments->at(i), b.arguments->at(i))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// true if the updates can not update the same location in different
+// iterations of a forall with the binding at offset
+static bool distinct_iterations(const UpdateAnalysis::Write& a, const UpdateAnalysis::Write& b,
+                                size_t offset) {
+  if (distinct(a, b)) {
+    return true;
+  }
+  if (!a.known || !b.known || a.arguments == nullptr) {
+    return false;
+  }
+  for (size_t i = 0; i < a.arguments->size(); i++) {
+    ExpressionBase *arg = a.arguments->at(i);
+    if (is_injective(arg, offset) && equal_keys(arg, b.arguments->at(i))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// true if the forall binds every element at most once
+static bool has_distinct_elements(ForallNode *node) {
+  return node->in_expr->type_.t == TypeType::INT ||
+         node->in_expr->type_.t == TypeType::ENUM ||
+         node->in_expr->node_type_ == NodeType::NUMBER_RANGE_ATOM;
+}
+
+UpdateAnalysis::UpdateAnalysis() : rules_(), derived_reads_(), num_unchecked(0) {}
+
+void UpdateAnalysis::analyze_specification(AstNode *specification) {
+  AstListNode *body_elements = reinterpret_cast<AstListNode*>(specification);
+  for (AstNode *e : body_elements->nodes) {
+    // symbolic traces depend on the order of the updates
+    if (e->node_type_ == NodeType::FUNCTION &&
+        reinterpret_cast<FunctionDefNode*>(e)->sym->is_symbolic) {
+      return;
+    }
+  }
+
+  // derived functions called by derived functions are expanded afterwards
+  std::unordered_map<const Function*, std::unordered_set<const Function*>> direct_reads;
+  for (AstNode *e : body_elements->nodes) {
+    if (e->node_type_ == NodeType::FUNCTION) {
+      Function *sym = reinterpret_cast<FunctionDefNode*>(e)->sym;
+      if (sym->type == Symbol::SymbolType::DERIVED) {
+        Effects effects;
+        analyze_expression(sym->derived, effects);
+        direct_reads.emplace(sym, effects.reads);
+      }
+    }
+  }
+  for (const auto& pair : direct_reads) {
+    std::unordered_set<const Function*> reads = pair.second;
+    std::vector<const Function*> pending(reads.begin(), reads.end());
+    while (!pending.empty()) {
+      auto iter = direct_reads.find(pending.back());
+      pending.pop_back();
+      if (iter != direct_reads.end()) {
+        for (const Function *f : iter->second) {
+          if (reads.insert(f).second) {
+            pending.push_back(f);
+          }
+        }
+      }
+    }
+    derived_reads_.emplace(pair.first, reads);
+  }
+
+  for (AstNode *e : body_elements->nodes) {
+    if (e->node_type_ == NodeType::RULE) {
+      analyze_rule(reinterpret_cast<RuleNode*>(e));
+    }
+  }
+}
+
+const UpdateAnalysis::Effects& UpdateAnalysis::analyze_rule(RuleNode *rule) {
+  auto iter = rules_.find(rule);
+  if (iter != rules_.end()) {
+    return iter->second;
+  }
+  // recursive calls see incomplete effects, which are never conflict free
+  rules_[rule].conflict_free = false;
+  Effects effects;
+  analyze_statement(rule->child_, effects);
+  Effects& result = rules_[rule];
+  result = std::move(effects);
+  return result;
+}
+
+bool UpdateAnalysis::check(const Effects& effects) {
+  if (!effects.conflict_free) {
+    return false;
+  }
+  for (const Write& w : effects.writes) {
+    if (effects.reads.count(w.function) > 0) {
+      return false;
+    }
+  }
+  num_unchecked += 1;
+  return true;
+}
+
+void UpdateAnalysis::analyze_statement(AstNode *stmt, Effects& effects) {
+  switch (stmt->node_type_) {
+    case NodeType::PARBLOCK: {
+      Effects block;
+      AstListNode *stmts = reinterpret_cast<AstListNode*>(
+          reinterpret_cast<UnaryNode*>(stmt)->child_);
+      for (AstNode *s : stmts->nodes) {
+        const size_t begin = block.writes.size();
+        analyze_statement(s, block);
+        for (size_t i = begin; i < block.writes.size() && block.conflict_free; i++) {
+          for (size_t j = 0; j < begin; j++) {
+            if (!distinct(block.writes[i], block.writes[j])) {
+              block.conflict_free = false;
+              break;
+            }
+          }
+        }
+      }
+      reinterpret_cast<UnaryNode*>(stmt)->unchecked_updates = check(block);
+      effects.reads.insert(block.reads.begin(), block.reads.end());
+      effects.writes.insert(effects.writes.end(), block.writes.begin(), block.writes.end());
+      effects.conflict_free = effects.conflict_free && block.conflict_free;
+      break;
+    }
+    case NodeType::FORALL: {
+      ForallNode *node = reinterpret_cast<ForallNode*>(stmt);
+      Effects body;
+      analyze_statement(node->statement, body);
+      if (!has_distinct_elements(node)) {
+        body.conflict_free = body.conflict_free && body.writes.empty();
+      }
+      for (size_t i = 0; i < body.writes.size() && body.conflict_free; i++) {
+        for (size_t j = i; j < body.writes.size(); j++) {
+          if (!distinct_iterations(body.writes[i], body.writes[j], node->offset)) {
+            body.conflict_free = false;
+            break;
+          }
+        }
+      }
+      node->unchecked_updates = check(body);
+      // the elements are evaluated before the pseudostate is forked
+      analyze_expression(node->in_expr, body);
+      effects.reads.insert(body.reads.begin(), body.reads.end());
+      effects.writes.insert(effects.writes.end(), body.writes.begin(), body.writes.end());
+      effects.conflict_free = effects.conflict_free && body.conflict_free;
+      break;
+    }
+    case NodeType::UPDATE:
+    case NodeType::UPDATE_SUBRANGE:
+    case NodeType::UPDATE_DUMPS: {
+      UpdateNode *update = reinterpret_cast<UpdateNode*>(stmt);
+      analyze_expression(update->expr_, effects);
+      analyze_arguments(update->func->arguments, effects);
+      effects.writes.push_back({update->func->symbol, update->func->arguments, true});
+      break;
+    }
+    case NodeType::CALL: {
+      CallNode *call = reinterpret_cast<CallNode*>(stmt);
+      analyze_arguments(call->arguments, effects);
+      // the called rule is only known at runtime
+      if (call->ruleref) {
+        analyze_expression(call->ruleref, effects);
+        effects.conflict_free = false;
+        break;
+      }
+      const Effects& rule = analyze_rule(call->rule);
+      effects.reads.insert(rule.reads.begin(), rule.reads.end());
+      std::unordered_set<const Function*> written;
+      for (const Write& w : rule.writes) {
+        if (written.insert(w.function).second) {
+          effects.writes.push_back({w.function, nullptr, false});
+        }
+      }
+      effects.conflict_free = effects.conflict_free && rule.conflict_free;
+      break;
+    }
+    case NodeType::PUSH: {
+      PushNode *node = reinterpret_cast<PushNode*>(stmt);
+      analyze_expression(node->expr, effects);
+      analyze_arguments(node->to->arguments, effects);
+      effects.reads.insert(node->to->symbol);
+      effects.writes.push_back({node->to->symbol, nullptr, false});
+      break;
+    }
+    case NodeType::POP: {
+      PopNode *node = reinterpret_cast<PopNode*>(stmt);
+      analyze_arguments(node->from->arguments, effects);
+      effects.reads.insert(node->from->symbol);
+      effects.writes.push_back({node->from->symbol, nullptr, false});
+      if (node->to->symbol_type == FunctionAtom::SymbolType::FUNCTION) {
+        analyze_arguments(node->to->arguments, effects);
+        effects.writes.push_back({node->to->symbol, nullptr, false});
+      }
+      break;
+    }
+    default:
+      for_each_slot(stmt, [&](AstNode*& s) { analyze_statement(s, effects); },
+                    [&](ExpressionBase*& e) { analyze_expression(e, effects); });
+      break;
+  }
+}
+
+void UpdateAnalysis::analyze_expression(ExpressionBase *expr, Effects& effects) {
+  switch (expr->node_type_) {
+    case NodeType::FUNCTION_ATOM: {
+      FunctionAtom *atom = reinterpret_cast<FunctionAtom*>(expr);
+      if (atom->symbol_type == FunctionAtom::SymbolType::FUNCTION) {
+        effects.reads.insert(atom->symbol);
+      } else if (atom->symbol_type == FunctionAtom::SymbolType::DERIVED) {
+        effects.reads.insert(atom->symbol);
+        auto iter = derived_reads_.find(atom->symbol);
+        if (iter != derived_reads_.end()) {
+          effects.reads.insert(iter->second.begin(), iter->second.end());
+        }
+      }
+      break;
+    }
+    case NodeType::FUNCTION_ATOM_SUBRANGE:
+      effects.reads.insert(reinterpret_cast<FunctionAtom*>(expr)->symbol);
+      break;
+    default:
+      break;
+  }
+  for_each_operand(expr, [&](ExpressionBase*& e) { analyze_expression(e, effects); });
+}
+
+void UpdateAnalysis::analyze_arguments(const std::vector<ExpressionBase*> *args,
+                                       Effects& effects) {
+  if (args) {
+    for (ExpressionBase *arg : *args) {
+      analyze_expression(arg, effects);
+    }
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef CASMI_LIBMIDDLE_UPDATE_ANALYSIS
+#define CASMI_LIBMIDDLE_UPDATE_ANALYSIS
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "libsyntax/ast.h"
+
+// Computes the functions read and written by rules and statements and proves
+// that the updates of parallel blocks and forall can not conflict. Two
+// updates can not conflict if they update different functions or have
+// different constants as the same argument. Different iterations of a forall
+// over a range, an Int or an enum can not conflict if both updates have the
+// binding, or the binding plus or minus the same constant, as the same
+// argument.
+//
+// Blocks whose updates can not conflict and which read no function they
+// write get unchecked_updates set. Inside a sequential pseudostate they add
+// their updates to it directly instead of forking a parallel pseudostate,
+// which would only check for conflicts and hide the updates from the reads of
+// the block. Specifications with symbolic functions are left unchanged. Must
+// only run on a specification that typechecked without errors.
+class UpdateAnalysis {
+  public:
+    struct Write {
+      const Function *function;
+      const std::vector<ExpressionBase*> *arguments;
+      // false if any location of the function may be updated
+      bool known;
+    };
+
+    struct Effects {
+      std::unordered_set<const Function*> reads;
+      std::vector<Write> writes;
+      // false if updates of one execution may conflict or if the effects are
+      // not completely known
+      bool conflict_free;
+
+      Effects() : reads(), writes(), conflict_free(true) {}
+    };
+
+  private:
+    std::unordered_map<const RuleNode*, Effects> rules_;
+    // functions read by derived functions, including the derived functions
+    // they call
+    std::unordered_map<const Function*, std::unordered_set<const Function*>> derived_reads_;
+
+    void analyze_statement(AstNode *stmt, Effects& effects);
+    void analyze_expression(ExpressionBase *expr, Effects& effects);
+    void analyze_arguments(const std::vector<ExpressionBase*> *args, Effects& effects);
+    bool check(const Effects& effects);
+
+  public:
+    size_t num_unchecked;
+
+    UpdateAnalysis();
+
+    const Effects& analyze_rule(RuleNode *rule);
+    void analyze_specification(AstNode *specification);
+};
+
+#endif
@@ -25,6 +25,8 @@ static std::map<NodeType, const std::string> node_type_names_ = {
     {NodeType::DERIVED, std::string("DERIVED")},
     {NodeType::RULE, std::string("RULE")},
     {NodeType::EXPRESSION, std::string("EXPRESSION")},
+    {NodeType::INT_EXPRESSION, std::string("INT EXPRESSION")},
+    {NodeType::BOOLEAN_EXPRESSION, std::string("BOOLEAN EXPRESSION")},
     {NodeType::UPDATE, std::string("UPDATE")},
     {NodeType::SPECIFICATION, std::string("SPECIFICATION")},
     {NodeType::STATEMENT, std::string("STATEMENT")},
@@ -223,7 +225,8 @@ bool RuleAtom::equals(AstNode*) {
 
 
 StringAtom::StringAtom(yy::location& loc, std::string&& string) :
-        AtomNode(loc, NodeType::STRING_ATOM, Type(TypeType::STRING)), string(string) {
+        AtomNode(loc, NodeType::STRING_ATOM, Type(TypeType::STRING)), string(string),
+        interned(nullptr) {
   DEBUG("StringAtom "<<string);
 }
 
@@ -246,7 +249,8 @@ FunctionAtom::FunctionAtom(yy::location& loc, const std::string name)
 
 FunctionAtom::FunctionAtom(yy::location& loc, const std::string name,
                            std::vector<ExpressionBase*> *args) 
-    : BaseFunctionAtom(loc, NodeType::FUNCTION_ATOM, name, args), symbol_type(SymbolType::UNSET), initialized(false) {
+    : BaseFunctionAtom(loc, NodeType::FUNCTION_ATOM, name, args), symbol_type(SymbolType::UNSET), initialized(false),
+      value_number(0), reuses_value(false) {
 }
 
 FunctionAtom::~FunctionAtom() {
@@ -428,23 +432,15 @@ ListAtom::ListAtom(yy::location& loc, std::vector<ExpressionBase*> *exprs)
   type_ = Type(TypeType::LIST, new Type(TypeType::UNKNOWN));
 }
 
-NumberRangeAtom::NumberRangeAtom(yy::location& loc, IntAtom *start, IntAtom *end) :
-    AtomNode(loc, NodeType::NUMBER_RANGE_ATOM, TypeType::UNKNOWN) {
+NumberRangeAtom::NumberRangeAtom(yy::location& loc, ExpressionBase *start,
+                                 ExpressionBase *end) :
+    AtomNode(loc, NodeType::NUMBER_RANGE_ATOM, TypeType::UNKNOWN), start(start), end(end) {
   type_ = Type(TypeType::LIST, new Type(TypeType::INT));
-  INT_T i_start = start->val_;
-  INT_T i_end = end->val_;
+}
 
-  std::vector<value_t> vals;
-  if (i_start <= i_end) {
-    for (INT_T i=i_end; i >= i_start; i--) {
-      vals.push_back(value_t(i));
-    }
-  } else {
-    for (INT_T i=i_end; i <= i_start; i++) {
-      vals.push_back(value_t(i));
-    }
-  }
-  list = new BottomList(vals);
+NumberRangeAtom::~NumberRangeAtom() {
+  delete start;
+  delete end;
 }
 
 Expression::Expression(yy::location& loc, ExpressionBase *left, ExpressionBase *right,
@@ -573,7 +569,8 @@ bool PopNode::equals(AstNode *other) {
 
 ForallNode::ForallNode(yy::location& loc, const std::string& ident,
                        ExpressionBase *expr, AstNode *stmt) 
-    : AstNode(loc, NodeType::FORALL), identifier(std::move(ident)), in_expr(expr), statement(stmt) {}
+    : AstNode(loc, NodeType::FORALL), identifier(std::move(ident)), in_expr(expr), statement(stmt),
+      offset(0), unchecked_updates(false) {}
 ForallNode::~ForallNode() {
   delete in_expr;
   delete statement;
@@ -581,7 +578,15 @@ ForallNode::~ForallNode() {
 
 CaseNode::CaseNode(yy::location& loc, ExpressionBase *expr,
              std::vector<std::pair<AtomNode*, AstNode*>>& case_list)
-    : AstNode(loc, NodeType::CASE), expr(expr), case_list(std::move(case_list)), label_map(), map_fixed(false) {}
+    : AstNode(loc, NodeType::CASE), expr(expr), case_list(std::move(case_list)), label_map(),
+      default_stmt(nullptr), map_fixed(false) {
+  for (auto& pair : this->case_list) {
+    // pair.first == nullptr for default:
+    if (pair.first == nullptr) {
+      default_stmt = pair.second;
+    }
+  }
+}
 
 CaseNode::~CaseNode() {
   delete expr;
@@ -594,7 +599,31 @@ bool CaseNode::equals(AstNode *other) {
   FAILURE();
 }
 
-UnaryNode::UnaryNode(yy::location& loc, NodeType node_type, AstNode *child) : AstNode(loc, node_type) {
+bool CaseNode::has_constant_labels() const {
+  for (auto& pair : case_list) {
+    if (pair.first == nullptr) {
+      continue;
+    }
+    switch (pair.first->node_type_) {
+      case NodeType::INT_ATOM:
+      case NodeType::BOOLEAN_ATOM:
+      case NodeType::STRING_ATOM:
+        break;
+      case NodeType::FUNCTION_ATOM:
+        if (reinterpret_cast<FunctionAtom*>(pair.first)->symbol_type !=
+            FunctionAtom::SymbolType::ENUM) {
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+UnaryNode::UnaryNode(yy::location& loc, NodeType node_type, AstNode *child)
+    : AstNode(loc, node_type), unchecked_updates(false) {
   child_ = child;
 }
 
@@ -614,22 +643,22 @@ bool UnaryNode::equals(AstNode *other) {
 
 RuleNode::RuleNode(yy::location& loc, AstNode *child, const std::string& name)
   :  UnaryNode(loc, NodeType::RULE, child), name(std::move(name)), arguments(),
-     binding_offsets(), dump_list() {}
+     binding_offsets(), dump_list(), num_read_values(0) {}
 
 RuleNode::RuleNode(yy::location& loc,
                    AstNode *child,
                    const std::string &name,
                    std::vector<Type*>& args)
   : UnaryNode(loc, NodeType::RULE, child), name(std::move(name)),
-    arguments(std::move(args)), binding_offsets(std::move(binding_offsets)),
-    dump_list() {}
+    arguments(std::move(args)), binding_offsets(),
+    dump_list(), num_read_values(0) {}
 
 RuleNode::RuleNode(yy::location& loc, AstNode *child, const std::string &name,
         std::vector<Type*>& args,
         const std::vector<std::pair<std::string, std::vector<std::string>>>& dump_list)
     : UnaryNode(loc, NodeType::RULE, child), name(std::move(name)),
-      arguments(std::move(args)), binding_offsets(std::move(binding_offsets)),
-      dump_list(std::move(dump_list)) {}
+      arguments(std::move(args)), binding_offsets(),
+      dump_list(std::move(dump_list)), num_read_values(0) {}
 
 
 CallNode::CallNode(yy::location& loc, const std::string& rule_name, ExpressionBase *ruleref)
@@ -652,7 +681,8 @@ PrintNode::PrintNode(yy::location& loc, const std::string& filter, const std::ve
 
 LetNode::LetNode(yy::location& loc, Type type, const std::string& identifier,
             ExpressionBase *expr, AstNode *stmt) 
-    : AstNode(loc, NodeType::LET, type), identifier(identifier), expr(expr), stmt(stmt) {}
+    : AstNode(loc, NodeType::LET, type), identifier(identifier), expr(expr), stmt(stmt),
+      offset(0) {}
 
 DiedieNode::DiedieNode(yy::location& loc, ExpressionBase *msg)
     : AstNode(loc, NodeType::DIEDIE), msg(msg) {}
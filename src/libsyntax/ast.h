@@ -37,6 +37,8 @@ enum NodeType {
   RULE,
   SPECIFICATION,
   EXPRESSION,
+  INT_EXPRESSION,
+  BOOLEAN_EXPRESSION,
   UPDATE,
   UPDATE_SUBRANGE,
   UPDATE_DUMPS,
@@ -111,6 +113,9 @@ class AstListNode: public AstNode {
 class UnaryNode: public AstNode {
   public:
     AstNode *child_;
+    // set by UpdateAnalysis for parallel blocks whose updates can neither
+    // conflict nor be read by the block
+    bool unchecked_updates;
 
     UnaryNode(yy::location& loc, NodeType node_type, AstNode *child);
     virtual ~UnaryNode();
@@ -124,6 +129,8 @@ class RuleNode: public UnaryNode {
     std::vector<Type*> arguments;
     std::map<std::string, size_t> binding_offsets;
     const std::vector<std::pair<std::string, std::vector<std::string>>> dump_list;
+    // number of reads with a value number in the body, set by ReadNumbering
+    uint16_t num_read_values;
 
     RuleNode(yy::location& loc, AstNode *child, const std::string &name);
     RuleNode(yy::location& loc, AstNode *child, const std::string &name,
@@ -250,6 +257,12 @@ class FunctionAtom : public BaseFunctionAtom {
       Enum *enum_;
     };
 
+    // reads of the same function with the same arguments share a value
+    // number if no update can become visible between them, 0 if the read
+    // is not shared. Only the first read of a value number is executed.
+    uint16_t value_number;
+    bool reuses_value;
+
     FunctionAtom(yy::location& loc, const std::string name);
     FunctionAtom(yy::location& loc, const std::string name,
                  std::vector<ExpressionBase*> *args);
@@ -307,6 +320,8 @@ class RuleAtom : public AtomNode {
 class StringAtom : public AtomNode {
   public:
     std::string string;
+    // set by the interpreter when the literal is first evaluated
+    const string_t *interned;
 
     StringAtom(yy::location& loc, std::string&& name);
  
@@ -323,9 +338,12 @@ class ListAtom : public AtomNode {
 
 class NumberRangeAtom : public AtomNode {
   public:
-    BottomList *list;
+    // the bounds are evaluated at runtime, the range is not materialized
+    ExpressionBase *start;
+    ExpressionBase *end;
 
-    NumberRangeAtom(yy::location& loc, IntAtom *start, IntAtom *end);
+    NumberRangeAtom(yy::location& loc, ExpressionBase *start, ExpressionBase *end);
+    virtual ~NumberRangeAtom();
 };
 
 enum class ExpressionOperation {
@@ -399,6 +417,11 @@ class ForallNode: public AstNode {
     const std::string identifier;
     ExpressionBase *in_expr;
     AstNode *statement;
+    // slot of the binding in the frame of the rule, set by the typechecker
+    size_t offset;
+    // set by UpdateAnalysis if the updates of the body can neither conflict
+    // nor be read by the body
+    bool unchecked_updates;
 
     ForallNode(yy::location& loc, const std::string& ident, ExpressionBase *expr, AstNode *stmt);
     virtual ~ForallNode();
@@ -411,13 +434,20 @@ class CaseNode: public AstNode {
 
     std::vector<std::pair<AtomNode*, AstNode*>> case_list;
     std::unordered_map<value_t, AstNode*> label_map;
+    // statement of the last default label, nullptr if there is none
+    AstNode *default_stmt;
 
+    // set once the label_map has been built on the first execution, the
+    // label_map stays empty if not all labels are constant
     bool map_fixed;
 
     CaseNode(yy::location& loc, ExpressionBase *expr,
              std::vector<std::pair<AtomNode*, AstNode*>>& case_list);
     virtual ~CaseNode();
     virtual bool equals(AstNode *other);
+
+    // true if all labels are Int, Boolean, String or enum constants
+    bool has_constant_labels() const;
 };
 
 
@@ -447,6 +477,8 @@ class LetNode: public AstNode {
     const std::string identifier;
     ExpressionBase *expr;
     AstNode *stmt;
+    // slot of the binding in the frame of the rule, set by the typechecker
+    size_t offset;
 
     LetNode(yy::location& loc, Type type, const std::string& identifier,
             ExpressionBase *expr, AstNode *stmt);
@@ -23,6 +23,14 @@ void AstDumpVisitor::dump_link(AstNode *from, AstNode *to) {
   dump_link((uint64_t) from, (uint64_t) to);
 }
 
+void AstDumpVisitor::dump_links(AstNode *from, const std::vector<ExpressionBase*> *to) {
+  if (to != nullptr) {
+    for (ExpressionBase *e : *to) {
+      dump_link(from, e);
+    }
+  }
+}
+
 void AstDumpVisitor::visit_body_elements(AstListNode *body_elements) {
   dump_node(body_elements, "Body Elements");
 
@@ -33,7 +41,14 @@ void AstDumpVisitor::visit_body_elements(AstListNode *body_elements) {
 
 void AstDumpVisitor::visit_function_def(FunctionDefNode *def, const std::vector<std::pair<bool, bool>>&) {
   dump_node(def, "Function Definition: "+def->sym->to_str());
-  DEBUG("TODO: implement initializers");
+  if (def->sym->intitializers_) {
+    for (auto& init : *def->sym->intitializers_) {
+      if (init.first) {
+        dump_link(def, init.first);
+      }
+      dump_link(def, init.second);
+    }
+  }
 }
 
 void AstDumpVisitor::visit_derived_def(FunctionDefNode *def, bool) {
@@ -72,11 +87,15 @@ void AstDumpVisitor::visit_ifthenelse(IfThenElseNode *node, bool) {
   }
 }
 
-bool AstDumpVisitor::visit_assert(UnaryNode *assert, bool) {
+void AstDumpVisitor::visit_assert(UnaryNode *assert, bool) {
   dump_node(assert, "Assert");
 
   dump_link((uint64_t) assert, (uint64_t) assert->child_);
-  return true;
+}
+
+void AstDumpVisitor::visit_assure(UnaryNode *assure, bool) {
+  dump_node(assure, "Assure");
+  dump_link(assure, assure->child_);
 }
 
 void AstDumpVisitor::visit_seqblock(UnaryNode *seqblock) {
@@ -97,20 +116,25 @@ bool AstDumpVisitor::visit_update(UpdateNode *update, bool, bool) {
   return true;
 }
 
+bool AstDumpVisitor::visit_update_subrange(UpdateNode *update, bool v1, bool v2) {
+  return visit_update(update, v1, v2);
+}
+
 bool AstDumpVisitor::visit_update_dumps(UpdateNode *update, bool v1, bool v2) {
   return visit_update(update, v1, v2);
 }
 
 bool AstDumpVisitor::visit_call_pre(CallNode *call) {
   dump_node(call, "Direct Call: "+call->rule_name);
-  // TODO we need to populate the rule here!!!
-  FAILURE();
+  dump_links(call, call->arguments);
+  return true;
 }
 
 bool AstDumpVisitor::visit_call_pre(CallNode *call, bool) {
   dump_node(call, "Indirect Call");
-  // TODO we need to populate the rule here!!!
-  FAILURE();
+  dump_link(call, call->ruleref);
+  dump_links(call, call->arguments);
+  return true;
 }
 
 bool AstDumpVisitor::visit_call(CallNode *call, std::vector<bool>& argument_results) {
@@ -130,14 +154,70 @@ bool AstDumpVisitor::visit_print(PrintNode *node, std::vector<bool>& argument_re
   return true;
 }
 
+void AstDumpVisitor::visit_diedie(DiedieNode *node, const bool&) {
+  dump_node(node, "Diedie");
+  if (node->msg) {
+    dump_link(node, node->msg);
+  }
+}
+
+void AstDumpVisitor::visit_impossible(AstNode *node) {
+  dump_node(node, "Impossible");
+}
+
 void AstDumpVisitor::visit_let(LetNode *node, bool) {
   dump_node(node, "Let "+node->identifier);
   dump_link(node, node->expr);
   dump_link(node, node->stmt);
 }
 
+void AstDumpVisitor::visit_pop(PopNode *node) {
+  dump_node(node, "Pop");
+  dump_link(node, node->to);
+  dump_link(node, node->from);
+}
+
+void AstDumpVisitor::visit_push(PushNode *node, bool, bool) {
+  dump_node(node, "Push");
+  dump_link(node, node->expr);
+  dump_link(node, node->to);
+}
+
+void AstDumpVisitor::visit_case(CaseNode *node, const bool, const std::vector<bool>&) {
+  dump_node(node, "Case");
+  dump_link(node, node->expr);
+  for (auto& pair : node->case_list) {
+    // pair.first == nullptr for default:
+    if (pair.first) {
+      dump_link(node, pair.first);
+    }
+    dump_link(node, pair.second);
+  }
+}
+
+void AstDumpVisitor::visit_forall_pre(ForallNode *node) {
+  dump_node(node, "Forall "+node->identifier);
+  dump_link(node, node->in_expr);
+  dump_link(node, node->statement);
+}
+
+void AstDumpVisitor::visit_iterate(UnaryNode *node) {
+  dump_node(node, "Iterate");
+  dump_link(node, node->child_);
+}
+
 bool AstDumpVisitor::visit_expression(Expression *expr, bool, bool) {
-  dump_node(expr, "Expression:"+operator_to_str(expr->op));
+  // show which expressions were specialized by the optimization passes
+  switch (expr->node_type_) {
+    case NodeType::INT_EXPRESSION:
+      dump_node(expr, "IntExpression:"+operator_to_str(expr->op));
+      break;
+    case NodeType::BOOLEAN_EXPRESSION:
+      dump_node(expr, "BooleanExpression:"+operator_to_str(expr->op));
+      break;
+    default:
+      dump_node(expr, "Expression:"+operator_to_str(expr->op));
+  }
   if (expr->left_ != nullptr) {
     dump_link(expr, expr->left_);
   }
@@ -163,8 +243,37 @@ bool AstDumpVisitor::visit_float_atom(FloatAtom *atom) {
   return true;
 }
 
+bool AstDumpVisitor::visit_rational_atom(RationalAtom *atom) {
+  dump_node(atom, std::string("RationalAtom: ")+atom->val_.to_str());
+  return true;
+}
+
+bool AstDumpVisitor::visit_undef_atom(UndefAtom *atom) {
+  dump_node(atom, std::string("UndefAtom"));
+  return true;
+}
+
 bool AstDumpVisitor::visit_function_atom(FunctionAtom *atom, bool[], uint16_t) {
   dump_node(atom, std::string("FunctionAtom:"+atom->name));
+  dump_links(atom, atom->arguments);
+  return true;
+}
+
+bool AstDumpVisitor::visit_function_atom_subrange(FunctionAtom *atom, bool[], uint16_t) {
+  dump_node(atom, std::string("FunctionAtom:"+atom->name));
+  dump_links(atom, atom->arguments);
+  return true;
+}
+
+bool AstDumpVisitor::visit_builtin_atom(BuiltinAtom *atom, bool[], uint16_t) {
+  dump_node(atom, std::string("BuiltinAtom:"+atom->name));
+  dump_links(atom, atom->arguments);
+  return true;
+}
+
+bool AstDumpVisitor::visit_derived_function_atom(FunctionAtom *atom, bool) {
+  dump_node(atom, std::string("DerivedAtom:"+atom->name));
+  dump_links(atom, atom->arguments);
   return true;
 }
 
@@ -187,3 +296,33 @@ bool AstDumpVisitor::visit_string_atom(StringAtom *atom) {
   dump_node(atom, std::string("StringAtom: "+atom->string));
   return true;
 }
+
+bool AstDumpVisitor::visit_list_atom(ListAtom *atom, std::vector<bool>&) {
+  dump_node(atom, std::string("ListAtom"));
+  dump_links(atom, atom->expr_list);
+  return true;
+}
+
+bool AstDumpVisitor::visit_number_range_atom(NumberRangeAtom *atom, bool, bool) {
+  dump_node(atom, std::string("NumberRangeAtom"));
+  dump_link(atom, atom->start);
+  dump_link(atom, atom->end);
+  return true;
+}
+
+template <>
+void AstWalker<AstDumpVisitor, bool>::walk_call(CallNode *call) {
+  // rules are dumped once as part of the specification, following the call
+  // would not terminate for recursive rules
+  if (call->ruleref == nullptr) {
+    visitor.visit_call_pre(call);
+  } else {
+    walk_expression_base(call->ruleref);
+    visitor.visit_call_pre(call, true);
+  }
+  if (call->arguments != nullptr) {
+    for (ExpressionBase *e: *call->arguments) {
+      walk_expression_base(e);
+    }
+  }
+}
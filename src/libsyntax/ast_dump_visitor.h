@@ -19,6 +19,7 @@ class AstDumpVisitor : public BaseVisitor<bool> {
     void dump_node(AstNode *n, const std::string& name);
     void dump_link(uint64_t from, uint64_t to);
     void dump_link(AstNode *from, AstNode *to);
+    void dump_links(AstNode *from, const std::vector<ExpressionBase*> *to);
 
 
   public:
@@ -36,39 +37,48 @@ class AstDumpVisitor : public BaseVisitor<bool> {
     void visit_statements(AstListNode *stmts);
     void visit_statement(AstNode *stmt);
     void visit_ifthenelse(IfThenElseNode *node, bool);
-    bool visit_assert(UnaryNode *assert, bool);
+    void visit_assert(UnaryNode *assert, bool);
+    void visit_assure(UnaryNode *assure, bool);
     void visit_seqblock(UnaryNode *seqblock);
     void visit_parblock(UnaryNode *parblock);
     bool visit_update(UpdateNode *update, bool, bool);
+    bool visit_update_subrange(UpdateNode *update, bool v1, bool v2);
     bool visit_update_dumps(UpdateNode *update, bool v1, bool v2);
     bool visit_call_pre(CallNode *call);
     bool visit_call_pre(CallNode *call, bool);
     bool visit_call(CallNode *call, std::vector<bool>& argument_results);
     void visit_call_post(CallNode *call) {UNUSED(call);}
     bool visit_print(PrintNode *node, std::vector<bool>& argument_results);
+    void visit_diedie(DiedieNode *node, const bool&);
+    void visit_impossible(AstNode *node);
 
     void visit_let(LetNode*, bool);
-    void visit_pop(PopNode*) { throw "Not implemented"; }
-    void visit_push(PushNode*, bool, bool)  { throw "Not implemented"; }
-    void visit_case(CaseNode*, const bool, const std::vector<bool>&) { throw "not implemented case astdump"; }
+    void visit_pop(PopNode *node);
+    void visit_push(PushNode *node, bool, bool);
+    void visit_case(CaseNode *node, const bool, const std::vector<bool>&);
 
-    void visit_forall_post(ForallNode*) { throw "not implemented"; }
-    void visit_iterate(UnaryNode*) { throw "not implemented"; }
+    void visit_forall_pre(ForallNode *node);
+    void visit_iterate(UnaryNode *node);
 
     bool visit_expression(Expression *expr, bool, bool);
     bool visit_expression_single(Expression *expr, bool);
     bool visit_int_atom(IntAtom *atom);
     bool visit_float_atom(FloatAtom *atom);
-    bool visit_undef_atom(UndefAtom*) { throw "not impleemented"; }
+    bool visit_rational_atom(RationalAtom *atom);
+    bool visit_undef_atom(UndefAtom *atom);
     bool visit_function_atom(FunctionAtom *atom, bool[], uint16_t);
-    bool visit_builtin_atom(BuiltinAtom *, bool[], uint16_t) { throw "not implemented"; }
-    bool visit_derived_function_atom(FunctionAtom*, bool) { throw "not implemented"; }
+    bool visit_function_atom_subrange(FunctionAtom *atom, bool[], uint16_t);
+    bool visit_builtin_atom(BuiltinAtom *atom, bool[], uint16_t);
+    bool visit_derived_function_atom(FunctionAtom *atom, bool);
     bool visit_self_atom(SelfAtom *atom);
     bool visit_rule_atom(RuleAtom *atom);
     bool visit_boolean_atom(BooleanAtom *atom);
     bool visit_string_atom(StringAtom *atom);
-    bool visit_list_atom(ListAtom*, std::vector<bool>&) { throw "not implemented"; }
-    bool visit_number_range_atom(NumberRangeAtom*) { throw "not implemented"; }
+    bool visit_list_atom(ListAtom *atom, std::vector<bool>&);
+    bool visit_number_range_atom(NumberRangeAtom *atom, bool, bool);
 };
 
+template <>
+void AstWalker<AstDumpVisitor, bool>::walk_call(CallNode *call);
+
 #endif //CASMI_LIBINTERPRETER_EXEC_VISITOR
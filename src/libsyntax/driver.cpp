@@ -177,4 +177,8 @@ AstNode *StringDriver::parse (const std::string &str) {
   return res;
 }
 
-
+AstNode *StringDriver::parse (const std::string &str, const std::string& filename) {
+  AstNode *res = parse(str);
+  filename_ = filename;
+  return res;
+}
@@ -14,8 +14,10 @@
 class AstNode;
 
 class Driver {
-  private:
+  protected:
     std::string filename_;
+
+  private:
     FILE *file_;
     std::vector<std::string> lines_;
     bool error_;
@@ -70,6 +72,8 @@ class StringDriver: public Driver {
 
   public:
     AstNode *parse (const std::string& str);
+    // parses str and reports errors as if it was read from filename
+    AstNode *parse (const std::string& str, const std::string& filename);
 };
 
 // Tell Flex the lexer's prototype ...
@@ -423,15 +423,9 @@ NUMBER: INT_NUMBER { $$ = $1; }
 RULEREF: "@" IDENTIFIER { $$ = $2; }
        ;
 
-NUMBER_RANGE: "[" NUMBER DOTDOT NUMBER "]" {
-              if ($2->node_type_ == NodeType::INT_ATOM && $4->node_type_ == NodeType::INT_ATOM) {
-                $$ = new NumberRangeAtom(@$, reinterpret_cast<IntAtom*>($2), reinterpret_cast<IntAtom*>($4));
-              } else {
-                driver.error(@$, "numbers in range expression must be Int");
-                $$ = nullptr;
-              }
+NUMBER_RANGE: "[" EXPRESSION DOTDOT EXPRESSION "]" {
+                $$ = new NumberRangeAtom(@$, $2, $4);
             }
-            /*| "[" IDENTIFIER DOTDOT IDENTIFIER "]" */
             ;
 
 LISTCONST: "[" EXPRESSION_LIST "]" { $$ = $2; }
@@ -52,8 +52,9 @@ Function::Function(bool is_static, bool is_symbolic, const std::string name,
              std::vector<std::pair<ExpressionBase*, ExpressionBase*>> *init) :
                 Symbol(name, SymbolType::FUNCTION), arguments_(std::move(args)), intitializers_(init),
                 return_type_(return_type), id(counter),
-                is_static(is_static), is_symbolic(is_symbolic),
-                subrange_arguments(), subrange_return(false) {
+                is_static(is_static), is_symbolic(is_symbolic), is_written(false),
+                subrange_arguments(), subrange_return(false),
+                num_read_values(0) {
 
   counter += 1;
   if (return_type->subrange_start < return_type->subrange_end) {
@@ -71,14 +72,16 @@ Function::Function(const std::string name, std::vector<Type*>& args,
                    ExpressionBase *expr, Type* return_type) :
                 Symbol(name, SymbolType::DERIVED), arguments_(std::move(args)), derived(expr),
                 return_type_(return_type), id(counter),
-                is_static(false), is_symbolic(false) {
+                is_static(false), is_symbolic(false), is_written(false),
+                num_read_values(0) {
   counter += 1;
 }
 
 Function::Function(const std::string name,
                    ExpressionBase *expr, Type* return_type) :
                 Symbol(name, SymbolType::DERIVED), arguments_(), derived(expr),
-                return_type_(return_type), id(counter), is_static(false), is_symbolic(false) {
+                return_type_(return_type), id(counter), is_static(false), is_symbolic(false),
+                is_written(false), num_read_values(0) {
   counter += 1;
 }
 
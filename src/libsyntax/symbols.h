@@ -51,10 +51,17 @@ class Function : public Symbol {
 
     const bool is_static;
     const bool is_symbolic;
+    // set by the typechecker if a rule updates, pushes into or pops from
+    // the function
+    bool is_written;
 
     std::vector<uint32_t> subrange_arguments;
     bool subrange_return;
 
+    // number of reads with a value number in the body of a derived
+    // function, set by ReadNumbering
+    uint16_t num_read_values;
+
     Function(const std::string name, std::vector<Type*>& args, Type* return_type,
            std::vector<std::pair<ExpressionBase*, ExpressionBase*>> *init);
     Function(bool is_static, bool is_symbolic, const std::string name,
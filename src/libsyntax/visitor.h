@@ -293,7 +293,11 @@ template<class T, class V> class AstWalker {
     }
 
     V walk_expression_base(ExpressionBase *expr) {
-      if (expr->node_type_ == NodeType::EXPRESSION) {
+      // specialized expressions are only handled differently by the
+      // execution walker, all other visitors see them as plain expressions
+      if (expr->node_type_ == NodeType::EXPRESSION ||
+          expr->node_type_ == NodeType::INT_EXPRESSION ||
+          expr->node_type_ == NodeType::BOOLEAN_EXPRESSION) {
         Expression *e = reinterpret_cast<Expression*>(expr);
         V v1 = walk_expression_base(e->left_);
         if (e->right_) {
@@ -387,8 +391,12 @@ template<class T, class V> class AstWalker {
         case NodeType::LIST_ATOM: {
           return walk_list_atom(reinterpret_cast<ListAtom*>(atom));
         }
-        case NodeType::NUMBER_RANGE_ATOM:
-          return visitor.visit_number_range_atom(reinterpret_cast<NumberRangeAtom*>(atom));
+        case NodeType::NUMBER_RANGE_ATOM: {
+          NumberRangeAtom *range = reinterpret_cast<NumberRangeAtom*>(atom);
+          V start = walk_expression_base(range->start);
+          V end = walk_expression_base(range->end);
+          return visitor.visit_number_range_atom(range, start, end);
+        }
         default: {
           throw RuntimeException("Invalid atom type:"+type_to_str(atom->node_type_)+std::to_string(atom->node_type_));
         }
@@ -450,7 +458,7 @@ template<class T> class BaseVisitor {
     T visit_boolean_atom(BooleanAtom*) { return T(); }
     T visit_string_atom(StringAtom*) { return T(); }
     T visit_list_atom(ListAtom*, std::vector<T> &) { return T(); }
-    T visit_number_range_atom(NumberRangeAtom*) { return T(); }
+    T visit_number_range_atom(NumberRangeAtom*, T, T) { return T(); }
 };
 
 #endif
@@ -0,0 +1,56 @@
+#include "gtest/gtest.h"
+
+#include "libinterpreter/bigint.h"
+
+class BigIntTest: public ::testing::Test {
+  protected:
+    virtual void SetUp() { bigint::enabled = true; }
+    virtual void TearDown() {
+      bigint::enabled = false;
+      free_unused_values();
+    }
+};
+
+TEST_F(BigIntTest, test_arithmetic) {
+  const bigint_t max(INT64_MAX);
+  EXPECT_TRUE(max.fits_int());
+  EXPECT_FALSE((max + bigint_t(1)).fits_int());
+  EXPECT_EQ("9223372036854775808", (max + bigint_t(1)).to_str());
+  EXPECT_EQ("-9223372036854775808", bigint_t(INT64_MIN).to_str());
+  EXPECT_EQ(INT64_MIN, (bigint_t(0) - max - bigint_t(1)).to_int());
+
+  const bigint_t big = max * max;
+  EXPECT_EQ("85070591730234615847396907784232501249", big.to_str());
+  EXPECT_EQ("3fffffffffffffff0000000000000001", big.to_str(16));
+  EXPECT_EQ(max, big / max);
+  EXPECT_EQ(bigint_t(0), big % max);
+  EXPECT_EQ(bigint_t(1), (big + bigint_t(1)) % max);
+  EXPECT_EQ(bigint_t(-1), (bigint_t(0) - big - bigint_t(1)) % max);
+  EXPECT_EQ(bigint_t(-7) / bigint_t(2), bigint_t(-3));
+  EXPECT_EQ(0, (big - big).compare(bigint_t(0)));
+  EXPECT_EQ(-1, (bigint_t(0) - big).compare(max));
+  EXPECT_THROW(big / bigint_t(0), RuntimeException);
+}
+
+TEST_F(BigIntTest, test_promotion) {
+  const value_t small = bigint::add(40, 2);
+  EXPECT_EQ(42, small.value.integer);
+
+  const value_t big = bigint::mul(INT64_MAX, 4);
+  EXPECT_TRUE(bigint::is_boxed(big.value.integer));
+  EXPECT_EQ("36893488147419103228", big.to_str());
+  // equal big integers are interned once
+  EXPECT_EQ(big, bigint::add(bigint::mul(INT64_MAX, 2).value.integer,
+                             bigint::mul(INT64_MAX, 2).value.integer));
+  EXPECT_EQ(1, bigint::compare(big.value.integer, INT64_MAX));
+  EXPECT_EQ(value_t((INT_T) 4),
+            bigint::div(big.value.integer, INT64_MAX));
+  EXPECT_EQ(value_t((INT_T) INT64_MAX),
+            bigint::sub(big.value.integer, bigint::mul(INT64_MAX, 3).value.integer));
+
+  // values in the boxed range are boxed as well
+  const value_t min = bigint::from_int(INT64_MIN);
+  EXPECT_TRUE(bigint::is_boxed(min.value.integer));
+  EXPECT_EQ("-9223372036854775808", min.to_str());
+  EXPECT_EQ("9223372036854775808", bigint::div(min.value.integer, -1).to_str());
+}
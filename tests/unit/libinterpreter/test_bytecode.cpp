@@ -0,0 +1,265 @@
+// gtest macros raise -Wsign-compare
+#pragma GCC diagnostic ignored "-Wsign-compare"
+
+#include <string>
+
+#include "specification_test.h"
+
+#include "libmiddle/read_numbering.h"
+
+#include "libinterpreter/bytecode.h"
+
+class BytecodeTest: public SpecificationTest {
+  protected:
+    RuleNode *compile(const std::string& spec, bool number_reads = false) {
+      parse_and_specialize(spec);
+
+      if (number_reads) {
+        ReadNumbering read_numbering;
+        read_numbering.number_specification(root_);
+      }
+
+      RuleNode *rule = driver_.get_init_rule();
+      compiler_.compile_rule(rule, &chunk_);
+      return rule;
+    }
+
+    std::vector<Opcode> opcodes() const {
+      std::vector<Opcode> ops;
+      for (const Instruction& inst : chunk_.code) {
+        ops.push_back(inst.op);
+      }
+      return ops;
+    }
+
+    BytecodeCompiler compiler_;
+    Chunk chunk_;
+};
+
+TEST_F(BytecodeTest, compile_update) {
+  compile("function x : -> Int\n"
+          "init main\n"
+          "rule main = {\n"
+          "    x := 1 + 2\n"
+          "}\n");
+
+  std::vector<Opcode> expected = {
+    Opcode::PAR_BEGIN,
+    Opcode::LOAD_CONST,
+    Opcode::LOAD_CONST,
+    Opcode::ADD,
+    Opcode::UPDATE,
+    Opcode::PAR_END,
+    Opcode::END
+  };
+  EXPECT_EQ(expected, opcodes());
+  EXPECT_EQ(2, chunk_.constants.size());
+
+  // the update reads the value from the destination of the addition
+  EXPECT_EQ(chunk_.code[3].a, chunk_.code[4].a);
+  EXPECT_EQ(0, chunk_.code[4].c);
+}
+
+TEST_F(BytecodeTest, compile_ifthenelse) {
+  compile("function x : -> Int\n"
+          "init main\n"
+          "rule main = \n"
+          "    if x = 1 then x := 2 else x := 3\n");
+
+  std::vector<Opcode> expected = {
+    Opcode::READ,
+    Opcode::LOAD_CONST,
+    Opcode::EQ,
+    Opcode::BRANCH,
+    Opcode::LOAD_CONST,
+    Opcode::UPDATE,
+    Opcode::JUMP,
+    Opcode::LOAD_CONST,
+    Opcode::UPDATE,
+    Opcode::END
+  };
+  EXPECT_EQ(expected, opcodes());
+  EXPECT_EQ(7, chunk_.code[3].target);
+  EXPECT_EQ(9, chunk_.code[6].target);
+}
+
+TEST_F(BytecodeTest, bindings_are_registers) {
+  compile("function x : -> Int\n"
+          "init main\n"
+          "rule main = \n"
+          "    let y = 5 in x := y\n");
+
+  std::vector<Opcode> expected = {
+    Opcode::LOAD_CONST,
+    Opcode::UPDATE,
+    Opcode::END
+  };
+  EXPECT_EQ(expected, opcodes());
+  // the update uses the register of the binding directly
+  EXPECT_EQ(chunk_.code[0].a, chunk_.code[1].a);
+}
+
+TEST_F(BytecodeTest, forall_body_ends_with_end) {
+  compile("function x : Int -> Int\n"
+          "init main\n"
+          "rule main = \n"
+          "    forall i in [1, 2] do x(i) := i\n");
+
+  std::vector<Opcode> expected = {
+    Opcode::LOAD_CONST,
+    Opcode::LOAD_CONST,
+    Opcode::LIST,
+    Opcode::FORALL,
+    Opcode::MOVE,
+    Opcode::UPDATE,
+    Opcode::END,
+    Opcode::END
+  };
+  EXPECT_EQ(expected, opcodes());
+  EXPECT_EQ(7, chunk_.code[3].target);
+  // arguments are copied into consecutive registers, the expression uses
+  // the register of the binding directly
+  EXPECT_EQ(chunk_.code[3].b, chunk_.code[4].b);
+  EXPECT_EQ(chunk_.code[4].a, chunk_.code[5].b);
+  EXPECT_EQ(chunk_.code[3].b, chunk_.code[5].a);
+}
+
+TEST_F(BytecodeTest, forall_over_range) {
+  compile("function n : -> Int\n"
+          "function x : Int -> Int\n"
+          "init main\n"
+          "rule main = \n"
+          "    forall i in [1..n] do x(i) := i\n");
+
+  // the bounds are evaluated at runtime, the range is not materialized
+  std::vector<Opcode> expected = {
+    Opcode::LOAD_CONST,
+    Opcode::READ,
+    Opcode::RANGE,
+    Opcode::FORALL,
+    Opcode::MOVE,
+    Opcode::UPDATE,
+    Opcode::END,
+    Opcode::END
+  };
+  EXPECT_EQ(expected, opcodes());
+  EXPECT_EQ(chunk_.code[0].a, chunk_.code[2].b);
+  EXPECT_EQ(chunk_.code[1].a, chunk_.code[2].c);
+}
+
+TEST_F(BytecodeTest, compile_short_circuit) {
+  RuleNode *rule = compile("function x : -> Int\n"
+                           "function b : -> Boolean\n"
+                           "init main\n"
+                           "rule main = \n"
+                           "    if x > 1 and b then x := 2\n");
+
+  IfThenElseNode *node = reinterpret_cast<IfThenElseNode*>(rule->child_);
+  Expression *cond = reinterpret_cast<Expression*>(node->condition_);
+  EXPECT_EQ(NodeType::BOOLEAN_EXPRESSION, cond->node_type_);
+  EXPECT_EQ(NodeType::INT_EXPRESSION, cond->left_->node_type_);
+
+  std::vector<Opcode> expected = {
+    Opcode::READ,
+    Opcode::LOAD_CONST,
+    Opcode::GREATER,
+    Opcode::JUMP_IF_BOOL,
+    Opcode::READ,
+    Opcode::BINARY,
+    Opcode::BRANCH,
+    Opcode::LOAD_CONST,
+    Opcode::UPDATE,
+    Opcode::END
+  };
+  EXPECT_EQ(expected, opcodes());
+  // `and` skips the read of b if the comparison is false
+  EXPECT_EQ(0, chunk_.code[3].b);
+  EXPECT_EQ(6, chunk_.code[3].target);
+  EXPECT_EQ(chunk_.code[2].a, chunk_.code[3].a);
+  EXPECT_EQ(chunk_.code[3].a, chunk_.code[6].a);
+}
+
+TEST_F(BytecodeTest, compile_case_dense_jump_table) {
+  compile("function x : -> Int\n"
+          "init main\n"
+          "rule main = \n"
+          "    case x of\n"
+          "      1: x := 10\n"
+          "      3: x := 30\n"
+          "      1: x := 0\n"
+          "      default: skip\n"
+          "    endcase\n");
+
+  EXPECT_EQ(Opcode::JUMP_TABLE, chunk_.code[1].op);
+  ASSERT_EQ(1, chunk_.jump_tables.size());
+  const JumpTable& table = chunk_.jump_tables[0];
+  EXPECT_EQ(1, table.first);
+  EXPECT_EQ(3, table.dense.size());
+  EXPECT_EQ(chunk_.code[1].target, table.default_target);
+
+  // the first matching label wins, missing labels jump to default
+  EXPECT_EQ(2, table.lookup(value_t((INT_T) 1)));
+  EXPECT_EQ(table.default_target, table.lookup(value_t((INT_T) 2)));
+  EXPECT_EQ(table.default_target, table.lookup(value_t((INT_T) 4)));
+  EXPECT_EQ(table.default_target, table.lookup(value_t()));
+}
+
+TEST_F(BytecodeTest, compile_case_sparse_jump_table) {
+  compile("function x : -> Int\n"
+          "init main\n"
+          "rule main = \n"
+          "    case x of\n"
+          "      -1000: x := 1\n"
+          "      1000000: x := 2\n"
+          "    endcase\n");
+
+  ASSERT_EQ(1, chunk_.jump_tables.size());
+  const JumpTable& table = chunk_.jump_tables[0];
+  EXPECT_TRUE(table.dense.empty());
+  EXPECT_EQ(2, table.targets.size());
+  // without default the case jumps to the end
+  EXPECT_EQ(chunk_.code.size() - 1, table.default_target);
+  EXPECT_EQ(table.default_target, table.lookup(value_t((INT_T) 0)));
+}
+
+TEST_F(BytecodeTest, compile_case_runtime_labels) {
+  compile("function x : -> Int\n"
+          "function y : -> Int\n"
+          "init main\n"
+          "rule main = \n"
+          "    case x of\n"
+          "      y: x := 1\n"
+          "      2: x := 2\n"
+          "    endcase\n");
+
+  // labels that are read from functions are compared in order
+  EXPECT_TRUE(chunk_.jump_tables.empty());
+  EXPECT_EQ(Opcode::JUMP_IF_EQ, chunk_.code[2].op);
+}
+
+TEST_F(BytecodeTest, reused_reads_are_registers) {
+  compile("function f : Int -> Int\n"
+          "function x : -> Int\n"
+          "function y : -> Int\n"
+          "init main\n"
+          "rule main = {\n"
+          "    x := f(1) + f(1)\n"
+          "    y := f(1)\n"
+          "}\n", true);
+
+  std::vector<Opcode> expected = {
+    Opcode::PAR_BEGIN,
+    Opcode::LOAD_CONST,
+    Opcode::READ,
+    Opcode::ADD,
+    Opcode::UPDATE,
+    Opcode::UPDATE,
+    Opcode::PAR_END,
+    Opcode::END
+  };
+  EXPECT_EQ(expected, opcodes());
+  // the value of the first read is used by all reads of f(1)
+  EXPECT_EQ(chunk_.code[2].a, chunk_.code[3].b);
+  EXPECT_EQ(chunk_.code[2].a, chunk_.code[3].c);
+  EXPECT_EQ(chunk_.code[2].a, chunk_.code[5].a);
+}
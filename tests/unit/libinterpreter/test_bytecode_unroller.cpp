@@ -0,0 +1,61 @@
+// gtest macros raise -Wsign-compare
+#pragma GCC diagnostic ignored "-Wsign-compare"
+
+#include <sstream>
+#include <string>
+
+#include "specification_test.h"
+
+#include "libinterpreter/bytecode_unroller.h"
+
+class BytecodeUnrollerTest: public SpecificationTest {
+  protected:
+    std::string generate(const std::string& spec) {
+      parse_and_specialize(spec);
+
+      std::stringstream out;
+      BytecodeUnroller unroller(driver_, spec);
+      unroller.generate(out);
+      return out.str();
+    }
+
+    bool contains(const std::string& code, const std::string& str) {
+      return code.find(str) != std::string::npos;
+    }
+};
+
+TEST_F(BytecodeUnrollerTest, rules_are_registered_with_instruction_count) {
+  const std::string code = generate("function x : -> Int\n"
+                                    "init main\n"
+                                    "rule main = {\n"
+                                    "    x := 1 + 2\n"
+                                    "}\n");
+
+  EXPECT_TRUE(contains(code, "static void rule_0(const value_t arguments[]) {"));
+  // the runtime checks the instruction count against the embedded specification
+  EXPECT_TRUE(contains(code, "{\"main\", rule_0, &chunk_rule_0, 7},"));
+  EXPECT_TRUE(contains(code, "CASM_UNROLLED_INT_OP("));
+  EXPECT_TRUE(contains(code, "unroller_runtime->update(Opcode::UPDATE"));
+}
+
+TEST_F(BytecodeUnrollerTest, direct_calls_and_derived_functions) {
+  const std::string code = generate("function x : -> Int\n"
+                                    "derived twice(a : Int) = a * 2\n"
+                                    "init main\n"
+                                    "rule set(a : Int) = x := twice(a)\n"
+                                    "rule main = call set(1)\n");
+
+  EXPECT_TRUE(contains(code, "static value_t derived_0(const value_t arguments[]) {"));
+  EXPECT_TRUE(contains(code, "{\"twice\", derived_0, &chunk_derived_0, "));
+  // rules are named in the order of the rules map
+  EXPECT_TRUE(contains(code, "{\"main\", rule_0, &chunk_rule_0, "));
+  EXPECT_TRUE(contains(code, "{\"set\", rule_1, &chunk_rule_1, "));
+  EXPECT_TRUE(contains(code, "rule_1(&r["));
+}
+
+TEST_F(BytecodeUnrollerTest, source_is_embedded) {
+  const std::string code = generate("init main\n"
+                                    "rule main = print \"a \\\"quoted\\\" string\"\n");
+
+  EXPECT_TRUE(contains(code, "\"rule main = print \\\"a \\\\\\\"quoted\\\\\\\" string\\\"\\n\""));
+}
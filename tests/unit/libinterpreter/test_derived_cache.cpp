@@ -0,0 +1,116 @@
+// gtest macros raise -Wsign-compare
+#pragma GCC diagnostic ignored "-Wsign-compare"
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+#include "libinterpreter/derived_cache.h"
+
+class DerivedCacheTest: public ::testing::Test {
+  protected:
+    Type int_type = Type(TypeType::INT);
+    Type list_type = Type(TypeType::LIST, new Type(TypeType::INT));
+    std::vector<Type*> no_args;
+    std::vector<Type*> int_args = {&int_type};
+
+    Function state = Function("state", no_args, &int_type, nullptr);
+    Function other = Function("other", no_args, &int_type, nullptr);
+    Function derived = Function("derived", int_args, nullptr, &int_type);
+    Function list_derived = Function("list_derived", no_args, nullptr, &list_type);
+
+    size_t num_symbols() const {
+      return std::max({state.id, other.id, derived.id, list_derived.id}) + 1;
+    }
+};
+
+TEST_F(DerivedCacheTest, test_results_are_reused) {
+  DerivedCache cache(num_symbols());
+  cache.enabled = true;
+  size_t calls = 0;
+  auto compute = [&]() {
+    calls += 1;
+    cache.read(state.id);
+    return value_t((INT_T) 42);
+  };
+
+  const value_t one[] = {value_t((INT_T) 1)};
+  const value_t two[] = {value_t((INT_T) 2)};
+  EXPECT_EQ(42, cache.get(&derived, one, 1, compute).value.integer);
+  EXPECT_EQ(42, cache.get(&derived, one, 1, compute).value.integer);
+  EXPECT_EQ(1, calls);
+  cache.get(&derived, two, 1, compute);
+  EXPECT_EQ(2, calls);
+  EXPECT_EQ(2, cache.size());
+
+  // undef arguments are never cached
+  const value_t undef[] = {value_t()};
+  cache.get(&derived, undef, 1, compute);
+  cache.get(&derived, undef, 1, compute);
+  EXPECT_EQ(4, calls);
+
+  // list results live in the list arena of the step
+  cache.get(&list_derived, nullptr, 0, compute);
+  cache.get(&list_derived, nullptr, 0, compute);
+  EXPECT_EQ(6, calls);
+  EXPECT_EQ(2, cache.size());
+}
+
+TEST_F(DerivedCacheTest, test_updates_invalidate_dependent_entries) {
+  DerivedCache cache(num_symbols());
+  cache.enabled = true;
+  size_t calls = 0;
+  const value_t one[] = {value_t((INT_T) 1)};
+  const value_t two[] = {value_t((INT_T) 2)};
+  auto reads_state = [&]() {
+    calls += 1;
+    cache.read(state.id);
+    return value_t((INT_T) 1);
+  };
+  auto reads_other = [&]() {
+    calls += 1;
+    cache.read(other.id);
+    return value_t((INT_T) 2);
+  };
+
+  cache.get(&derived, one, 1, reads_state);
+  cache.get(&derived, two, 1, reads_other);
+  EXPECT_EQ(2, calls);
+
+  // updates of the current step can be visible, the entry is not used
+  cache.write(state.id);
+  cache.get(&derived, one, 1, reads_state);
+  EXPECT_EQ(3, calls);
+  cache.get(&derived, two, 1, reads_other);
+  EXPECT_EQ(3, calls);
+
+  cache.apply_updates();
+  EXPECT_EQ(1, cache.size());
+  cache.get(&derived, one, 1, reads_state);
+  cache.get(&derived, one, 1, reads_state);
+  EXPECT_EQ(4, calls);
+}
+
+TEST_F(DerivedCacheTest, test_nested_calls_inherit_reads) {
+  DerivedCache cache(num_symbols());
+  cache.enabled = true;
+  size_t calls = 0;
+  const value_t one[] = {value_t((INT_T) 1)};
+  const value_t two[] = {value_t((INT_T) 2)};
+  auto inner = [&]() {
+    calls += 1;
+    cache.read(state.id);
+    return value_t((INT_T) 1);
+  };
+  auto outer = [&]() {
+    calls += 1;
+    return cache.get(&derived, one, 1, inner);
+  };
+
+  cache.get(&derived, two, 1, outer);
+  EXPECT_EQ(2, calls);
+
+  cache.write(state.id);
+  cache.apply_updates();
+  EXPECT_EQ(0, cache.size());
+}
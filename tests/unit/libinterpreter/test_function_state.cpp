@@ -0,0 +1,198 @@
+// gtest macros raise -Wsign-compare
+#pragma GCC diagnostic ignored "-Wsign-compare"
+
+#include <cstring>
+
+#include "gtest/gtest.h"
+
+#include "libinterpreter/function_state.h"
+
+
+class FunctionStateTest: public ::testing::Test {
+  protected:
+    virtual void SetUp() { }
+
+    SymbolTable symbol_table;
+    Type int_type = Type(TypeType::INT);
+};
+
+TEST_F(FunctionStateTest, test_nullary_function_is_dense) {
+  std::vector<Type*> args;
+  Function func("f", args, &int_type, nullptr);
+  FunctionState state(&func, symbol_table, false);
+
+  EXPECT_TRUE(state.is_dense());
+  EXPECT_EQ(nullptr, state.find(nullptr, 0));
+
+  value_t& v = state.get(nullptr, 0);
+  v = value_t((INT_T) 42);
+  EXPECT_EQ(&v, state.find(nullptr, 0));
+  EXPECT_EQ(42, state.find(nullptr, 0)->value.integer);
+}
+
+TEST_F(FunctionStateTest, test_bounded_arguments_are_dense) {
+  Type bool_type(TypeType::BOOLEAN);
+  Type subrange_type(TypeType::INT);
+  subrange_type.subrange_start = -2;
+  subrange_type.subrange_end = 2;
+
+  std::vector<Type*> args = {&subrange_type, &bool_type};
+  Function func("f", args, &int_type, nullptr);
+  FunctionState state(&func, symbol_table, false);
+  EXPECT_TRUE(state.is_dense());
+
+  uint64_t key1[2] = {(uint64_t) -2, 1};
+  uint64_t key2[2] = {2, 0};
+  uint64_t out_of_range[2] = {3, 0};
+
+  state.get(key1, 0) = value_t((INT_T) 1);
+  state.get(key2, 0) = value_t((INT_T) 2);
+  EXPECT_EQ(1, state.find(key1, 0)->value.integer);
+  EXPECT_EQ(2, state.find(key2, 0)->value.integer);
+  EXPECT_EQ(nullptr, state.find(out_of_range, 0));
+  ASSERT_THROW(state.get(out_of_range, 0), RuntimeException);
+
+  std::vector<std::pair<INT_T, uint64_t>> visited;
+  state.for_each([&](uint64_t *args, uint16_t, const value_t&) {
+    visited.push_back(std::make_pair((INT_T) args[0], args[1]));
+  });
+  ASSERT_EQ(2, visited.size());
+  EXPECT_EQ(std::make_pair((INT_T) -2, (uint64_t) 1), visited[0]);
+  EXPECT_EQ(std::make_pair((INT_T) 2, (uint64_t) 0), visited[1]);
+}
+
+TEST_F(FunctionStateTest, test_dense_for_each_with_many_arguments) {
+  Type bool_type(TypeType::BOOLEAN);
+  std::vector<Type*> args(12, &bool_type);
+  Function func("f", args, &int_type, nullptr);
+  FunctionState state(&func, symbol_table, false);
+  EXPECT_TRUE(state.is_dense());
+
+  uint64_t key[12] = {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+  state.get(key, 0) = value_t((INT_T) 1);
+
+  size_t visited = 0;
+  state.for_each([&](uint64_t *args, uint16_t, const value_t&) {
+    EXPECT_EQ(0, std::memcmp(key, args, sizeof(key)));
+    visited += 1;
+  });
+  EXPECT_EQ(1, visited);
+}
+
+TEST_F(FunctionStateTest, test_unbounded_arguments_use_flat_map) {
+  std::vector<Type*> args = {&int_type, &int_type};
+  Function func("f", args, &int_type, nullptr);
+  FunctionState state(&func, symbol_table, false);
+  EXPECT_EQ(FunctionState::Storage::FLAT, state.storage());
+
+  uint64_t key1[2] = {1, 2};
+  uint64_t key2[2] = {2, 1};
+  value_t& v1 = state.get(key1, 0);
+  v1 = value_t((INT_T) 12);
+  state.get(key2, 0) = value_t((INT_T) 21);
+
+  uint64_t lookup[2] = {1, 2};
+  EXPECT_EQ(&v1, state.find(lookup, 0));
+  EXPECT_EQ(21, state.find(key2, 0)->value.integer);
+}
+
+TEST_F(FunctionStateTest, test_symbolic_mode_uses_map) {
+  std::vector<Type*> args;
+  Function func("f", args, &int_type, nullptr);
+  FunctionState state(&func, symbol_table, true);
+  EXPECT_EQ(FunctionState::Storage::MAP, state.storage());
+
+  state.get(nullptr, 0) = value_t((INT_T) 1);
+  EXPECT_EQ(1, state.find(nullptr, 0)->value.integer);
+}
+
+TEST_F(FunctionStateTest, test_erase_reclaims_entries) {
+  std::vector<Type*> args = {&int_type};
+  Function func("f", args, &int_type, nullptr);
+  FunctionState state(&func, symbol_table, false);
+
+  uint64_t key1[1] = {1};
+  uint64_t key2[1] = {2};
+  value_t& v1 = state.get(key1, 0);
+  v1 = value_t((INT_T) 1);
+
+  state.erase(key1, 0);
+  EXPECT_EQ(nullptr, state.find(key1, 0));
+
+  // the entry of the erased key is reused
+  value_t& v2 = state.get(key2, 0);
+  EXPECT_EQ(&v1, &v2);
+  EXPECT_TRUE(v2.is_undef());
+}
+
+class ArgumentsMapTest: public ::testing::Test {
+  protected:
+    virtual void SetUp() { }
+
+    Type int_type = Type(TypeType::INT);
+};
+
+TEST_F(ArgumentsMapTest, test_argument_order_matters) {
+  ArgumentsMap map({&int_type, &int_type});
+
+  uint64_t key1[2] = {1, 2};
+  uint64_t key2[2] = {2, 1};
+  map.get(key1, 0) = value_t((INT_T) 12);
+  map.get(key2, 0) = value_t((INT_T) 21);
+
+  EXPECT_EQ(2, map.size());
+  EXPECT_EQ(12, map.find(key1, 0)->value.integer);
+  EXPECT_EQ(21, map.find(key2, 0)->value.integer);
+}
+
+TEST_F(ArgumentsMapTest, test_values_are_stable_while_growing) {
+  ArgumentsMap map({&int_type});
+
+  std::vector<value_t*> values;
+  for (uint64_t i = 0; i < 10000; i++) {
+    value_t& v = map.get(&i, 0);
+    v = value_t((INT_T) i);
+    values.push_back(&v);
+  }
+  EXPECT_EQ(10000, map.size());
+
+  for (uint64_t i = 0; i < 10000; i++) {
+    ASSERT_EQ(values[i], map.find(&i, 0));
+    EXPECT_EQ(i, values[i]->value.integer);
+  }
+
+  // get of a present key returns the existing value
+  uint64_t key = 42;
+  EXPECT_EQ(values[42], &map.get(&key, 0));
+  EXPECT_EQ(10000, map.size());
+}
+
+TEST_F(ArgumentsMapTest, test_erase) {
+  ArgumentsMap map({&int_type});
+
+  for (uint64_t i = 0; i < 100; i++) {
+    map.get(&i, 0) = value_t((INT_T) i);
+  }
+  for (uint64_t i = 0; i < 100; i += 2) {
+    EXPECT_TRUE(map.erase(&i, 0));
+  }
+  uint64_t missing = 1000;
+  EXPECT_FALSE(map.erase(&missing, 0));
+  EXPECT_EQ(50, map.size());
+
+  for (uint64_t i = 0; i < 100; i++) {
+    if (i % 2 == 0) {
+      EXPECT_EQ(nullptr, map.find(&i, 0));
+    } else {
+      ASSERT_NE(nullptr, map.find(&i, 0));
+      EXPECT_EQ(i, map.find(&i, 0)->value.integer);
+    }
+  }
+
+  size_t visited = 0;
+  map.for_each([&](uint64_t *args, uint16_t, const value_t& v) {
+    EXPECT_EQ(args[0], v.value.integer);
+    visited += 1;
+  });
+  EXPECT_EQ(50, visited);
+}
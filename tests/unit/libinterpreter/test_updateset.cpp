@@ -0,0 +1,160 @@
+// gtest macros raise -Wsign-compare
+#pragma GCC diagnostic ignored "-Wsign-compare"
+
+#include "gtest/gtest.h"
+
+#include "libinterpreter/updateset.h"
+
+
+class UpdatesetTest: public ::testing::Test {
+  protected:
+    virtual void SetUp() { }
+
+    casm_updateset uset;
+    uint64_t locations[4096];
+};
+
+TEST_F(UpdatesetTest, test_add_and_get) {
+  casm_update *u1 = uset.new_update(2);
+  EXPECT_EQ(2, u1->num_args);
+  EXPECT_EQ(reinterpret_cast<uint64_t*>(u1 + 1), u1->args);
+
+  EXPECT_EQ(nullptr, uset.add(&locations[0], u1));
+  EXPECT_EQ(u1, uset.get(&locations[0], 0));
+  EXPECT_EQ(nullptr, uset.get(&locations[1], 0));
+  EXPECT_EQ(nullptr, uset.get(&locations[0], 1));
+  EXPECT_EQ(1, uset.size());
+}
+
+TEST_F(UpdatesetTest, test_add_conflict_only_in_parallel_pseudostate) {
+  casm_update *u1 = uset.new_update(0);
+  casm_update *u2 = uset.new_update(0);
+
+  uset.add(&locations[0], u1);
+  EXPECT_EQ(u1, uset.add(&locations[0], u2));
+
+  CASM_UPDATESET_FORK_SEQ(&uset);
+  uset.add(&locations[1], u1);
+  EXPECT_EQ(nullptr, uset.add(&locations[1], u2));
+  EXPECT_EQ(u2, uset.get(&locations[1], 1));
+}
+
+TEST_F(UpdatesetTest, test_merge_par_overwrites) {
+  casm_update *u1 = uset.new_update(0);
+  casm_update *u2 = uset.new_update(0);
+
+  CASM_UPDATESET_FORK_SEQ(&uset);
+  uset.add(&locations[0], u1);
+  CASM_UPDATESET_FORK_PAR(&uset);
+  EXPECT_TRUE(CASM_UPDATESET_EMPTY(&uset));
+  uset.add(&locations[0], u2);
+  uset.add(&locations[1], u2);
+  EXPECT_FALSE(CASM_UPDATESET_EMPTY(&uset));
+
+  uset.merge_par();
+  EXPECT_EQ(1, uset.pseudostate);
+  EXPECT_EQ(u2, uset.get(&locations[0], 1));
+  EXPECT_EQ(u2, uset.get(&locations[1], 1));
+  EXPECT_EQ(nullptr, uset.get(&locations[0], 2));
+  EXPECT_EQ(2, uset.size());
+}
+
+TEST_F(UpdatesetTest, test_merge_seq_reports_conflict) {
+  casm_update *u1 = uset.new_update(0);
+  casm_update *u2 = uset.new_update(0);
+
+  uset.add(&locations[0], u1);
+  CASM_UPDATESET_FORK_SEQ(&uset);
+  uset.add(&locations[1], u2);
+  EXPECT_EQ(nullptr, uset.merge_seq());
+
+  CASM_UPDATESET_FORK_SEQ(&uset);
+  uset.add(&locations[0], u2);
+  EXPECT_EQ(u2, uset.merge_seq());
+}
+
+TEST_F(UpdatesetTest, test_for_each_newest_first) {
+  casm_update *updates[3];
+  for (int i=0; i < 3; i++) {
+    updates[i] = uset.new_update(0);
+    uset.add(&locations[i], updates[i]);
+  }
+
+  std::vector<casm_update*> visited;
+  uset.for_each([&](casm_update *u) { visited.push_back(u); });
+
+  ASSERT_EQ(3, visited.size());
+  EXPECT_EQ(updates[2], visited[0]);
+  EXPECT_EQ(updates[1], visited[1]);
+  EXPECT_EQ(updates[0], visited[2]);
+}
+
+TEST_F(UpdatesetTest, test_grow_and_clear) {
+  for (int i=0; i < 4096; i++) {
+    casm_update *u = uset.new_update(3);
+    u->args[2] = i;
+    uset.add(&locations[i], u);
+  }
+  EXPECT_EQ(4096, uset.size());
+
+  for (int i=0; i < 4096; i++) {
+    ASSERT_EQ(i, uset.get(&locations[i], 0)->args[2]);
+  }
+
+  uset.clear();
+  EXPECT_EQ(0, uset.size());
+  EXPECT_TRUE(CASM_UPDATESET_EMPTY(&uset));
+  EXPECT_EQ(nullptr, uset.get(&locations[42], 0));
+}
+
+TEST_F(UpdatesetTest, test_get_newest_visible_update) {
+  casm_update *u1 = uset.new_update(0);
+  casm_update *u2 = uset.new_update(0);
+  casm_update *u3 = uset.new_update(0);
+
+  CASM_UPDATESET_FORK_SEQ(&uset);
+  uset.add(&locations[0], u1);
+  EXPECT_EQ(u1, uset.get(&locations[0]));
+
+  // updates in parallel pseudostates are not visible
+  CASM_UPDATESET_FORK_PAR(&uset);
+  uset.add(&locations[0], u2);
+  EXPECT_EQ(u1, uset.get(&locations[0]));
+
+  CASM_UPDATESET_FORK_SEQ(&uset);
+  EXPECT_EQ(u1, uset.get(&locations[0]));
+  uset.add(&locations[0], u3);
+  uset.add(&locations[1], u3);
+  EXPECT_EQ(u3, uset.get(&locations[0]));
+  EXPECT_EQ(u3, uset.get(&locations[1]));
+
+  // merging into the parallel pseudostate restores the older versions
+  EXPECT_EQ(u3, uset.merge_seq());
+}
+
+TEST_F(UpdatesetTest, test_get_after_merges) {
+  casm_update *u1 = uset.new_update(0);
+  casm_update *u2 = uset.new_update(0);
+
+  CASM_UPDATESET_FORK_SEQ(&uset);
+  uset.add(&locations[0], u1);
+
+  CASM_UPDATESET_FORK_PAR(&uset);
+  CASM_UPDATESET_FORK_SEQ(&uset);
+  uset.add(&locations[0], u2);
+  uset.add(&locations[1], u2);
+  EXPECT_EQ(nullptr, uset.merge_seq());
+  EXPECT_EQ(u1, uset.get(&locations[0]));
+  EXPECT_EQ(nullptr, uset.get(&locations[1]));
+
+  uset.merge_par();
+  EXPECT_EQ(u2, uset.get(&locations[0]));
+  EXPECT_EQ(u2, uset.get(&locations[1]));
+
+  uset.merge_seq();
+  EXPECT_EQ(nullptr, uset.get(&locations[0]));
+  EXPECT_EQ(2, uset.size());
+
+  uset.clear();
+  EXPECT_EQ(nullptr, uset.get(&locations[0]));
+}
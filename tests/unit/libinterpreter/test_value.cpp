@@ -2,6 +2,7 @@
 #pragma GCC diagnostic ignored "-Wsign-compare"
 
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 
 #include "gtest/gtest.h"
@@ -38,14 +39,14 @@ TEST_F(ListIteratorTest, test_iterator_eq_begin_end) {
   EXPECT_TRUE(list.begin() != list.end());
 }
 
-TEST_F(ListIteratorTest, test_iterator_head_and_tail_list) {
+TEST_F(ListIteratorTest, test_iterator_head_and_append_list) {
   BottomList list;
   list.values = { value_t((INT_T)1), value_t((INT_T)2), value_t((INT_T)3) };
 
-  TailList tail(nullptr, value_t((INT_T)5));
-  list.tail = &tail;
+  AppendList appended(&list, std::make_shared<std::vector<value_t>>(1, value_t((INT_T)5)),
+                      0, 1);
 
-  HeadList head(&list, value_t((INT_T)4));
+  HeadList head(&appended, value_t((INT_T)4));
 
   auto iter = head.begin();
   EXPECT_EQ(4, (*iter).value.integer);
@@ -66,6 +67,29 @@ TEST_F(ListIteratorTest, test_iterator_head_and_tail_list) {
   EXPECT_EQ(list.end(), iter);
 }
 
+TEST_F(ListIteratorTest, test_iterator_range_list) {
+  RangeList range(3, 1);
+  EXPECT_TRUE(range.is_range());
+  EXPECT_EQ(3, range.count);
+
+  auto iter = range.begin();
+  EXPECT_EQ(3, (*iter).value.integer);
+
+  iter++;
+  EXPECT_EQ(2, (*iter).value.integer);
+
+  auto copy = iter;
+  iter++;
+  EXPECT_EQ(1, (*iter).value.integer);
+  EXPECT_EQ(2, (*copy).value.integer);
+
+  iter++;
+  EXPECT_EQ(range.end(), iter);
+
+  RangeList empty(1, 1, 0);
+  EXPECT_EQ(empty.end(), empty.begin());
+}
+
 
 class ListTest: public ::testing::Test {
   protected:
@@ -76,18 +100,21 @@ TEST_F(ListTest, test_list_eq_sublists) {
   BottomList list;
   list.values = { value_t((INT_T)1), value_t((INT_T)2), value_t((INT_T)3) };
 
-  TailList tail(nullptr, value_t((INT_T)5));
-  list.tail = &tail;
+  auto buffer = std::make_shared<std::vector<value_t>>(1, value_t((INT_T)5));
+  AppendList appended(&list, buffer, 0, 1);
+
+  HeadList head(&appended, value_t((INT_T)4));
 
-  HeadList head(&list, value_t((INT_T)4));
+  BottomList empty;
+  AppendList tail(&empty, buffer, 0, 1);
 
   EXPECT_EQ(true, head == head);
-  EXPECT_EQ(true, list == list);
+  EXPECT_EQ(true, appended == appended);
   EXPECT_EQ(true, tail == tail);
 
   EXPECT_EQ(true, tail != head);
-  EXPECT_EQ(true, head != list);
-  EXPECT_EQ(true, list != tail);
+  EXPECT_EQ(true, head != appended);
+  EXPECT_EQ(true, appended != tail);
 }
 
 TEST_F(ListTest, test_list_eq_head_lists) {
@@ -129,3 +156,356 @@ TEST_F(ListTest, test_list_eq_head_bottom_lists) {
   EXPECT_TRUE(bottom1 != h2);
 
 }
+
+TEST_F(ListTest, test_list_eq_range_lists) {
+  RangeList r1(1, 3);
+  RangeList r2(1, 1, 3);
+  RangeList r3(3, 1);
+
+  BottomList bottom;
+  bottom.values = { value_t((INT_T)3), value_t((INT_T)2), value_t((INT_T)1) };
+
+  EXPECT_TRUE(r1 == r2);
+  EXPECT_TRUE(r1 != r3);
+  EXPECT_TRUE(r1 == bottom);
+  EXPECT_TRUE(bottom == r1);
+  EXPECT_TRUE(RangeList(5, 5) == RangeList(5, -1, 1));
+}
+
+TEST_F(ListTest, test_range_list_materialize) {
+  RangeList range(1, 3);
+  range.materialize();
+
+  // a materialized range is a regular BottomList with reversed values
+  EXPECT_TRUE(range.is_bottom());
+  ASSERT_EQ(3, range.values.size());
+  EXPECT_EQ(3, range.values[0].value.integer);
+  EXPECT_EQ(1, range.values[2].value.integer);
+
+  BottomList bottom;
+  bottom.values = { value_t((INT_T)3), value_t((INT_T)2), value_t((INT_T)1) };
+  EXPECT_TRUE(range == bottom);
+}
+
+TEST_F(ListTest, test_list_size_and_nth) {
+  BottomList list;
+  list.values = { value_t((INT_T)3), value_t((INT_T)2), value_t((INT_T)1) };
+
+  auto buffer = std::make_shared<std::vector<value_t>>();
+  buffer->push_back(value_t((INT_T)4));
+  buffer->push_back(value_t((INT_T)5));
+  AppendList appended(&list, buffer, 0, 2);
+
+  HeadList head1(&appended, value_t((INT_T)0));
+  HeadList head2(&head1, value_t((INT_T)-1));
+  EXPECT_EQ(&appended, head2.base);
+  EXPECT_EQ(2, head2.depth);
+
+  // [-1, 0, 1, 2, 3, 4, 5]
+  EXPECT_EQ(3, list.size());
+  EXPECT_EQ(5, appended.size());
+  EXPECT_EQ(7, head2.size());
+  EXPECT_EQ(-1, head2.nth(0).value.integer);
+  EXPECT_EQ(0, head2.nth(1).value.integer);
+  EXPECT_EQ(1, head2.nth(2).value.integer);
+  EXPECT_EQ(4, head2.nth(5).value.integer);
+  EXPECT_EQ(5, head2.nth(6).value.integer);
+  EXPECT_TRUE(head2.nth(7).is_undef());
+
+  SkipList skip(2, &list);
+  EXPECT_EQ(1, skip.size());
+  EXPECT_EQ(3, skip.nth(0).value.integer);
+  EXPECT_TRUE(skip.nth(1).is_undef());
+  EXPECT_EQ(0, SkipList(6, &list).size());
+
+  RangeList range(5, 1);
+  EXPECT_EQ(5, range.size());
+  EXPECT_EQ(4, range.nth(1).value.integer);
+  EXPECT_TRUE(range.nth(5).is_undef());
+}
+
+TEST_F(ListTest, test_append_list_is_persistent) {
+  BottomList list;
+  list.values = { value_t((INT_T)1) };
+
+  ListArena arena;
+  AppendList first(&list, std::make_shared<std::vector<value_t>>(1, value_t((INT_T)2)), 0, 1);
+  AppendList *second = first.append(arena, value_t((INT_T)3));
+  // appending to an older version must not change the newer one
+  AppendList *other = first.append(arena, value_t((INT_T)4));
+
+  EXPECT_EQ(first.buffer, second->buffer);
+  EXPECT_NE(first.buffer, other->buffer);
+  EXPECT_EQ("[ 1, 2 ]", first.to_str());
+  EXPECT_EQ("[ 1, 2, 3 ]", second->to_str());
+  EXPECT_EQ("[ 1, 2, 4 ]", other->to_str());
+
+  BottomList *collected = other->collect();
+  EXPECT_EQ(&list, collected);
+  EXPECT_EQ("[ 1, 2, 4 ]", collected->to_str());
+}
+
+TEST_F(ListTest, test_bottom_list_back) {
+  BottomList list;
+  list.values = { value_t((INT_T)2), value_t((INT_T)1) };
+  list.back = { value_t((INT_T)0), value_t((INT_T)3), value_t((INT_T)4) };
+  list.back_begin = 1;
+
+  EXPECT_EQ("[ 1, 2, 3, 4 ]", list.to_str());
+  EXPECT_EQ(4, list.size());
+  EXPECT_EQ(3, list.nth(2).value.integer);
+  EXPECT_TRUE(list.nth(4).is_undef());
+
+  SkipList skip(3, &list);
+  EXPECT_EQ("[ 4 ]", skip.to_str());
+  EXPECT_EQ(1, skip.size());
+
+  BottomList *collected = skip.collect();
+  EXPECT_EQ(&list, collected);
+  EXPECT_EQ("[ 4 ]", collected->to_str());
+  EXPECT_EQ(0, collected->values.size());
+}
+
+TEST_F(ListTest, test_collect_append_reuses_storage) {
+  BottomList list;
+  list.values = { value_t((INT_T)1) };
+  list.bump_usage();
+
+  auto buffer = std::make_shared<std::vector<value_t>>();
+  buffer->push_back(value_t((INT_T)2));
+  buffer->push_back(value_t((INT_T)3));
+  AppendList appended(&list, buffer, 0, 2);
+  HeadList head(&appended, value_t((INT_T)0));
+
+  // the old version is still referenced, so collecting must copy
+  head.bump_usage();
+  BottomList *copy = head.collect();
+  EXPECT_NE(&list, copy);
+  EXPECT_EQ("[ 0, 1, 2, 3 ]", copy->to_str());
+  EXPECT_EQ("[ 1 ]", list.to_str());
+  EXPECT_FALSE(copy->is_temporary());
+  delete copy;
+
+  // stored to two locations, but the old version is not referenced anymore
+  SkipList skip(1, &list);
+  AppendList rest(&skip, buffer, 0, 2);
+  rest.bump_usage();
+  BottomList *collected = rest.collect(2);
+  EXPECT_EQ(&list, collected);
+  EXPECT_EQ("[ 2, 3 ]", collected->to_str());
+}
+
+TEST_F(ListTest, test_decrease_usage_through_chains) {
+  BottomList list;
+  list.bump_usage();
+
+  HeadList head(&list, value_t((INT_T)1));
+  SkipList skip(1, &list);
+  head.bump_usage();
+  skip.bump_usage();
+
+  EXPECT_EQ(nullptr, head.decrease_usage());
+  EXPECT_EQ(nullptr, skip.decrease_usage());
+  EXPECT_EQ(&list, list.decrease_usage());
+  EXPECT_FALSE(list.is_used());
+}
+
+TEST_F(ListTest, test_list_arena) {
+  ListArena arena;
+  BottomList *list = arena.make<BottomList>(
+      std::vector<value_t>{ value_t((INT_T)2), value_t((INT_T)1) });
+  HeadList *head = arena.make<HeadList>(list, value_t((INT_T)0));
+  EXPECT_EQ(2, arena.size());
+  EXPECT_TRUE(list->is_temporary());
+  EXPECT_EQ("[ 0, 1, 2 ]", head->to_str());
+
+  // storing moves the list out of the arena
+  head->bump_usage();
+  head->retain_elements();
+  std::unique_ptr<BottomList> stored(head->store(1));
+  EXPECT_FALSE(stored->is_temporary());
+  EXPECT_EQ("[ 0, 1, 2 ]", stored->to_str());
+
+  arena.clear();
+  EXPECT_EQ(0, arena.size());
+  for (int i = 0; i < 10000; i++) {
+    arena.make<SkipList>(1, stored.get());
+  }
+  EXPECT_EQ(10000, arena.size());
+  EXPECT_EQ("[ 0, 1, 2 ]", stored->to_str());
+}
+
+TEST_F(ListTest, test_intern_lists) {
+  BottomList bottom;
+  bottom.values = { value_t((INT_T)2), value_t((INT_T)1) };
+  HeadList h1(nullptr, value_t((INT_T)2));
+  HeadList h2(&h1, value_t((INT_T)1));
+  RangeList range(1, 3);
+
+  const InternedList *interned = InternedList::intern(&bottom);
+  EXPECT_EQ(interned, InternedList::intern(&h2));
+  EXPECT_NE(interned, InternedList::intern(&range));
+  EXPECT_EQ("[ 1, 2 ]", interned->to_str());
+  EXPECT_EQ(interned, bottom.interned);
+  Type list_type(TypeType::LIST);
+  EXPECT_EQ(interned->hash, hash_uint64_value(&list_type, (uint64_t) interned));
+
+  // folding changes the list in place, the interned version must not change
+  HeadList head(&bottom, value_t((INT_T)0));
+  EXPECT_EQ(&bottom, head.collect());
+  EXPECT_EQ(nullptr, bottom.interned);
+  EXPECT_EQ("[ 1, 2 ]", interned->to_str());
+  EXPECT_NE(interned, InternedList::intern(&bottom));
+}
+
+TEST_F(ListTest, test_intern_nested_lists) {
+  BottomList inner1;
+  inner1.values = { value_t((INT_T)1) };
+  HeadList inner2(nullptr, value_t((INT_T)1));
+
+  Type list_type(TypeType::LIST);
+  BottomList outer1;
+  outer1.values = { value_t(list_type, &inner1) };
+  BottomList outer2;
+  outer2.values = { value_t(list_type, &inner2) };
+
+  const InternedList *interned = InternedList::intern(&outer1);
+  EXPECT_EQ(interned, InternedList::intern(&outer2));
+  EXPECT_EQ(InternedList::intern(&inner1), interned->values[0].value.list);
+}
+
+TEST_F(ListTest, test_free_unused_interned_lists) {
+  free_unused_values();
+  const size_t before = InternedList::count();
+
+  Type list_type(TypeType::LIST);
+  ListArena arena;
+  for (INT_T i = 0; i < 1000; i++) {
+    // reads with a fresh list argument in every step
+    BottomList *inner = arena.make<BottomList>(std::vector<value_t>{ value_t(i) });
+    const value_t str(string_t::intern("element " + std::to_string(i)));
+    BottomList *list = arena.make<BottomList>(
+        std::vector<value_t>{ value_t(list_type, inner), str, value_t(i) });
+    const InternedList *interned = InternedList::intern(list);
+    EXPECT_EQ(interned, InternedList::intern(list));
+    EXPECT_EQ(before + 2, InternedList::count());
+    EXPECT_FALSE(str.value.string->pinned);
+
+    arena.clear();
+    free_unused_values();
+    ASSERT_EQ(before, InternedList::count());
+  }
+
+  // keys of functions are pinned, derived cache entries hold a reference
+  const InternedList *pinned;
+  const InternedList *used;
+  {
+    BottomList key;
+    key.values = { value_t((INT_T)1) };
+    pinned = InternedList::intern(&key);
+    pin_uint64_value(&list_type, (uint64_t) pinned);
+    BottomList cached;
+    cached.values = { value_t((INT_T)2) };
+    used = InternedList::intern(&cached);
+    InternedList::bump_usage(used);
+  }
+  free_unused_values();
+  EXPECT_EQ(before + 2, InternedList::count());
+
+  BottomList equal_key;
+  equal_key.values = { value_t((INT_T)1) };
+  EXPECT_EQ(pinned, InternedList::intern(&equal_key));
+  InternedList::decrease_usage(used);
+  free_unused_values();
+  EXPECT_EQ(before + 1, InternedList::count());
+}
+
+class StringTest: public ::testing::Test {
+  protected:
+    virtual void SetUp() { }
+};
+
+TEST_F(StringTest, test_intern_strings) {
+  const string_t *s1 = string_t::intern("interned");
+  const string_t *s2 = string_t::intern(std::string("inter") + "ned");
+  EXPECT_EQ(s1, s2);
+  EXPECT_NE(s1, string_t::intern("other"));
+  EXPECT_EQ("interned", s1->str);
+  EXPECT_EQ(std::hash<std::string>()("interned"), s1->hash);
+
+  Type string_type(TypeType::STRING);
+  EXPECT_EQ(s1->hash, hash_uint64_value(&string_type, (uint64_t) s1));
+  EXPECT_TRUE(eq_uint64_value(&string_type, (uint64_t) s1, (uint64_t) s2));
+  EXPECT_EQ(value_t(s1), value_t(s2));
+  EXPECT_EQ(std::hash<value_t>()(value_t(s1)), s1->hash);
+  string_t::free_unused();
+}
+
+TEST_F(StringTest, test_free_unused_strings) {
+  const string_t *used = string_t::intern("used");
+  string_t::bump_usage(used);
+  const string_t *pinned = string_t::intern("pinned");
+  string_t::pin(pinned);
+  string_t::intern("unused");
+  string_t::free_unused();
+
+  // the surviving strings are still found in the table
+  EXPECT_EQ(used, string_t::intern("used"));
+  EXPECT_EQ(pinned, string_t::intern("pinned"));
+  EXPECT_EQ("unused", string_t::intern("unused")->str);
+
+  string_t::decrease_usage(used);
+  string_t::free_unused();
+  EXPECT_EQ("used", string_t::intern("used")->str);
+  string_t::free_unused();
+}
+
+TEST_F(StringTest, test_intern_literals) {
+  const string_t *cache = nullptr;
+  const string_t *literal = string_t::literal("literal", cache);
+  EXPECT_EQ(literal, cache);
+  EXPECT_EQ(literal, string_t::literal("literal", cache));
+  EXPECT_TRUE(literal->pinned);
+  string_t::free_unused();
+  EXPECT_EQ(literal, string_t::intern("literal"));
+}
+
+class RationalTest: public ::testing::Test {
+  protected:
+    virtual void SetUp() { }
+};
+
+TEST_F(RationalTest, test_rationals_are_reduced) {
+  rational_t r(4, -6);
+  EXPECT_EQ(-2, r.numerator);
+  EXPECT_EQ(3, r.denominator);
+  EXPECT_EQ("-2/3", r.to_str());
+
+  rational_t sum = rational_t(1, 6) + rational_t(1, 3);
+  EXPECT_EQ(1, sum.numerator);
+  EXPECT_EQ(2, sum.denominator);
+  EXPECT_EQ("2", (rational_t(4, 3) * rational_t(3, 2)).to_str());
+  EXPECT_EQ("0", (rational_t(1, 3) - rational_t(2, 6)).to_str());
+
+  rational_t large(1, 3000000000LL);
+  EXPECT_THROW(large * large * large, RuntimeException);
+}
+
+TEST_F(RationalTest, test_inline_and_interned_rationals) {
+  const value_t small(rational_t(1, 2));
+  EXPECT_EQ(1, small.value.integer & 1);
+  EXPECT_EQ(rational_t(1, 2), small.to_rational());
+  EXPECT_EQ(rational_t(-7, 5), value_t(rational_t(-7, 5)).to_rational());
+  EXPECT_EQ(small, value_t(rational_t(2, 4)));
+
+  const value_t large(rational_t(1, 3000000000LL));
+  EXPECT_EQ(0, large.value.integer & 1);
+  EXPECT_EQ(rational_t(1, 3000000000LL), large.to_rational());
+  EXPECT_EQ(large.value.rat, value_t(rational_t(2, 6000000000LL)).value.rat);
+  EXPECT_NE(small, large);
+
+  Type rational_type(TypeType::RATIONAL);
+  EXPECT_TRUE(eq_uint64_value(&rational_type, large.to_uint64_t(),
+                              value_t(rational_t(1, 3000000000LL)).to_uint64_t()));
+  free_unused_values();
+}
@@ -0,0 +1,108 @@
+// gtest macros raise -Wsign-compare
+#pragma GCC diagnostic ignored "-Wsign-compare"
+
+#include <string>
+
+#include "specification_test.h"
+
+#include "libmiddle/constant_folding_visitor.h"
+
+class ConstantFoldingTest: public SpecificationTest {
+  protected:
+    RuleNode *fold(const std::string& spec) {
+      parse_and_typecheck(spec);
+
+      AstWalker<ConstantFoldingVisitor, AtomNode*> folding_walker(visitor_);
+      folding_walker.walk_specification(root_);
+      return driver_.get_init_rule();
+    }
+
+    ConstantFoldingVisitor visitor_;
+};
+
+TEST_F(ConstantFoldingTest, fold_arithmetic) {
+  RuleNode *rule = fold("function x : -> Int\n"
+                        "init main\n"
+                        "rule main = \n"
+                        "    x := 1 + 2 * 3\n");
+
+  UpdateNode *update = reinterpret_cast<UpdateNode*>(rule->child_);
+  ASSERT_EQ(NodeType::INT_ATOM, update->expr_->node_type_);
+  EXPECT_EQ(7, reinterpret_cast<IntAtom*>(update->expr_)->val_);
+  EXPECT_EQ(2, visitor_.num_folded);
+}
+
+TEST_F(ConstantFoldingTest, keep_division_by_zero) {
+  RuleNode *rule = fold("function x : -> Int\n"
+                        "init main\n"
+                        "rule main = \n"
+                        "    x := 1 / (2 - 2)\n");
+
+  // the division must still fail at runtime
+  UpdateNode *update = reinterpret_cast<UpdateNode*>(rule->child_);
+  ASSERT_EQ(NodeType::EXPRESSION, update->expr_->node_type_);
+  Expression *expr = reinterpret_cast<Expression*>(update->expr_);
+  EXPECT_EQ(NodeType::INT_ATOM, expr->right_->node_type_);
+}
+
+TEST_F(ConstantFoldingTest, propagate_static_functions) {
+  RuleNode *rule = fold("function (static) a : -> Int initially { 2 }\n"
+                        "function (static) t : Int -> Int initially { 1 -> 10, 2 -> 20 }\n"
+                        "function x : -> Int\n"
+                        "init main\n"
+                        "rule main = \n"
+                        "    x := t(a) + t(3)\n");
+
+  // t(3) has no initializer and is undef, so is the sum
+  UpdateNode *update = reinterpret_cast<UpdateNode*>(rule->child_);
+  EXPECT_EQ(NodeType::UNDEF_ATOM, update->expr_->node_type_);
+}
+
+TEST_F(ConstantFoldingTest, propagate_functions_without_updates) {
+  RuleNode *rule = fold("function a : -> Int initially { 2 }\n"
+                        "function b : -> Int initially { 3 }\n"
+                        "function x : -> Int\n"
+                        "init main\n"
+                        "rule main = {\n"
+                        "    x := a * b\n"
+                        "    b := 4\n"
+                        "}\n");
+
+  // b is updated by main and must be read at runtime
+  UnaryNode *block = reinterpret_cast<UnaryNode*>(rule->child_);
+  AstListNode *stmts = reinterpret_cast<AstListNode*>(block->child_);
+  UpdateNode *update = reinterpret_cast<UpdateNode*>(stmts->nodes.front());
+  ASSERT_EQ(NodeType::EXPRESSION, update->expr_->node_type_);
+  Expression *expr = reinterpret_cast<Expression*>(update->expr_);
+  ASSERT_EQ(NodeType::INT_ATOM, expr->left_->node_type_);
+  EXPECT_EQ(2, reinterpret_cast<IntAtom*>(expr->left_)->val_);
+  EXPECT_EQ(NodeType::FUNCTION_ATOM, expr->right_->node_type_);
+}
+
+TEST_F(ConstantFoldingTest, fold_forall_bound) {
+  RuleNode *rule = fold("function (static) n : -> Int initially { 4 }\n"
+                        "function x : Int -> Int\n"
+                        "init main\n"
+                        "rule main = \n"
+                        "    forall i in n * 2 do x(i) := i\n");
+
+  ForallNode *node = reinterpret_cast<ForallNode*>(rule->child_);
+  ASSERT_EQ(NodeType::INT_ATOM, node->in_expr->node_type_);
+  EXPECT_EQ(8, reinterpret_cast<IntAtom*>(node->in_expr)->val_);
+}
+
+TEST_F(ConstantFoldingTest, fold_case_labels) {
+  RuleNode *rule = fold("function (static) one : -> Int initially { 1 }\n"
+                        "function x : -> Int\n"
+                        "init main\n"
+                        "rule main = \n"
+                        "    case x of\n"
+                        "      one: x := 2\n"
+                        "      default: x := 1\n"
+                        "    endcase\n");
+
+  CaseNode *node = reinterpret_cast<CaseNode*>(rule->child_);
+  ASSERT_EQ(NodeType::INT_ATOM, node->case_list[0].first->node_type_);
+  EXPECT_EQ(1, reinterpret_cast<IntAtom*>(node->case_list[0].first)->val_);
+  EXPECT_EQ(nullptr, node->case_list[1].first);
+}
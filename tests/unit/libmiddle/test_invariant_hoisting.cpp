@@ -0,0 +1,99 @@
+// gtest macros raise -Wsign-compare
+#pragma GCC diagnostic ignored "-Wsign-compare"
+
+#include <string>
+
+#include "specification_test.h"
+
+#include "libmiddle/invariant_hoisting.h"
+
+class InvariantHoistingTest: public SpecificationTest {
+  protected:
+    RuleNode *hoist(const std::string& spec) {
+      parse_and_specialize(spec);
+
+      hoisting_.hoist_specification(root_);
+      return driver_.get_init_rule();
+    }
+
+    InvariantHoisting hoisting_;
+};
+
+TEST_F(InvariantHoistingTest, hoist_read_out_of_forall) {
+  RuleNode *rule = hoist("function x : Int -> Int\n"
+                         "function y : -> Int\n"
+                         "init main\n"
+                         "rule main = \n"
+                         "    forall i in [1..3] do x(i) := y + i\n");
+
+  ASSERT_EQ(NodeType::LET, rule->child_->node_type_);
+  LetNode *let = reinterpret_cast<LetNode*>(rule->child_);
+  EXPECT_EQ(0, let->offset);
+  ASSERT_EQ(NodeType::FUNCTION_ATOM, let->expr->node_type_);
+  EXPECT_EQ("y", reinterpret_cast<FunctionAtom*>(let->expr)->name);
+
+  // the binding of the loop moves behind the hoisted value
+  ASSERT_EQ(NodeType::FORALL, let->stmt->node_type_);
+  ForallNode *forall = reinterpret_cast<ForallNode*>(let->stmt);
+  EXPECT_EQ(1, forall->offset);
+  UpdateNode *update = reinterpret_cast<UpdateNode*>(forall->statement);
+  Expression *expr = reinterpret_cast<Expression*>(update->expr_);
+  FunctionAtom *value = reinterpret_cast<FunctionAtom*>(expr->left_);
+  FunctionAtom *binding = reinterpret_cast<FunctionAtom*>(expr->right_);
+  EXPECT_EQ(FunctionAtom::SymbolType::PARAMETER, value->symbol_type);
+  EXPECT_EQ(0, value->offset);
+  EXPECT_EQ(TypeType::INT, value->type_.t);
+  EXPECT_EQ(1, binding->offset);
+  EXPECT_EQ(1, hoisting_.num_hoisted);
+}
+
+TEST_F(InvariantHoistingTest, equal_expressions_share_a_binding) {
+  RuleNode *rule = hoist("function x : Int -> Int\n"
+                         "function y : -> Int\n"
+                         "init main\n"
+                         "rule main = \n"
+                         "    forall i in [1..3] do x(i + y * 2) := y * 2\n");
+
+  ASSERT_EQ(NodeType::LET, rule->child_->node_type_);
+  LetNode *let = reinterpret_cast<LetNode*>(rule->child_);
+  EXPECT_EQ(NodeType::INT_EXPRESSION, let->expr->node_type_);
+  EXPECT_EQ(NodeType::FORALL, let->stmt->node_type_);
+  EXPECT_EQ(1, hoisting_.num_hoisted);
+}
+
+TEST_F(InvariantHoistingTest, keep_reads_of_written_functions) {
+  RuleNode *rule = hoist("function n : -> Int\n"
+                         "function c : -> Int\n"
+                         "rule inc = c := c + 1\n"
+                         "init main\n"
+                         "rule main = {\n"
+                         "    iterate if n < 3 then n := n + 1\n"
+                         "    iterate if c < 3 then call inc\n"
+                         "}\n");
+
+  AstListNode *stmts = reinterpret_cast<AstListNode*>(
+      reinterpret_cast<UnaryNode*>(rule->child_)->child_);
+  EXPECT_EQ(NodeType::ITERATE, stmts->nodes[0]->node_type_);
+  EXPECT_EQ(NodeType::ITERATE, stmts->nodes[1]->node_type_);
+  EXPECT_EQ(0, hoisting_.num_hoisted);
+}
+
+TEST_F(InvariantHoistingTest, keep_expressions_that_can_fail) {
+  RuleNode *rule = hoist("function x : Int -> Int\n"
+                         "function a : -> Int\n"
+                         "function b : -> Int\n"
+                         "init main\n"
+                         "rule main = \n"
+                         "    forall i in [1..3] do x(i) := a / b\n");
+
+  // the body may never be executed, only the reads are hoisted
+  ASSERT_EQ(NodeType::LET, rule->child_->node_type_);
+  LetNode *let = reinterpret_cast<LetNode*>(rule->child_);
+  ASSERT_EQ(NodeType::LET, let->stmt->node_type_);
+  ForallNode *forall = reinterpret_cast<ForallNode*>(
+      reinterpret_cast<LetNode*>(let->stmt)->stmt);
+  ASSERT_EQ(NodeType::FORALL, forall->node_type_);
+  UpdateNode *update = reinterpret_cast<UpdateNode*>(forall->statement);
+  EXPECT_EQ(NodeType::INT_EXPRESSION, update->expr_->node_type_);
+  EXPECT_EQ(2, hoisting_.num_hoisted);
+}
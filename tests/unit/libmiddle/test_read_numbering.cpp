@@ -0,0 +1,110 @@
+// gtest macros raise -Wsign-compare
+#pragma GCC diagnostic ignored "-Wsign-compare"
+
+#include <string>
+
+#include "specification_test.h"
+
+#include "libmiddle/read_numbering.h"
+
+class ReadNumberingTest: public SpecificationTest {
+  protected:
+    RuleNode *number(const std::string& spec) {
+      parse_and_typecheck(spec);
+
+      numbering_.number_specification(root_);
+      return driver_.get_init_rule();
+    }
+
+    // the function atom of the expression of the n-th update in a block
+    FunctionAtom *updated_value(RuleNode *rule, size_t n) {
+      AstListNode *stmts = reinterpret_cast<AstListNode*>(
+          reinterpret_cast<UnaryNode*>(rule->child_)->child_);
+      AstNode *stmt = stmts->nodes.at(n);
+      EXPECT_EQ(NodeType::UPDATE, stmt->node_type_);
+      ExpressionBase *expr = reinterpret_cast<UpdateNode*>(stmt)->expr_;
+      EXPECT_EQ(NodeType::FUNCTION_ATOM, expr->node_type_);
+      return reinterpret_cast<FunctionAtom*>(expr);
+    }
+
+    ReadNumbering numbering_;
+};
+
+TEST_F(ReadNumberingTest, reuse_reads_in_parblock) {
+  RuleNode *rule = number("function f : Int -> Int\n"
+                          "function x : -> Int\n"
+                          "function y : -> Int\n"
+                          "function z : -> Int\n"
+                          "init main\n"
+                          "rule main = {\n"
+                          "    x := f(1)\n"
+                          "    y := f(1)\n"
+                          "    z := f(2)\n"
+                          "}\n");
+
+  EXPECT_EQ(1, rule->num_read_values);
+  EXPECT_EQ(1, updated_value(rule, 0)->value_number);
+  EXPECT_FALSE(updated_value(rule, 0)->reuses_value);
+  EXPECT_EQ(1, updated_value(rule, 1)->value_number);
+  EXPECT_TRUE(updated_value(rule, 1)->reuses_value);
+  // a read without reuses needs no register
+  EXPECT_EQ(0, updated_value(rule, 2)->value_number);
+  EXPECT_EQ(1, numbering_.num_reused);
+}
+
+TEST_F(ReadNumberingTest, seqblock_ends_reads) {
+  RuleNode *rule = number("function f : Int -> Int\n"
+                          "function x : -> Int\n"
+                          "function y : -> Int\n"
+                          "init main\n"
+                          "rule main = {|\n"
+                          "    x := f(1)\n"
+                          "    y := f(1)\n"
+                          "|}\n");
+
+  EXPECT_EQ(0, rule->num_read_values);
+  EXPECT_EQ(0, updated_value(rule, 0)->value_number);
+  EXPECT_EQ(0, updated_value(rule, 1)->value_number);
+}
+
+TEST_F(ReadNumberingTest, conditional_reads_are_not_available_after) {
+  RuleNode *rule = number("function f : Int -> Int\n"
+                          "function b : -> Boolean\n"
+                          "function x : -> Int\n"
+                          "function y : -> Int\n"
+                          "init main\n"
+                          "rule main = {\n"
+                          "    if b then x := f(1)\n"
+                          "    y := f(1)\n"
+                          "}\n");
+
+  EXPECT_EQ(0, rule->num_read_values);
+  EXPECT_EQ(0, updated_value(rule, 1)->value_number);
+}
+
+TEST_F(ReadNumberingTest, bindings_do_not_outlive_let) {
+  RuleNode *rule = number("function f : Int -> Int\n"
+                          "function x : -> Int\n"
+                          "function y : -> Int\n"
+                          "init main\n"
+                          "rule main = {\n"
+                          "    let a = 1 in x := f(a)\n"
+                          "    let c = 2 in y := f(c)\n"
+                          "}\n");
+
+  // both bindings use the same slot of the frame
+  EXPECT_EQ(0, rule->num_read_values);
+}
+
+TEST_F(ReadNumberingTest, number_derived_functions) {
+  number("function f : Int -> Int\n"
+         "function x : -> Int\n"
+         "derived d(a : Int) = f(a) * f(a) + f(a + 1)\n"
+         "init main\n"
+         "rule main = x := d(1)\n");
+
+  Function *d = driver_.function_table.get_function("d");
+  ASSERT_NE(nullptr, d);
+  EXPECT_EQ(1, d->num_read_values);
+  EXPECT_EQ(1, numbering_.num_reused);
+}
@@ -0,0 +1,104 @@
+// gtest macros raise -Wsign-compare
+#pragma GCC diagnostic ignored "-Wsign-compare"
+
+#include <string>
+
+#include "specification_test.h"
+
+#include "libmiddle/update_analysis.h"
+
+class UpdateAnalysisTest: public SpecificationTest {
+  protected:
+    // returns the statements of the parallel block of the init rule
+    std::vector<AstNode*>& analyze(const std::string& spec) {
+      parse_and_specialize(spec);
+
+      analysis_.analyze_specification(root_);
+      UnaryNode *block = reinterpret_cast<UnaryNode*>(driver_.get_init_rule()->child_);
+      return reinterpret_cast<AstListNode*>(block->child_)->nodes;
+    }
+
+    static bool unchecked(AstNode *stmt) {
+      if (stmt->node_type_ == NodeType::FORALL) {
+        return reinterpret_cast<ForallNode*>(stmt)->unchecked_updates;
+      }
+      return reinterpret_cast<UnaryNode*>(stmt)->unchecked_updates;
+    }
+
+    UpdateAnalysis analysis_;
+};
+
+TEST_F(UpdateAnalysisTest, iterations_update_distinct_locations) {
+  auto& stmts = analyze("function a : Int -> Int\n"
+                        "function b : Int * Int -> Int\n"
+                        "function n : -> Int\n"
+                        "init main\n"
+                        "rule main = {|\n"
+                        "    forall i in [0..5] do a(i) := i + n\n"
+                        "    forall i in 10 do forall j in [0..i] do b(i, j - 1) := n\n"
+                        "    forall i in [0..5] do { a(i + 1) := 1 b(i, 1) := 2 }\n"
+                        "|}\n");
+
+  EXPECT_TRUE(unchecked(stmts[0]));
+  EXPECT_TRUE(unchecked(stmts[1]));
+  EXPECT_TRUE(unchecked(reinterpret_cast<ForallNode*>(stmts[1])->statement));
+  EXPECT_TRUE(unchecked(stmts[2]));
+  EXPECT_TRUE(unchecked(reinterpret_cast<ForallNode*>(stmts[2])->statement));
+}
+
+TEST_F(UpdateAnalysisTest, iterations_may_conflict) {
+  auto& stmts = analyze("function a : Int -> Int\n"
+                        "function b : Int * Int -> Int\n"
+                        "init main\n"
+                        "rule main = {|\n"
+                        "    forall i in [0..5] do a(1) := i\n"
+                        "    forall i in [1, 1] do a(i) := 1\n"
+                        "    forall i in [0..5] do { a(i) := 1 a(i + 1) := 2 }\n"
+                        "    forall i in [0..5] do forall j in [0..5] do b(i, 1) := j\n"
+                        "|}\n");
+
+  for (AstNode *stmt : stmts) {
+    EXPECT_FALSE(unchecked(stmt));
+  }
+}
+
+TEST_F(UpdateAnalysisTest, parallel_blocks) {
+  auto& stmts = analyze("function a : Int -> Int\n"
+                        "function b : -> Int\n"
+                        "function c : -> Int\n"
+                        "function n : -> Int\n"
+                        "rule inc_b = b := 1\n"
+                        "init main\n"
+                        "rule main = {|\n"
+                        "    { a(1) := n  a(2) := n  b := 3 }\n"
+                        "    { a(1) := 1  a(n) := 2 }\n"
+                        "    { b := 1  call inc_b }\n"
+                        "    { c := 1  call inc_b }\n"
+                        "    { c := 1  call (@inc_b) }\n"
+                        "|}\n");
+
+  EXPECT_TRUE(unchecked(stmts[0]));
+  EXPECT_FALSE(unchecked(stmts[1]));
+  EXPECT_FALSE(unchecked(stmts[2]));
+  EXPECT_TRUE(unchecked(stmts[3]));
+  EXPECT_FALSE(unchecked(stmts[4]));
+}
+
+TEST_F(UpdateAnalysisTest, blocks_reading_their_updates_are_checked) {
+  auto& stmts = analyze("function a : Int -> Int\n"
+                        "function b : -> Int\n"
+                        "function c : -> Int\n"
+                        "derived d(x : Int) = e(x) + 1\n"
+                        "derived e(x : Int) = a(x)\n"
+                        "init main\n"
+                        "rule main = {|\n"
+                        "    forall i in [0..5] do a(i) := a(i) + 1\n"
+                        "    forall i in [0..5] do a(i) := d(i)\n"
+                        "    { b := c  c := b }\n"
+                        "|}\n");
+
+  for (AstNode *stmt : stmts) {
+    EXPECT_FALSE(unchecked(stmt));
+  }
+  EXPECT_EQ(0, analysis_.num_unchecked);
+}
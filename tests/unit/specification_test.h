@@ -0,0 +1,51 @@
+#ifndef CASMI_TESTS_UNIT_SPECIFICATION_TEST
+#define CASMI_TESTS_UNIT_SPECIFICATION_TEST
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "libsyntax/driver.h"
+#include "libmiddle/typecheck_visitor.h"
+#include "libmiddle/specialization_visitor.h"
+
+extern Driver *global_driver;
+
+// Fixture for tests of the passes that run on a typechecked specification.
+// The specification is parsed from a string and freed after the test.
+class SpecificationTest: public ::testing::Test {
+  protected:
+    virtual void SetUp() { global_driver = &driver_; }
+
+    virtual void TearDown() {
+      if (root_) {
+        delete root_;
+      }
+    }
+
+    AstNode *parse_and_typecheck(const std::string& spec) {
+      root_ = driver_.parse(spec);
+      EXPECT_NE(nullptr, root_);
+
+      TypecheckVisitor typecheck_visitor(driver_);
+      AstWalker<TypecheckVisitor, Type*> typecheck_walker(typecheck_visitor);
+      typecheck_walker.walk_specification(root_);
+      EXPECT_TRUE(driver_.ok());
+      return root_;
+    }
+
+    // the passes after constant folding expect specialized nodes
+    AstNode *parse_and_specialize(const std::string& spec) {
+      parse_and_typecheck(spec);
+
+      SpecializationVisitor specialization_visitor;
+      AstWalker<SpecializationVisitor, bool> specialization_walker(specialization_visitor);
+      specialization_walker.walk_specification(root_);
+      return root_;
+    }
+
+    StringDriver driver_;
+    AstNode *root_ = nullptr;
+};
+
+#endif